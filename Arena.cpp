@@ -0,0 +1,72 @@
+#include "Arena.h"
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+static const size_t FIRST_BLOCK_BYTES = 64 * 1024;
+static const size_t MAX_BLOCK_BYTES = 4 * 1024 * 1024;
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Blocks double in size up to MAX_BLOCK_BYTES; oversized requests get a block of their own
+static ArenaBlock* addBlock(Arena& arena, size_t minBytes) {
+    if (arena.nextBlockSize == 0) arena.nextBlockSize = FIRST_BLOCK_BYTES;
+    size_t capacity = arena.nextBlockSize;
+    if (capacity < minBytes) capacity = minBytes;
+    if (arena.nextBlockSize < MAX_BLOCK_BYTES) arena.nextBlockSize *= 2;
+
+    size_t headerBytes = alignUp(sizeof(ArenaBlock), alignof(max_align_t));
+    ArenaBlock* block = (ArenaBlock*)malloc(headerBytes + capacity);
+    if (!block) throw bad_alloc();
+    block->next = arena.head;
+    block->capacity = capacity;
+    block->used = 0;
+    arena.head = block;
+    arena.bytesReserved += capacity;
+    arena.blockCount++;
+    return block;
+}
+
+static char* blockData(ArenaBlock* block) {
+    return (char*)block + alignUp(sizeof(ArenaBlock), alignof(max_align_t));
+}
+
+void* arenaAllocate(Arena& arena, size_t bytes, size_t alignment) {
+    ArenaBlock* block = arena.head;
+    size_t offset = block ? alignUp(block->used, alignment) : 0;
+    if (!block || offset + bytes > block->capacity) {
+        block = addBlock(arena, bytes + alignment);
+        offset = 0;
+    }
+    block->used = offset + bytes;
+    arena.bytesUsed += bytes;
+    arena.allocationCount++;
+    return blockData(block) + offset;
+}
+
+const char* arenaCopyString(Arena& arena, const char* text, int length) {
+    char* copy = (char*)arenaAllocate(arena, (size_t)length + 1, 1);
+    memcpy(copy, text, (size_t)length);
+    copy[length] = '\0';
+    return copy;
+}
+
+void releaseArena(Arena& arena) {
+    ArenaBlock* block = arena.head;
+    while (block) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena = Arena();
+}
+
+void printArenaReport(const Arena& arena, const char* label) {
+    cout << label << ": " << arena.allocationCount << " allocations, "
+         << arena.bytesUsed / 1024.0 << " KB used of " << arena.bytesReserved / 1024.0
+         << " KB reserved in " << arena.blockCount << " block(s)." << endl;
+}
@@ -0,0 +1,44 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+
+using namespace std;
+
+// Header of one contiguous chunk of arena memory; the bytes follow it
+struct ArenaBlock {
+    ArenaBlock* next;
+    size_t capacity;
+    size_t used;
+};
+
+// Bump allocator for data that lives exactly as long as its owner.
+// Nothing is freed individually: releaseArena drops every block at once,
+// so only trivially destructible objects may be placed in it.
+struct Arena {
+    ArenaBlock* head;
+    size_t nextBlockSize;
+    long long allocationCount;
+    size_t bytesUsed;
+    size_t bytesReserved;
+    int blockCount;
+
+    Arena() : head(nullptr), nextBlockSize(0), allocationCount(0), bytesUsed(0), bytesReserved(0), blockCount(0) {}
+};
+
+void* arenaAllocate(Arena& arena, size_t bytes, size_t alignment);
+
+// Copies length chars plus a terminating NUL into the arena
+const char* arenaCopyString(Arena& arena, const char* text, int length);
+
+template <typename T>
+T* arenaNew(Arena& arena) {
+    return new (arenaAllocate(arena, sizeof(T), alignof(T))) T();
+}
+
+void releaseArena(Arena& arena);
+
+void printArenaReport(const Arena& arena, const char* label);
+
+#endif
@@ -0,0 +1,314 @@
+#include "BidirectionalSearch.h"
+#include <limits.h>
+
+using namespace std;
+
+// Minutes a ship spends in port between two legs
+const int LAYOVER_MINUTES = 60;
+
+// Starts a query on one side of the workspace: no port holds a label
+static void beginSide(SearchSide& side, int portCapacity) {
+    nextGeneration(side.generation, side.stamp, portCapacity);
+    side.labelCount = 0;
+    emptySearchHeap(side.open);
+    side.counters = HeapCounters();
+}
+
+// The first label port holds this query, or -1
+static int firstLabel(const SearchSide& side, int port) {
+    return side.stamp[port] == side.generation ? side.head[port] : -1;
+}
+
+// a is at least as good as b on every count: value, legs and time (an
+// earlier arrival forward, a later departure backward)
+static bool dominates(const SearchSide& side, const BidirectionalLabel& a, const BidirectionalLabel& b) {
+    if (a.value > b.value || a.legCount > b.legCount) return false;
+    return side.backward ? a.minutes >= b.minutes : a.minutes <= b.minutes;
+}
+
+// Adds label to its port unless a label there dominates it, and retires
+// the ones it dominates. Every label left at a port is the only way to
+// some combination of value, legs and time, so none can be given up
+// without perhaps losing a layover or the leg limit.
+static void offerLabel(SearchSide& side, const BidirectionalLabel& label, SearchWorkspace& ws) {
+    // last is the final label kept in the chain, -1 while there is none
+    int last = -1;
+    if (side.stamp[label.port] == side.generation) {
+        for (int l = side.head[label.port]; l >= 0; l = side.labels[l].nextAtPort) {
+            BidirectionalLabel& held = side.labels[l];
+            if (dominates(side, held, label)) return;
+            if (dominates(side, label, held)) {
+                held.alive = false;
+                if (last >= 0) {
+                    side.labels[last].nextAtPort = held.nextAtPort;
+                } else {
+                    side.head[label.port] = held.nextAtPort;
+                }
+            } else {
+                last = l;
+            }
+        }
+    }
+
+    if (side.labelCount >= side.labelCapacity) {
+        growWorkspaceArray(ws, side.labels, side.labelCapacity, side.labelCount);
+    }
+    int idx = side.labelCount++;
+    BidirectionalLabel& added = side.labels[idx];
+    added = label;
+    added.alive = true;
+    added.nextAtPort = -1;
+    if (last >= 0) {
+        side.labels[last].nextAtPort = idx;
+    } else {
+        side.head[label.port] = idx;
+        side.stamp[label.port] = side.generation;
+    }
+
+    SideEntry entry;
+    entry.value = label.value;
+    entry.label = idx;
+    if (side.open.size >= side.open.capacity) {
+        growWorkspaceArray(ws, side.open.items, side.open.capacity, side.open.size);
+    }
+    pushSearchHeap(side.open, entry);
+    side.counters.pushes++;
+    if (side.open.size > side.counters.peakSize) side.counters.peakSize = side.open.size;
+}
+
+// Pops the queued labels that were retired after being queued, so the top
+// of open is live (or open is empty)
+static void skipRetired(SearchSide& side) {
+    SideEntry top;
+    while (side.open.size > 0 && !side.labels[side.open.items[0].label].alive) {
+        popSearchHeap(side.open, top);
+        side.counters.pops++;
+        side.counters.stalePops++;
+    }
+}
+
+// Best path found so far: forward label, the sailing joining it to the
+// backward label (-1 if both labels sit on the same port), backward label
+struct Meeting {
+    int value;
+    int forwardLabel;
+    int edge;
+    int backwardLabel;
+
+    Meeting() : value(INT_MAX), forwardLabel(-1), edge(-1), backwardLabel(-1) {}
+};
+
+// Sailing e from a forward label to a backward label, if its times and the
+// leg count allow it and it beats the best meeting
+static void tryMeeting(const SearchSide& forward, int f, const SearchSide& backward, int b, const Sailing& s, int e, int weight, int maxLegs, Meeting& best) {
+    const BidirectionalLabel& fl = forward.labels[f];
+    const BidirectionalLabel& bl = backward.labels[b];
+    if (s.departure < fl.minutes + LAYOVER_MINUTES) return;
+    if (bl.parent >= 0 && sailingArrival(s) + LAYOVER_MINUTES > bl.minutes) return;
+    if (fl.legCount + 1 + bl.legCount > maxLegs) return;
+    int value = fl.value + weight + bl.value;
+    if (value < best.value) {
+        best.value = value;
+        best.forwardLabel = f;
+        best.edge = e;
+        best.backwardLabel = b;
+    }
+}
+
+template <typename Metric, typename Filter>
+static void expandForward(const FrozenGraph& fg, SearchSide& forward, const SearchSide& backward, int labelIdx,
+                          int maxLegs, const Filter& filter, Meeting& best, SearchWorkspace& ws, ShortestPathResult& result) {
+    BidirectionalLabel label = forward.labels[labelIdx];
+    if (label.legCount >= maxLegs) return;
+
+    const int edgeEnd = fg.firstEdge[label.port + 1];
+    for (int e = firstDepartureFrom(fg, label.port, label.minutes + LAYOVER_MINUTES); e < edgeEnd; e++) {
+        const Sailing& s = fg.edges[e];
+        if (!filter.allows(label.port, s)) continue;
+        int next = s.destinationId;
+        int weight = Metric::weight(s);
+        traceEdge(result.trace, label.port, next);
+
+        for (int b = firstLabel(backward, next); b >= 0; b = backward.labels[b].nextAtPort) {
+            tryMeeting(forward, labelIdx, backward, b, s, e, weight, maxLegs, best);
+        }
+
+        BidirectionalLabel grown;
+        grown.port = next;
+        grown.value = label.value + weight;
+        grown.legCount = label.legCount + 1;
+        grown.minutes = sailingArrival(s);
+        grown.parent = labelIdx;
+        grown.edge = e;
+        offerLabel(forward, grown, ws);
+    }
+}
+
+template <typename Metric, typename Filter>
+static void expandBackward(const FrozenGraph& fg, const SearchSide& forward, SearchSide& backward, int labelIdx,
+                           int maxLegs, const Filter& filter, Meeting& best, SearchWorkspace& ws, ShortestPathResult& result) {
+    BidirectionalLabel label = backward.labels[labelIdx];
+    if (label.legCount >= maxLegs) return;
+
+    // The destination takes any arrival; elsewhere the ship must be in
+    // port a layover before the label's departure
+    int latestArrival = label.parent >= 0 ? label.minutes - LAYOVER_MINUTES : INT_MAX;
+    int end = lastArrivalInto(fg, label.port, latestArrival);
+    for (int k = fg.firstIncoming[label.port]; k < end; k++) {
+        int e = fg.incomingEdge[k];
+        int prev = fg.incomingFrom[k];
+        const Sailing& s = fg.edges[e];
+        if (s.departure < SEARCH_START_MINUTES + LAYOVER_MINUTES) continue;
+        if (!filter.allows(prev, s)) continue;
+        int weight = Metric::weight(s);
+        traceEdge(result.trace, prev, label.port);
+
+        for (int f = firstLabel(forward, prev); f >= 0; f = forward.labels[f].nextAtPort) {
+            tryMeeting(forward, f, backward, labelIdx, s, e, weight, maxLegs, best);
+        }
+
+        BidirectionalLabel grown;
+        grown.port = prev;
+        grown.value = label.value + weight;
+        grown.legCount = label.legCount + 1;
+        grown.minutes = s.departure;
+        grown.parent = labelIdx;
+        grown.edge = e;
+        offerLabel(backward, grown, ws);
+    }
+}
+
+static void addCounters(HeapCounters& total, const HeapCounters& side) {
+    total.pushes += side.pushes;
+    total.pops += side.pops;
+    total.stalePops += side.stalePops;
+    total.peakSize += side.peakSize;
+}
+
+template <typename Metric, typename Filter>
+static void runBidirectional(Graph& g, const FrozenGraph& fg, const string& originPort, int originIdx, int destIdx,
+                             int maxLegs, const Filter& filter, SearchWorkspace& ws, ShortestPathResult& result) {
+    result.found = false;
+    result.totalCost = 0;
+    result.nodesExpanded = 0;
+    resetSearchTrace(result.trace);
+    result.heapCounters = HeapCounters();
+    clearJourney(result.journey);
+    initJourney(result.journey);
+
+    int portCount = fg.portCount;
+    if (originIdx < 0 || destIdx < 0 || originIdx >= portCount || destIdx >= portCount) return;
+
+    SearchSide& forward = ws.forward;
+    SearchSide& backward = ws.backward;
+    beginSide(forward, ws.portCapacity);
+    beginSide(backward, ws.portCapacity);
+
+    BidirectionalLabel root;
+    root.port = originIdx;
+    root.value = 0;
+    root.legCount = 0;
+    root.minutes = SEARCH_START_MINUTES;
+    root.parent = -1;
+    root.edge = -1;
+    offerLabel(forward, root, ws);
+    root.port = destIdx;
+    root.minutes = INT_MAX;
+    offerLabel(backward, root, ws);
+
+    Meeting best;
+    if (originIdx == destIdx) {
+        best.value = 0;
+        best.forwardLabel = 0;
+        best.backwardLabel = 0;
+    }
+
+    // Grow whichever side has the smaller frontier value. Every label a
+    // side gives up is dominated by one it keeps, so a path through the
+    // former can take the latter instead, for no more value. Once the two
+    // smallest queued values add up to the best join, no join left can
+    // beat it; and a side that ran dry has tried every join there is.
+    while (true) {
+        skipRetired(forward);
+        skipRetired(backward);
+        if (forward.open.size == 0 || backward.open.size == 0) break;
+        if ((long long)forward.open.items[0].value + backward.open.items[0].value >= best.value) break;
+
+        bool growForward = forward.open.items[0].value <= backward.open.items[0].value;
+        SearchSide& side = growForward ? forward : backward;
+        SideEntry top = side.open.items[0];
+        popSearchHeap(side.open, top);
+        side.counters.pops++;
+        result.nodesExpanded++;
+        if (growForward) {
+            expandForward<Metric>(fg, forward, backward, top.label, maxLegs, filter, best, ws, result);
+        } else {
+            expandBackward<Metric>(fg, forward, backward, top.label, maxLegs, filter, best, ws, result);
+        }
+    }
+
+    if (best.forwardLabel >= 0) {
+        result.found = true;
+
+        int pathLen = forward.labels[best.forwardLabel].legCount + 1 + backward.labels[best.backwardLabel].legCount;
+        int* pathEdges = workspacePath(ws, pathLen);
+        int n = 0;
+        for (int l = best.forwardLabel; forward.labels[l].parent >= 0; l = forward.labels[l].parent) {
+            pathEdges[n++] = forward.labels[l].edge;
+        }
+        for (int i = 0, j = n - 1; i < j; i++, j--) {
+            int swap = pathEdges[i];
+            pathEdges[i] = pathEdges[j];
+            pathEdges[j] = swap;
+        }
+        if (best.edge >= 0) {
+            pathEdges[n++] = best.edge;
+        }
+        for (int l = best.backwardLabel; backward.labels[l].parent >= 0; l = backward.labels[l].parent) {
+            pathEdges[n++] = backward.labels[l].edge;
+        }
+
+        string fromPort = originPort;
+        for (int i = 0; i < n; i++) {
+            Route* r = getRouteView(g, fg, pathEdges[i]);
+            result.totalCost += r->voyageCost;
+            appendLeg(result.journey,
+                fromPort,
+                r->destinationPort,
+                r->voyageDate,
+                r->departureTime,
+                r->arrivalTime,
+                r->voyageCost,
+                r->shippingCompany);
+            fromPort = r->destinationPort;
+        }
+    }
+
+    addCounters(result.heapCounters, forward.counters);
+    addCounters(result.heapCounters, backward.counters);
+}
+
+template <typename Metric>
+static void searchBidirectional(Graph& g, const string& originPort, const string& destPort, ShortestPathResult& result, int maxLegs, const RoutePreferences* prefs, SearchWorkspace* workspace) {
+    int originIdx = findPortId(g, originPort);
+    int destIdx = findPortId(g, destPort);
+
+    FrozenGraphPin pin(g);
+    SearchWorkspace& ws = chooseWorkspace(workspace);
+    prepareSearchWorkspace(ws, g);
+    if (preferencesFilterSailings(prefs)) {
+        PreferenceFilter filter(g, *prefs, ws);
+        runBidirectional<Metric>(g, *pin.fg, originPort, originIdx, destIdx, maxLegs, filter, ws, result);
+        return;
+    }
+    AcceptAllSailings acceptAll;
+    runBidirectional<Metric>(g, *pin.fg, originPort, originIdx, destIdx, maxLegs, acceptAll, ws, result);
+}
+
+void findCheapestRouteBidirectional(Graph& g, const string& originPort, const string& destPort, ShortestPathResult& result, int maxLegs, const RoutePreferences* prefs, SearchWorkspace* workspace) {
+    searchBidirectional<FareMetric>(g, originPort, destPort, result, maxLegs, prefs, workspace);
+}
+
+void findFastestRouteBidirectional(Graph& g, const string& originPort, const string& destPort, ShortestPathResult& result, int maxLegs, const RoutePreferences* prefs, SearchWorkspace* workspace) {
+    searchBidirectional<DurationMetric>(g, originPort, destPort, result, maxLegs, prefs, workspace);
+}
@@ -0,0 +1,31 @@
+#ifndef BIDIRECTIONAL_SEARCH_H
+#define BIDIRECTIONAL_SEARCH_H
+
+#include <string>
+#include "Graph.h"
+#include "ShortestPath.h"
+#include "RoutePreferences.h"
+
+using namespace std;
+
+// The same queries as findCheapestRouteIgnoringDates and
+// findFastestRouteIgnoringDates, searched from both ends at once. The
+// forward search labels ports with arrivals, the backward search (over
+// the version's reverse index) with the latest departure from a port that
+// still reaches destPort, and a sailing joins the two when it leaves 60
+// minutes after the forward arrival and lands 60 minutes before the
+// backward departure. Joins never exceed maxLegs legs in total, and prefs
+// applies to both sides. nodesExpanded counts the labels expanded by
+// either search. Both sides run in workspace (or the calling thread's own).
+//
+// Each port keeps every label on its side that no other label there
+// matches on value, legs and time, so a layover or the leg limit never
+// loses a route to a cheaper label that cannot make it. The searches stop
+// once their smallest queued values add up to the best join, and the
+// route found is the best one there is. The one-directional search keeps
+// one label per port, so it can return a dearer route, or none.
+void findCheapestRouteBidirectional(Graph& g, const string& originPort, const string& destPort, ShortestPathResult& result, int maxLegs = 15, const RoutePreferences* prefs = nullptr, SearchWorkspace* workspace = nullptr);
+
+void findFastestRouteBidirectional(Graph& g, const string& originPort, const string& destPort, ShortestPathResult& result, int maxLegs = 15, const RoutePreferences* prefs = nullptr, SearchWorkspace* workspace = nullptr);
+
+#endif
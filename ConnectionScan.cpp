@@ -0,0 +1,253 @@
+#include "ConnectionScan.h"
+#include "SearchKernel.h"
+#include <algorithm>
+#include <limits.h>
+
+using namespace std;
+
+static const int MIN_LAYOVER_MINUTES = 60;
+
+static bool connectionBefore(const Connection& a, const Connection& b) {
+    if (a.departure != b.departure) return a.departure < b.departure;
+    return a.edge < b.edge;
+}
+
+static bool departsBeforeMinute(const Connection& c, int minutes) {
+    return c.departure < minutes;
+}
+
+void freeConnectionScan(ConnectionScan& cs) {
+    releaseFrozenGraph(cs.fg);
+    delete[] cs.connections;
+    cs.fg = nullptr;
+    cs.connections = nullptr;
+    cs.connectionCount = 0;
+}
+
+// Rebuilds the array if a newer version has been published since
+static void refreshConnectionScan(Graph& g, ConnectionScan& cs) {
+    const FrozenGraph* current = acquireFrozenGraph(g);
+    if (current == cs.fg) {
+        releaseFrozenGraph(current);
+        return;
+    }
+    freeConnectionScan(cs);
+    cs.fg = current;
+
+    const FrozenGraph& fg = *current;
+    cs.connections = new Connection[fg.edgeCount > 0 ? fg.edgeCount : 1];
+    cs.connectionCount = fg.edgeCount;
+    for (int port = 0; port < fg.portCount; port++) {
+        for (int e = fg.firstEdge[port]; e < fg.firstEdge[port + 1]; e++) {
+            Connection& c = cs.connections[e];
+            c.departure = fg.edges[e].departure;
+            c.arrival = sailingArrival(fg.edges[e]);
+            c.originId = port;
+            c.destinationId = fg.edges[e].destinationId;
+            c.voyageCost = fg.edges[e].voyageCost;
+            c.edge = e;
+        }
+    }
+    sort(cs.connections, cs.connections + cs.connectionCount, connectionBefore);
+}
+
+static int firstConnectionFrom(const ConnectionScan& cs, int minutes) {
+    return (int)(lower_bound(cs.connections, cs.connections + cs.connectionCount, minutes, departsBeforeMinute) - cs.connections);
+}
+
+static void resetResult(ShortestPathResult& result) {
+    result.found = false;
+    result.totalCost = 0;
+    result.nodesExpanded = 0;
+    resetSearchTrace(result.trace);
+    result.heapCounters = HeapCounters();
+    result.arrivalMinutes = 0;
+    clearJourney(result.journey);
+    initJourney(result.journey);
+}
+
+// Appends the legs, given as edges of cs.fg from last to first
+static void buildJourney(Graph& g, const ConnectionScan& cs, const string& originPort, const int* edgesReversed, int legCount, ShortestPathResult& result) {
+    string fromPort = originPort;
+    for (int i = legCount - 1; i >= 0; i--) {
+        Route* r = getRouteView(g, *cs.fg, edgesReversed[i]);
+        result.totalCost += r->voyageCost;
+        appendLeg(result.journey,
+            fromPort,
+            r->destinationPort,
+            r->voyageDate,
+            r->departureTime,
+            r->arrivalTime,
+            r->voyageCost,
+            r->shippingCompany);
+        fromPort = r->destinationPort;
+    }
+}
+
+// The arrival at p is its workspace value, and parentEdge[p] the
+// connection that brought it
+template <typename Filter>
+static void scanEarliestArrival(Graph& g, const ConnectionScan& cs, const string& originPort, int originIdx, int destIdx, int departAfter, const Filter& filter, SearchWorkspace& ws, ShortestPathResult& result) {
+    const FrozenGraph& fg = *cs.fg;
+    int portCount = fg.portCount;
+    beginWorkspaceSearch(ws);
+    setWorkspaceValue(ws, originIdx, departAfter);
+
+    // Ports only ever get earlier arrivals, and a leg can only follow one
+    // that arrived before it departs, so one pass in departure order
+    // settles every port. Scanning stops once nothing can beat destIdx.
+    for (int i = firstConnectionFrom(cs, departAfter); i < cs.connectionCount; i++) {
+        const Connection& c = cs.connections[i];
+        if (c.departure >= workspaceValue(ws, destIdx)) break;
+        result.nodesExpanded++;
+
+        int at = workspaceValue(ws, c.originId);
+        if (at == INT_MAX) continue;
+        if (c.originId != originIdx && !canConnect(at, c.departure, MIN_LAYOVER_MINUTES)) continue;
+        if (c.arrival >= workspaceValue(ws, c.destinationId)) continue;
+        if (!filter.allows(c.originId, fg.edges[c.edge])) continue;
+
+        setWorkspaceValue(ws, c.destinationId, c.arrival);
+        ws.parentEdge[c.destinationId] = i;
+        traceEdge(result.trace, c.originId, c.destinationId);
+    }
+
+    if (destIdx != originIdx && workspaceValue(ws, destIdx) != INT_MAX) {
+        result.found = true;
+        result.arrivalMinutes = workspaceValue(ws, destIdx);
+
+        int* pathEdges = workspacePath(ws, portCount);
+        int pathLen = 0;
+        for (int port = destIdx; port != originIdx; ) {
+            const Connection& c = cs.connections[ws.parentEdge[port]];
+            pathEdges[pathLen++] = c.edge;
+            port = c.originId;
+        }
+        buildJourney(g, cs, originPort, pathEdges, pathLen, result);
+    }
+}
+
+void findEarliestArrivalCSA(Graph& g, ConnectionScan& cs, const string& originPort, const string& destPort, const Date& departAfterDate, const Time& departAfterTime, ShortestPathResult& result, const RoutePreferences* prefs, SearchWorkspace* workspace) {
+    resetResult(result);
+
+    int originIdx = findPortId(g, originPort);
+    int destIdx = findPortId(g, destPort);
+    if (originIdx < 0 || destIdx < 0) return;
+
+    refreshConnectionScan(g, cs);
+    if (originIdx >= cs.fg->portCount || destIdx >= cs.fg->portCount) return;
+
+    SearchWorkspace& ws = chooseWorkspace(workspace);
+    prepareSearchWorkspace(ws, g);
+    int departAfter = toEpochMinutes(departAfterDate, departAfterTime);
+    if (preferencesFilterSailings(prefs)) {
+        PreferenceFilter filter(g, *prefs, ws);
+        scanEarliestArrival(g, cs, originPort, originIdx, destIdx, departAfter, filter, ws, result);
+        return;
+    }
+    AcceptAllSailings acceptAll;
+    scanEarliestArrival(g, cs, originPort, originIdx, destIdx, departAfter, acceptAll, ws, result);
+}
+
+// The workspace value of p is the cheapest way to be at p ready to sail
+// by the departure being scanned, and parentPort[p] the label that got
+// there; arrivals join it once their layover passes
+template <typename Filter>
+static void scanCheapestInWindow(Graph& g, const ConnectionScan& cs, const string& originPort, int originIdx, int destIdx, int start, int end, const Filter& filter, SearchWorkspace& ws, ShortestPathResult& result) {
+    const FrozenGraph& fg = *cs.fg;
+    beginWorkspaceSearch(ws);
+    setWorkspaceValue(ws, originIdx, 0);
+    ws.parentPort[originIdx] = -1;
+
+    int labelCount = 0;
+    SearchHeap<PendingLabel, PendingLabelBefore>& pending = ws.pending;
+    emptySearchHeap(pending);
+
+    int bestCost = INT_MAX;
+    int bestLabel = -1;
+
+    for (int i = firstConnectionFrom(cs, start); i < cs.connectionCount; i++) {
+        const Connection& c = cs.connections[i];
+        if (c.departure >= end) break;
+        result.nodesExpanded++;
+
+        while (pending.size > 0 && pending.items[0].readyAt <= c.departure) {
+            PendingLabel ready;
+            popSearchHeap(pending, ready);
+            if (ready.cost < workspaceValue(ws, ready.port)) {
+                setWorkspaceValue(ws, ready.port, ready.cost);
+                ws.parentPort[ready.port] = ready.label;
+            }
+        }
+
+        int atCost = workspaceValue(ws, c.originId);
+        if (atCost == INT_MAX) continue;
+        if (c.arrival >= end) continue;
+        int cost = atCost + c.voyageCost;
+        if (cost >= bestCost) continue;
+        if (c.destinationId != destIdx && cost >= workspaceValue(ws, c.destinationId)) continue;
+        if (!filter.allows(c.originId, fg.edges[c.edge])) continue;
+
+        if (labelCount >= ws.windowLabelCapacity) {
+            growWorkspaceArray(ws, ws.windowLabels, ws.windowLabelCapacity, labelCount);
+        }
+        int label = labelCount++;
+        ws.windowLabels[label].connection = i;
+        ws.windowLabels[label].parent = ws.parentPort[c.originId];
+        traceEdge(result.trace, c.originId, c.destinationId);
+
+        if (c.destinationId == destIdx) {
+            bestCost = cost;
+            bestLabel = label;
+        } else {
+            PendingLabel arrivalLabel;
+            arrivalLabel.readyAt = c.arrival + MIN_LAYOVER_MINUTES;
+            arrivalLabel.port = c.destinationId;
+            arrivalLabel.cost = cost;
+            arrivalLabel.label = label;
+            if (pending.size >= pending.capacity) ws.growths++;
+            pushSearchHeap(pending, arrivalLabel);
+        }
+    }
+
+    if (bestLabel >= 0) {
+        const WindowLabel* labels = ws.windowLabels;
+        result.found = true;
+        result.arrivalMinutes = cs.connections[labels[bestLabel].connection].arrival;
+
+        int pathLen = 0;
+        for (int l = bestLabel; l >= 0; l = labels[l].parent) {
+            pathLen++;
+        }
+        int* pathEdges = workspacePath(ws, pathLen);
+        int n = 0;
+        for (int l = bestLabel; l >= 0; l = labels[l].parent) {
+            pathEdges[n++] = cs.connections[labels[l].connection].edge;
+        }
+        buildJourney(g, cs, originPort, pathEdges, pathLen, result);
+    }
+}
+
+void findCheapestInWindowCSA(Graph& g, ConnectionScan& cs, const string& originPort, const string& destPort, const Date& windowStart, int windowDays, ShortestPathResult& result, const RoutePreferences* prefs, SearchWorkspace* workspace) {
+    resetResult(result);
+
+    int originIdx = findPortId(g, originPort);
+    int destIdx = findPortId(g, destPort);
+    if (originIdx < 0 || destIdx < 0 || windowDays <= 0) return;
+
+    refreshConnectionScan(g, cs);
+    if (originIdx >= cs.fg->portCount || destIdx >= cs.fg->portCount) return;
+
+    SearchWorkspace& ws = chooseWorkspace(workspace);
+    prepareSearchWorkspace(ws, g);
+    Time midnight = {0, 0};
+    int start = toEpochMinutes(windowStart, midnight);
+    int end = start + windowDays * MINUTES_PER_DAY;
+    if (preferencesFilterSailings(prefs)) {
+        PreferenceFilter filter(g, *prefs, ws);
+        scanCheapestInWindow(g, cs, originPort, originIdx, destIdx, start, end, filter, ws, result);
+        return;
+    }
+    AcceptAllSailings acceptAll;
+    scanCheapestInWindow(g, cs, originPort, originIdx, destIdx, start, end, acceptAll, ws, result);
+}
@@ -0,0 +1,48 @@
+#ifndef CONNECTION_SCAN_H
+#define CONNECTION_SCAN_H
+
+#include <string>
+#include <cstdint>
+#include "Graph.h"
+#include "ShortestPath.h"
+#include "RoutePreferences.h"
+
+using namespace std;
+
+// One sailing as the scan sees it; edge indexes the version's CSR edges
+struct Connection {
+    int32_t departure;
+    int32_t arrival;
+    int32_t originId;
+    int32_t destinationId;
+    int32_t voyageCost;
+    int32_t edge;
+};
+
+// Every sailing of one timetable version in a single array sorted by
+// departure. Queries stream through it once instead of expanding ports.
+// The version it was built from stays pinned, and the array is rebuilt
+// on the first query after a newer version is published.
+struct ConnectionScan {
+    const FrozenGraph* fg;
+    Connection* connections;
+    int connectionCount;
+
+    ConnectionScan() : fg(nullptr), connections(nullptr), connectionCount(0) {}
+};
+
+void freeConnectionScan(ConnectionScan& cs);
+
+// Both scans keep their labels in workspace, or in the calling thread's
+// own workspace when given none
+
+// Earliest arrival at destPort leaving originPort no earlier than
+// departAfter, with the usual 60 minute layover between legs.
+// nodesExpanded counts the connections scanned.
+void findEarliestArrivalCSA(Graph& g, ConnectionScan& cs, const string& originPort, const string& destPort, const Date& departAfterDate, const Time& departAfterTime, ShortestPathResult& result, const RoutePreferences* prefs = nullptr, SearchWorkspace* workspace = nullptr);
+
+// Cheapest itinerary leaving on or after windowStart and arriving before
+// windowStart + windowDays
+void findCheapestInWindowCSA(Graph& g, ConnectionScan& cs, const string& originPort, const string& destPort, const Date& windowStart, int windowDays, ShortestPathResult& result, const RoutePreferences* prefs = nullptr, SearchWorkspace* workspace = nullptr);
+
+#endif
@@ -0,0 +1,1037 @@
+#include "ContractionHierarchy.h"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <limits.h>
+
+using namespace std;
+
+static const char HIERARCHY_MAGIC[8] = { 'O', 'R', 'N', 'C', 'H', 'I', 'E', 'R' };
+
+// Ports a witness search may settle before giving up and keeping the
+// shortcut; estimating a priority only needs a rough count, so it stops sooner
+const int WITNESS_SETTLE_LIMIT = 500;
+const int PRIORITY_SETTLE_LIMIT = 50;
+
+// Fixed-size header; the payload is rank[n], firstUp[n + 1],
+// firstDown[n + 1], upArcs[upCount], downArcs[downCount], arcs[arcCount]
+struct HierarchyHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    int32_t portCount;
+    int32_t arcCount;
+    int32_t upCount;
+    int32_t downCount;
+    int32_t choice;
+    int32_t corePorts;
+    uint64_t networkChecksum;
+    uint64_t payloadBytes;
+};
+
+static uint64_t checksumBytes(uint64_t h, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Unpacked paths name sailings by edge index, so unlike the route matrix
+// the fingerprint covers which sailing each arc stands for
+static uint64_t checksumHierarchyInput(const PortArcs& arcs, int choice) {
+    uint64_t h = checksumPortArcs(arcs);
+    h = checksumBytes(h, &choice, sizeof(choice));
+    h = checksumBytes(h, arcs.arcEdge, sizeof(int) * arcs.arcCount);
+    return h;
+}
+
+static size_t payloadSizeFor(int portCount, int upCount, int downCount, int arcCount) {
+    return sizeof(int32_t) * ((size_t)portCount + 2 * ((size_t)portCount + 1) + upCount + downCount)
+         + sizeof(HierarchyArc) * (size_t)arcCount;
+}
+
+// An arc still in the graph being contracted; other is the far end
+struct ContractionEdge {
+    int other;
+    int weight;
+    int arc;
+};
+
+struct EdgeList {
+    ContractionEdge* items;
+    int count;
+    int capacity;
+};
+
+static void appendEdge(EdgeList& list, const ContractionEdge& edge) {
+    if (list.count >= list.capacity) {
+        int newCap = list.capacity > 0 ? list.capacity * 2 : 4;
+        ContractionEdge* grown = new ContractionEdge[newCap];
+        for (int i = 0; i < list.count; i++) {
+            grown[i] = list.items[i];
+        }
+        delete[] list.items;
+        list.items = grown;
+        list.capacity = newCap;
+    }
+    list.items[list.count++] = edge;
+}
+
+static void removeEdge(EdgeList& list, int other) {
+    for (int i = 0; i < list.count; i++) {
+        if (list.items[i].other == other) {
+            list.items[i] = list.items[--list.count];
+            return;
+        }
+    }
+}
+
+static ContractionEdge* findEdge(EdgeList& list, int other) {
+    for (int i = 0; i < list.count; i++) {
+        if (list.items[i].other == other) return &list.items[i];
+    }
+    return nullptr;
+}
+
+// The remaining graph plus everything the hierarchy has gained so far.
+// Once a port is contracted its own lists are frozen: they hold exactly
+// its arcs to and from higher-ranked ports.
+struct ContractionGraph {
+    int portCount;
+    EdgeList* out;
+    EdgeList* in;
+    bool* contracted;
+    bool* inRound;
+    int* shortcuts;
+    int* priority;
+    int* contractedNeighbors;
+    int* level;
+    int* rank;
+    HierarchyArc* arcs;
+    int arcCount;
+    int arcCapacity;
+};
+
+static int addArc(ContractionGraph& cg, int from, int to, int weight, int first, int second, int sailing) {
+    if (cg.arcCount >= cg.arcCapacity) {
+        int newCap = cg.arcCapacity > 0 ? cg.arcCapacity * 2 : 64;
+        HierarchyArc* grown = new HierarchyArc[newCap];
+        for (int i = 0; i < cg.arcCount; i++) {
+            grown[i] = cg.arcs[i];
+        }
+        delete[] cg.arcs;
+        cg.arcs = grown;
+        cg.arcCapacity = newCap;
+    }
+    HierarchyArc& a = cg.arcs[cg.arcCount];
+    a.from = from;
+    a.to = to;
+    a.weight = weight;
+    a.first = first;
+    a.second = second;
+    a.sailing = sailing;
+    return cg.arcCount++;
+}
+
+struct Shortcut {
+    int from;
+    int to;
+    int weight;
+    int first;
+    int second;
+};
+
+struct ShortcutList {
+    Shortcut* items;
+    int count;
+    int capacity;
+};
+
+static void appendShortcut(ShortcutList& list, const Shortcut& s) {
+    if (list.count >= list.capacity) {
+        int newCap = list.capacity > 0 ? list.capacity * 2 : 8;
+        Shortcut* grown = new Shortcut[newCap];
+        for (int i = 0; i < list.count; i++) {
+            grown[i] = list.items[i];
+        }
+        delete[] list.items;
+        list.items = grown;
+        list.capacity = newCap;
+    }
+    list.items[list.count++] = s;
+}
+
+// Per-thread Dijkstra arrays for witness searches
+struct WitnessSearch {
+    int* value;
+    int* touched;
+    int touchedCount;
+    int* targetOf;
+    IndexedHeap<HierarchyQueryEntry, HierarchyQueryEntryOrder> open;
+    long long searches;
+};
+
+static void initWitnessSearch(WitnessSearch& ws, int portCount) {
+    ws.value = new int[portCount];
+    ws.touched = new int[portCount];
+    ws.touchedCount = 0;
+    ws.targetOf = new int[portCount];
+    for (int i = 0; i < portCount; i++) {
+        ws.value[i] = INT_MAX;
+        ws.targetOf[i] = -1;
+    }
+    resetIndexedHeap(ws.open, portCount);
+    ws.searches = 0;
+}
+
+static void freeWitnessSearch(WitnessSearch& ws) {
+    delete[] ws.value;
+    delete[] ws.touched;
+    delete[] ws.targetOf;
+    clearIndexedHeap(ws.open);
+}
+
+// Shortest values from source up to limit, avoiding skip, contracted ports
+// and (if skipRound) every port contracted in this round. It stops early
+// once the target ports marked with targetOf == skip are all settled.
+// Values left in ws.value are lengths of real paths, so any of them can
+// serve as a witness.
+static void runWitnessSearch(const ContractionGraph& cg, WitnessSearch& ws, int source, int skip, int limit, int targets, int settleLimit, bool skipRound) {
+    for (int i = 0; i < ws.touchedCount; i++) {
+        ws.value[ws.touched[i]] = INT_MAX;
+    }
+    ws.touchedCount = 0;
+    resetIndexedHeap(ws.open, cg.portCount);
+    ws.searches++;
+
+    ws.value[source] = 0;
+    ws.touched[ws.touchedCount++] = source;
+    HierarchyQueryEntry start = { 0, source };
+    pushIndexedHeap(ws.open, start);
+
+    int settled = 0;
+    HierarchyQueryEntry current = { 0, 0 };
+    while (popIndexedHeap(ws.open, current)) {
+        if (current.value > limit || ++settled > settleLimit) break;
+        if (ws.targetOf[current.port] == skip && --targets == 0) break;
+        const EdgeList& edges = cg.out[current.port];
+        for (int i = 0; i < edges.count; i++) {
+            int v = edges.items[i].other;
+            if (v == skip || cg.contracted[v] || (skipRound && cg.inRound[v])) continue;
+            int next = current.value + edges.items[i].weight;
+            if (next >= ws.value[v]) continue;
+            if (ws.value[v] == INT_MAX) ws.touched[ws.touchedCount++] = v;
+            ws.value[v] = next;
+            HierarchyQueryEntry entry = { next, v };
+            pushIndexedHeap(ws.open, entry);
+        }
+    }
+}
+
+// Shortcuts contracting v would need: one for every in-neighbour u and
+// out-neighbour w whose path through v has no witness of the same length.
+// With out set they are collected, otherwise only counted, and counting
+// stops once more than countLimit are found.
+static int findShortcuts(const ContractionGraph& cg, WitnessSearch& ws, int v, bool skipRound, ShortcutList* out, int countLimit = INT_MAX) {
+    const EdgeList& ins = cg.in[v];
+    const EdgeList& outs = cg.out[v];
+    int maxOut = 0;
+    for (int j = 0; j < outs.count; j++) {
+        if (outs.items[j].weight > maxOut) maxOut = outs.items[j].weight;
+        ws.targetOf[outs.items[j].other] = v;
+    }
+
+    int found = 0;
+    for (int i = 0; i < ins.count && found <= countLimit; i++) {
+        int u = ins.items[i].other;
+        runWitnessSearch(cg, ws, u, v, ins.items[i].weight + maxOut, outs.count, out ? WITNESS_SETTLE_LIMIT : PRIORITY_SETTLE_LIMIT, skipRound);
+        for (int j = 0; j < outs.count; j++) {
+            int w = outs.items[j].other;
+            if (w == u) continue;
+            int through = ins.items[i].weight + outs.items[j].weight;
+            if (ws.value[w] <= through) continue;
+            found++;
+            if (out) {
+                Shortcut s = { u, w, through, ins.items[i].arc, outs.items[j].arc };
+                appendShortcut(*out, s);
+            }
+        }
+    }
+    for (int j = 0; j < outs.count; j++) {
+        ws.targetOf[outs.items[j].other] = -1;
+    }
+    return found;
+}
+
+// Past in + out shortcuts v is not contractible, and then its priority
+// is never compared, so the count stops there
+static void updatePriority(ContractionGraph& cg, WitnessSearch& ws, int v) {
+    int shortcuts = findShortcuts(cg, ws, v, false, nullptr, cg.in[v].count + cg.out[v].count);
+    cg.shortcuts[v] = shortcuts;
+    cg.priority[v] = 2 * shortcuts - 2 * (cg.in[v].count + cg.out[v].count) + cg.contractedNeighbors[v] + cg.level[v];
+}
+
+enum ContractionTask {
+    TASK_PRIORITIES,
+    TASK_SHORTCUTS
+};
+
+// What one worker thread needs; ports come from the shared counter
+struct ContractionWorker {
+    ContractionGraph* cg;
+    WitnessSearch ws;
+    const int* ports;
+    int portTotal;
+    atomic<int>* nextPort;
+    ContractionTask task;
+    ShortcutList* shortcuts;
+};
+
+static void runContractionWorker(ContractionWorker* worker) {
+    ContractionGraph& cg = *worker->cg;
+    while (true) {
+        int i = worker->nextPort->fetch_add(1);
+        if (i >= worker->portTotal) break;
+        int v = worker->ports[i];
+        if (worker->task == TASK_PRIORITIES) {
+            updatePriority(cg, worker->ws, v);
+        } else {
+            findShortcuts(cg, worker->ws, v, true, &worker->shortcuts[i]);
+        }
+    }
+}
+
+static void runContractionTask(ContractionWorker* workers, int threadCount, ContractionTask task, const int* ports, int portTotal, ShortcutList* shortcuts) {
+    atomic<int> nextPort(0);
+    for (int i = 0; i < threadCount; i++) {
+        workers[i].ports = ports;
+        workers[i].portTotal = portTotal;
+        workers[i].nextPort = &nextPort;
+        workers[i].task = task;
+        workers[i].shortcuts = shortcuts;
+    }
+
+    int used = threadCount < portTotal ? threadCount : portTotal;
+    if (used > 1) {
+        thread* threads = new thread[used - 1];
+        for (int i = 1; i < used; i++) {
+            threads[i - 1] = thread(runContractionWorker, &workers[i]);
+        }
+        runContractionWorker(&workers[0]);
+        for (int i = 0; i < used - 1; i++) {
+            threads[i].join();
+        }
+        delete[] threads;
+    } else {
+        runContractionWorker(&workers[0]);
+    }
+}
+
+// Lower priority first, port id breaking ties
+static bool contractsBefore(const ContractionGraph& cg, int a, int b) {
+    if (cg.priority[a] != cg.priority[b]) return cg.priority[a] < cg.priority[b];
+    return a < b;
+}
+
+// A port is only worth contracting while it adds no more shortcuts than
+// the arcs it takes out of the remaining graph; past that, every query
+// through it would relax more arcs than the plain core search does
+static bool isContractible(const ContractionGraph& cg, int v) {
+    return cg.shortcuts[v] <= cg.in[v].count + cg.out[v].count;
+}
+
+// Ports that are not contractible are left out of the comparison, so the
+// contractible port of lowest priority always starts a round
+static bool isLocalMinimum(const ContractionGraph& cg, int v) {
+    if (!isContractible(cg, v)) return false;
+    for (int i = 0; i < cg.out[v].count; i++) {
+        int w = cg.out[v].items[i].other;
+        if (isContractible(cg, w) && !contractsBefore(cg, v, w)) return false;
+    }
+    for (int i = 0; i < cg.in[v].count; i++) {
+        int w = cg.in[v].items[i].other;
+        if (isContractible(cg, w) && !contractsBefore(cg, v, w)) return false;
+    }
+    return true;
+}
+
+// Adds u -> w unless an arc at least as short is already there
+static void insertShortcut(ContractionGraph& cg, const Shortcut& s) {
+    ContractionEdge* existing = findEdge(cg.out[s.from], s.to);
+    if (existing && existing->weight <= s.weight) return;
+
+    int arc = addArc(cg, s.from, s.to, s.weight, s.first, s.second, -1);
+    if (existing) {
+        existing->weight = s.weight;
+        existing->arc = arc;
+        ContractionEdge* mirror = findEdge(cg.in[s.to], s.from);
+        mirror->weight = s.weight;
+        mirror->arc = arc;
+        return;
+    }
+    ContractionEdge forward = { s.to, s.weight, arc };
+    ContractionEdge backward = { s.from, s.weight, arc };
+    appendEdge(cg.out[s.from], forward);
+    appendEdge(cg.in[s.to], backward);
+}
+
+// Copies the frozen lists into the CSR arrays of ch, keeping only the arcs
+// they (and through them every shortcut) refer to
+static void packHierarchy(ContractionGraph& cg, ContractionHierarchy& ch) {
+    int portCount = cg.portCount;
+    int* remap = new int[cg.arcCount > 0 ? cg.arcCount : 1];
+    for (int a = 0; a < cg.arcCount; a++) {
+        remap[a] = -1;
+    }
+    int upCount = 0;
+    int downCount = 0;
+    for (int v = 0; v < portCount; v++) {
+        for (int i = 0; i < cg.out[v].count; i++) remap[cg.out[v].items[i].arc] = 0;
+        for (int i = 0; i < cg.in[v].count; i++) remap[cg.in[v].items[i].arc] = 0;
+        upCount += cg.out[v].count;
+        downCount += cg.in[v].count;
+    }
+    int kept = 0;
+    for (int a = 0; a < cg.arcCount; a++) {
+        if (remap[a] == 0) remap[a] = kept++;
+    }
+
+    ch.portCount = portCount;
+    ch.arcCount = kept;
+    ch.rank = new int32_t[portCount];
+    ch.firstUp = new int32_t[portCount + 1];
+    ch.firstDown = new int32_t[portCount + 1];
+    ch.upArcs = new int32_t[upCount > 0 ? upCount : 1];
+    ch.downArcs = new int32_t[downCount > 0 ? downCount : 1];
+    ch.arcs = new HierarchyArc[kept > 0 ? kept : 1];
+
+    for (int a = 0; a < cg.arcCount; a++) {
+        if (remap[a] < 0) continue;
+        HierarchyArc arc = cg.arcs[a];
+        if (arc.sailing < 0) {
+            arc.first = remap[arc.first];
+            arc.second = remap[arc.second];
+        }
+        ch.arcs[remap[a]] = arc;
+    }
+
+    int up = 0;
+    int down = 0;
+    for (int v = 0; v < portCount; v++) {
+        ch.rank[v] = cg.rank[v];
+        ch.firstUp[v] = up;
+        for (int i = 0; i < cg.out[v].count; i++) ch.upArcs[up++] = remap[cg.out[v].items[i].arc];
+        ch.firstDown[v] = down;
+        for (int i = 0; i < cg.in[v].count; i++) ch.downArcs[down++] = remap[cg.in[v].items[i].arc];
+    }
+    ch.firstUp[portCount] = up;
+    ch.firstDown[portCount] = down;
+    delete[] remap;
+}
+
+bool buildContractionHierarchy(Graph& g, ContractionHierarchy& ch, HierarchyStats& stats, PortArcChoice choice, int threadCount, const RoutePreferences* prefs) {
+    stats = HierarchyStats();
+    freeContractionHierarchy(ch);
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+
+    PortArcs portArcs;
+    unsigned long long graphVersion;
+    {
+        FrozenGraphPin pin(g);
+        buildPortArcs(g, *pin.fg, portArcs, prefs, choice);
+        graphVersion = pin.fg->version;
+    }
+    int portCount = portArcs.portCount;
+    if (portCount == 0) {
+        freePortArcs(portArcs);
+        return false;
+    }
+
+    ContractionGraph cg;
+    cg.portCount = portCount;
+    cg.out = new EdgeList[portCount];
+    cg.in = new EdgeList[portCount];
+    cg.contracted = new bool[portCount];
+    cg.inRound = new bool[portCount];
+    cg.shortcuts = new int[portCount];
+    cg.priority = new int[portCount];
+    cg.contractedNeighbors = new int[portCount];
+    cg.level = new int[portCount];
+    cg.rank = new int[portCount];
+    cg.arcs = nullptr;
+    cg.arcCount = 0;
+    cg.arcCapacity = 0;
+    for (int v = 0; v < portCount; v++) {
+        cg.out[v].items = nullptr;
+        cg.out[v].count = 0;
+        cg.out[v].capacity = 0;
+        cg.in[v] = cg.out[v];
+        cg.contracted[v] = false;
+        cg.inRound[v] = false;
+        cg.contractedNeighbors[v] = 0;
+        cg.level[v] = 0;
+        cg.rank[v] = -1;
+    }
+    for (int u = 0; u < portCount; u++) {
+        for (int a = portArcs.firstArc[u]; a < portArcs.firstArc[u + 1]; a++) {
+            int v = portArcs.arcTarget[a];
+            int weight = choice == PORT_ARCS_FASTEST ? portArcs.arcMinutes[a] : portArcs.arcCost[a];
+            int arc = addArc(cg, u, v, weight, -1, -1, portArcs.arcEdge[a]);
+            ContractionEdge forward = { v, weight, arc };
+            ContractionEdge backward = { u, weight, arc };
+            appendEdge(cg.out[u], forward);
+            appendEdge(cg.in[v], backward);
+        }
+    }
+    stats.originalArcs = cg.arcCount;
+
+    if (threadCount <= 0) {
+        threadCount = (int)thread::hardware_concurrency();
+        if (threadCount <= 0) threadCount = 1;
+    }
+    ContractionWorker* workers = new ContractionWorker[threadCount];
+    for (int i = 0; i < threadCount; i++) {
+        workers[i].cg = &cg;
+        initWitnessSearch(workers[i].ws, portCount);
+    }
+
+    int* remaining = new int[portCount];
+    int remainingCount = portCount;
+    for (int v = 0; v < portCount; v++) {
+        remaining[v] = v;
+    }
+    runContractionTask(workers, threadCount, TASK_PRIORITIES, remaining, remainingCount, nullptr);
+
+    int* round = new int[portCount];
+    int* touched = new int[portCount];
+    bool* isTouched = new bool[portCount];
+    for (int v = 0; v < portCount; v++) {
+        isTouched[v] = false;
+    }
+    ShortcutList* pending = new ShortcutList[portCount];
+    for (int v = 0; v < portCount; v++) {
+        pending[v].items = nullptr;
+        pending[v].count = 0;
+        pending[v].capacity = 0;
+    }
+
+    int nextRank = 0;
+    while (remainingCount > 0) {
+        int roundCount = 0;
+        for (int i = 0; i < remainingCount; i++) {
+            int v = remaining[i];
+            if (isLocalMinimum(cg, v)) {
+                round[roundCount++] = v;
+                cg.inRound[v] = true;
+            }
+        }
+        if (roundCount == 0) break;
+        stats.rounds++;
+
+        runContractionTask(workers, threadCount, TASK_SHORTCUTS, round, roundCount, pending);
+
+        int touchedCount = 0;
+        for (int i = 0; i < roundCount; i++) {
+            int v = round[i];
+            cg.rank[v] = nextRank++;
+            cg.contracted[v] = true;
+            cg.inRound[v] = false;
+
+            for (int k = 0; k < pending[i].count; k++) {
+                insertShortcut(cg, pending[i].items[k]);
+            }
+            pending[i].count = 0;
+
+            for (int k = 0; k < cg.out[v].count; k++) {
+                int w = cg.out[v].items[k].other;
+                removeEdge(cg.in[w], v);
+                cg.contractedNeighbors[w]++;
+                if (cg.level[w] <= cg.level[v]) cg.level[w] = cg.level[v] + 1;
+                if (!isTouched[w]) {
+                    isTouched[w] = true;
+                    touched[touchedCount++] = w;
+                }
+            }
+            for (int k = 0; k < cg.in[v].count; k++) {
+                int u = cg.in[v].items[k].other;
+                removeEdge(cg.out[u], v);
+                cg.contractedNeighbors[u]++;
+                if (cg.level[u] <= cg.level[v]) cg.level[u] = cg.level[v] + 1;
+                if (!isTouched[u]) {
+                    isTouched[u] = true;
+                    touched[touchedCount++] = u;
+                }
+            }
+        }
+
+        int kept = 0;
+        for (int i = 0; i < remainingCount; i++) {
+            if (!cg.contracted[remaining[i]]) remaining[kept++] = remaining[i];
+        }
+        remainingCount = kept;
+
+        // Ports touched by a shortcut also neighbour a contracted port, so
+        // these are the only priorities that can have changed
+        kept = 0;
+        for (int i = 0; i < touchedCount; i++) {
+            isTouched[touched[i]] = false;
+            if (!cg.contracted[touched[i]]) touched[kept++] = touched[i];
+        }
+        runContractionTask(workers, threadCount, TASK_PRIORITIES, touched, kept, nullptr);
+    }
+
+    // Whatever is left is the core: ranked above everything else in any
+    // order, with its arcs kept as they are and searched without shortcuts
+    stats.corePorts = remainingCount;
+    for (int i = 0; i < remainingCount; i++) {
+        cg.rank[remaining[i]] = nextRank++;
+    }
+
+    packHierarchy(cg, ch);
+    ch.corePorts = remainingCount;
+    ch.choice = choice;
+    ch.networkChecksum = checksumHierarchyInput(portArcs, choice);
+    ch.graphVersion = graphVersion;
+
+    stats.portCount = portCount;
+    stats.shortcuts = 0;
+    for (int a = 0; a < ch.arcCount; a++) {
+        if (ch.arcs[a].sailing < 0) stats.shortcuts++;
+    }
+    stats.threadCount = threadCount;
+    for (int i = 0; i < threadCount; i++) {
+        stats.witnessSearches += workers[i].ws.searches;
+        freeWitnessSearch(workers[i].ws);
+    }
+
+    for (int v = 0; v < portCount; v++) {
+        delete[] cg.out[v].items;
+        delete[] cg.in[v].items;
+        delete[] pending[v].items;
+    }
+    delete[] cg.out;
+    delete[] cg.in;
+    delete[] cg.contracted;
+    delete[] cg.inRound;
+    delete[] cg.shortcuts;
+    delete[] cg.priority;
+    delete[] cg.contractedNeighbors;
+    delete[] cg.level;
+    delete[] cg.rank;
+    delete[] cg.arcs;
+    delete[] workers;
+    delete[] remaining;
+    delete[] round;
+    delete[] touched;
+    delete[] isTouched;
+    delete[] pending;
+    freePortArcs(portArcs);
+
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    return true;
+}
+
+void freeContractionHierarchy(ContractionHierarchy& ch) {
+    if (ch.file.data) {
+        unmapFile(ch.file);
+    } else {
+        delete[] ch.rank;
+        delete[] ch.firstUp;
+        delete[] ch.upArcs;
+        delete[] ch.firstDown;
+        delete[] ch.downArcs;
+        delete[] ch.arcs;
+    }
+    ch.rank = nullptr;
+    ch.firstUp = nullptr;
+    ch.upArcs = nullptr;
+    ch.firstDown = nullptr;
+    ch.downArcs = nullptr;
+    ch.arcs = nullptr;
+    ch.portCount = 0;
+    ch.arcCount = 0;
+    ch.corePorts = 0;
+    ch.networkChecksum = 0;
+    ch.graphVersion = 0;
+}
+
+bool saveContractionHierarchy(const ContractionHierarchy& ch, const string& path) {
+    if (!ch.arcs) return false;
+    int n = ch.portCount;
+    int upCount = ch.firstUp[n];
+    int downCount = ch.firstDown[n];
+
+    HierarchyHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HIERARCHY_MAGIC, sizeof(HIERARCHY_MAGIC));
+    header.version = CONTRACTION_HIERARCHY_FORMAT_VERSION;
+    header.headerSize = sizeof(HierarchyHeader);
+    header.portCount = n;
+    header.arcCount = ch.arcCount;
+    header.upCount = upCount;
+    header.downCount = downCount;
+    header.choice = ch.choice;
+    header.corePorts = ch.corePorts;
+    header.networkChecksum = ch.networkChecksum;
+    header.payloadBytes = payloadSizeFor(n, upCount, downCount, ch.arcCount);
+
+    // Write next to the target and swap it in, so a crash never leaves a half-written hierarchy
+    string tempPath = path + ".tmp";
+    bool ok = false;
+    FILE* f = fopen(tempPath.c_str(), "wb");
+    if (f) {
+        ok = fwrite(&header, sizeof(header), 1, f) == 1;
+        if (ok) ok = fwrite(ch.rank, sizeof(int32_t), n, f) == (size_t)n;
+        if (ok) ok = fwrite(ch.firstUp, sizeof(int32_t), n + 1, f) == (size_t)n + 1;
+        if (ok) ok = fwrite(ch.firstDown, sizeof(int32_t), n + 1, f) == (size_t)n + 1;
+        if (ok) ok = fwrite(ch.upArcs, sizeof(int32_t), upCount, f) == (size_t)upCount;
+        if (ok) ok = fwrite(ch.downArcs, sizeof(int32_t), downCount, f) == (size_t)downCount;
+        if (ok) ok = fwrite(ch.arcs, sizeof(HierarchyArc), ch.arcCount, f) == (size_t)ch.arcCount;
+        if (fclose(f) != 0) ok = false;
+        if (ok) {
+            remove(path.c_str());
+            ok = rename(tempPath.c_str(), path.c_str()) == 0;
+        }
+        if (!ok) remove(tempPath.c_str());
+    }
+    return ok;
+}
+
+bool loadContractionHierarchy(Graph& g, ContractionHierarchy& ch, const string& path, PortArcChoice choice, const RoutePreferences* prefs) {
+    freeContractionHierarchy(ch);
+
+    MappedFile file;
+    if (!mapFileReadOnly(path, file)) return false;
+    if (file.size < sizeof(HierarchyHeader)) {
+        unmapFile(file);
+        return false;
+    }
+
+    HierarchyHeader header;
+    memcpy(&header, file.data, sizeof(header));
+    if (memcmp(header.magic, HIERARCHY_MAGIC, sizeof(HIERARCHY_MAGIC)) != 0
+        || header.version != CONTRACTION_HIERARCHY_FORMAT_VERSION || header.headerSize != sizeof(HierarchyHeader)) {
+        cout << "Contraction hierarchy ignored: format version " << header.version << ", expected " << CONTRACTION_HIERARCHY_FORMAT_VERSION << "." << endl;
+        unmapFile(file);
+        return false;
+    }
+    if (header.portCount <= 0 || header.arcCount < 0 || header.corePorts < 0 || header.corePorts > header.portCount || header.upCount < 0 || header.downCount < 0
+        || header.payloadBytes != file.size - sizeof(HierarchyHeader)
+        || header.payloadBytes != payloadSizeFor(header.portCount, header.upCount, header.downCount, header.arcCount)) {
+        cout << "Contraction hierarchy ignored: size does not match its header." << endl;
+        unmapFile(file);
+        return false;
+    }
+
+    PortArcs arcs;
+    unsigned long long graphVersion;
+    {
+        FrozenGraphPin pin(g);
+        buildPortArcs(g, *pin.fg, arcs, prefs, choice);
+        graphVersion = pin.fg->version;
+    }
+    bool current = header.choice == choice && arcs.portCount == header.portCount
+        && checksumHierarchyInput(arcs, choice) == header.networkChecksum;
+    freePortArcs(arcs);
+    if (!current) {
+        cout << "Contraction hierarchy ignored: built from a different timetable." << endl;
+        unmapFile(file);
+        return false;
+    }
+
+    int n = header.portCount;
+    const char* payload = file.data + sizeof(HierarchyHeader);
+    adviseRandomAccess(file);
+    ch.file = file;
+    ch.portCount = n;
+    ch.arcCount = header.arcCount;
+    ch.corePorts = header.corePorts;
+    ch.choice = header.choice;
+    ch.networkChecksum = header.networkChecksum;
+    ch.graphVersion = graphVersion;
+    ch.rank = (int32_t*)payload;
+    ch.firstUp = ch.rank + n;
+    ch.firstDown = ch.firstUp + n + 1;
+    ch.upArcs = ch.firstDown + n + 1;
+    ch.downArcs = ch.upArcs + header.upCount;
+    ch.arcs = (HierarchyArc*)(ch.downArcs + header.downCount);
+    return true;
+}
+
+void initHierarchyQuery(HierarchyQuery& q, int portCount) {
+    freeHierarchyQuery(q);
+    q.portCount = portCount;
+    q.forwardValue = new int[portCount > 0 ? portCount : 1];
+    q.backwardValue = new int[portCount > 0 ? portCount : 1];
+    q.forwardArc = new int[portCount > 0 ? portCount : 1];
+    q.backwardArc = new int[portCount > 0 ? portCount : 1];
+    q.touched = new int[portCount > 0 ? portCount : 1];
+    q.touchedCount = 0;
+    for (int i = 0; i < portCount; i++) {
+        q.forwardValue[i] = INT_MAX;
+        q.backwardValue[i] = INT_MAX;
+    }
+    resetIndexedHeap(q.forwardOpen, portCount);
+    resetIndexedHeap(q.backwardOpen, portCount);
+}
+
+void freeHierarchyQuery(HierarchyQuery& q) {
+    delete[] q.forwardValue;
+    delete[] q.backwardValue;
+    delete[] q.forwardArc;
+    delete[] q.backwardArc;
+    delete[] q.touched;
+    clearIndexedHeap(q.forwardOpen);
+    clearIndexedHeap(q.backwardOpen);
+    q.forwardValue = nullptr;
+    q.backwardValue = nullptr;
+    q.forwardArc = nullptr;
+    q.backwardArc = nullptr;
+    q.touched = nullptr;
+    q.touchedCount = 0;
+    q.portCount = 0;
+}
+
+static void touchPort(HierarchyQuery& q, int port) {
+    if (q.forwardValue[port] == INT_MAX && q.backwardValue[port] == INT_MAX) {
+        q.touched[q.touchedCount++] = port;
+    }
+}
+
+static bool isCorePort(const ContractionHierarchy& ch, int port) {
+    return ch.rank[port] >= ch.portCount - ch.corePorts;
+}
+
+// Lowers value[next] through arc and checks the other side for a better
+// meeting. Core ports are left off the queue while the searches still
+// climb; the core search queues them itself.
+static void relaxHierarchyArc(const ContractionHierarchy& ch, HierarchyQuery& q, bool forward, int arc, int next, int nextValue, bool queueCore, int& best, int& meeting) {
+    int* value = forward ? q.forwardValue : q.backwardValue;
+    int* otherValue = forward ? q.backwardValue : q.forwardValue;
+    if (nextValue >= value[next]) return;
+    touchPort(q, next);
+    value[next] = nextValue;
+    (forward ? q.forwardArc : q.backwardArc)[next] = arc;
+    if (otherValue[next] != INT_MAX && (long long)nextValue + otherValue[next] < best) {
+        best = nextValue + otherValue[next];
+        meeting = next;
+    }
+    if (queueCore || !isCorePort(ch, next)) {
+        HierarchyQueryEntry entry = { nextValue, next };
+        pushIndexedHeap(forward ? q.forwardOpen : q.backwardOpen, entry);
+    }
+}
+
+// Settles the top of one side below the core. A port some higher-ranked
+// port already reaches more cheaply is stalled: its value is not final,
+// so it is not relaxed any further.
+static void settleUpwardPort(const ContractionHierarchy& ch, HierarchyQuery& q, bool forward, int& best, int& meeting, int& settled) {
+    IndexedHeap<HierarchyQueryEntry, HierarchyQueryEntryOrder>& open = forward ? q.forwardOpen : q.backwardOpen;
+    const int* value = forward ? q.forwardValue : q.backwardValue;
+
+    HierarchyQueryEntry current = { 0, 0 };
+    popIndexedHeap(open, current);
+    int u = current.port;
+    settled++;
+
+    const int32_t* first = forward ? ch.firstDown : ch.firstUp;
+    const int32_t* list = forward ? ch.downArcs : ch.upArcs;
+    for (int i = first[u]; i < first[u + 1]; i++) {
+        const HierarchyArc& a = ch.arcs[list[i]];
+        int higher = forward ? a.from : a.to;
+        if (value[higher] != INT_MAX && (long long)value[higher] + a.weight < current.value) return;
+    }
+
+    first = forward ? ch.firstUp : ch.firstDown;
+    list = forward ? ch.upArcs : ch.downArcs;
+    for (int i = first[u]; i < first[u + 1]; i++) {
+        const HierarchyArc& a = ch.arcs[list[i]];
+        relaxHierarchyArc(ch, q, forward, list[i], forward ? a.to : a.from, current.value + a.weight, false, best, meeting);
+    }
+}
+
+// Settles the top of one side inside the core, where the arcs of a port
+// run to every core port it still had an arc with, so nothing is stalled
+static void settleCorePort(const ContractionHierarchy& ch, HierarchyQuery& q, bool forward, int& best, int& meeting, int& settled) {
+    HierarchyQueryEntry current = { 0, 0 };
+    popIndexedHeap(forward ? q.forwardOpen : q.backwardOpen, current);
+    int u = current.port;
+    settled++;
+
+    const int32_t* first = forward ? ch.firstUp : ch.firstDown;
+    const int32_t* list = forward ? ch.upArcs : ch.downArcs;
+    for (int i = first[u]; i < first[u + 1]; i++) {
+        const HierarchyArc& a = ch.arcs[list[i]];
+        relaxHierarchyArc(ch, q, forward, list[i], forward ? a.to : a.from, current.value + a.weight, true, best, meeting);
+    }
+}
+
+static void appendSailing(int*& items, int& count, int& capacity, int value) {
+    if (count >= capacity) {
+        int newCap = capacity > 0 ? capacity * 2 : 8;
+        int* grown = new int[newCap];
+        for (int i = 0; i < count; i++) {
+            grown[i] = items[i];
+        }
+        delete[] items;
+        items = grown;
+        capacity = newCap;
+    }
+    items[count++] = value;
+}
+
+// Replaces arc by the sailings it stands for, in travel order
+static void unpackArc(const ContractionHierarchy& ch, int arc, int*& sailings, int& count, int& capacity, int*& stack, int& stackCapacity) {
+    int depth = 0;
+    appendSailing(stack, depth, stackCapacity, arc);
+    while (depth > 0) {
+        const HierarchyArc& a = ch.arcs[stack[--depth]];
+        if (a.sailing >= 0) {
+            appendSailing(sailings, count, capacity, a.sailing);
+        } else {
+            appendSailing(stack, depth, stackCapacity, a.second);
+            appendSailing(stack, depth, stackCapacity, a.first);
+        }
+    }
+}
+
+void findRouteHierarchy(Graph& g, const ContractionHierarchy& ch, HierarchyQuery& q, const string& originPort, const string& destPort, ShortestPathResult& result) {
+    result.found = false;
+    result.totalCost = 0;
+    result.nodesExpanded = 0;
+    resetSearchTrace(result.trace);
+    result.heapCounters = HeapCounters();
+    clearJourney(result.journey);
+    initJourney(result.journey);
+
+    int origin = findPortId(g, originPort);
+    int dest = findPortId(g, destPort);
+    if (origin < 0 || dest < 0 || origin >= ch.portCount || dest >= ch.portCount) return;
+
+    FrozenGraphPin pin(g);
+    const FrozenGraph& fg = *pin.fg;
+    if (fg.version != ch.graphVersion) return;
+    if (q.portCount != ch.portCount) initHierarchyQuery(q, ch.portCount);
+
+    for (int i = 0; i < q.touchedCount; i++) {
+        q.forwardValue[q.touched[i]] = INT_MAX;
+        q.backwardValue[q.touched[i]] = INT_MAX;
+    }
+    q.touchedCount = 0;
+    resetIndexedHeap(q.forwardOpen, ch.portCount);
+    resetIndexedHeap(q.backwardOpen, ch.portCount);
+
+    touchPort(q, origin);
+    q.forwardValue[origin] = 0;
+    q.forwardArc[origin] = -1;
+    touchPort(q, dest);
+    q.backwardValue[dest] = 0;
+    q.backwardArc[dest] = -1;
+    int best = INT_MAX;
+    int meeting = -1;
+    if (origin == dest) {
+        best = 0;
+        meeting = origin;
+    }
+    HierarchyQueryEntry start = { 0, origin };
+    if (!isCorePort(ch, origin)) pushIndexedHeap(q.forwardOpen, start);
+    start.port = dest;
+    if (!isCorePort(ch, dest)) pushIndexedHeap(q.backwardOpen, start);
+
+    // Both sides climb to the core; each stops early once its smallest
+    // value reaches the best meeting
+    int settled = 0;
+    while (true) {
+        bool forwardLive = q.forwardOpen.size > 0 && q.forwardOpen.items[0].value < best;
+        bool backwardLive = q.backwardOpen.size > 0 && q.backwardOpen.items[0].value < best;
+        if (!forwardLive && !backwardLive) break;
+        bool forward = forwardLive && (!backwardLive || q.forwardOpen.items[0].value <= q.backwardOpen.items[0].value);
+        settleUpwardPort(ch, q, forward, best, meeting, settled);
+    }
+    HeapCounters counters = q.forwardOpen.counters;
+    counters.pushes += q.backwardOpen.counters.pushes;
+    counters.decreases += q.backwardOpen.counters.decreases;
+    counters.pops += q.backwardOpen.counters.pops;
+    counters.peakSize = q.forwardOpen.counters.peakSize + q.backwardOpen.counters.peakSize;
+
+    // Then a plain bidirectional search over the core, from every core
+    // port either side reached. Both now search the same arcs, so it can
+    // stop once the two smallest values together reach the best meeting.
+    if (ch.corePorts > 0) {
+        resetIndexedHeap(q.forwardOpen, ch.portCount);
+        resetIndexedHeap(q.backwardOpen, ch.portCount);
+        for (int i = 0; i < q.touchedCount; i++) {
+            int p = q.touched[i];
+            if (!isCorePort(ch, p)) continue;
+            HierarchyQueryEntry entry = { q.forwardValue[p], p };
+            if (entry.value != INT_MAX) pushIndexedHeap(q.forwardOpen, entry);
+            entry.value = q.backwardValue[p];
+            if (entry.value != INT_MAX) pushIndexedHeap(q.backwardOpen, entry);
+        }
+        while (q.forwardOpen.size > 0 && q.backwardOpen.size > 0
+               && (long long)q.forwardOpen.items[0].value + q.backwardOpen.items[0].value < best) {
+            bool forward = q.forwardOpen.items[0].value <= q.backwardOpen.items[0].value;
+            settleCorePort(ch, q, forward, best, meeting, settled);
+        }
+        counters.pushes += q.forwardOpen.counters.pushes + q.backwardOpen.counters.pushes;
+        counters.decreases += q.forwardOpen.counters.decreases + q.backwardOpen.counters.decreases;
+        counters.pops += q.forwardOpen.counters.pops + q.backwardOpen.counters.pops;
+        int corePeak = q.forwardOpen.counters.peakSize + q.backwardOpen.counters.peakSize;
+        if (corePeak > counters.peakSize) counters.peakSize = corePeak;
+    }
+    result.nodesExpanded = settled;
+    result.heapCounters = counters;
+    if (meeting < 0) return;
+
+    int* sailings = nullptr;
+    int sailingCount = 0;
+    int sailingCapacity = 0;
+    int* stack = nullptr;
+    int stackCapacity = 0;
+
+    // The forward parents run backwards from the meeting port, so collect
+    // them first and unpack in travel order
+    int* upward = nullptr;
+    int upwardCount = 0;
+    int upwardCapacity = 0;
+    for (int p = meeting; q.forwardArc[p] >= 0 && p != origin; p = ch.arcs[q.forwardArc[p]].from) {
+        appendSailing(upward, upwardCount, upwardCapacity, q.forwardArc[p]);
+    }
+    for (int i = upwardCount - 1; i >= 0; i--) {
+        unpackArc(ch, upward[i], sailings, sailingCount, sailingCapacity, stack, stackCapacity);
+    }
+    for (int p = meeting; q.backwardArc[p] >= 0 && p != dest; p = ch.arcs[q.backwardArc[p]].to) {
+        unpackArc(ch, q.backwardArc[p], sailings, sailingCount, sailingCapacity, stack, stackCapacity);
+    }
+
+    result.found = true;
+    string fromPort = originPort;
+    for (int i = 0; i < sailingCount; i++) {
+        Route* r = getRouteView(g, fg, sailings[i]);
+        result.totalCost += r->voyageCost;
+        appendLeg(result.journey,
+            fromPort,
+            r->destinationPort,
+            r->voyageDate,
+            r->departureTime,
+            r->arrivalTime,
+            r->voyageCost,
+            r->shippingCompany);
+        fromPort = r->destinationPort;
+    }
+
+    delete[] sailings;
+    delete[] stack;
+    delete[] upward;
+}
+
+void printHierarchyStats(const HierarchyStats& stats) {
+    cout << "Contraction hierarchy: " << stats.portCount << " ports (" << stats.corePorts << " left in the core), "
+         << stats.originalArcs << " arcs + " << stats.shortcuts << " shortcut(s) in " << stats.rounds << " round(s), " << stats.witnessSearches
+         << " witness searches in " << stats.seconds * 1000.0 << " ms (" << stats.threadCount << " thread(s))." << endl;
+}
@@ -0,0 +1,133 @@
+#ifndef CONTRACTION_HIERARCHY_H
+#define CONTRACTION_HIERARCHY_H
+
+#include <string>
+#include <cstdint>
+#include "Graph.h"
+#include "MappedFile.h"
+#include "RouteMatrix.h"
+#include "ShortestPath.h"
+
+using namespace std;
+
+// Bump whenever the on-disk layout changes; older hierarchy files are then rebuilt
+const unsigned int CONTRACTION_HIERARCHY_FORMAT_VERSION = 2;
+
+// One arc of the hierarchy, from -> to. An original arc stands for the
+// sailing with edge index sailing; a shortcut (sailing < 0) stands for arc
+// first followed by arc second, through a port contracted before both ends.
+struct HierarchyArc {
+    int32_t from;
+    int32_t to;
+    int32_t weight;
+    int32_t first;
+    int32_t second;
+    int32_t sailing;
+};
+
+// Contraction hierarchy over the PortArcs of one timetable version, with
+// fares (PORT_ARCS_CHEAPEST) or minutes (PORT_ARCS_FASTEST) as weights.
+// Ports are contracted in order of rank; the arcs leaving u towards
+// higher-ranked ports are upArcs[firstUp[u] .. firstUp[u + 1]) and the
+// arcs entering v from higher-ranked ports are
+// downArcs[firstDown[v] .. firstDown[v + 1]), both indexing arcs. The
+// corePorts highest-ranked ports were never contracted; their lists hold
+// their arcs to and from each other. Either owned (built in memory) or
+// pointing straight into a mapped file.
+struct ContractionHierarchy {
+    int portCount;
+    int arcCount;
+    int corePorts;
+    int choice;
+    unsigned long long networkChecksum;
+    unsigned long long graphVersion;
+    int32_t* rank;
+    int32_t* firstUp;
+    int32_t* upArcs;
+    int32_t* firstDown;
+    int32_t* downArcs;
+    HierarchyArc* arcs;
+    MappedFile file;
+
+    ContractionHierarchy() : portCount(0), arcCount(0), corePorts(0), choice(PORT_ARCS_CHEAPEST), networkChecksum(0), graphVersion(0),
+                             rank(nullptr), firstUp(nullptr), upArcs(nullptr), firstDown(nullptr), downArcs(nullptr), arcs(nullptr) {}
+};
+
+struct HierarchyStats {
+    int portCount;
+    int corePorts;
+    int originalArcs;
+    int shortcuts;
+    int rounds;
+    int threadCount;
+    long long witnessSearches;
+    double seconds;
+
+    HierarchyStats() : portCount(0), corePorts(0), originalArcs(0), shortcuts(0), rounds(0), threadCount(0), witnessSearches(0), seconds(0.0) {}
+};
+
+// Contracts the ports of the current version in rounds. Each round picks
+// the ports whose priority (shortcuts added minus arcs removed, plus
+// contracted neighbours and depth in the hierarchy) is lowest among their
+// neighbours, and contracts them on threadCount workers (one per hardware
+// thread if <= 0). Witness searches skip the whole round, so the result
+// does not depend on the thread count. Only ports that add no more
+// shortcuts than the arcs they remove are contracted; once none is left,
+// the rest are kept as a core at the top (corePorts of them), which
+// queries search without shortcuts. On a timetable with little structure,
+// such as random crossings between any two ports, most ports stay there.
+bool buildContractionHierarchy(Graph& g, ContractionHierarchy& ch, HierarchyStats& stats, PortArcChoice choice = PORT_ARCS_CHEAPEST, int threadCount = 0, const RoutePreferences* prefs = nullptr);
+
+void freeContractionHierarchy(ContractionHierarchy& ch);
+
+// Writes the hierarchy behind a small header, replacing the file atomically
+bool saveContractionHierarchy(const ContractionHierarchy& ch, const string& path);
+
+// Maps a saved hierarchy read-only. Returns false if it is missing or has
+// another format version, or if it was built from other port arcs than
+// the current version, choice and prefs give now.
+bool loadContractionHierarchy(Graph& g, ContractionHierarchy& ch, const string& path, PortArcChoice choice = PORT_ARCS_CHEAPEST, const RoutePreferences* prefs = nullptr);
+
+// Per-thread query arrays, sized once and reset through their touched lists
+struct HierarchyQueryEntry {
+    int value;
+    int port;
+};
+
+struct HierarchyQueryEntryOrder {
+    static bool before(const HierarchyQueryEntry& a, const HierarchyQueryEntry& b) { return a.value < b.value; }
+    static int id(const HierarchyQueryEntry& e) { return e.port; }
+};
+
+struct HierarchyQuery {
+    int portCount;
+    int* forwardValue;
+    int* backwardValue;
+    int* forwardArc;
+    int* backwardArc;
+    int* touched;
+    int touchedCount;
+    IndexedHeap<HierarchyQueryEntry, HierarchyQueryEntryOrder> forwardOpen;
+    IndexedHeap<HierarchyQueryEntry, HierarchyQueryEntryOrder> backwardOpen;
+
+    HierarchyQuery() : portCount(0), forwardValue(nullptr), backwardValue(nullptr), forwardArc(nullptr), backwardArc(nullptr),
+                       touched(nullptr), touchedCount(0) {}
+};
+
+void initHierarchyQuery(HierarchyQuery& q, int portCount);
+
+void freeHierarchyQuery(HierarchyQuery& q);
+
+// Cheapest (or fastest, depending on how ch was built) route between two
+// ports over the collapsed timetable, so consecutive legs need not connect
+// in time and maxLegs does not apply. Upward searches from both ends climb
+// to the core and a bidirectional search over the core joins them (or they
+// meet below it); shortcuts are then unpacked into the sailings they stand
+// for. Nothing is found if the graph has been updated
+// since ch was built or loaded. nodesExpanded counts ports settled by
+// either search.
+void findRouteHierarchy(Graph& g, const ContractionHierarchy& ch, HierarchyQuery& q, const string& originPort, const string& destPort, ShortestPathResult& result);
+
+void printHierarchyStats(const HierarchyStats& stats);
+
+#endif
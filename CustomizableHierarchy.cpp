@@ -0,0 +1,1013 @@
+#include "CustomizableHierarchy.h"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <limits.h>
+
+using namespace std;
+
+// Levels with fewer ports than this per worker run on the calling thread;
+// most levels near the top of the tree hold only a handful of ports
+const int CUSTOMIZE_PORTS_PER_THREAD = 64;
+
+// Parts this small are ranked as they are instead of being cut again
+const int DISSECTION_LEAF_SIZE = 16;
+
+struct PortList {
+    int* items;
+    int count;
+    int capacity;
+};
+
+static void appendPort(PortList& list, int port) {
+    if (list.count >= list.capacity) {
+        int newCap = list.capacity > 0 ? list.capacity * 2 : 4;
+        int* grown = new int[newCap];
+        for (int i = 0; i < list.count; i++) {
+            grown[i] = list.items[i];
+        }
+        delete[] list.items;
+        list.items = grown;
+        list.capacity = newCap;
+    }
+    list.items[list.count++] = port;
+}
+
+static void removePort(PortList& list, int port) {
+    for (int i = 0; i < list.count; i++) {
+        if (list.items[i] == port) {
+            list.items[i] = list.items[--list.count];
+            return;
+        }
+    }
+}
+
+struct ByRank {
+    const int* rank;
+    bool operator()(int a, int b) const { return rank[a] < rank[b]; }
+};
+
+// Ports of one part are ports[first .. first + count), to be given ranks
+// rankBase onwards
+struct DissectionPart {
+    int first;
+    int count;
+    int rankBase;
+};
+
+static void pushPart(DissectionPart*& stack, int& size, int& capacity, DissectionPart part) {
+    if (size >= capacity) {
+        int newCap = capacity > 0 ? capacity * 2 : 16;
+        DissectionPart* grown = new DissectionPart[newCap];
+        for (int i = 0; i < size; i++) {
+            grown[i] = stack[i];
+        }
+        delete[] stack;
+        stack = grown;
+        capacity = newCap;
+    }
+    stack[size++] = part;
+}
+
+// Breadth-first levels from start over the ports with partOf == id; queue
+// ends up holding the reached ports in level order
+static int levelsWithinPart(const PortList* adjacent, const int* partOf, int id, int start, int* level, int* queue) {
+    int head = 0;
+    int tail = 0;
+    level[start] = 0;
+    queue[tail++] = start;
+    while (head < tail) {
+        int v = queue[head++];
+        for (int i = 0; i < adjacent[v].count; i++) {
+            int x = adjacent[v].items[i];
+            if (partOf[x] != id || level[x] >= 0) continue;
+            level[x] = level[v] + 1;
+            queue[tail++] = x;
+        }
+    }
+    return tail;
+}
+
+// Nested dissection: each part is cut in two by one breadth-first level
+// (started from a far port), the cut goes to the top of the part's ranks
+// and both halves are cut again. A part that falls apart is split along
+// its components with an empty cut.
+static void orderByDissection(const PortList* adjacent, int portCount, int* rank) {
+    int* ports = new int[portCount];
+    int* sorted = new int[portCount];
+    int* partOf = new int[portCount];
+    int* level = new int[portCount];
+    int* queue = new int[portCount];
+    int* levelSize = new int[portCount + 1];
+    for (int v = 0; v < portCount; v++) {
+        ports[v] = v;
+        partOf[v] = 0;
+        level[v] = -1;
+    }
+    int nextPartId = 1;
+
+    DissectionPart* stack = nullptr;
+    int stackSize = 0;
+    int stackCapacity = 0;
+    DissectionPart whole = { 0, portCount, 0 };
+    pushPart(stack, stackSize, stackCapacity, whole);
+    while (stackSize > 0) {
+        DissectionPart part = stack[--stackSize];
+        int* members = ports + part.first;
+        if (part.count <= DISSECTION_LEAF_SIZE) {
+            for (int i = 0; i < part.count; i++) {
+                rank[members[i]] = part.rankBase + i;
+            }
+            continue;
+        }
+
+        int id = partOf[members[0]];
+        int reached = levelsWithinPart(adjacent, partOf, id, members[0], level, queue);
+        int cutLevel = -1;
+        if (reached == part.count) {
+            int far = queue[reached - 1];
+            for (int i = 0; i < reached; i++) {
+                level[queue[i]] = -1;
+            }
+            levelsWithinPart(adjacent, partOf, id, far, level, queue);
+            int levelCount = level[queue[reached - 1]] + 1;
+            for (int l = 0; l < levelCount; l++) {
+                levelSize[l] = 0;
+            }
+            for (int i = 0; i < reached; i++) {
+                levelSize[level[queue[i]]]++;
+            }
+
+            // Thinnest level leaving at least a quarter on each side, or
+            // failing that the one holding the middle port
+            int before = 0;
+            for (int l = 1; l + 1 < levelCount; l++) {
+                before += levelSize[l - 1];
+                int after = part.count - before - levelSize[l];
+                if (before * 4 >= part.count && after * 4 >= part.count
+                    && (cutLevel < 0 || levelSize[l] < levelSize[cutLevel])) cutLevel = l;
+            }
+            if (cutLevel < 0 && levelCount > 2) {
+                cutLevel = level[queue[part.count / 2]];
+                if (cutLevel == 0) cutLevel = 1;
+                if (cutLevel == levelCount - 1) cutLevel = levelCount - 2;
+            }
+            if (cutLevel < 0) {
+                // Too dense to cut by levels
+                for (int i = 0; i < part.count; i++) {
+                    rank[members[i]] = part.rankBase + i;
+                    level[members[i]] = -1;
+                }
+                continue;
+            }
+        }
+
+        // 0: first half, 1: second half, 2: cut. Cut ports with no
+        // neighbour past the cut can join the first half.
+        int sideCount[3] = { 0, 0, 0 };
+        for (int i = 0; i < part.count; i++) {
+            int v = members[i];
+            int side;
+            if (cutLevel < 0) {
+                side = level[v] >= 0 ? 0 : 1;
+            } else if (level[v] < cutLevel) {
+                side = 0;
+            } else if (level[v] > cutLevel) {
+                side = 1;
+            } else {
+                side = 0;
+                for (int k = 0; k < adjacent[v].count; k++) {
+                    int x = adjacent[v].items[k];
+                    if (partOf[x] == id && level[x] == cutLevel + 1) {
+                        side = 2;
+                        break;
+                    }
+                }
+            }
+            queue[i] = side;
+            sideCount[side]++;
+        }
+        int at[3] = { 0, sideCount[0], sideCount[0] + sideCount[1] };
+        for (int i = 0; i < part.count; i++) {
+            sorted[at[queue[i]]++] = members[i];
+        }
+
+        int firstId = nextPartId++;
+        int secondId = nextPartId++;
+        for (int i = 0; i < part.count; i++) {
+            int v = sorted[i];
+            members[i] = v;
+            level[v] = -1;
+            if (i < sideCount[0]) {
+                partOf[v] = firstId;
+            } else if (i < sideCount[0] + sideCount[1]) {
+                partOf[v] = secondId;
+            } else {
+                partOf[v] = -1;
+                rank[v] = part.rankBase + i;
+            }
+        }
+        DissectionPart first = { part.first, sideCount[0], part.rankBase };
+        DissectionPart second = { part.first + sideCount[0], sideCount[1], part.rankBase + sideCount[0] };
+        if (first.count > 0) pushPart(stack, stackSize, stackCapacity, first);
+        if (second.count > 0) pushPart(stack, stackSize, stackCapacity, second);
+    }
+
+    delete[] stack;
+    delete[] ports;
+    delete[] sorted;
+    delete[] partOf;
+    delete[] level;
+    delete[] queue;
+    delete[] levelSize;
+}
+
+// Arc from lower to higher, or -1 if the hierarchy does not join them
+static int findHierarchyArc(const CustomizableHierarchy& cch, int lower, int higher) {
+    int lo = cch.firstUp[lower];
+    int hi = cch.firstUp[lower + 1];
+    int wanted = cch.rank[higher];
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cch.rank[cch.upHead[mid]] < wanted) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < cch.firstUp[lower + 1] && cch.upHead[lo] == higher ? lo : -1;
+}
+
+bool buildCustomizableHierarchy(Graph& g, CustomizableHierarchy& cch, CustomizableHierarchyStats& stats) {
+    stats = CustomizableHierarchyStats();
+    freeCustomizableHierarchy(cch);
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+
+    int portCount;
+    PortList* adjacent;
+    {
+        FrozenGraphPin pin(g);
+        const FrozenGraph& fg = *pin.fg;
+        portCount = fg.portCount;
+        if (portCount == 0) return false;
+        cch.graphVersion = fg.version;
+
+        adjacent = new PortList[portCount];
+        for (int v = 0; v < portCount; v++) {
+            adjacent[v].items = nullptr;
+            adjacent[v].count = 0;
+            adjacent[v].capacity = 0;
+        }
+        for (int u = 0; u < portCount; u++) {
+            for (int e = fg.firstEdge[u]; e < fg.firstEdge[u + 1]; e++) {
+                int v = fg.edges[e].destinationId;
+                if (v == u) continue;
+                appendPort(adjacent[u], v);
+                appendPort(adjacent[v], u);
+            }
+        }
+    }
+
+    // Drop repeated pairs; mark[x] == stamp while x is in the list at hand
+    int* mark = new int[portCount];
+    for (int v = 0; v < portCount; v++) {
+        mark[v] = -1;
+    }
+    int stamp = 0;
+    for (int v = 0; v < portCount; v++) {
+        stamp++;
+        int kept = 0;
+        for (int i = 0; i < adjacent[v].count; i++) {
+            int x = adjacent[v].items[i];
+            if (mark[x] == stamp) continue;
+            mark[x] = stamp;
+            adjacent[v].items[kept++] = x;
+        }
+        adjacent[v].count = kept;
+        stats.pairCount += kept;
+    }
+    stats.pairCount /= 2;
+
+    cch.rank = new int[portCount];
+    orderByDissection(adjacent, portCount, cch.rank);
+    int* order = new int[portCount];
+    for (int v = 0; v < portCount; v++) {
+        order[cch.rank[v]] = v;
+    }
+
+    // Eliminate in rank order. The neighbours a port has left when it goes
+    // are its upper neighbours, and are joined to each other; no later
+    // elimination touches its list again.
+    for (int r = 0; r < portCount; r++) {
+        const PortList& neighbours = adjacent[order[r]];
+        for (int i = 0; i < neighbours.count; i++) {
+            removePort(adjacent[neighbours.items[i]], order[r]);
+        }
+        for (int i = 0; i < neighbours.count; i++) {
+            int x = neighbours.items[i];
+            stamp++;
+            mark[x] = stamp;
+            for (int k = 0; k < adjacent[x].count; k++) {
+                mark[adjacent[x].items[k]] = stamp;
+            }
+            for (int j = 0; j < neighbours.count; j++) {
+                int y = neighbours.items[j];
+                if (mark[y] != stamp) appendPort(adjacent[x], y);
+            }
+        }
+    }
+
+    ByRank byRank = { cch.rank };
+    cch.portCount = portCount;
+    cch.firstUp = new int[portCount + 1];
+    int arcCount = 0;
+    for (int v = 0; v < portCount; v++) {
+        cch.firstUp[v] = arcCount;
+        arcCount += adjacent[v].count;
+    }
+    cch.firstUp[portCount] = arcCount;
+    cch.arcCount = arcCount;
+    cch.upHead = new int[arcCount > 0 ? arcCount : 1];
+    cch.arcTail = new int[arcCount > 0 ? arcCount : 1];
+    cch.parent = new int[portCount];
+    for (int v = 0; v < portCount; v++) {
+        sort(adjacent[v].items, adjacent[v].items + adjacent[v].count, byRank);
+        for (int i = 0; i < adjacent[v].count; i++) {
+            cch.upHead[cch.firstUp[v] + i] = adjacent[v].items[i];
+            cch.arcTail[cch.firstUp[v] + i] = v;
+        }
+        cch.parent[v] = adjacent[v].count > 0 ? adjacent[v].items[0] : -1;
+        delete[] adjacent[v].items;
+    }
+    delete[] adjacent;
+
+    // Counting sort by head, walking tails in rank order
+    cch.firstDown = new int[portCount + 1];
+    cch.downArcs = new int[arcCount > 0 ? arcCount : 1];
+    for (int v = 0; v <= portCount; v++) {
+        cch.firstDown[v] = 0;
+    }
+    for (int a = 0; a < arcCount; a++) {
+        cch.firstDown[cch.upHead[a] + 1]++;
+    }
+    for (int v = 0; v < portCount; v++) {
+        cch.firstDown[v + 1] += cch.firstDown[v];
+    }
+    int* fill = new int[portCount];
+    for (int v = 0; v < portCount; v++) {
+        fill[v] = cch.firstDown[v];
+    }
+    for (int r = 0; r < portCount; r++) {
+        int u = order[r];
+        for (int a = cch.firstUp[u]; a < cch.firstUp[u + 1]; a++) {
+            cch.downArcs[fill[cch.upHead[a]]++] = a;
+        }
+    }
+
+    // A port's level is one above its highest lower neighbour, so a level
+    // only reads arcs customized by the levels below it
+    int* level = fill;
+    int levelCount = 0;
+    for (int r = 0; r < portCount; r++) {
+        int v = order[r];
+        level[v] = 0;
+        for (int d = cch.firstDown[v]; d < cch.firstDown[v + 1]; d++) {
+            int below = level[cch.arcTail[cch.downArcs[d]]] + 1;
+            if (below > level[v]) level[v] = below;
+        }
+        if (level[v] + 1 > levelCount) levelCount = level[v] + 1;
+    }
+    cch.levelCount = levelCount;
+    cch.firstInLevel = new int[levelCount + 1];
+    cch.levelPorts = new int[portCount];
+    for (int l = 0; l <= levelCount; l++) {
+        cch.firstInLevel[l] = 0;
+    }
+    for (int v = 0; v < portCount; v++) {
+        cch.firstInLevel[level[v] + 1]++;
+    }
+    for (int l = 0; l < levelCount; l++) {
+        cch.firstInLevel[l + 1] += cch.firstInLevel[l];
+    }
+    for (int v = 0; v < portCount; v++) {
+        cch.levelPorts[cch.firstInLevel[level[v]]++] = v;
+    }
+    for (int l = levelCount; l > 0; l--) {
+        cch.firstInLevel[l] = cch.firstInLevel[l - 1];
+    }
+    cch.firstInLevel[0] = 0;
+
+    // Height of the elimination tree, which bounds the ports a query walks
+    int* depth = mark;
+    for (int r = portCount - 1; r >= 0; r--) {
+        int v = order[r];
+        depth[v] = cch.parent[v] < 0 ? 1 : depth[cch.parent[v]] + 1;
+        if (depth[v] > stats.treeHeight) stats.treeHeight = depth[v];
+    }
+
+    delete[] mark;
+    delete[] order;
+    delete[] fill;
+
+    stats.portCount = portCount;
+    stats.arcCount = arcCount;
+    stats.levelCount = levelCount;
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    return true;
+}
+
+void freeCustomizableHierarchy(CustomizableHierarchy& cch) {
+    delete[] cch.rank;
+    delete[] cch.firstUp;
+    delete[] cch.upHead;
+    delete[] cch.arcTail;
+    delete[] cch.firstDown;
+    delete[] cch.downArcs;
+    delete[] cch.parent;
+    delete[] cch.firstInLevel;
+    delete[] cch.levelPorts;
+    cch.rank = nullptr;
+    cch.firstUp = nullptr;
+    cch.upHead = nullptr;
+    cch.arcTail = nullptr;
+    cch.firstDown = nullptr;
+    cch.downArcs = nullptr;
+    cch.parent = nullptr;
+    cch.firstInLevel = nullptr;
+    cch.levelPorts = nullptr;
+    cch.portCount = 0;
+    cch.arcCount = 0;
+    cch.levelCount = 0;
+    cch.graphVersion = 0;
+}
+
+enum CustomizeTask {
+    TASK_SAILINGS,
+    TASK_TRIANGLES
+};
+
+// What one worker thread needs; ports come from the shared counter
+struct CustomizeWorker {
+    const CustomizableHierarchy* cch;
+    HierarchyMetric* metric;
+    const PortArcs* portArcs;
+    const int* ports;
+    int portTotal;
+    atomic<int>* nextPort;
+    atomic<bool>* missingPair;
+    CustomizeTask task;
+    int* arcTo;
+};
+
+// Puts the collapsed sailings of port u on its arcs. Each direction of an
+// arc is written from one end only, so ports need no locking.
+static void placeSailings(CustomizeWorker& worker, int u) {
+    const CustomizableHierarchy& cch = *worker.cch;
+    HierarchyMetric& metric = *worker.metric;
+    const PortArcs& portArcs = *worker.portArcs;
+    for (int k = portArcs.firstArc[u]; k < portArcs.firstArc[u + 1]; k++) {
+        int v = portArcs.arcTarget[k];
+        int weight = metric.choice == PORT_ARCS_FASTEST ? portArcs.arcMinutes[k] : portArcs.arcCost[k];
+        if (cch.rank[u] < cch.rank[v]) {
+            int a = findHierarchyArc(cch, u, v);
+            if (a < 0) {
+                *worker.missingPair = true;
+                continue;
+            }
+            metric.upWeight[a] = weight;
+            metric.upSailing[a] = portArcs.arcEdge[k];
+        } else {
+            int a = findHierarchyArc(cch, v, u);
+            if (a < 0) {
+                *worker.missingPair = true;
+                continue;
+            }
+            metric.downWeight[a] = weight;
+            metric.downSailing[a] = portArcs.arcEdge[k];
+        }
+    }
+}
+
+// Shortens the arcs of v through each lower neighbour u that is joined to
+// both ends. Only v's own arcs are written, and the arcs read belong to
+// ports of lower levels, which are already final.
+static void relaxLowerTriangles(CustomizeWorker& worker, int v) {
+    const CustomizableHierarchy& cch = *worker.cch;
+    HierarchyMetric& metric = *worker.metric;
+    int* arcTo = worker.arcTo;
+    for (int a = cch.firstUp[v]; a < cch.firstUp[v + 1]; a++) {
+        arcTo[cch.upHead[a]] = a;
+    }
+
+    for (int d = cch.firstDown[v]; d < cch.firstDown[v + 1]; d++) {
+        int lower = cch.downArcs[d];
+        int u = cch.arcTail[lower];
+        int vToU = metric.downWeight[lower];
+        int uToV = metric.upWeight[lower];
+        if (vToU == INT_MAX && uToV == INT_MAX) continue;
+
+        // u's arcs are in rank order, so those past v lead above it
+        for (int b = lower + 1; b < cch.firstUp[u + 1]; b++) {
+            int through = arcTo[cch.upHead[b]];
+            if (through < 0) continue;
+            if (vToU != INT_MAX && metric.upWeight[b] != INT_MAX
+                && (long long)vToU + metric.upWeight[b] < metric.upWeight[through]) {
+                metric.upWeight[through] = vToU + metric.upWeight[b];
+                metric.upSailing[through] = -1;
+                metric.upMiddle[through] = u;
+            }
+            if (uToV != INT_MAX && metric.downWeight[b] != INT_MAX
+                && (long long)metric.downWeight[b] + uToV < metric.downWeight[through]) {
+                metric.downWeight[through] = metric.downWeight[b] + uToV;
+                metric.downSailing[through] = -1;
+                metric.downMiddle[through] = u;
+            }
+        }
+    }
+
+    for (int a = cch.firstUp[v]; a < cch.firstUp[v + 1]; a++) {
+        arcTo[cch.upHead[a]] = -1;
+    }
+}
+
+static void runCustomizeWorker(CustomizeWorker* worker) {
+    while (true) {
+        int i = worker->nextPort->fetch_add(1);
+        if (i >= worker->portTotal) break;
+        int v = worker->ports ? worker->ports[i] : i;
+        if (worker->task == TASK_SAILINGS) {
+            placeSailings(*worker, v);
+        } else {
+            relaxLowerTriangles(*worker, v);
+        }
+    }
+}
+
+static void runCustomizeTask(CustomizeWorker* workers, int threadCount, CustomizeTask task, const int* ports, int portTotal) {
+    atomic<int> nextPort(0);
+    for (int i = 0; i < threadCount; i++) {
+        workers[i].ports = ports;
+        workers[i].portTotal = portTotal;
+        workers[i].nextPort = &nextPort;
+        workers[i].task = task;
+    }
+
+    int used = portTotal / CUSTOMIZE_PORTS_PER_THREAD;
+    if (used > threadCount) used = threadCount;
+    if (used > 1) {
+        thread* threads = new thread[used - 1];
+        for (int i = 1; i < used; i++) {
+            threads[i - 1] = thread(runCustomizeWorker, &workers[i]);
+        }
+        runCustomizeWorker(&workers[0]);
+        for (int i = 0; i < used - 1; i++) {
+            threads[i].join();
+        }
+        delete[] threads;
+    } else {
+        runCustomizeWorker(&workers[0]);
+    }
+}
+
+bool customizeHierarchy(Graph& g, const CustomizableHierarchy& cch, HierarchyMetric& metric, HierarchyMetricStats& stats,
+                        PortArcChoice choice, int threadCount, const RoutePreferences* prefs) {
+    stats = HierarchyMetricStats();
+    freeHierarchyMetric(metric);
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+
+    PortArcs portArcs;
+    {
+        FrozenGraphPin pin(g);
+        buildPortArcs(g, *pin.fg, portArcs, prefs, choice);
+        metric.graphVersion = pin.fg->version;
+    }
+    if (portArcs.portCount != cch.portCount || cch.portCount == 0) {
+        freePortArcs(portArcs);
+        return false;
+    }
+
+    int arcCount = cch.arcCount;
+    metric.arcCount = arcCount;
+    metric.choice = choice;
+    metric.upWeight = new int[arcCount > 0 ? arcCount : 1];
+    metric.downWeight = new int[arcCount > 0 ? arcCount : 1];
+    metric.upSailing = new int[arcCount > 0 ? arcCount : 1];
+    metric.downSailing = new int[arcCount > 0 ? arcCount : 1];
+    metric.upMiddle = new int[arcCount > 0 ? arcCount : 1];
+    metric.downMiddle = new int[arcCount > 0 ? arcCount : 1];
+    for (int a = 0; a < arcCount; a++) {
+        metric.upWeight[a] = INT_MAX;
+        metric.downWeight[a] = INT_MAX;
+        metric.upSailing[a] = -1;
+        metric.downSailing[a] = -1;
+        metric.upMiddle[a] = -1;
+        metric.downMiddle[a] = -1;
+    }
+
+    if (threadCount <= 0) {
+        threadCount = (int)thread::hardware_concurrency();
+        if (threadCount <= 0) threadCount = 1;
+    }
+
+    atomic<bool> missingPair(false);
+    CustomizeWorker* workers = new CustomizeWorker[threadCount];
+    for (int i = 0; i < threadCount; i++) {
+        workers[i].cch = &cch;
+        workers[i].metric = &metric;
+        workers[i].portArcs = &portArcs;
+        workers[i].missingPair = &missingPair;
+        workers[i].arcTo = new int[cch.portCount];
+        for (int v = 0; v < cch.portCount; v++) {
+            workers[i].arcTo[v] = -1;
+        }
+    }
+
+    runCustomizeTask(workers, threadCount, TASK_SAILINGS, nullptr, cch.portCount);
+    if (!missingPair) {
+        for (int l = 0; l < cch.levelCount; l++) {
+            int first = cch.firstInLevel[l];
+            runCustomizeTask(workers, threadCount, TASK_TRIANGLES, cch.levelPorts + first, cch.firstInLevel[l + 1] - first);
+        }
+    }
+
+    for (int i = 0; i < threadCount; i++) {
+        delete[] workers[i].arcTo;
+    }
+    delete[] workers;
+    freePortArcs(portArcs);
+
+    if (missingPair) {
+        cout << "Hierarchy metric not built: the timetable links ports the hierarchy does not join." << endl;
+        freeHierarchyMetric(metric);
+        return false;
+    }
+
+    stats.arcCount = arcCount;
+    stats.levelCount = cch.levelCount;
+    stats.threadCount = threadCount;
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    return true;
+}
+
+void freeHierarchyMetric(HierarchyMetric& metric) {
+    delete[] metric.upWeight;
+    delete[] metric.downWeight;
+    delete[] metric.upSailing;
+    delete[] metric.downSailing;
+    delete[] metric.upMiddle;
+    delete[] metric.downMiddle;
+    metric.upWeight = nullptr;
+    metric.downWeight = nullptr;
+    metric.upSailing = nullptr;
+    metric.downSailing = nullptr;
+    metric.upMiddle = nullptr;
+    metric.downMiddle = nullptr;
+    metric.arcCount = 0;
+    metric.graphVersion = 0;
+}
+
+static unsigned long long hashName(const string& name) {
+    unsigned long long h = 14695981039346656037ULL;
+    for (size_t i = 0; i < name.size(); i++) {
+        h ^= (unsigned char)name[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Order-free fingerprint of the parts of prefs a metric depends on
+static unsigned long long hashRouteFilter(const RoutePreferences* prefs) {
+    if (!prefs) return 0;
+    unsigned long long companies = 0;
+    for (int i = 0; i < prefs->allowedCompaniesCount; i++) {
+        companies += hashName(prefs->allowedCompanies[i]);
+    }
+    unsigned long long ports = 0;
+    for (int i = 0; i < prefs->forbiddenPortsCount; i++) {
+        ports += hashName(prefs->forbiddenPorts[i]);
+    }
+    return companies * 31 + ports;
+}
+
+static bool listedIn(const string* names, int count, const string& name) {
+    for (int i = 0; i < count; i++) {
+        if (names[i] == name) return true;
+    }
+    return false;
+}
+
+static bool sameNames(const string* a, int aCount, const string* b, int bCount) {
+    for (int i = 0; i < aCount; i++) {
+        if (!listedIn(b, bCount, a[i])) return false;
+    }
+    for (int i = 0; i < bCount; i++) {
+        if (!listedIn(a, aCount, b[i])) return false;
+    }
+    return true;
+}
+
+static bool sameRouteFilter(const RoutePreferences& filter, const RoutePreferences* prefs) {
+    RoutePreferences none;
+    const RoutePreferences& other = prefs ? *prefs : none;
+    return sameNames(filter.allowedCompanies, filter.allowedCompaniesCount, other.allowedCompanies, other.allowedCompaniesCount)
+        && sameNames(filter.forbiddenPorts, filter.forbiddenPortsCount, other.forbiddenPorts, other.forbiddenPortsCount);
+}
+
+// Pins and returns the slot matching the key, or nullptr; the caller holds cache.lock
+static const HierarchyMetric* pinCachedMetric(HierarchyMetricCache& cache, unsigned long long version, PortArcChoice choice,
+                                              unsigned long long filterHash, const RoutePreferences* prefs) {
+    for (int i = 0; i < HIERARCHY_METRIC_CACHE_SLOTS; i++) {
+        CachedHierarchyMetric& slot = cache.slots[i];
+        if (!slot.metric || slot.metric->graphVersion != version || slot.metric->choice != choice) continue;
+        if (slot.filterHash != filterHash || !sameRouteFilter(slot.filter, prefs)) continue;
+        slot.pins++;
+        slot.lastUse = ++cache.clock;
+        return slot.metric;
+    }
+    return nullptr;
+}
+
+const HierarchyMetric* acquireHierarchyMetric(Graph& g, const CustomizableHierarchy& cch, HierarchyMetricCache& cache,
+                                              PortArcChoice choice, const RoutePreferences* prefs, int threadCount) {
+    unsigned long long version;
+    {
+        FrozenGraphPin pin(g);
+        version = pin.fg->version;
+    }
+    unsigned long long filterHash = hashRouteFilter(prefs);
+    {
+        lock_guard<mutex> lock(cache.lock);
+        const HierarchyMetric* cached = pinCachedMetric(cache, version, choice, filterHash, prefs);
+        if (cached) {
+            cache.hits++;
+            return cached;
+        }
+        cache.misses++;
+    }
+
+    // Customize without the lock so hits on other filters are not held up
+    HierarchyMetric* fresh = new HierarchyMetric();
+    HierarchyMetricStats stats;
+    if (!customizeHierarchy(g, cch, *fresh, stats, choice, threadCount, prefs)) {
+        delete fresh;
+        return nullptr;
+    }
+
+    lock_guard<mutex> lock(cache.lock);
+    const HierarchyMetric* raced = pinCachedMetric(cache, fresh->graphVersion, choice, filterHash, prefs);
+    if (raced) {
+        freeHierarchyMetric(*fresh);
+        delete fresh;
+        return raced;
+    }
+
+    int victim = -1;
+    for (int i = 0; i < HIERARCHY_METRIC_CACHE_SLOTS; i++) {
+        const CachedHierarchyMetric& slot = cache.slots[i];
+        if (!slot.metric) {
+            victim = i;
+            break;
+        }
+        if (slot.pins == 0 && (victim < 0 || slot.lastUse < cache.slots[victim].lastUse)) victim = i;
+    }
+    // Every slot is pinned: hand out an uncached metric, freed on release
+    if (victim < 0) return fresh;
+
+    CachedHierarchyMetric& slot = cache.slots[victim];
+    if (slot.metric) {
+        freeHierarchyMetric(*slot.metric);
+        delete slot.metric;
+    }
+    slot.metric = fresh;
+    slot.filterHash = filterHash;
+    slot.filter = prefs ? *prefs : RoutePreferences();
+    slot.pins = 1;
+    slot.lastUse = ++cache.clock;
+    return fresh;
+}
+
+void releaseHierarchyMetric(HierarchyMetricCache& cache, const HierarchyMetric* metric) {
+    if (!metric) return;
+    {
+        lock_guard<mutex> lock(cache.lock);
+        for (int i = 0; i < HIERARCHY_METRIC_CACHE_SLOTS; i++) {
+            if (cache.slots[i].metric == metric) {
+                cache.slots[i].pins--;
+                return;
+            }
+        }
+    }
+    HierarchyMetric* uncached = const_cast<HierarchyMetric*>(metric);
+    freeHierarchyMetric(*uncached);
+    delete uncached;
+}
+
+void freeHierarchyMetricCache(HierarchyMetricCache& cache) {
+    lock_guard<mutex> lock(cache.lock);
+    for (int i = 0; i < HIERARCHY_METRIC_CACHE_SLOTS; i++) {
+        CachedHierarchyMetric& slot = cache.slots[i];
+        if (slot.metric) {
+            freeHierarchyMetric(*slot.metric);
+            delete slot.metric;
+        }
+        slot = CachedHierarchyMetric();
+    }
+    cache.clock = 0;
+    cache.hits = 0;
+    cache.misses = 0;
+}
+
+void initCustomizedQuery(CustomizedQuery& q, int portCount) {
+    freeCustomizedQuery(q);
+    q.portCount = portCount;
+    q.forwardValue = new int[portCount > 0 ? portCount : 1];
+    q.backwardValue = new int[portCount > 0 ? portCount : 1];
+    q.forwardArc = new int[portCount > 0 ? portCount : 1];
+    q.backwardArc = new int[portCount > 0 ? portCount : 1];
+    for (int i = 0; i < portCount; i++) {
+        q.forwardValue[i] = INT_MAX;
+        q.backwardValue[i] = INT_MAX;
+    }
+}
+
+void freeCustomizedQuery(CustomizedQuery& q) {
+    delete[] q.forwardValue;
+    delete[] q.backwardValue;
+    delete[] q.forwardArc;
+    delete[] q.backwardArc;
+    q.forwardValue = nullptr;
+    q.backwardValue = nullptr;
+    q.forwardArc = nullptr;
+    q.backwardArc = nullptr;
+    q.portCount = 0;
+}
+
+// Relaxes the arcs of v unless its value already reaches best. All upper
+// neighbours are ancestors, so only ports on the tree path get values.
+static bool relaxUpward(const CustomizableHierarchy& cch, const int* weight, int* value, int* parentArc, int v, long long best) {
+    if (value[v] == INT_MAX || value[v] >= best) return false;
+    for (int a = cch.firstUp[v]; a < cch.firstUp[v + 1]; a++) {
+        if (weight[a] == INT_MAX) continue;
+        int x = cch.upHead[a];
+        if ((long long)value[v] + weight[a] < value[x]) {
+            value[x] = value[v] + weight[a];
+            parentArc[x] = a;
+        }
+    }
+    return true;
+}
+
+static void appendValue(int*& items, int& count, int& capacity, int value) {
+    if (count >= capacity) {
+        int newCap = capacity > 0 ? capacity * 2 : 8;
+        int* grown = new int[newCap];
+        for (int i = 0; i < count; i++) {
+            grown[i] = items[i];
+        }
+        delete[] items;
+        items = grown;
+        capacity = newCap;
+    }
+    items[count++] = value;
+}
+
+// Replaces one direction of arc (2 * arc, plus 1 going head to tail) by
+// the sailings it stands for, in travel order
+static void unpackMetricArc(const CustomizableHierarchy& cch, const HierarchyMetric& metric, int step,
+                            int*& sailings, int& count, int& capacity, int*& stack, int& stackCapacity) {
+    int depth = 0;
+    appendValue(stack, depth, stackCapacity, step);
+    while (depth > 0) {
+        int current = stack[--depth];
+        int a = current / 2;
+        bool down = current % 2 == 1;
+        int sailing = down ? metric.downSailing[a] : metric.upSailing[a];
+        if (sailing >= 0) {
+            appendValue(sailings, count, capacity, sailing);
+            continue;
+        }
+        int u = down ? metric.downMiddle[a] : metric.upMiddle[a];
+        int toTail = findHierarchyArc(cch, u, cch.arcTail[a]);
+        int toHead = findHierarchyArc(cch, u, cch.upHead[a]);
+        if (down) {
+            // head -> u -> tail
+            appendValue(stack, depth, stackCapacity, 2 * toTail);
+            appendValue(stack, depth, stackCapacity, 2 * toHead + 1);
+        } else {
+            // tail -> u -> head
+            appendValue(stack, depth, stackCapacity, 2 * toHead);
+            appendValue(stack, depth, stackCapacity, 2 * toTail + 1);
+        }
+    }
+}
+
+void findRouteCustomized(Graph& g, const CustomizableHierarchy& cch, const HierarchyMetric& metric, CustomizedQuery& q,
+                         const string& originPort, const string& destPort, ShortestPathResult& result) {
+    result.found = false;
+    result.totalCost = 0;
+    result.nodesExpanded = 0;
+    resetSearchTrace(result.trace);
+    result.heapCounters = HeapCounters();
+    clearJourney(result.journey);
+    initJourney(result.journey);
+
+    int origin = findPortId(g, originPort);
+    int dest = findPortId(g, destPort);
+    if (origin < 0 || dest < 0 || origin >= cch.portCount || dest >= cch.portCount) return;
+
+    FrozenGraphPin pin(g);
+    const FrozenGraph& fg = *pin.fg;
+    if (fg.version != metric.graphVersion || metric.arcCount != cch.arcCount) return;
+    if (q.portCount != cch.portCount) initCustomizedQuery(q, cch.portCount);
+
+    // Walk both tree paths in rank order. Past the lowest common ancestor
+    // they are the same path, where the sides meet; a side whose value
+    // already reaches the best meeting has nothing left to add.
+    q.forwardValue[origin] = 0;
+    q.forwardArc[origin] = -1;
+    q.backwardValue[dest] = 0;
+    q.backwardArc[dest] = -1;
+    long long best = LLONG_MAX;
+    int meeting = -1;
+    int f = origin;
+    int b = dest;
+    while (f >= 0 || b >= 0) {
+        if (b < 0 || (f >= 0 && cch.rank[f] < cch.rank[b])) {
+            if (relaxUpward(cch, metric.upWeight, q.forwardValue, q.forwardArc, f, best)) result.nodesExpanded++;
+            f = cch.parent[f];
+        } else if (f < 0 || cch.rank[b] < cch.rank[f]) {
+            if (relaxUpward(cch, metric.downWeight, q.backwardValue, q.backwardArc, b, best)) result.nodesExpanded++;
+            b = cch.parent[b];
+        } else {
+            if (q.forwardValue[f] != INT_MAX && q.backwardValue[f] != INT_MAX
+                && (long long)q.forwardValue[f] + q.backwardValue[f] < best) {
+                best = (long long)q.forwardValue[f] + q.backwardValue[f];
+                meeting = f;
+            }
+            if (relaxUpward(cch, metric.upWeight, q.forwardValue, q.forwardArc, f, best)) result.nodesExpanded++;
+            if (relaxUpward(cch, metric.downWeight, q.backwardValue, q.backwardArc, b, best)) result.nodesExpanded++;
+            f = cch.parent[f];
+            b = cch.parent[b];
+        }
+    }
+
+    int* sailings = nullptr;
+    int sailingCount = 0;
+    int sailingCapacity = 0;
+    int* stack = nullptr;
+    int stackCapacity = 0;
+    if (meeting >= 0) {
+        // The forward parents run backwards from the meeting port, so
+        // collect them first and unpack in travel order
+        int* upward = nullptr;
+        int upwardCount = 0;
+        int upwardCapacity = 0;
+        for (int p = meeting; p != origin; p = cch.arcTail[q.forwardArc[p]]) {
+            appendValue(upward, upwardCount, upwardCapacity, q.forwardArc[p]);
+        }
+        for (int i = upwardCount - 1; i >= 0; i--) {
+            unpackMetricArc(cch, metric, 2 * upward[i], sailings, sailingCount, sailingCapacity, stack, stackCapacity);
+        }
+        for (int p = meeting; p != dest; p = cch.arcTail[q.backwardArc[p]]) {
+            unpackMetricArc(cch, metric, 2 * q.backwardArc[p] + 1, sailings, sailingCount, sailingCapacity, stack, stackCapacity);
+        }
+        delete[] upward;
+    }
+
+    for (int v = origin; v >= 0; v = cch.parent[v]) {
+        q.forwardValue[v] = INT_MAX;
+    }
+    for (int v = dest; v >= 0; v = cch.parent[v]) {
+        q.backwardValue[v] = INT_MAX;
+    }
+
+    if (meeting >= 0) {
+        result.found = true;
+        string fromPort = originPort;
+        for (int i = 0; i < sailingCount; i++) {
+            Route* r = getRouteView(g, fg, sailings[i]);
+            result.totalCost += r->voyageCost;
+            appendLeg(result.journey,
+                fromPort,
+                r->destinationPort,
+                r->voyageDate,
+                r->departureTime,
+                r->arrivalTime,
+                r->voyageCost,
+                r->shippingCompany);
+            fromPort = r->destinationPort;
+        }
+    }
+
+    delete[] sailings;
+    delete[] stack;
+}
+
+void printCustomizableHierarchyStats(const CustomizableHierarchyStats& stats) {
+    cout << "Customizable hierarchy: " << stats.portCount << " ports, " << stats.pairCount << " linked pair(s) -> " << stats.arcCount
+         << " arcs in " << stats.levelCount << " level(s), tree height " << stats.treeHeight << ", built in " << stats.seconds * 1000.0 << " ms." << endl;
+}
+
+void printHierarchyMetricStats(const HierarchyMetricStats& stats) {
+    cout << "Hierarchy metric: " << stats.arcCount << " arcs over " << stats.levelCount << " level(s) customized in "
+         << stats.seconds * 1000.0 << " ms (" << stats.threadCount << " thread(s))." << endl;
+}
@@ -0,0 +1,177 @@
+#ifndef CUSTOMIZABLE_HIERARCHY_H
+#define CUSTOMIZABLE_HIERARCHY_H
+
+#include <string>
+#include <mutex>
+#include "Graph.h"
+#include "RouteMatrix.h"
+#include "RoutePreferences.h"
+#include "ShortestPath.h"
+
+using namespace std;
+
+// Metrics kept by one HierarchyMetricCache; the least recently used
+// unpinned one makes room for a new filter
+const int HIERARCHY_METRIC_CACHE_SLOTS = 8;
+
+// Weight-free hierarchy over every port pair some sailing links, in
+// either direction. Ports are ranked by nested dissection, eliminated in
+// that order and the neighbours of each one are joined up as it goes, so
+// every triangle a metric needs is already an arc. Arc a joins arcTail[a] to the
+// higher-ranked upHead[a]; the arcs of u are [firstUp[u], firstUp[u + 1])
+// in rank order of their heads, and downArcs[firstDown[v] ..
+// firstDown[v + 1]) are the arcs whose head is v. parent is the lowest
+// upper neighbour (-1 at a root); every upper neighbour of a port is one
+// of its ancestors. Ports of level l, which only have lower neighbours
+// below l, are levelPorts[firstInLevel[l] .. firstInLevel[l + 1]).
+struct CustomizableHierarchy {
+    int portCount;
+    int arcCount;
+    int levelCount;
+    unsigned long long graphVersion;
+    int* rank;
+    int* firstUp;
+    int* upHead;
+    int* arcTail;
+    int* firstDown;
+    int* downArcs;
+    int* parent;
+    int* firstInLevel;
+    int* levelPorts;
+
+    CustomizableHierarchy() : portCount(0), arcCount(0), levelCount(0), graphVersion(0), rank(nullptr), firstUp(nullptr), upHead(nullptr),
+                              arcTail(nullptr), firstDown(nullptr), downArcs(nullptr), parent(nullptr), firstInLevel(nullptr), levelPorts(nullptr) {}
+};
+
+struct CustomizableHierarchyStats {
+    int portCount;
+    int pairCount;
+    int arcCount;
+    int levelCount;
+    int treeHeight;
+    double seconds;
+
+    CustomizableHierarchyStats() : portCount(0), pairCount(0), arcCount(0), levelCount(0), treeHeight(0), seconds(0.0) {}
+};
+
+// Builds the hierarchy from the port pairs of the current version. Later
+// versions can be customized on it as long as they link no new pairs.
+bool buildCustomizableHierarchy(Graph& g, CustomizableHierarchy& cch, CustomizableHierarchyStats& stats);
+
+void freeCustomizableHierarchy(CustomizableHierarchy& cch);
+
+// Fares (PORT_ARCS_CHEAPEST) or minutes (PORT_ARCS_FASTEST) on the arcs of
+// one hierarchy for one version and one prefs filter, unreachable arcs
+// holding INT_MAX. upWeight[a] runs tail to head, downWeight[a] head to
+// tail. An arc either stands for the sailing of that direction, or goes
+// through the lower port in upMiddle / downMiddle (-1 when it does not).
+struct HierarchyMetric {
+    int arcCount;
+    int choice;
+    unsigned long long graphVersion;
+    int* upWeight;
+    int* downWeight;
+    int* upSailing;
+    int* downSailing;
+    int* upMiddle;
+    int* downMiddle;
+
+    HierarchyMetric() : arcCount(0), choice(PORT_ARCS_CHEAPEST), graphVersion(0), upWeight(nullptr), downWeight(nullptr),
+                        upSailing(nullptr), downSailing(nullptr), upMiddle(nullptr), downMiddle(nullptr) {}
+};
+
+struct HierarchyMetricStats {
+    int arcCount;
+    int levelCount;
+    int threadCount;
+    double seconds;
+
+    HierarchyMetricStats() : arcCount(0), levelCount(0), threadCount(0), seconds(0.0) {}
+};
+
+// Weighs cch for the current version. Sailings by companies prefs does not
+// allow, and those touching a forbidden port, are left out; the other
+// preferences do not apply. Arcs are first set from the collapsed
+// sailings, then each level's ports take the shortest way through their
+// lower neighbours, spread over threadCount workers (one per hardware
+// thread if <= 0). Returns false if the version links a pair cch lacks.
+bool customizeHierarchy(Graph& g, const CustomizableHierarchy& cch, HierarchyMetric& metric, HierarchyMetricStats& stats,
+                        PortArcChoice choice = PORT_ARCS_CHEAPEST, int threadCount = 0, const RoutePreferences* prefs = nullptr);
+
+void freeHierarchyMetric(HierarchyMetric& metric);
+
+struct CachedHierarchyMetric {
+    HierarchyMetric* metric;
+    unsigned long long filterHash;
+    RoutePreferences filter;
+    int pins;
+    long long lastUse;
+
+    CachedHierarchyMetric() : metric(nullptr), filterHash(0), pins(0), lastUse(0) {}
+};
+
+// Customizations of one hierarchy, keyed by choice, version and the
+// company / forbidden-port filter of the prefs they were made for
+struct HierarchyMetricCache {
+    mutex lock;
+    CachedHierarchyMetric slots[HIERARCHY_METRIC_CACHE_SLOTS];
+    long long clock;
+    long long hits;
+    long long misses;
+
+    HierarchyMetricCache() : clock(0), hits(0), misses(0) {}
+};
+
+// The cached metric for the current version, choice and prefs, customized
+// first on a miss. Each call pins the metric until releaseHierarchyMetric;
+// pinned metrics are never evicted. Returns nullptr if customizing fails.
+const HierarchyMetric* acquireHierarchyMetric(Graph& g, const CustomizableHierarchy& cch, HierarchyMetricCache& cache,
+                                              PortArcChoice choice = PORT_ARCS_CHEAPEST, const RoutePreferences* prefs = nullptr, int threadCount = 0);
+
+void releaseHierarchyMetric(HierarchyMetricCache& cache, const HierarchyMetric* metric);
+
+void freeHierarchyMetricCache(HierarchyMetricCache& cache);
+
+// Holds a metric for the lifetime of a query
+struct HierarchyMetricPin {
+    HierarchyMetricCache& cache;
+    const HierarchyMetric* metric;
+
+    HierarchyMetricPin(Graph& g, const CustomizableHierarchy& cch, HierarchyMetricCache& cache, PortArcChoice choice, const RoutePreferences* prefs)
+        : cache(cache), metric(acquireHierarchyMetric(g, cch, cache, choice, prefs)) {}
+    ~HierarchyMetricPin() { releaseHierarchyMetric(cache, metric); }
+
+    HierarchyMetricPin(const HierarchyMetricPin&) = delete;
+    HierarchyMetricPin& operator=(const HierarchyMetricPin&) = delete;
+};
+
+// Per-thread query arrays, kept at INT_MAX between queries
+struct CustomizedQuery {
+    int portCount;
+    int* forwardValue;
+    int* backwardValue;
+    int* forwardArc;
+    int* backwardArc;
+
+    CustomizedQuery() : portCount(0), forwardValue(nullptr), backwardValue(nullptr), forwardArc(nullptr), backwardArc(nullptr) {}
+};
+
+void initCustomizedQuery(CustomizedQuery& q, int portCount);
+
+void freeCustomizedQuery(CustomizedQuery& q);
+
+// Cheapest (or fastest, depending on the metric) route between two ports
+// over the collapsed timetable, so consecutive legs need not connect in
+// time and maxLegs does not apply. Both ends relax their arcs up the
+// elimination tree to the root, without a queue, and meet at a common
+// ancestor; arcs are then unpacked into sailings. Nothing is found if the
+// graph has been updated since metric was customized. nodesExpanded
+// counts the ports relaxed by either side.
+void findRouteCustomized(Graph& g, const CustomizableHierarchy& cch, const HierarchyMetric& metric, CustomizedQuery& q,
+                         const string& originPort, const string& destPort, ShortestPathResult& result);
+
+void printCustomizableHierarchyStats(const CustomizableHierarchyStats& stats);
+
+void printHierarchyMetricStats(const HierarchyMetricStats& stats);
+
+#endif
@@ -44,3 +44,37 @@ int compareTime(const Time &a, const Time &b) {
  if (a.minute != b.minute) return a.minute < b.minute ? -1 : 1;
  return 0;
 }
+
+// Howard Hinnant's days_from_civil: exact for every Gregorian date
+static int daysFromCivil(int y, int m, int d) {
+ y -= m <= 2;
+ int era = (y >= 0 ? y : y - 399) / 400;
+ int yoe = y - era * 400;
+ int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+ int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+ return era * 146097 + doe - 719468;
+}
+
+static void civilFromDays(int z, Date &out) {
+ z += 719468;
+ int era = (z >= 0 ? z : z - 146096) / 146097;
+ int doe = z - era * 146097;
+ int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+ int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+ int mp = (5 * doy + 2) / 153;
+ out.day = doy - (153 * mp + 2) / 5 + 1;
+ out.month = mp < 10 ? mp + 3 : mp - 9;
+ out.year = yoe + era * 400 + (out.month <= 2);
+}
+
+int toEpochMinutes(const Date &d, const Time &t) {
+ return daysFromCivil(d.year, d.month, d.day) * 1440 + t.hour * 60 + t.minute;
+}
+
+void fromEpochMinutes(int minutes, Date &d, Time &t) {
+ int days = minutes >= 0 ? minutes / 1440 : -((-minutes + 1439) / 1440);
+ int rest = minutes - days * 1440;
+ civilFromDays(days, d);
+ t.hour = rest / 60;
+ t.minute = rest % 60;
+}
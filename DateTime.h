@@ -22,3 +22,20 @@ Time parseTime(const string &s);
 int compareDate(const Date &a, const Date &b);
 
 int compareTime(const Time &a, const Time &b);
+
+// Minutes since 1970-01-01 00:00 in the proleptic Gregorian calendar
+int toEpochMinutes(const Date &d, const Time &t);
+
+void fromEpochMinutes(int minutes, Date &d, Time &t);
+
+const int MINUTES_PER_DAY = 1440;
+
+// Arrival time at a search origin: earlier than every real sailing, and
+// still safe to add a layover to without overflowing
+const int SEARCH_START_MINUTES = -(1 << 30);
+
+// A sailing leaving at departureMinutes can be caught after arriving at
+// arrivalMinutes (both epoch minutes) with at least minLayoverMinutes to spare
+inline bool canConnect(int arrivalMinutes, int departureMinutes, int minLayoverMinutes) {
+ return departureMinutes - arrivalMinutes >= minLayoverMinutes;
+}
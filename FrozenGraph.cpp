@@ -0,0 +1,295 @@
+#include "FrozenGraph.h"
+#include "Graph.h"
+#include <algorithm>
+#include <limits.h>
+
+using namespace std;
+
+Sailing makeSailing(int destinationId, const Date& date, const Time& dep, const Time& arr, int cost, int companyId) {
+    int depMinutes = dep.hour * 60 + dep.minute;
+    int arrMinutes = arr.hour * 60 + arr.minute;
+
+    Sailing s;
+    s.departure = toEpochMinutes(date, dep);
+    s.destinationId = destinationId;
+    s.voyageCost = cost;
+    s.companyId = (uint16_t)companyId;
+    s.duration = (uint16_t)((arrMinutes - depMinutes + MINUTES_PER_DAY) % MINUTES_PER_DAY);
+    return s;
+}
+
+static bool departsBefore(const Sailing& a, const Sailing& b) {
+    return a.departure < b.departure;
+}
+
+static bool departsBeforeMinute(const Sailing& s, int minutes) {
+    return s.departure < minutes;
+}
+
+int firstDepartureFrom(const FrozenGraph& fg, int portId, int minutes) {
+    const Sailing* begin = fg.edges + fg.firstEdge[portId];
+    const Sailing* end = fg.edges + fg.firstEdge[portId + 1];
+    return (int)(lower_bound(begin, end, minutes, departsBeforeMinute) - fg.edges);
+}
+
+int lastArrivalInto(const FrozenGraph& fg, int portId, int minutes) {
+    int lo = fg.firstIncoming[portId];
+    int hi = fg.firstIncoming[portId + 1];
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (sailingArrival(fg.edges[fg.incomingEdge[mid]]) <= minutes) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+FrozenGraph* newFrozenGraph(int portCount, int edgeCount) {
+    FrozenGraph* fg = new FrozenGraph();
+    fg->portCount = portCount;
+    fg->edgeCount = edgeCount;
+    fg->firstEdge = new int[portCount + 1];
+    fg->edges = new Sailing[edgeCount > 0 ? edgeCount : 1];
+    fg->views = new atomic<Route*>[edgeCount > 0 ? edgeCount : 1];
+    for (int e = 0; e < edgeCount; e++) {
+        fg->views[e].store(nullptr, memory_order_relaxed);
+    }
+    return fg;
+}
+
+// Published versions are never written, so the read-only mapping can
+// stand in for the arrays
+FrozenGraph* newMappedFrozenGraph(int portCount, int edgeCount, MappedFile& file, const int* firstEdge, const Sailing* edges) {
+    FrozenGraph* fg = new FrozenGraph();
+    fg->portCount = portCount;
+    fg->edgeCount = edgeCount;
+    fg->firstEdge = const_cast<int*>(firstEdge);
+    fg->edges = const_cast<Sailing*>(edges);
+    fg->views = new atomic<Route*>[edgeCount > 0 ? edgeCount : 1];
+    for (int e = 0; e < edgeCount; e++) {
+        fg->views[e].store(nullptr, memory_order_relaxed);
+    }
+    fg->file = file;
+    file = MappedFile();
+    return fg;
+}
+
+void deleteFrozenGraph(FrozenGraph* fg) {
+    if (!fg) return;
+    if (fg->file.data) {
+        unmapFile(fg->file);
+    } else {
+        delete[] fg->firstEdge;
+        delete[] fg->edges;
+    }
+    delete[] fg->firstIncoming;
+    delete[] fg->incomingEdge;
+    delete[] fg->incomingFrom;
+    delete[] fg->views;
+    releaseArena(fg->viewArena);
+    delete fg;
+}
+
+// Merges the current version and the pending sailings into a new version.
+// The current version is only read, so pinned searches keep running on it.
+void freezeGraph(Graph& g) {
+    lock_guard<mutex> lock(g.updateLock);
+    const FrozenGraph* old = g.frozen.load();
+    int portCount = g.portCount;
+    int oldPortCount = old ? old->portCount : 0;
+
+    int edgeCount = (old ? old->edgeCount : 0) + g.pendingCount;
+    FrozenGraph* fg = newFrozenGraph(portCount, edgeCount);
+    int* firstEdge = fg->firstEdge;
+    Sailing* edges = fg->edges;
+
+    for (int id = 0; id <= portCount; id++) {
+        firstEdge[id] = 0;
+    }
+    for (int id = 0; id < oldPortCount; id++) {
+        firstEdge[id + 1] += old->firstEdge[id + 1] - old->firstEdge[id];
+    }
+    for (int i = 0; i < g.pendingCount; i++) {
+        firstEdge[g.pending[i].originId + 1]++;
+    }
+    for (int id = 0; id < portCount; id++) {
+        firstEdge[id + 1] += firstEdge[id];
+    }
+
+    int* fill = new int[portCount > 0 ? portCount : 1];
+    for (int id = 0; id < portCount; id++) {
+        fill[id] = firstEdge[id];
+        if (id < oldPortCount) {
+            for (int e = old->firstEdge[id]; e < old->firstEdge[id + 1]; e++) {
+                edges[fill[id]++] = old->edges[e];
+            }
+        }
+    }
+    for (int i = 0; i < g.pendingCount; i++) {
+        edges[fill[g.pending[i].originId]++] = g.pending[i].sailing;
+    }
+    delete[] fill;
+
+    // Stable so sailings with equal departures keep their load order
+    for (int id = 0; id < portCount; id++) {
+        stable_sort(edges + firstEdge[id], edges + firstEdge[id + 1], departsBefore);
+    }
+
+    publishFrozenGraph(g, fg);
+
+    // The staging buffer is only needed again if more sailings arrive
+    delete[] g.pending;
+    g.pending = nullptr;
+    g.pendingCount = 0;
+    g.pendingCapacity = 0;
+}
+
+static bool needsFreeze(const Graph& g, const FrozenGraph* fg) {
+    return !fg || g.pendingCount > 0 || fg->portCount != g.portCount;
+}
+
+const FrozenGraph& getFrozenGraph(Graph& g) {
+    if (needsFreeze(g, g.frozen.load())) {
+        freezeGraph(g);
+    }
+    return *g.frozen.load();
+}
+
+// pinsInProgress lets reclaimFrozenGraphs tell a reader that has loaded
+// frozen but not yet bumped its pin count from one that holds no pin
+const FrozenGraph* acquireFrozenGraph(Graph& g) {
+    if (needsFreeze(g, g.frozen.load())) {
+        freezeGraph(g);
+    }
+    g.pinsInProgress.fetch_add(1);
+    const FrozenGraph* fg = g.frozen.load();
+    fg->pinCount.fetch_add(1);
+    g.pinsInProgress.fetch_sub(1);
+    return fg;
+}
+
+// Only the pointer is compared once the pin is gone: another thread's
+// reclaim may already have freed the version
+void releaseFrozenGraph(const FrozenGraph* fg) {
+    if (!fg) return;
+    Graph* g = fg->owner;
+    if (fg->pinCount.fetch_sub(1) != 1 || !g) return;
+    if (g->frozen.load() != fg) {
+        lock_guard<mutex> lock(g->updateLock);
+        reclaimFrozenGraphs(*g);
+    }
+}
+
+struct ArrivesBefore {
+    const Sailing* edges;
+    bool operator()(int a, int b) const { return sailingArrival(edges[a]) < sailingArrival(edges[b]); }
+};
+
+// Counting sort of the edges by destination, then each slice by arrival
+static void buildIncomingIndex(FrozenGraph& fg) {
+    int portCount = fg.portCount;
+    int edgeCount = fg.edgeCount;
+    fg.firstIncoming = new int[portCount + 1];
+    fg.incomingEdge = new int[edgeCount > 0 ? edgeCount : 1];
+    fg.incomingFrom = new int[edgeCount > 0 ? edgeCount : 1];
+
+    for (int id = 0; id <= portCount; id++) {
+        fg.firstIncoming[id] = 0;
+    }
+    for (int e = 0; e < edgeCount; e++) {
+        fg.firstIncoming[fg.edges[e].destinationId + 1]++;
+    }
+    for (int id = 0; id < portCount; id++) {
+        fg.firstIncoming[id + 1] += fg.firstIncoming[id];
+    }
+
+    int* fill = new int[portCount > 0 ? portCount : 1];
+    for (int id = 0; id < portCount; id++) {
+        fill[id] = fg.firstIncoming[id];
+    }
+    for (int from = 0; from < portCount; from++) {
+        for (int e = fg.firstEdge[from]; e < fg.firstEdge[from + 1]; e++) {
+            fg.incomingEdge[fill[fg.edges[e].destinationId]++] = e;
+        }
+    }
+    delete[] fill;
+
+    ArrivesBefore byArrival = {fg.edges};
+    for (int id = 0; id < portCount; id++) {
+        stable_sort(fg.incomingEdge + fg.firstIncoming[id], fg.incomingEdge + fg.firstIncoming[id + 1], byArrival);
+    }
+
+    // An edge's origin is the port whose slice of firstEdge holds it
+    for (int k = 0; k < edgeCount; k++) {
+        int e = fg.incomingEdge[k];
+        fg.incomingFrom[k] = (int)(upper_bound(fg.firstEdge, fg.firstEdge + portCount + 1, e) - fg.firstEdge) - 1;
+    }
+}
+
+void publishFrozenGraph(Graph& g, FrozenGraph* next) {
+    next->minVoyageCost = next->edgeCount > 0 ? INT_MAX : 0;
+    next->maxVoyageCost = 0;
+    next->maxDuration = 0;
+    for (int e = 0; e < next->edgeCount; e++) {
+        const Sailing& s = next->edges[e];
+        if (s.voyageCost < next->minVoyageCost) next->minVoyageCost = s.voyageCost;
+        if (s.voyageCost > next->maxVoyageCost) next->maxVoyageCost = s.voyageCost;
+        if (s.duration > next->maxDuration) next->maxDuration = s.duration;
+    }
+    buildIncomingIndex(*next);
+
+    FrozenGraph* old = g.frozen.load();
+    next->version = old ? old->version + 1 : 1;
+    next->owner = &g;
+    g.frozen.store(next);
+    if (old) {
+        old->nextRetired = g.retired;
+        g.retired = old;
+    }
+    reclaimFrozenGraphs(g);
+}
+
+void reclaimFrozenGraphs(Graph& g) {
+    if (g.pinsInProgress.load() != 0) return;
+    FrozenGraph** link = &g.retired;
+    while (*link) {
+        FrozenGraph* fg = *link;
+        if (fg->pinCount.load() == 0) {
+            *link = fg->nextRetired;
+            deleteFrozenGraph(fg);
+        } else {
+            link = &fg->nextRetired;
+        }
+    }
+}
+
+void expandSailing(const Graph& g, const FrozenGraph& fg, int edge, Route& out) {
+    const Sailing& s = fg.edges[edge];
+    out.destinationPort = g.portById[s.destinationId]->name;
+    out.destinationId = s.destinationId;
+    fromEpochMinutes(s.departure, out.voyageDate, out.departureTime);
+    int arrMinutes = (out.departureTime.hour * 60 + out.departureTime.minute + s.duration) % MINUTES_PER_DAY;
+    out.arrivalTime.hour = arrMinutes / 60;
+    out.arrivalTime.minute = arrMinutes % 60;
+    out.departureMinutes = s.departure;
+    out.arrivalMinutes = sailingArrival(s);
+    out.voyageCost = s.voyageCost;
+    out.shippingCompany = g.companyNames[s.companyId];
+    out.companyId = s.companyId;
+    out.next = nullptr;
+}
+
+// Several searches may ask for the same view; the version's arena is not
+// thread-safe, so building one is serialised on viewLock
+Route* getRouteView(Graph& g, const FrozenGraph& fg, int edge) {
+    Route* r = fg.views[edge].load(memory_order_acquire);
+    if (r) return r;
+
+    lock_guard<mutex> lock(g.viewLock);
+    r = fg.views[edge].load(memory_order_relaxed);
+    if (!r) {
+        r = arenaNew<Route>(fg.viewArena);
+        expandSailing(g, fg, edge, *r);
+        fg.views[edge].store(r, memory_order_release);
+    }
+    return r;
+}
@@ -0,0 +1,94 @@
+#ifndef FROZEN_GRAPH_H
+#define FROZEN_GRAPH_H
+
+#include <atomic>
+#include <cstdint>
+#include "Route.h"
+#include "Arena.h"
+#include "MappedFile.h"
+
+using namespace std;
+
+struct Graph;
+
+// One sailing packed into 16 bytes. departure is in epoch minutes (see
+// DateTime.h), duration is in minutes and always under a day (an arrival
+// clock time earlier than the departure means the next day), and companyId
+// indexes Graph::companyNames.
+struct Sailing {
+    int32_t departure;
+    int32_t destinationId;
+    int32_t voyageCost;
+    uint16_t companyId;
+    uint16_t duration;
+};
+
+// A sailing added since the last freeze, waiting to be merged into the CSR arrays
+struct PendingSailing {
+    int originId;
+    Sailing sailing;
+};
+
+// One published version of the timetable in compressed-sparse-row form.
+// Sailings leaving port id u are edges[firstEdge[u] .. firstEdge[u + 1]),
+// sorted by departure. A version is never modified once published:
+// freezes and schedule updates build a new one and swap it in, and the old
+// one is reclaimed once no search has it pinned (see acquireFrozenGraph).
+// views[e] caches the Route built for edge e by getRouteView; it stays
+// null until someone asks for it, and the Routes live in viewArena, so
+// they go with the version. owner is the graph it was published in. If
+// file holds a mapping, firstEdge and edges point into it rather than
+// owning arrays, and it is unmapped with the version. The fare and duration bounds and the
+// reverse index are filled in when the version is published: the sailings
+// arriving at port v are incomingEdge[firstIncoming[v] .. firstIncoming[v + 1]),
+// sorted by arrival, and incomingFrom holds the port each one leaves from.
+struct FrozenGraph {
+    unsigned long long version;
+    int portCount;
+    int edgeCount;
+    int minVoyageCost;
+    int maxVoyageCost;
+    int maxDuration;
+    int* firstEdge;
+    Sailing* edges;
+    int* firstIncoming;
+    int* incomingEdge;
+    int* incomingFrom;
+    atomic<Route*>* views;
+    mutable Arena viewArena;
+    MappedFile file;
+    Graph* owner;
+    mutable atomic<int> pinCount;
+    FrozenGraph* nextRetired;
+
+    FrozenGraph() : version(0), portCount(0), edgeCount(0), minVoyageCost(0), maxVoyageCost(0), maxDuration(0), firstEdge(nullptr), edges(nullptr), firstIncoming(nullptr), incomingEdge(nullptr), incomingFrom(nullptr), views(nullptr), owner(nullptr), pinCount(0), nextRetired(nullptr) {}
+};
+
+// Most companies a uint16 company id can address
+const int MAX_COMPANIES = 65535;
+
+inline int sailingArrival(const Sailing& s) {
+    return s.departure + s.duration;
+}
+
+Sailing makeSailing(int destinationId, const Date& date, const Time& dep, const Time& arr, int cost, int companyId);
+
+// First edge of portId departing at or after minutes (epoch minutes), or
+// firstEdge[portId + 1] if there is none. The slice is sorted by departure,
+// so this is a binary search.
+int firstDepartureFrom(const FrozenGraph& fg, int portId, int minutes);
+
+// End of the incoming slice of portId: the first sailing into it arriving
+// after minutes, or firstIncoming[portId + 1] if there is none
+int lastArrivalInto(const FrozenGraph& fg, int portId, int minutes);
+
+// Allocates a version with room for the given counts and no cached views
+FrozenGraph* newFrozenGraph(int portCount, int edgeCount);
+
+// A version reading firstEdge and edges straight out of file, which it
+// takes over (file is left empty); both must lie inside the mapping
+FrozenGraph* newMappedFrozenGraph(int portCount, int edgeCount, MappedFile& file, const int* firstEdge, const Sailing* edges);
+
+void deleteFrozenGraph(FrozenGraph* fg);
+
+#endif
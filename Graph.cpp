@@ -1,91 +1,241 @@
 
 
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <cstring>
 #include "Graph.h"
 #include "DateTime.h"
+#include "RouteLoader.h"
 
 using namespace std;
 
-Port* findPort(Graph& g, const string& name) {
-	Port* cur = g.portHead;
-	while (cur) {
-		if (cur->name == name) return cur;
-		cur = cur->next;
+static unsigned int hashName(const char* name, int length) {
+	unsigned int h = 2166136261u;
+	for (int i = 0; i < length; i++) {
+		h ^= (unsigned char)name[i];
+		h *= 16777619u;
 	}
-	return nullptr;
+	return h;
 }
 
-Port* addPortIfNotExists(Graph& g, const string& name) {
-	Port* p = findPort(g, name);
-	if (p) return p;
-	p = new Port();
-	p->name = name;
-	p->routeHead = nullptr;
+// Inserts an already-assigned port id into the name index (linear probing)
+static void insertIntoNameIndex(Graph& g, int portId) {
+	unsigned int mask = (unsigned int)g.nameIndexCapacity - 1;
+	const Port* p = g.portById[portId];
+	unsigned int slot = hashName(p->name, p->nameLength) & mask;
+	while (g.nameIndex[slot] != -1) {
+		slot = (slot + 1) & mask;
+	}
+	g.nameIndex[slot] = portId;
+}
+
+// Keeps the index at most half full so probe chains stay short
+static void growNameIndex(Graph& g) {
+	int newCapacity = g.nameIndexCapacity == 0 ? 64 : g.nameIndexCapacity * 2;
+	delete[] g.nameIndex;
+	g.nameIndex = new int[newCapacity];
+	g.nameIndexCapacity = newCapacity;
+	for (int i = 0; i < newCapacity; i++) {
+		g.nameIndex[i] = -1;
+	}
+	for (int id = 0; id < g.portCount; id++) {
+		insertIntoNameIndex(g, id);
+	}
+}
+
+static void growPortTable(Graph& g) {
+	int newCapacity = g.portCapacity == 0 ? 64 : g.portCapacity * 2;
+	Port** newTable = new Port*[newCapacity];
+	for (int i = 0; i < g.portCount; i++) {
+		newTable[i] = g.portById[i];
+	}
+	delete[] g.portById;
+	g.portById = newTable;
+	g.portCapacity = newCapacity;
+}
+
+static void insertIntoCompanyIndex(Graph& g, int companyId) {
+	unsigned int mask = (unsigned int)g.companyIndexCapacity - 1;
+	const char* name = g.companyNames[companyId];
+	unsigned int slot = hashName(name, (int)strlen(name)) & mask;
+	while (g.companyIndex[slot] != -1) {
+		slot = (slot + 1) & mask;
+	}
+	g.companyIndex[slot] = companyId;
+}
+
+static void growCompanyIndex(Graph& g) {
+	int newCapacity = g.companyIndexCapacity == 0 ? 64 : g.companyIndexCapacity * 2;
+	delete[] g.companyIndex;
+	g.companyIndex = new int[newCapacity];
+	g.companyIndexCapacity = newCapacity;
+	for (int i = 0; i < newCapacity; i++) {
+		g.companyIndex[i] = -1;
+	}
+	for (int id = 0; id < g.companyCount; id++) {
+		insertIntoCompanyIndex(g, id);
+	}
+}
+
+// Hashed name -> dense port id lookup, -1 if the port is unknown.
+// Takes a raw character range so loaders can probe without building a string.
+int findPortId(const Graph& g, const char* name, int length) {
+	if (g.nameIndexCapacity == 0) return -1;
+	unsigned int mask = (unsigned int)g.nameIndexCapacity - 1;
+	unsigned int slot = hashName(name, length) & mask;
+	while (g.nameIndex[slot] != -1) {
+		int id = g.nameIndex[slot];
+		const Port* candidate = g.portById[id];
+		if (candidate->nameLength == length && memcmp(candidate->name, name, length) == 0) return id;
+		slot = (slot + 1) & mask;
+	}
+	return -1;
+}
+
+int findPortId(const Graph& g, const string& name) {
+	return findPortId(g, name.data(), (int)name.size());
+}
+
+Port* findPort(Graph& g, const string& name) {
+	int id = findPortId(g, name);
+	return id >= 0 ? g.portById[id] : nullptr;
+}
+
+Port* addPortIfNotExists(Graph& g, const char* name, int length) {
+	int existing = findPortId(g, name, length);
+	if (existing >= 0) return g.portById[existing];
+	Port* p = arenaNew<Port>(g.arena);
+	p->name = arenaCopyString(g.arena, name, length);
+	p->nameLength = length;
 	p->next = g.portHead;
 	g.portHead = p;
+
+	if (g.portCount >= g.portCapacity) {
+		growPortTable(g);
+	}
+	p->id = g.portCount;
+	g.portById[p->id] = p;
 	g.portCount++;
+
+	if (g.portCount * 2 > g.nameIndexCapacity) {
+		growNameIndex(g);
+	} else {
+		insertIntoNameIndex(g, p->id);
+	}
 	return p;
 }
 
-void addRoute(Graph& g, const string& origin, const string& destination, const Date& date, const Time& dep, const Time& arr, int cost, const string& company) {
-	Port* originPort = addPortIfNotExists(g, origin);
-	addPortIfNotExists(g, destination);
-	Route* r = createRoute(destination, date, dep, arr, cost, company);
-	originPort->routeHead = prependRoute(originPort->routeHead, r);
+Port* addPortIfNotExists(Graph& g, const string& name) {
+	return addPortIfNotExists(g, name.data(), (int)name.size());
 }
 
-static bool parseLine(const string& line, string& origin, string& destination, Date& date, Time& dep, Time& arr, int& cost, string& company) {
-	if (line.empty()) return false;
-	istringstream iss(line);
-	string dateStr, depStr, arrStr;
-	if (!(iss >> origin >> destination >> dateStr >> depStr >> arrStr >> cost >> company)) {
-		return false;
+// Company names are stored once in the arena, so every route of a company shares one pointer.
+// Returns -1 once MAX_COMPANIES distinct names exist.
+int internCompany(Graph& g, const char* name, int length) {
+	if (g.companyIndexCapacity > 0) {
+		unsigned int mask = (unsigned int)g.companyIndexCapacity - 1;
+		unsigned int slot = hashName(name, length) & mask;
+		while (g.companyIndex[slot] != -1) {
+			int id = g.companyIndex[slot];
+			const char* candidate = g.companyNames[id];
+			if (memcmp(candidate, name, length) == 0 && candidate[length] == '\0') return id;
+			slot = (slot + 1) & mask;
+		}
+	}
+
+	if (g.companyCount >= MAX_COMPANIES) {
+		return -1;
+	}
+
+	if (g.companyCount >= g.companyCapacity) {
+		int newCapacity = g.companyCapacity == 0 ? 64 : g.companyCapacity * 2;
+		const char** newNames = new const char*[newCapacity];
+		for (int i = 0; i < g.companyCount; i++) {
+			newNames[i] = g.companyNames[i];
+		}
+		delete[] g.companyNames;
+		g.companyNames = newNames;
+		g.companyCapacity = newCapacity;
+	}
+	int id = g.companyCount++;
+	g.companyNames[id] = arenaCopyString(g.arena, name, length);
+
+	if (g.companyCount * 2 > g.companyIndexCapacity) {
+		growCompanyIndex(g);
+	} else {
+		insertIntoCompanyIndex(g, id);
 	}
-	date = parseDate(dateStr);
-	dep = parseTime(depStr);
-	arr = parseTime(arrStr);
+	return id;
+}
+
+// Queues a packed sailing; it becomes visible to searches at the next freeze
+void addRouteById(Graph& g, int originId, int destinationId, const Date& date, const Time& dep, const Time& arr, int cost, int companyId) {
+	if (g.pendingCount >= g.pendingCapacity) {
+		int newCapacity = g.pendingCapacity == 0 ? 256 : g.pendingCapacity * 2;
+		PendingSailing* newPending = new PendingSailing[newCapacity];
+		for (int i = 0; i < g.pendingCount; i++) {
+			newPending[i] = g.pending[i];
+		}
+		delete[] g.pending;
+		g.pending = newPending;
+		g.pendingCapacity = newCapacity;
+	}
+	PendingSailing& p = g.pending[g.pendingCount++];
+	p.originId = originId;
+	p.sailing = makeSailing(destinationId, date, dep, arr, cost, companyId);
+}
+
+// Returns false when the sailing is dropped because the company table is full
+bool addRoute(Graph& g, const string& origin, const string& destination, const Date& date, const Time& dep, const Time& arr, int cost, const string& company) {
+	Port* originPort = addPortIfNotExists(g, origin);
+	Port* destPort = addPortIfNotExists(g, destination);
+	int companyId = internCompany(g, company.data(), (int)company.size());
+	if (companyId < 0) return false;
+	addRouteById(g, originPort->id, destPort->id, date, dep, arr, cost, companyId);
 	return true;
 }
 
 // Parses Routes.txt and populates graph with all voyage routes
 bool loadRoutesFromFile(Graph& g, const string& filePath) {
-	ifstream fin(filePath.c_str());
-	if (!fin.is_open()) {
+	RouteLoadStats stats;
+	if (!loadRoutesParallel(g, filePath, stats)) {
 		cout << "Failed to open routes file: " << filePath << endl;
 		return false;
 	}
-	string line;
-	int lineCount = 0;
-	while (getline(fin, line)) {
-		if (line.empty()) continue;
-		string origin, destination, company; Date date; Time dep; Time arr; int cost;
-		if (parseLine(line, origin, destination, date, dep, arr, cost, company)) {
-			addRoute(g, origin, destination, date, dep, arr, cost, company);
-			lineCount++;
-		}
-		else {
-			cout << "Invalid line skipped: " << line << endl;
-		}
-	}
-	cout << "Loaded " << lineCount << " routes." << endl;
+	cout << "Loaded " << stats.linesAccepted << " routes." << endl;
+	printRouteLoadStats(stats);
+	freezeGraph(g);
 	return true;
 }
 
+// Ports, route views and all names live in the arena, so teardown is one release.
+// Every version goes, pinned or not: no search may outlive the graph.
 void freeGraph(Graph& g) {
-	Port* p = g.portHead;
-	while (p) {
-		Route* r = p->routeHead;
-		while (r) {
-			Route* nextR = r->next;
-			delete r;
-			r = nextR;
-		}
-		Port* nextP = p->next;
-		delete p;
-		p = nextP;
+	deleteFrozenGraph(g.frozen.exchange(nullptr));
+	while (g.retired) {
+		FrozenGraph* next = g.retired->nextRetired;
+		deleteFrozenGraph(g.retired);
+		g.retired = next;
 	}
+	delete[] g.pending;
+	g.pending = nullptr;
+	g.pendingCount = 0;
+	g.pendingCapacity = 0;
+	releaseArena(g.arena);
 	g.portHead = nullptr;
 	g.portCount = 0;
+
+	delete[] g.portById;
+	g.portById = nullptr;
+	g.portCapacity = 0;
+	delete[] g.nameIndex;
+	g.nameIndex = nullptr;
+	g.nameIndexCapacity = 0;
+
+	delete[] g.companyNames;
+	g.companyNames = nullptr;
+	g.companyCount = 0;
+	g.companyCapacity = 0;
+	delete[] g.companyIndex;
+	g.companyIndex = nullptr;
+	g.companyIndexCapacity = 0;
 }
@@ -2,32 +2,129 @@
 
 #include <string>
 #include <iostream>
+#include <atomic>
+#include <mutex>
 #include "Route.h"
+#include "FrozenGraph.h"
+#include "Arena.h"
 
 using namespace std;
 
 struct Port {
- string name;
- string normalizedName;
- Route *routeHead;
+ const char *name;
+ int nameLength;
+ int id;
  Port *next;
  int dailyCharge;
 
- Port() : name(), normalizedName(), routeHead(nullptr), next(nullptr), dailyCharge(-1) {}
+ Port() : name(""), nameLength(0), id(-1), next(nullptr), dailyCharge(-1) {}
 };
 
+// Ports are interned at load time: each gets a dense id (0..portCount-1),
+// portById maps id -> Port and nameIndex is an open-addressing hash table
+// of port ids keyed by name (-1 marks an empty slot). Company names are
+// interned the same way. Sailings are stored packed in the frozen CSR arrays
+// (see FrozenGraph.h); new ones wait in pending until the next freeze.
+// Port nodes, Route views and all names are allocated from the graph's
+// arena and released together by freeGraph.
+//
+// frozen is the published timetable version. Writers (freezes and schedule
+// updates) hold updateLock, build a new version and swap it in; versions
+// they replace wait on the retired list until no search has them pinned.
+// Searches pin without locking. Name interning (new ports or companies)
+// and pending sailings belong to the loading/UI thread and must not
+// overlap searches running on other threads.
 struct Graph {
  Port *portHead;
  int portCount;
- Graph() : portHead(nullptr), portCount(0) {}
+
+ Port **portById;
+ int portCapacity;
+
+ int *nameIndex;
+ int nameIndexCapacity;
+
+ const char **companyNames;
+ int companyCount;
+ int companyCapacity;
+
+ int *companyIndex;
+ int companyIndexCapacity;
+
+ PendingSailing *pending;
+ int pendingCount;
+ int pendingCapacity;
+
+ atomic<FrozenGraph*> frozen;
+ FrozenGraph *retired;
+ atomic<int> pinsInProgress;
+ mutex updateLock;
+
+ Arena arena;
+ mutex viewLock;
+
+ Graph() : portHead(nullptr), portCount(0), portById(nullptr), portCapacity(0), nameIndex(nullptr), nameIndexCapacity(0),
+  companyNames(nullptr), companyCount(0), companyCapacity(0), companyIndex(nullptr), companyIndexCapacity(0),
+  pending(nullptr), pendingCount(0), pendingCapacity(0), frozen(nullptr), retired(nullptr), pinsInProgress(0), arena() {}
 };
 
 Port* findPort(Graph &g, const string &name);
 
+int findPortId(const Graph &g, const string &name);
+
+int findPortId(const Graph &g, const char *name, int length);
+
 Port* addPortIfNotExists(Graph &g, const string &name);
 
-void addRoute(Graph &g, const string &origin, const string &destination, const Date &date, const Time &dep, const Time &arr, int cost, const string &company);
+Port* addPortIfNotExists(Graph &g, const char *name, int length);
+
+int internCompany(Graph &g, const char *name, int length);
+
+void addRouteById(Graph &g, int originId, int destinationId, const Date &date, const Time &dep, const Time &arr, int cost, int companyId);
+
+bool addRoute(Graph &g, const string &origin, const string &destination, const Date &date, const Time &dep, const Time &arr, int cost, const string &company);
 
 bool loadRoutesFromFile(Graph &g, const string &filePath);
 
+void freezeGraph(Graph &g);
+
+// Current version without a pin, for the thread that owns the graph when
+// no other thread applies updates (loading, snapshots)
+const FrozenGraph& getFrozenGraph(Graph &g);
+
+// Pins the current version so it outlives any update published while a
+// search is using it. Lock-free; pair with releaseFrozenGraph.
+const FrozenGraph* acquireFrozenGraph(Graph &g);
+
+// Dropping the last pin on a version that has since been replaced frees
+// it there and then, taking updateLock; never call it with that lock held
+void releaseFrozenGraph(const FrozenGraph *fg);
+
+// Records the fare and duration bounds of next, builds its reverse index,
+// swaps it in and retires the old version; caller holds updateLock
+void publishFrozenGraph(Graph &g, FrozenGraph *next);
+
+// Frees retired versions that are no longer pinned; caller holds updateLock
+void reclaimFrozenGraphs(Graph &g);
+
+// Holds a pin for the lifetime of a search
+struct FrozenGraphPin {
+ const FrozenGraph *fg;
+
+ explicit FrozenGraphPin(Graph &g) : fg(acquireFrozenGraph(g)) {}
+ ~FrozenGraphPin() { releaseFrozenGraph(fg); }
+
+ FrozenGraphPin(const FrozenGraphPin &) = delete;
+ FrozenGraphPin &operator=(const FrozenGraphPin &) = delete;
+};
+
+// Expands CSR edge e of version fg into a Route value; the names point into the arena
+void expandSailing(const Graph &g, const FrozenGraph &fg, int edge, Route &out);
+
+// Route for CSR edge e of version fg, built on first use and freed with
+// the version, so only use it while fg is pinned. Prefer expandSailing
+// for short-lived copies so the version's view arena does not grow.
+Route* getRouteView(Graph &g, const FrozenGraph &fg, int edge);
+
 void freeGraph(Graph &g);
+
@@ -0,0 +1,232 @@
+#include "GraphSnapshot.h"
+#include "MappedFile.h"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <sys/stat.h>
+
+using namespace std;
+
+static const char SNAPSHOT_MAGIC[8] = { 'O', 'R', 'N', 'S', 'N', 'A', 'P', '\0' };
+
+// Fixed-size header at the start of the file; everything after it is the
+// payload covered by the checksum.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    int64_t routesSize;
+    int64_t routesModified;
+    int64_t chargesSize;
+    int64_t chargesModified;
+    int32_t portCount;
+    int32_t companyCount;
+    int32_t edgeCount;
+    int32_t stringBytes;
+    uint64_t payloadBytes;
+    uint64_t checksum;
+};
+
+// Payload layout, in order:
+//   int32 portNameOffset[portCount + 1]      into the string blob
+//   int32 companyOffset[companyCount + 1]    into the string blob
+//   int32 dailyCharge[portCount]
+//   int32 firstEdge[portCount + 1]
+//   Sailing edges[edgeCount]                 CSR order, sorted by departure per port
+//   char strings[stringBytes]
+
+static uint64_t checksumBytes(const char* data, size_t size) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Missing files are recorded as size -1 so that creating one later invalidates the snapshot
+static void sourceFileStamp(const string& path, int64_t& size, int64_t& modified) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        size = -1;
+        modified = 0;
+        return;
+    }
+    size = (int64_t)st.st_size;
+    modified = (int64_t)st.st_mtime;
+}
+
+static size_t payloadSizeFor(int portCount, int companyCount, int edgeCount, int stringBytes) {
+    return sizeof(int32_t) * (portCount + 1)
+        + sizeof(int32_t) * (companyCount + 1)
+        + sizeof(int32_t) * portCount
+        + sizeof(int32_t) * (portCount + 1)
+        + sizeof(Sailing) * edgeCount
+        + stringBytes;
+}
+
+bool saveGraphSnapshot(Graph& g, const string& snapshotPath, const string& routesPath, const string& chargesPath) {
+    const FrozenGraph& fg = getFrozenGraph(g);
+    int portCount = g.portCount;
+    int edgeCount = fg.edgeCount;
+
+    int32_t* portNameOffset = new int32_t[portCount + 1];
+    int companyCount = g.companyCount;
+    int32_t* companyOffset = new int32_t[companyCount + 1];
+    int32_t* dailyCharge = new int32_t[portCount > 0 ? portCount : 1];
+    int32_t stringBytes = 0;
+    for (int id = 0; id < portCount; id++) {
+        portNameOffset[id] = stringBytes;
+        stringBytes += (int32_t)g.portById[id]->nameLength;
+        dailyCharge[id] = g.portById[id]->dailyCharge;
+    }
+    portNameOffset[portCount] = stringBytes;
+    for (int c = 0; c < companyCount; c++) {
+        companyOffset[c] = stringBytes;
+        stringBytes += (int32_t)strlen(g.companyNames[c]);
+    }
+    companyOffset[companyCount] = stringBytes;
+
+    size_t payloadBytes = payloadSizeFor(portCount, companyCount, edgeCount, stringBytes);
+
+    char* payload = new char[payloadBytes > 0 ? payloadBytes : 1];
+    char* out = payload;
+    memcpy(out, portNameOffset, sizeof(int32_t) * (portCount + 1)); out += sizeof(int32_t) * (portCount + 1);
+    memcpy(out, companyOffset, sizeof(int32_t) * (companyCount + 1)); out += sizeof(int32_t) * (companyCount + 1);
+    memcpy(out, dailyCharge, sizeof(int32_t) * portCount); out += sizeof(int32_t) * portCount;
+    memcpy(out, fg.firstEdge, sizeof(int32_t) * (portCount + 1)); out += sizeof(int32_t) * (portCount + 1);
+    memcpy(out, fg.edges, sizeof(Sailing) * edgeCount); out += sizeof(Sailing) * edgeCount;
+    for (int id = 0; id < portCount; id++) {
+        memcpy(out, g.portById[id]->name, g.portById[id]->nameLength);
+        out += g.portById[id]->nameLength;
+    }
+    for (int c = 0; c < companyCount; c++) {
+        int length = companyOffset[c + 1] - companyOffset[c];
+        memcpy(out, g.companyNames[c], length);
+        out += length;
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_FORMAT_VERSION;
+    header.headerSize = sizeof(SnapshotHeader);
+    sourceFileStamp(routesPath, header.routesSize, header.routesModified);
+    sourceFileStamp(chargesPath, header.chargesSize, header.chargesModified);
+    header.portCount = portCount;
+    header.companyCount = companyCount;
+    header.edgeCount = edgeCount;
+    header.stringBytes = stringBytes;
+    header.payloadBytes = payloadBytes;
+    header.checksum = checksumBytes(payload, payloadBytes);
+
+    // Write next to the target and swap it in, so a crash never leaves a half-written snapshot
+    string tempPath = snapshotPath + ".tmp";
+    bool ok = false;
+    FILE* f = fopen(tempPath.c_str(), "wb");
+    if (f) {
+        ok = fwrite(&header, sizeof(header), 1, f) == 1;
+        if (ok && payloadBytes > 0) ok = fwrite(payload, payloadBytes, 1, f) == 1;
+        if (fclose(f) != 0) ok = false;
+        if (ok) {
+            remove(snapshotPath.c_str());
+            ok = rename(tempPath.c_str(), snapshotPath.c_str()) == 0;
+        }
+        if (!ok) remove(tempPath.c_str());
+    }
+
+    delete[] payload;
+    delete[] portNameOffset;
+    delete[] companyOffset;
+    delete[] dailyCharge;
+    return ok;
+}
+
+// Header checks that do not need to touch the payload
+static bool snapshotHeaderUsable(const SnapshotHeader& header, size_t fileSize, const string& routesPath, const string& chargesPath) {
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        cout << "Snapshot ignored: not a route snapshot." << endl;
+        return false;
+    }
+    if (header.version != SNAPSHOT_FORMAT_VERSION || header.headerSize != sizeof(SnapshotHeader)) {
+        cout << "Snapshot ignored: format version " << header.version << ", expected " << SNAPSHOT_FORMAT_VERSION << "." << endl;
+        return false;
+    }
+    if (header.portCount < 0 || header.companyCount < 0 || header.edgeCount < 0 || header.stringBytes < 0
+        || header.payloadBytes != fileSize - sizeof(SnapshotHeader)
+        || header.payloadBytes != payloadSizeFor(header.portCount, header.companyCount, header.edgeCount, header.stringBytes)) {
+        cout << "Snapshot ignored: size does not match its header." << endl;
+        return false;
+    }
+
+    int64_t size, modified;
+    sourceFileStamp(routesPath, size, modified);
+    if (size != header.routesSize || modified != header.routesModified) {
+        cout << "Snapshot ignored: " << routesPath << " has changed." << endl;
+        return false;
+    }
+    sourceFileStamp(chargesPath, size, modified);
+    if (size != header.chargesSize || modified != header.chargesModified) {
+        cout << "Snapshot ignored: " << chargesPath << " has changed." << endl;
+        return false;
+    }
+    return true;
+}
+
+bool loadGraphSnapshot(Graph& g, const string& snapshotPath, const string& routesPath, const string& chargesPath) {
+    MappedFile file;
+    if (!mapFileReadOnly(snapshotPath, file)) return false;
+
+    if (file.size < sizeof(SnapshotHeader)) {
+        unmapFile(file);
+        return false;
+    }
+
+    SnapshotHeader header;
+    memcpy(&header, file.data, sizeof(header));
+    if (!snapshotHeaderUsable(header, file.size, routesPath, chargesPath)) {
+        unmapFile(file);
+        return false;
+    }
+
+    const char* payload = file.data + sizeof(SnapshotHeader);
+    if (checksumBytes(payload, header.payloadBytes) != header.checksum) {
+        cout << "Snapshot ignored: checksum mismatch." << endl;
+        unmapFile(file);
+        return false;
+    }
+
+    int portCount = header.portCount;
+    int companyCount = header.companyCount;
+    int edgeCount = header.edgeCount;
+
+    const int32_t* portNameOffset = (const int32_t*)payload;
+    const int32_t* companyOffset = portNameOffset + (portCount + 1);
+    const int32_t* dailyCharge = companyOffset + (companyCount + 1);
+    const int32_t* firstEdge = dailyCharge + portCount;
+    const Sailing* edges = (const Sailing*)(firstEdge + (portCount + 1));
+    const char* strings = (const char*)(edges + edgeCount);
+
+    for (int id = 0; id < portCount; id++) {
+        Port* p = addPortIfNotExists(g, strings + portNameOffset[id], portNameOffset[id + 1] - portNameOffset[id]);
+        p->dailyCharge = dailyCharge[id];
+    }
+
+    // Interning in stored order gives every company its original id back
+    for (int c = 0; c < companyCount; c++) {
+        internCompany(g, strings + companyOffset[c], companyOffset[c + 1] - companyOffset[c]);
+    }
+
+    // The sailings are already packed and sorted, so the version reads them
+    // in place and keeps the file mapped until it is reclaimed
+    adviseRandomAccess(file);
+    FrozenGraph* fg = newMappedFrozenGraph(portCount, edgeCount, file, firstEdge, edges);
+    {
+        lock_guard<mutex> lock(g.updateLock);
+        publishFrozenGraph(g, fg);
+    }
+
+    cout << "Loaded " << edgeCount << " routes from snapshot " << snapshotPath << "." << endl;
+    return true;
+}
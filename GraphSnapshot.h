@@ -0,0 +1,26 @@
+#ifndef GRAPH_SNAPSHOT_H
+#define GRAPH_SNAPSHOT_H
+
+#include <string>
+#include "Graph.h"
+
+using namespace std;
+
+// Bump whenever the on-disk layout changes; older snapshots are then rebuilt
+const unsigned int SNAPSHOT_FORMAT_VERSION = 2;
+
+// Writes the loaded graph (ports, interned companies, port charges and the
+// packed CSR sailings, already sorted by departure) to a binary file. The sizes and
+// modification times of the source text files are recorded so a later load
+// can tell whether the snapshot is stale.
+bool saveGraphSnapshot(Graph &g, const string &snapshotPath, const string &routesPath, const string &chargesPath);
+
+// Maps the snapshot read-only and rebuilds the graph from it. The loaded
+// version reads its sailings straight from the mapping and keeps the file
+// mapped until the version is reclaimed. Returns false (leaving g empty)
+// if the file is missing, has another format version, fails its checksum
+// or was written from different source files; the caller then falls back
+// to parsing the text files.
+bool loadGraphSnapshot(Graph &g, const string &snapshotPath, const string &routesPath, const string &chargesPath);
+
+#endif
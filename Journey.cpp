@@ -160,7 +160,7 @@ BookedJourney buildJourneyFromSafeJourney(const string& originPort, const SafeJo
     SafeJourneyLeg* leg = safeJourney.legsHead;
     
     while (leg != nullptr) {
-        Route* route = leg->route;
+        const Route* route = &leg->route;
         appendLeg(j, currentPort, route->destinationPort, route->voyageDate, 
                   route->departureTime, route->arrivalTime, route->voyageCost, 
                   route->shippingCompany);
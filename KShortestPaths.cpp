@@ -0,0 +1,359 @@
+#include "KShortestPaths.h"
+#include "ShortestPath.h"
+#include "SearchKernel.h"
+#include <chrono>
+#include <algorithm>
+#include <limits.h>
+
+using namespace std;
+
+// A kernel result that also keeps the edge indices of the route found
+struct SpurResult : ShortestPathResult {
+    int* edges;
+    int edgeCount;
+    int edgeCapacity;
+
+    SpurResult() : edges(nullptr), edgeCount(0), edgeCapacity(0) {}
+    ~SpurResult() { delete[] edges; }
+
+private:
+    SpurResult(const SpurResult&);
+    SpurResult& operator=(const SpurResult&);
+};
+
+template <>
+struct KernelPathKeeper<SpurResult> {
+    static void keep(SpurResult& result, const int* edges, int count) {
+        if (count > result.edgeCapacity) {
+            delete[] result.edges;
+            result.edgeCapacity = count * 2;
+            result.edges = new int[result.edgeCapacity];
+        }
+        for (int i = 0; i < count; i++) {
+            result.edges[i] = edges[i];
+        }
+        result.edgeCount = count;
+    }
+};
+
+// Wraps the preference filter for one branch: nothing may enter a port the
+// kept legs already visited, and out of the branching port only sailings
+// leaving after departAfter and not banned are taken
+template <typename Inner>
+struct SpurFilter {
+    const Inner& inner;
+    const Sailing* edges;
+    const bool* portBlocked;
+    int spurPort;
+    int departAfter;
+    const int* banned;
+    int bannedCount;
+
+    SpurFilter(const Inner& inner, const Sailing* edges, const bool* portBlocked)
+        : inner(inner), edges(edges), portBlocked(portBlocked), spurPort(-1), departAfter(INT_MIN), banned(nullptr), bannedCount(0) {}
+
+    bool allows(int fromPort, const Sailing& s) const {
+        if (!inner.allows(fromPort, s) || portBlocked[s.destinationId]) return false;
+        if (fromPort != spurPort) return true;
+        if (s.departure < departAfter) return false;
+        int e = (int)(&s - edges);
+        for (int i = 0; i < bannedCount; i++) {
+            if (banned[i] == e) return false;
+        }
+        return true;
+    }
+};
+
+struct CandidateRoute {
+    int* edges;
+    int legs;
+    int value;
+    int cost;
+};
+
+struct CandidateList {
+    CandidateRoute* items;
+    int count;
+    int capacity;
+};
+
+static void appendCandidate(CandidateList& list, const CandidateRoute& route) {
+    if (list.count >= list.capacity) {
+        int newCap = list.capacity > 0 ? list.capacity * 2 : 16;
+        CandidateRoute* grown = new CandidateRoute[newCap];
+        for (int i = 0; i < list.count; i++) {
+            grown[i] = list.items[i];
+        }
+        delete[] list.items;
+        list.items = grown;
+        list.capacity = newCap;
+    }
+    list.items[list.count++] = route;
+}
+
+static void clearCandidates(CandidateList& list) {
+    for (int i = 0; i < list.count; i++) {
+        delete[] list.items[i].edges;
+    }
+    delete[] list.items;
+    list.items = nullptr;
+    list.count = 0;
+    list.capacity = 0;
+}
+
+static void appendEdge(int*& items, int& count, int& capacity, int edge) {
+    if (count >= capacity) {
+        int newCap = capacity > 0 ? capacity * 2 : 16;
+        int* grown = new int[newCap];
+        for (int i = 0; i < count; i++) {
+            grown[i] = items[i];
+        }
+        delete[] items;
+        items = grown;
+        capacity = newCap;
+    }
+    items[count++] = edge;
+}
+
+static bool samePrefix(const CandidateRoute& a, const CandidateRoute& b, int legs) {
+    for (int i = 0; i < legs; i++) {
+        if (a.edges[i] != b.edges[i]) return false;
+    }
+    return true;
+}
+
+static bool listedRoute(const CandidateList& list, const CandidateRoute& route) {
+    for (int i = 0; i < list.count; i++) {
+        if (list.items[i].legs == route.legs && samePrefix(list.items[i], route, route.legs)) return true;
+    }
+    return false;
+}
+
+// Lower value first, then fewer legs, then the lower fare
+static bool rankedBefore(const CandidateRoute& a, const CandidateRoute& b) {
+    if (a.value != b.value) return a.value < b.value;
+    if (a.legs != b.legs) return a.legs < b.legs;
+    return a.cost < b.cost;
+}
+
+// Earlier candidates win ties
+static int bestCandidate(const CandidateList& list) {
+    int best = -1;
+    for (int i = 0; i < list.count; i++) {
+        if (best < 0 || rankedBefore(list.items[i], list.items[best])) best = i;
+    }
+    return best;
+}
+
+static CandidateRoute takeCandidate(CandidateList& list, int index) {
+    CandidateRoute taken = list.items[index];
+    for (int i = index + 1; i < list.count; i++) {
+        list.items[i - 1] = list.items[i];
+    }
+    list.count--;
+    return taken;
+}
+
+static void appendRankedRoute(Graph& g, const FrozenGraph& fg, const string& originPort, const CandidateRoute& route, RankedRoute*& routes, int& count) {
+    RankedRoute& r = routes[count++];
+    r.value = route.value;
+    r.totalCost = route.cost;
+    r.legs = route.legs;
+    initJourney(r.journey);
+    string fromPort = originPort;
+    for (int i = 0; i < route.legs; i++) {
+        Route* leg = getRouteView(g, fg, route.edges[i]);
+        appendLeg(r.journey,
+            fromPort,
+            leg->destinationPort,
+            leg->voyageDate,
+            leg->departureTime,
+            leg->arrivalTime,
+            leg->voyageCost,
+            leg->shippingCompany);
+        fromPort = leg->destinationPort;
+    }
+}
+
+template <typename Metric, typename Filter>
+static void rankRoutes(Graph& g, const FrozenGraph& fg, const string& originPort, int originIdx, int destIdx, int k,
+                       int maxLegs, int maxCost, bool rankedByFare, const Filter& prefsFilter, double budgetMs, SearchWorkspace& ws, RankedRoutesResult& result) {
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+    int portCount = fg.portCount;
+
+    // All false between queries, and left that way
+    bool* portBlocked = ws.onPath;
+    SpurFilter<Filter> filter(prefsFilter, fg.edges, portBlocked);
+    NoHeuristic none;
+    SpurResult spur;
+
+    // ranked holds every route taken so far, including those over the fare
+    // cap, since later candidates branch off them too
+    CandidateList ranked = { nullptr, 0, 0 };
+    CandidateList pending = { nullptr, 0, 0 };
+    int* banned = nullptr;
+    int bannedCount = 0;
+    int bannedCapacity = 0;
+    int withinCap = 0;
+
+    int firstValue = runSearchKernel<Metric>(g, fg, originPort, originIdx, destIdx, none, LegLimit(maxLegs), filter, ws, spur);
+    if (spur.found) {
+        CandidateRoute first;
+        first.legs = spur.edgeCount;
+        first.edges = new int[first.legs > 0 ? first.legs : 1];
+        for (int i = 0; i < first.legs; i++) {
+            first.edges[i] = spur.edges[i];
+        }
+        first.value = firstValue;
+        first.cost = spur.totalCost;
+        appendCandidate(pending, first);
+    }
+    result.spurSearches = 1;
+
+    while (withinCap < k && pending.count > 0) {
+        CandidateRoute next = takeCandidate(pending, bestCandidate(pending));
+        appendCandidate(ranked, next);
+        if (maxCost < 0 || next.cost <= maxCost) {
+            withinCap++;
+        } else if (rankedByFare) {
+            // Branches of dearer routes are dearer still, bar the odd one
+            // the single label per port missed
+            break;
+        }
+        if (withinCap >= k) break;
+
+        bool outOfTime = false;
+        int rootValue = 0;
+        int rootCost = 0;
+        for (int i = 0; i < next.legs; i++) {
+            if (chrono::duration<double, milli>(chrono::steady_clock::now() - started).count() > budgetMs) {
+                outOfTime = true;
+                break;
+            }
+            const Sailing* last = i > 0 ? &fg.edges[next.edges[i - 1]] : nullptr;
+            if (last) {
+                rootValue += Metric::weight(*last);
+                rootCost += last->voyageCost;
+                portBlocked[i == 1 ? originIdx : fg.edges[next.edges[i - 2]].destinationId] = true;
+            }
+            if (i >= maxLegs) break;
+
+            int spurPort = last ? last->destinationId : originIdx;
+            bannedCount = 0;
+            for (int r = 0; r < ranked.count; r++) {
+                if (ranked.items[r].legs > i && samePrefix(ranked.items[r], next, i)) {
+                    appendEdge(banned, bannedCount, bannedCapacity, ranked.items[r].edges[i]);
+                }
+            }
+            filter.spurPort = spurPort;
+            filter.departAfter = last ? sailingArrival(*last) + 60 : INT_MIN;
+            filter.banned = banned;
+            filter.bannedCount = bannedCount;
+
+            int spurValue = runSearchKernel<Metric>(g, fg, g.portById[spurPort]->name, spurPort, destIdx, none, LegLimit(maxLegs - i), filter, ws, spur);
+            result.spurSearches++;
+            if (!spur.found) continue;
+
+            CandidateRoute candidate;
+            candidate.legs = i + spur.edgeCount;
+            candidate.edges = new int[candidate.legs];
+            for (int j = 0; j < i; j++) {
+                candidate.edges[j] = next.edges[j];
+            }
+            for (int j = 0; j < spur.edgeCount; j++) {
+                candidate.edges[i + j] = spur.edges[j];
+            }
+            candidate.value = rootValue + spurValue;
+            candidate.cost = rootCost + spur.totalCost;
+            if (listedRoute(ranked, candidate) || listedRoute(pending, candidate)) {
+                delete[] candidate.edges;
+                continue;
+            }
+            appendCandidate(pending, candidate);
+        }
+        for (int i = 0; i < portCount; i++) {
+            portBlocked[i] = false;
+        }
+        filter.spurPort = -1;
+
+        if (outOfTime) {
+            result.complete = false;
+            break;
+        }
+    }
+
+    // Out of time: the best candidates found so far make up the numbers
+    if (!result.complete) {
+        while (withinCap < k && pending.count > 0) {
+            CandidateRoute next = takeCandidate(pending, bestCandidate(pending));
+            appendCandidate(ranked, next);
+            if (maxCost < 0 || next.cost <= maxCost) withinCap++;
+        }
+    }
+
+    // A branch leaving later than the route it came from can still find
+    // something cheaper than a route ranked before it, since the kernel keeps
+    // one label per port; the list is put back in order here
+    stable_sort(ranked.items, ranked.items + ranked.count, rankedBefore);
+    result.routes = new RankedRoute[withinCap > 0 ? withinCap : 1];
+    for (int r = 0; r < ranked.count; r++) {
+        if (maxCost >= 0 && ranked.items[r].cost > maxCost) continue;
+        appendRankedRoute(g, fg, originPort, ranked.items[r], result.routes, result.routeCount);
+    }
+    result.found = result.routeCount > 0;
+
+    clearCandidates(ranked);
+    clearCandidates(pending);
+    delete[] banned;
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+}
+
+template <typename Metric>
+static void findKRoutes(Graph& g, const string& originPort, const string& destPort, int k, RankedRoutesResult& result,
+                        int maxLegs, const RoutePreferences* prefs, double budgetMs, bool rankedByFare, SearchWorkspace* workspace) {
+    clearRankedRoutes(result);
+
+    int originIdx = findPortId(g, originPort);
+    int destIdx = findPortId(g, destPort);
+    if (originIdx < 0 || destIdx < 0 || originIdx == destIdx || k <= 0) return;
+
+    FrozenGraphPin pin(g);
+    const FrozenGraph& fg = *pin.fg;
+    if (originIdx >= fg.portCount || destIdx >= fg.portCount) return;
+    SearchWorkspace& ws = chooseWorkspace(workspace);
+    prepareSearchWorkspace(ws, g);
+
+    if (prefs && prefs->useMaxLegs && prefs->maxLegs > 0 && prefs->maxLegs < maxLegs) maxLegs = prefs->maxLegs;
+    int maxCost = prefs && prefs->useMaxTotalCost ? prefs->maxTotalCost : -1;
+
+    if (preferencesFilterSailings(prefs)) {
+        PreferenceFilter filter(g, *prefs, ws);
+        rankRoutes<Metric>(g, fg, originPort, originIdx, destIdx, k, maxLegs, maxCost, rankedByFare, filter, budgetMs, ws, result);
+    } else {
+        AcceptAllSailings acceptAll;
+        rankRoutes<Metric>(g, fg, originPort, originIdx, destIdx, k, maxLegs, maxCost, rankedByFare, acceptAll, budgetMs, ws, result);
+    }
+}
+
+void findKCheapestRoutes(Graph& g, const string& originPort, const string& destPort, int k, RankedRoutesResult& result,
+                         int maxLegs, const RoutePreferences* prefs, double budgetMs, SearchWorkspace* workspace) {
+    findKRoutes<FareMetric>(g, originPort, destPort, k, result, maxLegs, prefs, budgetMs, true, workspace);
+}
+
+void findKFastestRoutes(Graph& g, const string& originPort, const string& destPort, int k, RankedRoutesResult& result,
+                        int maxLegs, const RoutePreferences* prefs, double budgetMs, SearchWorkspace* workspace) {
+    findKRoutes<DurationMetric>(g, originPort, destPort, k, result, maxLegs, prefs, budgetMs, false, workspace);
+}
+
+void clearRankedRoutes(RankedRoutesResult& result) {
+    for (int i = 0; i < result.routeCount; i++) {
+        clearJourney(result.routes[i].journey);
+    }
+    delete[] result.routes;
+    result.routes = nullptr;
+    result.routeCount = 0;
+    result.found = false;
+    result.complete = true;
+    result.spurSearches = 0;
+    result.seconds = 0.0;
+}
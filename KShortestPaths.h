@@ -0,0 +1,57 @@
+#ifndef K_SHORTEST_PATHS_H
+#define K_SHORTEST_PATHS_H
+
+#include <string>
+#include "Graph.h"
+#include "Journey.h"
+#include "RoutePreferences.h"
+#include "SearchKernel.h"
+
+using namespace std;
+
+// Time allowed for ranking, in milliseconds, when the caller gives none
+const double K_SHORTEST_DEFAULT_BUDGET_MS = 50.0;
+
+struct RankedRoute {
+    int value;
+    int totalCost;
+    int legs;
+    BookedJourney journey;
+};
+
+// Up to k loopless journeys, best first; value is the fare or the minutes
+// at sea, whichever they were ranked by. complete is false when the budget
+// ran out: the journeys are still valid, but the later ones are only the
+// best candidates found by then.
+struct RankedRoutesResult {
+    bool found;
+    bool complete;
+    RankedRoute* routes;
+    int routeCount;
+    int spurSearches;
+    double seconds;
+
+    RankedRoutesResult() : found(false), complete(true), routes(nullptr), routeCount(0), spurSearches(0), seconds(0.0) {}
+};
+
+// Yen's k shortest loopless paths over the date-agnostic search of
+// findCheapestRouteIgnoringDates / findFastestRouteIgnoringDates. Each new
+// candidate branches off a ranked route at one of its ports: the legs up
+// to there are kept, the ports they visit and the sailings that ranked
+// routes with the same legs took next are banned, and the kernel finds
+// the best continuation leaving at least 60 minutes after the arrival.
+// Companies and ports prefs excludes never appear; routes over maxLegs
+// (or prefs->maxLegs) legs or prefs->maxTotalCost are left out. No new
+// branch is searched once budgetMs has passed. Every spur search runs in
+// workspace (or the calling thread's own).
+void findKCheapestRoutes(Graph& g, const string& originPort, const string& destPort, int k, RankedRoutesResult& result,
+                         int maxLegs = 15, const RoutePreferences* prefs = nullptr, double budgetMs = K_SHORTEST_DEFAULT_BUDGET_MS,
+                         SearchWorkspace* workspace = nullptr);
+
+void findKFastestRoutes(Graph& g, const string& originPort, const string& destPort, int k, RankedRoutesResult& result,
+                        int maxLegs = 15, const RoutePreferences* prefs = nullptr, double budgetMs = K_SHORTEST_DEFAULT_BUDGET_MS,
+                        SearchWorkspace* workspace = nullptr);
+
+void clearRankedRoutes(RankedRoutesResult& result);
+
+#endif
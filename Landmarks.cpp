@@ -0,0 +1,340 @@
+#include "Landmarks.h"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <limits.h>
+
+using namespace std;
+
+struct LandmarkEntry {
+    int value;
+    int port;
+};
+
+struct LandmarkEntryOrder {
+    static bool before(const LandmarkEntry& a, const LandmarkEntry& b) { return a.value < b.value; }
+    static int id(const LandmarkEntry& e) { return e.port; }
+};
+
+typedef IndexedHeap<LandmarkEntry, LandmarkEntryOrder> LandmarkHeap;
+
+// The same arcs turned around, so a search over them from L finds the
+// distances from every port to L
+static void reversePortArcs(const PortArcs& arcs, PortArcs& reversed) {
+    freePortArcs(reversed);
+    int portCount = arcs.portCount;
+    int arcCount = arcs.arcCount;
+    reversed.portCount = portCount;
+    reversed.arcCount = arcCount;
+    reversed.firstArc = new int[portCount + 1];
+    reversed.arcTarget = new int[arcCount > 0 ? arcCount : 1];
+    reversed.arcCost = new int[arcCount > 0 ? arcCount : 1];
+    reversed.arcMinutes = new int[arcCount > 0 ? arcCount : 1];
+    reversed.arcEdge = new int[arcCount > 0 ? arcCount : 1];
+
+    for (int p = 0; p <= portCount; p++) {
+        reversed.firstArc[p] = 0;
+    }
+    for (int a = 0; a < arcCount; a++) {
+        reversed.firstArc[arcs.arcTarget[a] + 1]++;
+    }
+    for (int p = 0; p < portCount; p++) {
+        reversed.firstArc[p + 1] += reversed.firstArc[p];
+    }
+
+    int* next = new int[portCount > 0 ? portCount : 1];
+    for (int p = 0; p < portCount; p++) {
+        next[p] = reversed.firstArc[p];
+    }
+    for (int u = 0; u < portCount; u++) {
+        for (int a = arcs.firstArc[u]; a < arcs.firstArc[u + 1]; a++) {
+            int r = next[arcs.arcTarget[a]]++;
+            reversed.arcTarget[r] = u;
+            reversed.arcCost[r] = arcs.arcCost[a];
+            reversed.arcMinutes[r] = arcs.arcMinutes[a];
+            reversed.arcEdge[r] = arcs.arcEdge[a];
+        }
+    }
+    delete[] next;
+}
+
+// Dijkstra from origin with weight[a] on arc a. Afterwards dist[p] is the
+// distance to p, or LANDMARK_UNREACHABLE. Returns the ports settled.
+static int searchFromLandmark(const PortArcs& arcs, const int* weight, int origin, int* dist, LandmarkHeap& heap) {
+    int portCount = arcs.portCount;
+    for (int p = 0; p < portCount; p++) {
+        dist[p] = INT_MAX;
+    }
+    resetIndexedHeap(heap, portCount);
+
+    dist[origin] = 0;
+    LandmarkEntry start = { 0, origin };
+    pushIndexedHeap(heap, start);
+
+    int settled = 0;
+    LandmarkEntry current;
+    while (popIndexedHeap(heap, current)) {
+        int u = current.port;
+        settled++;
+        for (int a = arcs.firstArc[u]; a < arcs.firstArc[u + 1]; a++) {
+            int v = arcs.arcTarget[a];
+            int value = current.value + weight[a];
+            if (value >= dist[v]) continue;
+            dist[v] = value;
+            LandmarkEntry next = { value, v };
+            pushIndexedHeap(heap, next);
+        }
+    }
+
+    for (int p = 0; p < portCount; p++) {
+        if (dist[p] == INT_MAX) dist[p] = LANDMARK_UNREACHABLE;
+    }
+    return settled;
+}
+
+// Farthest selection: each landmark is the port whose fare from the
+// nearest landmark picked so far is largest. Ports no landmark reaches yet
+// come first, so a timetable in several parts gets a landmark in each;
+// ports without any sailing are never picked. Returns the count picked.
+static int pickLandmarks(const PortArcs& fareArcs, int requested, int* landmarks, long long& portsSettled) {
+    int portCount = fareArcs.portCount;
+    int* nearest = new int[portCount > 0 ? portCount : 1];
+    int* dist = new int[portCount > 0 ? portCount : 1];
+    bool* linked = new bool[portCount > 0 ? portCount : 1];
+    for (int p = 0; p < portCount; p++) {
+        nearest[p] = INT_MAX;
+        linked[p] = fareArcs.firstArc[p + 1] > fareArcs.firstArc[p];
+    }
+    for (int a = 0; a < fareArcs.arcCount; a++) {
+        linked[fareArcs.arcTarget[a]] = true;
+    }
+
+    LandmarkHeap heap;
+    int count = 0;
+    while (count < requested) {
+        int best = -1;
+        for (int p = 0; p < portCount; p++) {
+            if (!linked[p] || nearest[p] == 0) continue;
+            if (best < 0 || nearest[p] > nearest[best]) best = p;
+        }
+        if (best < 0) break;
+
+        landmarks[count++] = best;
+        nearest[best] = 0;
+        portsSettled += searchFromLandmark(fareArcs, fareArcs.arcCost, best, dist, heap);
+        for (int p = 0; p < portCount; p++) {
+            if (dist[p] != LANDMARK_UNREACHABLE && dist[p] < nearest[p]) nearest[p] = dist[p];
+        }
+    }
+
+    clearIndexedHeap(heap);
+    delete[] nearest;
+    delete[] dist;
+    delete[] linked;
+    return count;
+}
+
+// Table t of landmark l is task l * 4 + t: fares from and to L, then
+// minutes from and to L. Tasks come from the shared counter.
+struct LandmarkWorker {
+    const PortArcs* arcs[4];
+    int* tables[4];
+    const LandmarkIndex* index;
+    atomic<int>* nextTask;
+    int taskCount;
+    long long portsSettled;
+};
+
+static void runLandmarkWorker(LandmarkWorker* worker) {
+    const LandmarkIndex& index = *worker->index;
+    int portCount = index.portCount;
+    int* dist = new int[portCount > 0 ? portCount : 1];
+    LandmarkHeap heap;
+
+    while (true) {
+        int task = worker->nextTask->fetch_add(1);
+        if (task >= worker->taskCount) break;
+        int l = task / 4;
+        int t = task % 4;
+
+        const PortArcs& arcs = *worker->arcs[t];
+        const int* weight = t < 2 ? arcs.arcCost : arcs.arcMinutes;
+        worker->portsSettled += searchFromLandmark(arcs, weight, index.landmarks[l], dist, heap);
+
+        int* table = worker->tables[t];
+        for (int p = 0; p < portCount; p++) {
+            table[(size_t)p * index.landmarkCount + l] = dist[p];
+        }
+    }
+
+    clearIndexedHeap(heap);
+    delete[] dist;
+}
+
+static bool hasNegativeWeight(const int* weight, int count) {
+    for (int a = 0; a < count; a++) {
+        if (weight[a] < 0) return true;
+    }
+    return false;
+}
+
+// Both sets of arcs at once, so a version that leaves them unchanged can
+// keep the tables
+static unsigned long long checksumLandmarkArcs(const PortArcs& cheapest, const PortArcs& fastest) {
+    return checksumPortArcs(cheapest) * 1099511628211ULL ^ checksumPortArcs(fastest);
+}
+
+// Fares come from the cheapest sailing of each port pair and minutes from
+// the fastest, so both stay lower bounds
+static void buildLandmarkArcs(const Graph& g, const FrozenGraph& fg, PortArcs& cheapest, PortArcs& fastest) {
+    buildPortArcs(g, fg, cheapest, nullptr, PORT_ARCS_CHEAPEST);
+    buildPortArcs(g, fg, fastest, nullptr, PORT_ARCS_FASTEST);
+}
+
+static void buildFromArcs(const FrozenGraph& fg, const PortArcs& cheapest, const PortArcs& fastest, LandmarkIndex& index) {
+    freeLandmarkIndex(index);
+    index.stats = LandmarkStats();
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+
+    PortArcs cheapestBack;
+    PortArcs fastestBack;
+    reversePortArcs(cheapest, cheapestBack);
+    reversePortArcs(fastest, fastestBack);
+
+    // Dijkstra cannot give distances over negative arcs; with no landmarks
+    // every bound is 0 and A* searches like Dijkstra
+    int portCount = fg.portCount;
+    int requested = index.requested > 0 ? index.requested : 0;
+    if (hasNegativeWeight(cheapest.arcCost, cheapest.arcCount) || hasNegativeWeight(fastest.arcMinutes, fastest.arcCount)) {
+        requested = 0;
+    }
+    index.portCount = portCount;
+    index.landmarks = new int[requested > 0 ? requested : 1];
+    index.landmarkCount = pickLandmarks(cheapest, requested, index.landmarks, index.stats.portsSettled);
+
+    size_t cells = (size_t)portCount * index.landmarkCount;
+    index.fareFrom = new int[cells > 0 ? cells : 1];
+    index.fareTo = new int[cells > 0 ? cells : 1];
+    index.minutesFrom = new int[cells > 0 ? cells : 1];
+    index.minutesTo = new int[cells > 0 ? cells : 1];
+
+    int taskCount = index.landmarkCount * 4;
+    int threadCount = index.threadCount;
+    if (threadCount <= 0) {
+        threadCount = (int)thread::hardware_concurrency();
+        if (threadCount <= 0) threadCount = 1;
+    }
+    if (threadCount > taskCount) threadCount = taskCount > 0 ? taskCount : 1;
+
+    atomic<int> nextTask(0);
+    LandmarkWorker* workers = new LandmarkWorker[threadCount];
+    for (int i = 0; i < threadCount; i++) {
+        workers[i].arcs[0] = &cheapest;
+        workers[i].arcs[1] = &cheapestBack;
+        workers[i].arcs[2] = &fastest;
+        workers[i].arcs[3] = &fastestBack;
+        workers[i].tables[0] = index.fareFrom;
+        workers[i].tables[1] = index.fareTo;
+        workers[i].tables[2] = index.minutesFrom;
+        workers[i].tables[3] = index.minutesTo;
+        workers[i].index = &index;
+        workers[i].nextTask = &nextTask;
+        workers[i].taskCount = taskCount;
+        workers[i].portsSettled = 0;
+    }
+
+    if (threadCount > 1) {
+        thread* threads = new thread[threadCount - 1];
+        for (int i = 1; i < threadCount; i++) {
+            threads[i - 1] = thread(runLandmarkWorker, &workers[i]);
+        }
+        runLandmarkWorker(&workers[0]);
+        for (int i = 0; i < threadCount - 1; i++) {
+            threads[i].join();
+        }
+        delete[] threads;
+    } else {
+        runLandmarkWorker(&workers[0]);
+    }
+
+    for (int i = 0; i < threadCount; i++) {
+        index.stats.portsSettled += workers[i].portsSettled;
+    }
+    delete[] workers;
+    freePortArcs(cheapestBack);
+    freePortArcs(fastestBack);
+
+    index.built = true;
+    index.graphVersion = fg.version;
+    index.arcsChecksum = checksumLandmarkArcs(cheapest, fastest);
+    index.stats.portCount = portCount;
+    index.stats.landmarkCount = index.landmarkCount;
+    index.stats.threadCount = threadCount;
+    index.stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+}
+
+void buildLandmarkIndex(const Graph& g, const FrozenGraph& fg, LandmarkIndex& index) {
+    PortArcs cheapest;
+    PortArcs fastest;
+    buildLandmarkArcs(g, fg, cheapest, fastest);
+    buildFromArcs(fg, cheapest, fastest, index);
+    freePortArcs(cheapest);
+    freePortArcs(fastest);
+}
+
+// Collapsing the timetable is one pass over the sailings, far cheaper than
+// the landmark searches, so a version whose arcs match the tables' only
+// moves graphVersion on
+void refreshLandmarkIndex(const Graph& g, const FrozenGraph& fg, LandmarkIndex& index) {
+    unique_lock<shared_mutex> exclusive(index.lock);
+    if (index.built && index.graphVersion == fg.version) return;
+
+    PortArcs cheapest;
+    PortArcs fastest;
+    buildLandmarkArcs(g, fg, cheapest, fastest);
+    if (index.built && index.portCount == fg.portCount && index.arcsChecksum == checksumLandmarkArcs(cheapest, fastest)) {
+        index.graphVersion = fg.version;
+        index.stats.versionsKept++;
+    } else {
+        buildFromArcs(fg, cheapest, fastest, index);
+    }
+    freePortArcs(cheapest);
+    freePortArcs(fastest);
+}
+
+// Another query may move the index to its own version between the refresh
+// and the shared lock, so the check is repeated until the two agree
+LandmarkPin::LandmarkPin(const Graph& g, const FrozenGraph& fg, LandmarkIndex& landmarks) : index(landmarks) {
+    for (;;) {
+        index.lock.lock_shared();
+        if (index.built && index.graphVersion == fg.version) return;
+        index.lock.unlock_shared();
+        refreshLandmarkIndex(g, fg, index);
+    }
+}
+
+// Keeps requested and threadCount for the next build
+void freeLandmarkIndex(LandmarkIndex& index) {
+    delete[] index.landmarks;
+    delete[] index.fareFrom;
+    delete[] index.fareTo;
+    delete[] index.minutesFrom;
+    delete[] index.minutesTo;
+    index.landmarks = nullptr;
+    index.fareFrom = nullptr;
+    index.fareTo = nullptr;
+    index.minutesFrom = nullptr;
+    index.minutesTo = nullptr;
+    index.built = false;
+    index.graphVersion = 0;
+    index.arcsChecksum = 0;
+    index.portCount = 0;
+    index.landmarkCount = 0;
+}
+
+void printLandmarkStats(const LandmarkStats& stats) {
+    cout << "Landmarks: " << stats.landmarkCount << " over " << stats.portCount << " ports, " << stats.portsSettled
+         << " port(s) settled in " << stats.seconds * 1000.0 << " ms (" << stats.threadCount << " thread(s)), kept for "
+         << stats.versionsKept << " later version(s)." << endl;
+}
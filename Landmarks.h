@@ -0,0 +1,112 @@
+#ifndef LANDMARKS_H
+#define LANDMARKS_H
+
+#include <shared_mutex>
+#include "Graph.h"
+#include "RouteMatrix.h"
+
+using namespace std;
+
+// Landmarks picked when the caller sets no other count
+const int LANDMARK_DEFAULT_COUNT = 8;
+
+// Distance in a landmark table between ports with no route between them
+const int LANDMARK_UNREACHABLE = -1;
+
+struct LandmarkStats {
+    int portCount;
+    int landmarkCount;
+    int threadCount;
+    long long portsSettled;
+    double seconds;
+    int versionsKept;
+
+    LandmarkStats() : portCount(0), landmarkCount(0), threadCount(0), portsSettled(0), seconds(0.0), versionsKept(0) {}
+};
+
+// Lower bounds for A* from the triangle inequality (ALT). For each
+// landmark L the tables hold the cheapest fare and the fewest minutes at
+// sea from L to every port and from every port to L, over the timetable
+// collapsed to port arcs. Dates and layovers are ignored there, so no
+// real route can beat these distances, and for any ports v and t
+//     d(v, t) >= d(L, t) - d(L, v)   and   d(v, t) >= d(v, L) - d(t, L).
+// Tables are port-major: fareFrom[p * landmarkCount + l] is the fare from
+// landmark l to p. The tables belong to timetable version graphVersion;
+// the first query that pins a newer one rebuilds them only if the port
+// arcs changed (arcsChecksum), and stats.versionsKept counts the versions
+// that reused them since the last build. requested and threadCount (one
+// per hardware thread if <= 0) set up the builds. The searches behind the
+// tables need fares and minutes of at least 0; a timetable with a
+// negative one gets no landmarks, so every bound is 0. Queries read the
+// tables under lock held shared (see LandmarkPin) and a refresh takes it
+// exclusively, so one query never rebuilds them under another.
+struct LandmarkIndex {
+    bool built;
+    unsigned long long graphVersion;
+    unsigned long long arcsChecksum;
+    int requested;
+    int threadCount;
+    int portCount;
+    int landmarkCount;
+    int* landmarks;
+    int* fareFrom;
+    int* fareTo;
+    int* minutesFrom;
+    int* minutesTo;
+    LandmarkStats stats;
+    shared_mutex lock;
+
+    LandmarkIndex() : built(false), graphVersion(0), arcsChecksum(0), requested(LANDMARK_DEFAULT_COUNT), threadCount(0), portCount(0), landmarkCount(0),
+                      landmarks(nullptr), fareFrom(nullptr), fareTo(nullptr), minutesFrom(nullptr), minutesTo(nullptr) {}
+};
+
+// Picks the landmarks of version fg one at a time, each the port farthest
+// by fare from those already picked (ports no landmark reaches count as
+// farthest), then fills the four tables on index.threadCount workers.
+void buildLandmarkIndex(const Graph& g, const FrozenGraph& fg, LandmarkIndex& index);
+
+// Rebuilds the index unless it belongs to version fg or to one with the
+// same port arcs. Takes index.lock exclusively.
+void refreshLandmarkIndex(const Graph& g, const FrozenGraph& fg, LandmarkIndex& index);
+
+// Holds index refreshed for version fg, with its lock shared, for as long
+// as a search reads the tables
+struct LandmarkPin {
+    LandmarkIndex& index;
+
+    LandmarkPin(const Graph& g, const FrozenGraph& fg, LandmarkIndex& index);
+    ~LandmarkPin() { index.lock.unlock_shared(); }
+
+    LandmarkPin(const LandmarkPin&) = delete;
+    LandmarkPin& operator=(const LandmarkPin&) = delete;
+};
+
+void freeLandmarkIndex(LandmarkIndex& index);
+
+// Best bound over all landmarks on the fare (or, with minutes, the time at
+// sea) of any route from port to target; 0 when no landmark gives one
+inline int landmarkLowerBound(const LandmarkIndex& index, bool minutes, int port, int target) {
+    if (port < 0 || target < 0 || port >= index.portCount || target >= index.portCount) return 0;
+    int count = index.landmarkCount;
+    const int* from = (minutes ? index.minutesFrom : index.fareFrom);
+    const int* to = (minutes ? index.minutesTo : index.fareTo);
+    const int* fromPort = from + (size_t)port * count;
+    const int* fromTarget = from + (size_t)target * count;
+    const int* toPort = to + (size_t)port * count;
+    const int* toTarget = to + (size_t)target * count;
+
+    int best = 0;
+    for (int l = 0; l < count; l++) {
+        if (fromPort[l] != LANDMARK_UNREACHABLE && fromTarget[l] != LANDMARK_UNREACHABLE && fromTarget[l] - fromPort[l] > best) {
+            best = fromTarget[l] - fromPort[l];
+        }
+        if (toPort[l] != LANDMARK_UNREACHABLE && toTarget[l] != LANDMARK_UNREACHABLE && toPort[l] - toTarget[l] > best) {
+            best = toPort[l] - toTarget[l];
+        }
+    }
+    return best;
+}
+
+void printLandmarkStats(const LandmarkStats& stats);
+
+#endif
@@ -0,0 +1,108 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+
+bool mapFileReadOnly(const string& path, MappedFile& file) {
+    unmapFile(file);
+
+    HANDLE h = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(h, &size)) {
+        CloseHandle(h);
+        return false;
+    }
+
+    file.fileHandle = h;
+    file.size = (size_t)size.QuadPart;
+    if (file.size == 0) {
+        // Empty files cannot be mapped; an empty view is still a valid result
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(h, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        unmapFile(file);
+        return false;
+    }
+    file.mappingHandle = mapping;
+
+    file.data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!file.data) {
+        unmapFile(file);
+        return false;
+    }
+    return true;
+}
+
+void unmapFile(MappedFile& file) {
+    if (file.data) UnmapViewOfFile(file.data);
+    if (file.mappingHandle) CloseHandle((HANDLE)file.mappingHandle);
+    if (file.fileHandle) CloseHandle((HANDLE)file.fileHandle);
+    file.data = nullptr;
+    file.size = 0;
+    file.fileHandle = nullptr;
+    file.mappingHandle = nullptr;
+}
+
+// Mapped views take no access advice on Windows
+void adviseRandomAccess(MappedFile&) {}
+
+#else
+
+bool mapFileReadOnly(const string& path, MappedFile& file) {
+    unmapFile(file);
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+
+    file.fd = fd;
+    file.size = (size_t)st.st_size;
+    if (file.size == 0) {
+        // Empty files cannot be mapped; an empty view is still a valid result
+        return true;
+    }
+
+    void* addr = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+        unmapFile(file);
+        return false;
+    }
+    // The loaders read front to back
+    madvise(addr, file.size, MADV_SEQUENTIAL);
+
+    file.data = (const char*)addr;
+    return true;
+}
+
+void unmapFile(MappedFile& file) {
+    if (file.data) munmap((void*)file.data, file.size);
+    if (file.fd >= 0) close(file.fd);
+    file.data = nullptr;
+    file.size = 0;
+    file.fd = -1;
+}
+
+void adviseRandomAccess(MappedFile& file) {
+    if (file.data) madvise((void*)file.data, file.size, MADV_RANDOM);
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+// Read-only view of a whole file mapped into memory
+struct MappedFile {
+    const char* data;
+    size_t size;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fd;
+#endif
+
+#ifdef _WIN32
+    MappedFile() : data(nullptr), size(0), fileHandle(nullptr), mappingHandle(nullptr) {}
+#else
+    MappedFile() : data(nullptr), size(0), fd(-1) {}
+#endif
+};
+
+bool mapFileReadOnly(const string& path, MappedFile& file);
+
+void unmapFile(MappedFile& file);
+
+// Tells the kernel that reads from here on jump around the file, so it
+// stops reading ahead; for mappings kept after a front-to-back load
+void adviseRandomAccess(MappedFile& file);
+
+#endif
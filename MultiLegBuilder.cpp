@@ -109,13 +109,14 @@ MultiLegNode* MultiLegRouteBuilder::getNodeAtIndex(int index) const {
 bool MultiLegRouteBuilder::hasValidRoute(const string& fromPort, const string& toPort) const {
     Port* from = findPort(*graphRef, fromPort);
     if (!from) return false;
+    int toId = findPortId(*graphRef, toPort);
 
-    Route* route = from->routeHead;
-    while (route) {
-        if (route->destinationPort == toPort) {
+    FrozenGraphPin pin(*graphRef);
+    const FrozenGraph& fg = *pin.fg;
+    for (int e = fg.firstEdge[from->id]; e < fg.firstEdge[from->id + 1]; e++) {
+        if (fg.edges[e].destinationId == toId) {
             return true;
         }
-        route = route->next;
     }
 
     return false;
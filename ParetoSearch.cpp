@@ -0,0 +1,212 @@
+#include "ParetoSearch.h"
+#include <algorithm>
+
+using namespace std;
+
+// Bags and marked lists are workspace arrays, so growing one is counted in
+// ws.growths like any other
+static void appendIndex(SearchWorkspace& ws, int*& items, int& count, int& capacity, int value) {
+    if (count >= capacity) {
+        growWorkspaceArray(ws, items, capacity, count, 4);
+    }
+    items[count++] = value;
+}
+
+// Every label in a bag has at most as many legs as one being created now,
+// so matching it on cost and arrival is enough to make the new one redundant
+static bool isDominated(const ParetoBag& bag, const ParetoLabel* labels, int cost, int arrival) {
+    for (int i = 0; i < bag.count; i++) {
+        const ParetoLabel& l = labels[bag.labels[i]];
+        if (l.cost <= cost && l.arrival <= arrival) return true;
+    }
+    return false;
+}
+
+// Drops labels from this round that the new label beats; labels from
+// earlier rounds have fewer legs and stay
+static void removeDominated(ParetoBag& bag, ParetoLabel* labels, int legs, int cost, int arrival) {
+    int kept = 0;
+    for (int i = 0; i < bag.count; i++) {
+        ParetoLabel& l = labels[bag.labels[i]];
+        if (l.legs == legs && l.cost >= cost && l.arrival >= arrival) {
+            l.alive = false;
+        } else {
+            bag.labels[kept++] = bag.labels[i];
+        }
+    }
+    bag.count = kept;
+}
+
+static bool optionBefore(const ParetoOption& a, const ParetoOption& b) {
+    if (a.totalCost != b.totalCost) return a.totalCost < b.totalCost;
+    if (a.arrivalMinutes != b.arrivalMinutes) return a.arrivalMinutes < b.arrivalMinutes;
+    return a.legs < b.legs;
+}
+
+void clearParetoResult(ParetoResult& result) {
+    for (int i = 0; i < result.optionCount; i++) {
+        clearJourney(result.options[i].journey);
+    }
+    delete[] result.options;
+    result.options = nullptr;
+    result.optionCount = 0;
+    result.found = false;
+    result.labelsCreated = 0;
+    result.rounds = 0;
+}
+
+void findParetoRoutes(Graph& g, const string& originPort, const string& destPort, const Date& departDate, int windowDays, const RoutePreferences& prefs, ParetoResult& result, SearchWorkspace* workspace) {
+    clearParetoResult(result);
+
+    int originIdx = findPortId(g, originPort);
+    int destIdx = findPortId(g, destPort);
+    if (originIdx < 0 || destIdx < 0 || originIdx == destIdx || windowDays <= 0) return;
+
+    FrozenGraphPin pin(g);
+    const FrozenGraph& fg = *pin.fg;
+    int portCount = fg.portCount;
+    if (originIdx >= portCount || destIdx >= portCount) return;
+
+    int maxLegs = prefs.useMaxLegs && prefs.maxLegs > 0 ? prefs.maxLegs : PARETO_DEFAULT_MAX_LEGS;
+
+    // Bags, labels and the marked lists are the workspace's; preferences
+    // are resolved to its flags once instead of comparing names per sailing
+    SearchWorkspace& ws = chooseWorkspace(workspace);
+    prepareSearchWorkspace(ws, g);
+    beginWorkspaceSearch(ws);
+    PreferenceFilter filter(g, prefs, ws);
+
+    int labelCount = 0;
+    if (ws.paretoLabelCapacity == 0) {
+        growWorkspaceArray(ws, ws.paretoLabels, ws.paretoLabelCapacity, 0);
+    }
+    ParetoLabel* labels = ws.paretoLabels;
+
+    Time midnight = {0, 0};
+    int start = toEpochMinutes(departDate, midnight);
+    int end = start + windowDays * MINUTES_PER_DAY;
+
+    ParetoLabel& origin = labels[labelCount++];
+    origin.cost = 0;
+    origin.arrival = start;
+    origin.legs = 0;
+    origin.port = originIdx;
+    origin.edge = -1;
+    origin.parent = -1;
+    origin.alive = true;
+    ParetoBag& originBag = paretoBag(ws, originIdx);
+    appendIndex(ws, originBag.labels, originBag.count, originBag.capacity, 0);
+
+    int* marked = ws.marked;
+    int markedCount = 0;
+    int markedCapacity = ws.markedCapacity;
+    int* nextMarked = ws.nextMarked;
+    int nextCount = 0;
+    int nextCapacity = ws.nextMarkedCapacity;
+    if (!filter.portForbidden[originIdx]) {
+        appendIndex(ws, marked, markedCount, markedCapacity, 0);
+    }
+
+    ParetoBag& destBag = paretoBag(ws, destIdx);
+    for (int round = 1; round <= maxLegs && markedCount > 0; round++) {
+        result.rounds = round;
+        nextCount = 0;
+
+        for (int m = 0; m < markedCount; m++) {
+            int from = marked[m];
+            if (!labels[from].alive) continue;
+            int port = labels[from].port;
+            int baseCost = labels[from].cost;
+            int readyAt = from == 0 ? start : labels[from].arrival + prefs.minLayoverMinutes;
+
+            const int edgeEnd = fg.firstEdge[port + 1];
+            for (int e = firstDepartureFrom(fg, port, readyAt); e < edgeEnd; e++) {
+                const Sailing& s = fg.edges[e];
+                if (s.departure >= end) break;
+
+                int next = s.destinationId;
+                int arrival = sailingArrival(s);
+                int cost = baseCost + s.voyageCost;
+                if (arrival >= end || next == originIdx) continue;
+                if (prefs.useMaxTotalCost && cost > prefs.maxTotalCost) continue;
+                if (!filter.allows(port, s)) continue;
+
+                // Nothing that the destination already beats is worth extending
+                if (isDominated(destBag, labels, cost, arrival)) continue;
+                ParetoBag& bag = paretoBag(ws, next);
+                if (next != destIdx && isDominated(bag, labels, cost, arrival)) continue;
+
+                if (labelCount >= ws.paretoLabelCapacity) {
+                    growWorkspaceArray(ws, ws.paretoLabels, ws.paretoLabelCapacity, labelCount);
+                    labels = ws.paretoLabels;
+                }
+
+                removeDominated(bag, labels, round, cost, arrival);
+
+                int idx = labelCount++;
+                ParetoLabel& l = labels[idx];
+                l.cost = cost;
+                l.arrival = arrival;
+                l.legs = round;
+                l.port = next;
+                l.edge = e;
+                l.parent = from;
+                l.alive = true;
+                appendIndex(ws, bag.labels, bag.count, bag.capacity, idx);
+                if (next != destIdx) {
+                    appendIndex(ws, nextMarked, nextCount, nextCapacity, idx);
+                }
+                result.labelsCreated++;
+            }
+        }
+
+        int* swapItems = marked;
+        marked = nextMarked;
+        nextMarked = swapItems;
+        int swapCapacity = markedCapacity;
+        markedCapacity = nextCapacity;
+        nextCapacity = swapCapacity;
+        markedCount = nextCount;
+    }
+    ws.marked = marked;
+    ws.markedCapacity = markedCapacity;
+    ws.nextMarked = nextMarked;
+    ws.nextMarkedCapacity = nextCapacity;
+
+    const ParetoBag& frontier = destBag;
+    if (frontier.count > 0) {
+        result.found = true;
+        result.optionCount = frontier.count;
+        result.options = new ParetoOption[frontier.count];
+
+        int* pathEdges = workspacePath(ws, maxLegs);
+        for (int i = 0; i < frontier.count; i++) {
+            const ParetoLabel& last = labels[frontier.labels[i]];
+            ParetoOption& option = result.options[i];
+            option.totalCost = last.cost;
+            option.arrivalMinutes = last.arrival;
+            option.legs = last.legs;
+            initJourney(option.journey);
+
+            int pathLen = 0;
+            for (int l = frontier.labels[i]; labels[l].parent >= 0; l = labels[l].parent) {
+                pathEdges[pathLen++] = labels[l].edge;
+            }
+            string fromPort = originPort;
+            for (int k = pathLen - 1; k >= 0; k--) {
+                Route* r = getRouteView(g, fg, pathEdges[k]);
+                appendLeg(option.journey,
+                    fromPort,
+                    r->destinationPort,
+                    r->voyageDate,
+                    r->departureTime,
+                    r->arrivalTime,
+                    r->voyageCost,
+                    r->shippingCompany);
+                fromPort = r->destinationPort;
+            }
+        }
+
+        sort(result.options, result.options + result.optionCount, optionBefore);
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef PARETO_SEARCH_H
+#define PARETO_SEARCH_H
+
+#include <string>
+#include "Graph.h"
+#include "Journey.h"
+#include "RoutePreferences.h"
+#include "SearchKernel.h"
+
+using namespace std;
+
+// Leg bound used when the preferences do not set one
+const int PARETO_DEFAULT_MAX_LEGS = 5;
+
+struct ParetoOption {
+    int totalCost;
+    int arrivalMinutes;
+    int legs;
+    BookedJourney journey;
+};
+
+// Every itinerary not beaten on all of cost, arrival and leg count by
+// another, cheapest first
+struct ParetoResult {
+    bool found;
+    ParetoOption* options;
+    int optionCount;
+    int labelsCreated;
+    int rounds;
+
+    ParetoResult() : found(false), options(nullptr), optionCount(0), labelsCreated(0), rounds(0) {}
+};
+
+// Round-based search in the style of RAPTOR: round k extends the itineraries
+// found in round k-1 by one sailing, so round k holds exactly the options
+// with k legs and the rounds stop at prefs.maxLegs. Itineraries leave on or
+// after departDate and arrive within windowDays of it. The layover, cost
+// cap, allowed companies and forbidden ports in prefs all apply. Labels
+// and bags live in workspace (or the calling thread's own).
+void findParetoRoutes(Graph& g, const string& originPort, const string& destPort, const Date& departDate, int windowDays, const RoutePreferences& prefs, ParetoResult& result,
+                      SearchWorkspace* workspace = nullptr);
+
+void clearParetoResult(ParetoResult& result);
+
+#endif
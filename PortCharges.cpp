@@ -49,16 +49,26 @@ PortChargeNode* findPortCharge(PortChargeList& list, const string& name) {
     return nullptr;
 }
 
+// Every listed port takes its charge, replacing any it had; when a port is
+// listed twice the entry nearest the head wins, as findPortCharge would
+// pick it
 void applyPortChargesToGraph(PortChargeList& list, Graph& g) {
-    Port* currentPort = g.portHead;
-    while (currentPort != nullptr) {
-        PortChargeNode* chargeNode = findPortCharge(list, currentPort->name);
-        if (chargeNode != nullptr) {
-            currentPort->dailyCharge = chargeNode->dailyCharge;
+    bool* applied = new bool[g.portCount > 0 ? g.portCount : 1];
+    for (int i = 0; i < g.portCount; i++) {
+        applied[i] = false;
+    }
+
+    PortChargeNode* chargeNode = list.head;
+    while (chargeNode != nullptr) {
+        Port* port = findPort(g, chargeNode->portName);
+        if (port != nullptr && !applied[port->id]) {
+            port->dailyCharge = chargeNode->dailyCharge;
+            applied[port->id] = true;
         }
 
-        currentPort = currentPort->next;
+        chargeNode = chargeNode->next;
     }
+    delete[] applied;
 }
 
 void clearPortChargeList(PortChargeList& list) {
@@ -0,0 +1,375 @@
+#include "QueryCache.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+static unsigned long long hashText(const string& text) {
+    unsigned long long h = 14695981039346656037ULL;
+    for (size_t i = 0; i < text.size(); i++) {
+        h ^= (unsigned char)text[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// A name with its length in front, so no name can read as a separator
+static void appendName(string& out, const string& name) {
+    out += to_string(name.size());
+    out += ':';
+    out += name;
+}
+
+// Names in sorted order, so the same set always reads the same
+static void appendNameSet(string& out, const string* names, int count) {
+    string sorted[MAX_ALLOWED_COMPANIES > MAX_FORBIDDEN_PORTS ? MAX_ALLOWED_COMPANIES : MAX_FORBIDDEN_PORTS];
+    int n = 0;
+    for (int i = 0; i < count && n < (int)(sizeof(sorted) / sizeof(sorted[0])); i++) {
+        sorted[n++] = names[i];
+    }
+    sort(sorted, sorted + n);
+    out += '[';
+    for (int i = 0; i < n; i++) {
+        appendName(out, sorted[i]);
+    }
+    out += ']';
+}
+
+// Text that two keys share exactly when any search would treat them alike
+static string canonicalKey(const QueryKey& key) {
+    string out = to_string(key.strategy) + '|';
+    appendName(out, key.originPort);
+    appendName(out, key.destPort);
+    out += to_string(key.date.day) + '/' + to_string(key.date.month) + '/' + to_string(key.date.year) + '|'
+         + to_string(key.maxLegs);
+    const RoutePreferences* prefs = key.prefs;
+    if (!prefs) return out;
+
+    out += "|cost" + (prefs->useMaxTotalCost ? to_string(prefs->maxTotalCost) : string("-"));
+    out += "|legs" + (prefs->useMaxLegs ? to_string(prefs->maxLegs) : string("-"));
+    out += "|co";
+    appendNameSet(out, prefs->allowedCompanies, prefs->allowedCompaniesCount);
+    out += "|avoid";
+    appendNameSet(out, prefs->forbiddenPorts, prefs->forbiddenPortsCount);
+    out += "|via";
+    appendNameSet(out, prefs->preferredPorts, prefs->preferredPortsCount);
+    out += '|';
+    out += prefs->preferCheapest ? 'c' : '-';
+    out += prefs->preferFastest ? 'f' : '-';
+    out += prefs->sameDayOnly ? 'd' : '-';
+    out += to_string(prefs->minLayoverMinutes);
+    return out;
+}
+
+static QueryCacheShard& shardFor(QueryCache& cache, unsigned long long hash) {
+    return cache.shards[hash % QUERY_CACHE_SHARDS];
+}
+
+static int bucketFor(const QueryCacheShard& shard, unsigned long long hash) {
+    return (int)((hash / QUERY_CACHE_SHARDS) % (unsigned long long)shard.bucketCount);
+}
+
+static size_t entryBytes(const CachedQuery& entry) {
+    return entry.key.capacity() + entry.legCount * sizeof(int) + entry.traceCount * sizeof(TracedEdge);
+}
+
+// Copies the edges trace holds; caller holds the shard lock and has taken
+// the entry's bytes out of shard.bytes
+static void keepTrace(CachedQuery& entry, const SearchTrace& trace) {
+    delete[] entry.trace;
+    entry.trace = trace.count > 0 ? new TracedEdge[trace.count] : nullptr;
+    for (int i = 0; i < trace.count; i++) {
+        entry.trace[i] = trace.edges[i];
+    }
+    entry.traceCount = trace.count;
+    entry.traceOffered = trace.offered;
+    entry.traced = true;
+}
+
+static void freeEntry(CachedQuery& entry) {
+    delete[] entry.sailings;
+    delete[] entry.trace;
+    entry = CachedQuery();
+}
+
+static size_t shardBaseBytes(const QueryCacheShard& shard) {
+    return shard.capacity * sizeof(CachedQuery) + shard.bucketCount * sizeof(int);
+}
+
+// Empties the shard, keeping its arrays; caller holds shard.lock
+static void clearShardEntries(QueryCacheShard& shard) {
+    for (int i = 0; i < shard.capacity; i++) {
+        CachedQuery& entry = shard.entries[i];
+        freeEntry(entry);
+        entry.chain = i + 1 < shard.capacity ? i + 1 : -1;
+    }
+    for (int b = 0; b < shard.bucketCount; b++) {
+        shard.buckets[b] = -1;
+    }
+    shard.freeEntry = shard.capacity > 0 ? 0 : -1;
+    shard.count = 0;
+    shard.newest = -1;
+    shard.oldest = -1;
+    shard.bytes = shardBaseBytes(shard);
+}
+
+// Entries of older versions can never be hit again
+static void syncShardVersion(QueryCacheShard& shard, unsigned long long version) {
+    if (version <= shard.version) return;
+    if (shard.count > 0) {
+        clearShardEntries(shard);
+        shard.invalidations++;
+    }
+    shard.version = version;
+}
+
+static int findEntry(const QueryCacheShard& shard, unsigned long long hash, const string& key) {
+    for (int i = shard.buckets[bucketFor(shard, hash)]; i >= 0; i = shard.entries[i].chain) {
+        const CachedQuery& entry = shard.entries[i];
+        if (entry.hash == hash && entry.key == key) return i;
+    }
+    return -1;
+}
+
+static void unlinkRecent(QueryCacheShard& shard, int i) {
+    CachedQuery& entry = shard.entries[i];
+    if (entry.prev >= 0) shard.entries[entry.prev].next = entry.next;
+    else shard.newest = entry.next;
+    if (entry.next >= 0) shard.entries[entry.next].prev = entry.prev;
+    else shard.oldest = entry.prev;
+    entry.prev = -1;
+    entry.next = -1;
+}
+
+static void linkNewest(QueryCacheShard& shard, int i) {
+    CachedQuery& entry = shard.entries[i];
+    entry.prev = -1;
+    entry.next = shard.newest;
+    if (shard.newest >= 0) shard.entries[shard.newest].prev = i;
+    shard.newest = i;
+    if (shard.oldest < 0) shard.oldest = i;
+}
+
+// Frees the least recently used entry and returns its index
+static int evictOldest(QueryCacheShard& shard) {
+    int victim = shard.oldest;
+    CachedQuery& entry = shard.entries[victim];
+    unlinkRecent(shard, victim);
+
+    int* link = &shard.buckets[bucketFor(shard, entry.hash)];
+    while (*link != victim) {
+        link = &shard.entries[*link].chain;
+    }
+    *link = entry.chain;
+
+    shard.bytes -= entryBytes(entry);
+    freeEntry(entry);
+    shard.count--;
+    shard.evictions++;
+    return victim;
+}
+
+void initQueryCache(QueryCache& cache, int capacity) {
+    freeQueryCache(cache);
+    int perShard = capacity / QUERY_CACHE_SHARDS;
+    if (perShard < 1) perShard = 1;
+    for (int s = 0; s < QUERY_CACHE_SHARDS; s++) {
+        QueryCacheShard& shard = cache.shards[s];
+        lock_guard<mutex> lock(shard.lock);
+        shard.capacity = perShard;
+        shard.entries = new CachedQuery[perShard];
+        shard.bucketCount = perShard * 2;
+        shard.buckets = new int[shard.bucketCount];
+        clearShardEntries(shard);
+    }
+}
+
+void freeQueryCache(QueryCache& cache) {
+    for (int s = 0; s < QUERY_CACHE_SHARDS; s++) {
+        QueryCacheShard& shard = cache.shards[s];
+        lock_guard<mutex> lock(shard.lock);
+        for (int i = 0; i < shard.capacity; i++) {
+            freeEntry(shard.entries[i]);
+        }
+        delete[] shard.entries;
+        delete[] shard.buckets;
+        shard.entries = nullptr;
+        shard.buckets = nullptr;
+        shard.capacity = 0;
+        shard.bucketCount = 0;
+        shard.count = 0;
+        shard.freeEntry = -1;
+        shard.newest = -1;
+        shard.oldest = -1;
+        shard.version = 0;
+        shard.hits = 0;
+        shard.misses = 0;
+        shard.evictions = 0;
+        shard.invalidations = 0;
+        shard.bytes = 0;
+    }
+}
+
+bool lookupQueryCache(QueryCache& cache, Graph& g, const QueryKey& key, ShortestPathResult& result, QueryCacheTicket& ticket) {
+    FrozenGraphPin pin(g);
+    ticket.key = canonicalKey(key);
+    ticket.hash = hashText(ticket.key);
+    ticket.version = pin.fg->version;
+
+    QueryCacheShard& shard = shardFor(cache, ticket.hash);
+    lock_guard<mutex> lock(shard.lock);
+    if (shard.capacity == 0) return false;
+    syncShardVersion(shard, ticket.version);
+
+    int i = shard.version == ticket.version ? findEntry(shard, ticket.hash, ticket.key) : -1;
+    if (i < 0 || (result.trace && !shard.entries[i].traced)) {
+        shard.misses++;
+        return false;
+    }
+    shard.hits++;
+    unlinkRecent(shard, i);
+    linkNewest(shard, i);
+
+    const CachedQuery& entry = shard.entries[i];
+    result.found = entry.found;
+    result.totalCost = entry.totalCost;
+    result.nodesExpanded = entry.nodesExpanded;
+    result.arrivalMinutes = entry.arrivalMinutes;
+    resetSearchTrace(result.trace);
+    if (result.trace) {
+        SearchTrace& trace = *result.trace;
+        while (trace.capacity < entry.traceCount) {
+            growSearchTrace(trace);
+        }
+        for (int t = 0; t < entry.traceCount; t++) {
+            trace.edges[t] = entry.trace[t];
+        }
+        trace.count = entry.traceCount;
+        trace.offered = entry.traceOffered;
+    }
+    result.heapCounters = HeapCounters();
+    clearJourney(result.journey);
+    initJourney(result.journey);
+
+    string fromPort = key.originPort;
+    for (int l = 0; l < entry.legCount; l++) {
+        Route* r = getRouteView(g, *pin.fg, entry.sailings[l]);
+        appendLeg(result.journey,
+            fromPort,
+            r->destinationPort,
+            r->voyageDate,
+            r->departureTime,
+            r->arrivalTime,
+            r->voyageCost,
+            r->shippingCompany);
+        fromPort = r->destinationPort;
+    }
+    return true;
+}
+
+// CSR id of the sailing leg stands for in fg, or -1
+static int findLegSailing(const Graph& g, const FrozenGraph& fg, const BookedLeg& leg) {
+    int from = findPortId(g, leg.originPort);
+    int to = findPortId(g, leg.destinationPort);
+    if (from < 0 || to < 0 || from >= fg.portCount) return -1;
+
+    int departure = toEpochMinutes(leg.voyageDate, leg.departureTime);
+    const int edgeEnd = fg.firstEdge[from + 1];
+    for (int e = firstDepartureFrom(fg, from, departure); e < edgeEnd && fg.edges[e].departure == departure; e++) {
+        const Sailing& s = fg.edges[e];
+        if (s.destinationId == to && s.voyageCost == leg.voyageCost && leg.shippingCompany == g.companyNames[s.companyId]) return e;
+    }
+    return -1;
+}
+
+void storeQueryCache(QueryCache& cache, Graph& g, const QueryCacheTicket& ticket, const ShortestPathResult& result) {
+    FrozenGraphPin pin(g);
+    if (pin.fg->version != ticket.version) return;
+
+    int legCount = result.found ? result.journey.legCount : 0;
+    int* sailings = legCount > 0 ? new int[legCount] : nullptr;
+    int l = 0;
+    for (const BookedLeg* leg = result.journey.head; leg && l < legCount; leg = leg->next) {
+        int e = findLegSailing(g, *pin.fg, *leg);
+        if (e < 0) {
+            delete[] sailings;
+            return;
+        }
+        sailings[l++] = e;
+    }
+
+    QueryCacheShard& shard = shardFor(cache, ticket.hash);
+    lock_guard<mutex> lock(shard.lock);
+    if (shard.capacity == 0) {
+        delete[] sailings;
+        return;
+    }
+    syncShardVersion(shard, ticket.version);
+    if (shard.version != ticket.version) {
+        delete[] sailings;
+        return;
+    }
+
+    // Already cached, perhaps by another thread; only a missing trace is added
+    int known = findEntry(shard, ticket.hash, ticket.key);
+    if (known >= 0) {
+        CachedQuery& entry = shard.entries[known];
+        if (result.trace && !entry.traced) {
+            shard.bytes -= entryBytes(entry);
+            keepTrace(entry, *result.trace);
+            shard.bytes += entryBytes(entry);
+        }
+        delete[] sailings;
+        return;
+    }
+
+    int i;
+    if (shard.freeEntry >= 0) {
+        i = shard.freeEntry;
+        shard.freeEntry = shard.entries[i].chain;
+    } else {
+        i = evictOldest(shard);
+    }
+
+    CachedQuery& entry = shard.entries[i];
+    entry.hash = ticket.hash;
+    entry.key = ticket.key;
+    entry.found = result.found;
+    entry.totalCost = result.totalCost;
+    entry.nodesExpanded = result.nodesExpanded;
+    entry.arrivalMinutes = result.arrivalMinutes;
+    entry.sailings = sailings;
+    entry.legCount = l;
+    if (result.trace) keepTrace(entry, *result.trace);
+
+    int b = bucketFor(shard, entry.hash);
+    entry.chain = shard.buckets[b];
+    shard.buckets[b] = i;
+    linkNewest(shard, i);
+    shard.count++;
+    shard.bytes += entryBytes(entry);
+}
+
+QueryCacheStats getQueryCacheStats(QueryCache& cache) {
+    QueryCacheStats stats;
+    for (int s = 0; s < QUERY_CACHE_SHARDS; s++) {
+        QueryCacheShard& shard = cache.shards[s];
+        lock_guard<mutex> lock(shard.lock);
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.evictions += shard.evictions;
+        stats.invalidations += shard.invalidations;
+        stats.entries += shard.count;
+        stats.capacity += shard.capacity;
+        stats.bytes += shard.bytes;
+    }
+    return stats;
+}
+
+void printQueryCacheStats(const QueryCacheStats& stats) {
+    long long lookups = stats.hits + stats.misses;
+    double hitRate = lookups > 0 ? 100.0 * stats.hits / lookups : 0.0;
+    cout << "Query cache: " << stats.hits << " hit(s) / " << lookups << " lookup(s) (" << hitRate << "%), "
+         << stats.entries << " of " << stats.capacity << " entries, " << stats.bytes / 1024.0 << " KB, "
+         << stats.evictions << " evicted, " << stats.invalidations << " shard(s) invalidated." << endl;
+}
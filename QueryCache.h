@@ -0,0 +1,133 @@
+#ifndef QUERY_CACHE_H
+#define QUERY_CACHE_H
+
+#include <string>
+#include <mutex>
+#include "Graph.h"
+#include "DateTime.h"
+#include "RoutePreferences.h"
+#include "ShortestPath.h"
+#include "SearchTrace.h"
+
+using namespace std;
+
+// Shards of a QueryCache; a query only ever locks the one its key hashes to
+const int QUERY_CACHE_SHARDS = 16;
+
+// Entries kept across all shards when initQueryCache is given none
+const int QUERY_CACHE_DEFAULT_CAPACITY = 4096;
+
+// Everything a search result depends on besides the timetable. strategy
+// is the caller's own code for the engine that ran (the UI passes its
+// UIStrategy); date should be left zeroed for searches that ignore it.
+struct QueryKey {
+    int strategy;
+    string originPort;
+    string destPort;
+    Date date;
+    int maxLegs;
+    const RoutePreferences* prefs;
+
+    QueryKey() : strategy(0), date(), maxLegs(0), prefs(nullptr) {}
+};
+
+// One cached result: the totals and the CSR ids of its sailings in the
+// version it was found on, plus the explored edges if the search that
+// stored it was traced (traced is then set, even for an empty trace).
+// key is the canonical text of the QueryKey, so a hash collision never
+// returns another query's route. Entries of a shard are chained per
+// bucket and linked from most to least recently used through prev / next.
+struct CachedQuery {
+    unsigned long long hash;
+    string key;
+    bool found;
+    int totalCost;
+    int nodesExpanded;
+    int arrivalMinutes;
+    int* sailings;
+    int legCount;
+    bool traced;
+    TracedEdge* trace;
+    int traceCount;
+    int traceOffered;
+    int chain;
+    int prev;
+    int next;
+
+    CachedQuery() : hash(0), found(false), totalCost(0), nodesExpanded(0), arrivalMinutes(0), sailings(nullptr), legCount(0),
+                    traced(false), trace(nullptr), traceCount(0), traceOffered(0), chain(-1), prev(-1), next(-1) {}
+};
+
+// Entries of a shard all belong to version; seeing a newer version
+// empties the shard before it is used
+struct QueryCacheShard {
+    mutex lock;
+    CachedQuery* entries;
+    int capacity;
+    int count;
+    int* buckets;
+    int bucketCount;
+    int freeEntry;
+    int newest;
+    int oldest;
+    unsigned long long version;
+    long long hits;
+    long long misses;
+    long long evictions;
+    long long invalidations;
+    size_t bytes;
+
+    QueryCacheShard() : entries(nullptr), capacity(0), count(0), buckets(nullptr), bucketCount(0), freeEntry(-1), newest(-1), oldest(-1),
+                        version(0), hits(0), misses(0), evictions(0), invalidations(0), bytes(0) {}
+};
+
+// Thread-safe LRU cache of search results keyed by query and timetable
+// version. Any number of threads may look up and store at once.
+struct QueryCache {
+    QueryCacheShard shards[QUERY_CACHE_SHARDS];
+};
+
+// What a lookup found out, for the store that follows a miss
+struct QueryCacheTicket {
+    unsigned long long hash;
+    unsigned long long version;
+    string key;
+
+    QueryCacheTicket() : hash(0), version(0) {}
+};
+
+struct QueryCacheStats {
+    long long hits;
+    long long misses;
+    long long evictions;
+    long long invalidations;
+    int entries;
+    int capacity;
+    size_t bytes;
+
+    QueryCacheStats() : hits(0), misses(0), evictions(0), invalidations(0), entries(0), capacity(0), bytes(0) {}
+};
+
+// Room for capacity entries in all (at least one per shard)
+void initQueryCache(QueryCache& cache, int capacity = QUERY_CACHE_DEFAULT_CAPACITY);
+
+void freeQueryCache(QueryCache& cache);
+
+// On a hit, fills found, totalCost, nodesExpanded, arrivalMinutes and the
+// journey of result from the current version and returns true. If result
+// has a trace it gets the stored edges, as the storing search sampled
+// them; an entry stored without a trace then counts as a miss, and the
+// store after the search adds the trace to it. Either way ticket is set
+// up for storeQueryCache.
+bool lookupQueryCache(QueryCache& cache, Graph& g, const QueryKey& key, ShortestPathResult& result, QueryCacheTicket& ticket);
+
+// Caches result for the query of ticket, with its trace if it has one,
+// unless the timetable has changed since the lookup (the result may then
+// be from either version) or a leg names no sailing of the version
+void storeQueryCache(QueryCache& cache, Graph& g, const QueryCacheTicket& ticket, const ShortestPathResult& result);
+
+QueryCacheStats getQueryCacheStats(QueryCache& cache);
+
+void printQueryCacheStats(const QueryCacheStats& stats);
+
+#endif
@@ -5,18 +5,22 @@
 
 using namespace std;
 
+// destinationPort and shippingCompany point at names interned in the
+// graph's arena; copies of a Route share them and must not outlive the graph.
+// departureMinutes and arrivalMinutes are the same sailing in epoch minutes
+// (arrival already rolled over midnight), for connection checks.
 struct Route {
- string destinationPort;
+ const char *destinationPort;
+ int destinationId;
  Date voyageDate;
  Time departureTime;
  Time arrivalTime;
  int voyageCost;
- string shippingCompany;
+ const char *shippingCompany;
+ int companyId;
+ int departureMinutes;
+ int arrivalMinutes;
  Route *next;
 
- Route() : destinationPort(), voyageDate{0,0,0}, departureTime{0,0}, arrivalTime{0,0}, voyageCost(0), shippingCompany(), next(nullptr) {}
+ Route() : destinationPort(""), destinationId(-1), voyageDate{0,0,0}, departureTime{0,0}, arrivalTime{0,0}, voyageCost(0), shippingCompany(""), companyId(-1), departureMinutes(0), arrivalMinutes(0), next(nullptr) {}
 };
-
-Route *createRoute(const string &destination, const Date &date, const Time &dep, const Time &arr, int cost, const string &company);
-
-Route *prependRoute(Route *head, Route *r);
@@ -0,0 +1,352 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "RouteFeed.h"
+#include "RouteLoader.h"
+#include "ScheduleUpdate.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// A larger backlog is worked off over several polls so one call stays short
+static const long long MAX_BYTES_PER_POLL = 4 * 1024 * 1024;
+
+// An unfinished line longer than this is not a sailing and is dropped
+static const size_t MAX_LINE_BYTES = 4096;
+
+// Only the first few malformed lines are echoed, the rest are just counted
+static const int MAX_REPORTED_REJECTS = 10;
+
+static long long fileSize(FILE *f) {
+#ifdef _WIN32
+    if (_fseeki64(f, 0, SEEK_END) != 0) return -1;
+    return _ftelli64(f);
+#else
+    if (fseeko(f, 0, SEEK_END) != 0) return -1;
+    return (long long)ftello(f);
+#endif
+}
+
+static bool seekTo(FILE *f, long long offset) {
+#ifdef _WIN32
+    return _fseeki64(f, offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static void addWatch(RouteFeed &feed) {
+#ifdef __linux__
+    if (feed.inotifyFd < 0) return;
+    feed.watchFd = inotify_add_watch(feed.inotifyFd, feed.path.c_str(),
+                                     IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+#else
+    (void)feed;
+#endif
+}
+
+// Drains queued watch events; true if any arrived. Once the file is moved
+// or deleted the watch is gone and the feed polls until it can re-watch.
+static bool drainWatch(RouteFeed &feed) {
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+    bool changed = false;
+    ssize_t n;
+    while ((n = read(feed.inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + n; ) {
+            const inotify_event *event = (const inotify_event *)p;
+            if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) {
+                if (event->wd == feed.watchFd) feed.watchFd = -1;
+            }
+            changed = true;
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+    return changed;
+#else
+    (void)feed;
+    return false;
+#endif
+}
+
+static void reserveCarry(RouteFeed &feed, size_t needed) {
+    if (needed <= feed.carryCapacity) return;
+    size_t capacity = feed.carryCapacity > 0 ? feed.carryCapacity : 4096;
+    while (capacity < needed) capacity *= 2;
+    char *grown = new char[capacity];
+    if (feed.carryLength > 0) memcpy(grown, feed.carry, feed.carryLength);
+    delete[] feed.carry;
+    feed.carry = grown;
+    feed.carryCapacity = capacity;
+}
+
+static void rejectLine(RouteFeed &feed, const char *line, const char *lineEnd) {
+    if (feed.stats.linesRejected < MAX_REPORTED_REJECTS) {
+        if (lineEnd > line && lineEnd[-1] == '\r') lineEnd--;
+        cout << "Invalid line skipped: " << string(line, lineEnd - line) << endl;
+    }
+    feed.stats.linesRejected++;
+}
+
+// Orders sailings by the key a cancel matches on (origin, departure,
+// destination, company), then by their terms
+static bool sailingChangeBefore(const SailingChange &a, const SailingChange &b) {
+    if (a.originId != b.originId) return a.originId < b.originId;
+    if (a.sailing.departure != b.sailing.departure) return a.sailing.departure < b.sailing.departure;
+    if (a.sailing.destinationId != b.sailing.destinationId) return a.sailing.destinationId < b.sailing.destinationId;
+    if (a.sailing.companyId != b.sailing.companyId) return a.sailing.companyId < b.sailing.companyId;
+    if (a.sailing.duration != b.sailing.duration) return a.sailing.duration < b.sailing.duration;
+    return a.sailing.voyageCost < b.sailing.voyageCost;
+}
+
+static bool sameSailingKey(const SailingChange &a, const SailingChange &b) {
+    return a.originId == b.originId && a.sailing.departure == b.sailing.departure
+        && a.sailing.destinationId == b.sailing.destinationId && a.sailing.companyId == b.sailing.companyId;
+}
+
+static bool sameSailingTerms(const SailingChange &a, const SailingChange &b) {
+    return a.sailing.duration == b.sailing.duration && a.sailing.voyageCost == b.sailing.voyageCost;
+}
+
+// The batch that turns the current version into exactly the sailings in
+// file (all SAILING_ADDED, sorted here). Sailings sharing a key are
+// compared as a group; a group that differs at all is cancelled whole and
+// added again. Every cancel comes before every add, so none of them can
+// match a sailing the same batch adds. Caller frees the result.
+static SailingChange *diffWithGraph(Graph &g, SailingChange *file, int fileCount, int &changeCount) {
+    FrozenGraphPin pin(g);
+    const FrozenGraph &fg = *pin.fg;
+    SailingChange *current = new SailingChange[fg.edgeCount > 0 ? fg.edgeCount : 1];
+    for (int port = 0; port < fg.portCount; port++) {
+        for (int e = fg.firstEdge[port]; e < fg.firstEdge[port + 1]; e++) {
+            SailingChange &c = current[e];
+            c.kind = SAILING_CANCELLED;
+            c.originId = port;
+            c.sailing = fg.edges[e];
+            c.retimed = c.sailing;
+        }
+    }
+    sort(current, current + fg.edgeCount, sailingChangeBefore);
+    sort(file, file + fileCount, sailingChangeBefore);
+
+    // Cancels fill changes from the front; the groups to add are only
+    // marked until then
+    SailingChange *changes = new SailingChange[fg.edgeCount + fileCount > 0 ? fg.edgeCount + fileCount : 1];
+    bool *addGroup = new bool[fileCount > 0 ? fileCount : 1];
+    changeCount = 0;
+    int i = 0;
+    int j = 0;
+    while (i < fg.edgeCount || j < fileCount) {
+        // The group shares the key of whichever side sorts first
+        const SailingChange &key = j >= fileCount || (i < fg.edgeCount && sailingChangeBefore(current[i], file[j])) ? current[i] : file[j];
+        int currentEnd = i;
+        while (currentEnd < fg.edgeCount && sameSailingKey(current[currentEnd], key)) currentEnd++;
+        int fileEnd = j;
+        while (fileEnd < fileCount && sameSailingKey(file[fileEnd], key)) fileEnd++;
+
+        bool same = currentEnd - i == fileEnd - j;
+        for (int k = 0; same && k < currentEnd - i; k++) {
+            same = sameSailingTerms(current[i + k], file[j + k]);
+        }
+        for (int k = i; !same && k < currentEnd; k++) {
+            changes[changeCount++] = current[k];
+        }
+        for (int k = j; k < fileEnd; k++) {
+            addGroup[k] = !same;
+        }
+        i = currentEnd;
+        j = fileEnd;
+    }
+    for (int k = 0; k < fileCount; k++) {
+        if (addGroup[k]) changes[changeCount++] = file[k];
+    }
+
+    delete[] addGroup;
+    delete[] current;
+    return changes;
+}
+
+bool openRouteFeed(RouteFeed &feed, const string &path, int pollIntervalMs) {
+    closeRouteFeed(feed);
+    feed.path = path;
+    feed.pollIntervalMs = pollIntervalMs;
+
+    // Watch before taking the size so no append falls between the two
+#ifdef __linux__
+    feed.inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    addWatch(feed);
+#endif
+
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) {
+        closeRouteFeed(feed);
+        return false;
+    }
+    long long size = fileSize(f);
+    fclose(f);
+
+    feed.offset = size > 0 ? size : 0;
+    feed.lastCheck = chrono::steady_clock::now();
+    return true;
+}
+
+int pollRouteFeed(Graph &g, RouteFeed &feed) {
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+    bool due = feed.behind;
+    if (feed.watchFd >= 0 && drainWatch(feed)) due = true;
+    if (feed.watchFd < 0 && now - feed.lastCheck >= chrono::milliseconds(feed.pollIntervalMs)) {
+        due = true;
+        addWatch(feed);
+    }
+    if (!due) return 0;
+    feed.lastCheck = now;
+
+    FILE *f = fopen(feed.path.c_str(), "rb");
+    if (!f) return 0;
+    long long size = fileSize(f);
+
+    // A file that shrank was truncated or replaced, so what was applied
+    // from it may be gone: it is read again from the top in one go and the
+    // graph is brought in line with it (see diffWithGraph)
+    bool restart = size >= 0 && size < feed.offset;
+    if (restart) {
+        feed.offset = 0;
+        feed.carryLength = 0;
+        feed.stats.restarts++;
+    }
+
+    long long available = size - feed.offset;
+    if (available < 0 || (available == 0 && !restart) || !seekTo(f, feed.offset)) {
+        fclose(f);
+        feed.behind = false;
+        feed.stats.backlogBytes = 0;
+        return 0;
+    }
+    if (!feed.behind) {
+        feed.behind = true;
+        feed.noticedAt = now;
+    }
+
+    long long wanted = restart || available < MAX_BYTES_PER_POLL ? available : MAX_BYTES_PER_POLL;
+    reserveCarry(feed, feed.carryLength + (size_t)wanted);
+    size_t got = wanted > 0 ? fread(feed.carry + feed.carryLength, 1, (size_t)wanted, f) : 0;
+    fclose(f);
+
+    feed.offset += (long long)got;
+    feed.carryLength += got;
+    feed.stats.bytesRead += (long long)got;
+    feed.stats.backlogBytes = size - feed.offset;
+
+    // Only complete lines are parsed; the tail waits for its newline
+    const char *begin = feed.carry;
+    const char *complete = begin + feed.carryLength;
+    while (complete > begin && complete[-1] != '\n') complete--;
+
+    int lines = 0;
+    for (const char *p = begin; p < complete; p++) {
+        if (*p == '\n') lines++;
+    }
+    SailingChange *changes = new SailingChange[lines > 0 ? lines : 1];
+    int changeCount = 0;
+    int accepted = 0;
+
+    const char *line = begin;
+    while (line < complete) {
+        const char *lineEnd = line;
+        while (*lineEnd != '\n') lineEnd++;
+
+        if (!isBlankLine(line, lineEnd)) {
+            ParsedSailing s;
+            int companyId = -1;
+            if (parseSailingLine(line, lineEnd, s)) {
+                companyId = internCompany(g, s.company, s.companyLength);
+            }
+            // A sailing past the company limit cannot be stored, so it is
+            // rejected like a malformed line
+            if (companyId >= 0) {
+                accepted++;
+                SailingChange &c = changes[changeCount++];
+                c.kind = SAILING_ADDED;
+                c.originId = addPortIfNotExists(g, s.origin, s.originLength)->id;
+                c.sailing = makeSailing(addPortIfNotExists(g, s.destination, s.destinationLength)->id,
+                                        s.date, s.departure, s.arrival, s.cost, companyId);
+                c.retimed = c.sailing;
+            } else {
+                rejectLine(feed, line, lineEnd);
+            }
+        }
+        line = lineEnd + 1;
+    }
+
+    size_t consumed = (size_t)(complete - begin);
+    feed.carryLength -= consumed;
+    if (feed.carryLength > MAX_LINE_BYTES) {
+        // Echo just the start of it
+        rejectLine(feed, feed.carry + consumed, feed.carry + consumed + 80);
+        feed.carryLength = 0;
+    } else if (consumed > 0 && feed.carryLength > 0) {
+        memmove(feed.carry, feed.carry + consumed, feed.carryLength);
+    }
+    feed.stats.linesAccepted += accepted;
+
+    if (restart) {
+        int diffCount = 0;
+        SailingChange *diff = diffWithGraph(g, changes, changeCount, diffCount);
+        delete[] changes;
+        changes = diff;
+        changeCount = diffCount;
+    }
+
+    if (changeCount > 0) {
+        ScheduleUpdateStats update;
+        applyScheduleUpdate(g, changes, changeCount, update);
+        feed.stats.version = update.version;
+        feed.stats.batches++;
+
+        chrono::steady_clock::time_point published = chrono::steady_clock::now();
+        feed.stats.lastLagMilliseconds = chrono::duration<double, milli>(published - feed.noticedAt).count();
+        if (feed.stats.lastLagMilliseconds > feed.stats.maxLagMilliseconds) {
+            feed.stats.maxLagMilliseconds = feed.stats.lastLagMilliseconds;
+        }
+    }
+    delete[] changes;
+
+    // Bytes still unread keep their original notice time for the lag figure
+    feed.behind = feed.stats.backlogBytes > 0;
+
+    feed.stats.busySeconds += chrono::duration<double>(chrono::steady_clock::now() - now).count();
+    int totalLines = feed.stats.linesAccepted + feed.stats.linesRejected;
+    feed.stats.linesPerSecond = feed.stats.busySeconds > 0.0 ? totalLines / feed.stats.busySeconds : 0.0;
+    return changeCount;
+}
+
+void closeRouteFeed(RouteFeed &feed) {
+#ifdef __linux__
+    if (feed.inotifyFd >= 0) close(feed.inotifyFd);
+#endif
+    delete[] feed.carry;
+    feed.carry = nullptr;
+    feed.carryLength = 0;
+    feed.carryCapacity = 0;
+    feed.inotifyFd = -1;
+    feed.watchFd = -1;
+    feed.offset = 0;
+    feed.behind = false;
+    feed.stats = RouteFeedStats();
+}
+
+void printRouteFeedStats(const RouteFeedStats &stats) {
+    cout << "Route feed -> version " << stats.version << ": " << stats.linesAccepted << " sailing(s) in "
+         << stats.batches << " batch(es)";
+    if (stats.linesRejected > 0) {
+        cout << ", " << stats.linesRejected << " rejected";
+    }
+    cout << "; lag " << stats.lastLagMilliseconds << " ms (max " << stats.maxLagMilliseconds << " ms), "
+         << stats.backlogBytes << " bytes behind, " << (long long)stats.linesPerSecond << " lines/s." << endl;
+}
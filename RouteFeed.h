@@ -0,0 +1,75 @@
+#ifndef ROUTE_FEED_H
+#define ROUTE_FEED_H
+
+#include <string>
+#include <chrono>
+#include "Graph.h"
+
+using namespace std;
+
+// Cumulative counters for a followed routes file. Lag runs from the poll
+// that first saw unread bytes to the publish of the version holding them;
+// backlogBytes is what was still unread when the last poll returned.
+struct RouteFeedStats {
+    int linesAccepted;
+    int linesRejected;
+    int batches;
+    int restarts;
+    long long bytesRead;
+    long long backlogBytes;
+    unsigned long long version;
+    double lastLagMilliseconds;
+    double maxLagMilliseconds;
+    double busySeconds;
+    double linesPerSecond;
+
+    RouteFeedStats() : linesAccepted(0), linesRejected(0), batches(0), restarts(0), bytesRead(0), backlogBytes(0), version(0),
+        lastLagMilliseconds(0.0), maxLagMilliseconds(0.0), busySeconds(0.0), linesPerSecond(0.0) {}
+};
+
+// Follows a routes file that normally only grows. offset is the first byte
+// not yet read; an unfinished last line waits in carry until its newline
+// arrives. If the file shrinks it was truncated or replaced, and the next
+// poll makes the graph hold exactly the sailings it now lists. On Linux
+// an inotify watch says when to look again, elsewhere (or if the watch
+// cannot be set up) the file is checked every pollIntervalMs.
+struct RouteFeed {
+    string path;
+    long long offset;
+
+    char *carry;
+    size_t carryLength;
+    size_t carryCapacity;
+
+    int inotifyFd;
+    int watchFd;
+
+    int pollIntervalMs;
+    chrono::steady_clock::time_point lastCheck;
+    chrono::steady_clock::time_point noticedAt;
+    bool behind;
+
+    RouteFeedStats stats;
+
+    RouteFeed() : offset(0), carry(nullptr), carryLength(0), carryCapacity(0), inotifyFd(-1), watchFd(-1),
+        pollIntervalMs(250), behind(false) {}
+};
+
+// Starts following path from its current end, so it pairs with a graph
+// that was just loaded from the same file. Returns false if the file
+// cannot be opened.
+bool openRouteFeed(RouteFeed &feed, const string &path, int pollIntervalMs = 250);
+
+// Reads whatever was appended since the last call, parses the complete
+// lines and applies them to the graph as one schedule update. Never
+// blocks; cheap enough to call every frame. New ports and companies are
+// interned here, so call it from the thread that owns the graph. Returns
+// the number of sailings added, or after a truncation the number of
+// sailings cancelled and added to match the file.
+int pollRouteFeed(Graph &g, RouteFeed &feed);
+
+void closeRouteFeed(RouteFeed &feed);
+
+void printRouteFeedStats(const RouteFeedStats &stats);
+
+#endif
@@ -0,0 +1,245 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include "RouteLoader.h"
+#include "MappedFile.h"
+
+using namespace std;
+
+// Chunks smaller than this are not worth a thread of their own
+static const size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+// Only the first few malformed lines are echoed, the rest are just counted
+static const int MAX_REPORTED_REJECTS = 10;
+
+struct ParsedChunk {
+    const char *begin;
+    const char *end;
+
+    ParsedSailing *sailings;
+    int count;
+    int rejected;
+
+    const char *rejectStart[MAX_REPORTED_REJECTS];
+    int rejectLength[MAX_REPORTED_REJECTS];
+    int reportedRejects;
+
+    ParsedChunk() : begin(nullptr), end(nullptr), sailings(nullptr), count(0), rejected(0), reportedRejects(0) {}
+};
+
+static inline bool isFieldSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Advances p to the next whitespace-separated field on the line
+static bool nextField(const char *&p, const char *lineEnd, const char *&start, int &length) {
+    while (p < lineEnd && isFieldSpace(*p)) p++;
+    if (p >= lineEnd) return false;
+    start = p;
+    while (p < lineEnd && !isFieldSpace(*p)) p++;
+    length = (int)(p - start);
+    return true;
+}
+
+static bool scanNumber(const char *&p, const char *end, int &value) {
+    if (p >= end || !isDigit(*p)) return false;
+    int v = 0;
+    while (p < end && isDigit(*p)) {
+        v = v * 10 + (*p - '0');
+        p++;
+    }
+    value = v;
+    return true;
+}
+
+// d/m/yyyy
+static bool scanDate(const char *s, int length, Date &d) {
+    const char *p = s;
+    const char *end = s + length;
+    if (!scanNumber(p, end, d.day) || p >= end || *p++ != '/') return false;
+    if (!scanNumber(p, end, d.month) || p >= end || *p++ != '/') return false;
+    if (!scanNumber(p, end, d.year)) return false;
+    return p == end;
+}
+
+// HH:MM
+static bool scanTime(const char *s, int length, Time &t) {
+    const char *p = s;
+    const char *end = s + length;
+    if (!scanNumber(p, end, t.hour) || p >= end || *p++ != ':') return false;
+    if (!scanNumber(p, end, t.minute)) return false;
+    return p == end;
+}
+
+static bool scanCost(const char *s, int length, int &cost) {
+    const char *p = s;
+    const char *end = s + length;
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        p++;
+    }
+    if (!scanNumber(p, end, cost)) return false;
+    if (negative) cost = -cost;
+    return p == end;
+}
+
+// Origin Dest d/m/yyyy HH:MM HH:MM cost Company
+bool parseSailingLine(const char *line, const char *lineEnd, ParsedSailing &s) {
+    const char *p = line;
+    const char *field;
+    int length;
+
+    if (!nextField(p, lineEnd, s.origin, s.originLength)) return false;
+    if (!nextField(p, lineEnd, s.destination, s.destinationLength)) return false;
+    if (!nextField(p, lineEnd, field, length) || !scanDate(field, length, s.date)) return false;
+    if (!nextField(p, lineEnd, field, length) || !scanTime(field, length, s.departure)) return false;
+    if (!nextField(p, lineEnd, field, length) || !scanTime(field, length, s.arrival)) return false;
+    if (!nextField(p, lineEnd, field, length) || !scanCost(field, length, s.cost)) return false;
+    if (!nextField(p, lineEnd, s.company, s.companyLength)) return false;
+    return true;
+}
+
+bool isBlankLine(const char *line, const char *lineEnd) {
+    for (const char *p = line; p < lineEnd; p++) {
+        if (!isFieldSpace(*p)) return false;
+    }
+    return true;
+}
+
+// Worker body: one pass to size the output, one pass to parse
+static void parseChunk(ParsedChunk *chunk) {
+    int lines = 1;
+    for (const char *p = chunk->begin; p < chunk->end; p++) {
+        if (*p == '\n') lines++;
+    }
+    chunk->sailings = new ParsedSailing[lines];
+
+    const char *line = chunk->begin;
+    while (line < chunk->end) {
+        const char *lineEnd = line;
+        while (lineEnd < chunk->end && *lineEnd != '\n') lineEnd++;
+
+        if (!isBlankLine(line, lineEnd)) {
+            if (parseSailingLine(line, lineEnd, chunk->sailings[chunk->count])) {
+                chunk->count++;
+            } else {
+                if (chunk->reportedRejects < MAX_REPORTED_REJECTS) {
+                    const char *shown = lineEnd;
+                    if (shown > line && shown[-1] == '\r') shown--;
+                    chunk->rejectStart[chunk->reportedRejects] = line;
+                    chunk->rejectLength[chunk->reportedRejects] = (int)(shown - line);
+                    chunk->reportedRejects++;
+                }
+                chunk->rejected++;
+            }
+        }
+        line = lineEnd + 1;
+    }
+}
+
+// Single-threaded merge so port ids and list order match the file order
+// Returns how many sailings were dropped because the company table is full
+static int mergeChunk(Graph &g, const ParsedChunk &chunk) {
+    int dropped = 0;
+    for (int i = 0; i < chunk.count; i++) {
+        const ParsedSailing &s = chunk.sailings[i];
+        int originId = addPortIfNotExists(g, s.origin, s.originLength)->id;
+        int destinationId = addPortIfNotExists(g, s.destination, s.destinationLength)->id;
+        int companyId = internCompany(g, s.company, s.companyLength);
+        if (companyId < 0) {
+            dropped++;
+            continue;
+        }
+        addRouteById(g, originId, destinationId, s.date, s.departure, s.arrival, s.cost, companyId);
+    }
+    return dropped;
+}
+
+// Cuts [data, data+size) into at most parts pieces that end on a newline
+static int splitIntoChunks(const char *data, size_t size, int parts, ParsedChunk *chunks) {
+    int count = 0;
+    const char *end = data + size;
+    const char *start = data;
+    for (int i = 0; i < parts && start < end; i++) {
+        const char *cut = (i == parts - 1) ? end : data + (size * (i + 1)) / parts;
+        if (cut < start) cut = start;
+        while (cut < end && *cut != '\n') cut++;
+        if (cut < end) cut++;
+        chunks[count].begin = start;
+        chunks[count].end = cut;
+        count++;
+        start = cut;
+    }
+    return count;
+}
+
+bool loadRoutesParallel(Graph &g, const string &filePath, RouteLoadStats &stats, int threadCount) {
+    stats = RouteLoadStats();
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+
+    MappedFile file;
+    if (!mapFileReadOnly(filePath, file)) return false;
+
+    if (threadCount <= 0) {
+        threadCount = (int)thread::hardware_concurrency();
+        if (threadCount <= 0) threadCount = 1;
+    }
+    int maxChunks = (int)(file.size / MIN_CHUNK_BYTES) + 1;
+    if (threadCount > maxChunks) threadCount = maxChunks;
+
+    ParsedChunk *chunks = new ParsedChunk[threadCount];
+    int chunkCount = splitIntoChunks(file.data, file.size, threadCount, chunks);
+
+    if (chunkCount > 1) {
+        thread *workers = new thread[chunkCount - 1];
+        for (int i = 1; i < chunkCount; i++) {
+            workers[i - 1] = thread(parseChunk, &chunks[i]);
+        }
+        parseChunk(&chunks[0]);
+        for (int i = 0; i < chunkCount - 1; i++) {
+            workers[i].join();
+        }
+        delete[] workers;
+    } else if (chunkCount == 1) {
+        parseChunk(&chunks[0]);
+    }
+
+    for (int i = 0; i < chunkCount; i++) {
+        int dropped = mergeChunk(g, chunks[i]);
+        for (int r = 0; r < chunks[i].reportedRejects; r++) {
+            if (stats.linesRejected + r >= MAX_REPORTED_REJECTS) break;
+            cout << "Invalid line skipped: " << string(chunks[i].rejectStart[r], chunks[i].rejectLength[r]) << endl;
+        }
+        stats.linesAccepted += chunks[i].count - dropped;
+        stats.linesDropped += dropped;
+        stats.linesRejected += chunks[i].rejected;
+        delete[] chunks[i].sailings;
+    }
+    stats.chunkCount = chunkCount;
+    stats.threadCount = chunkCount > 0 ? chunkCount : 1;
+    stats.bytesRead = (long long)file.size;
+
+    delete[] chunks;
+    unmapFile(file);
+
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    int totalLines = stats.linesAccepted + stats.linesDropped + stats.linesRejected;
+    stats.linesPerSecond = stats.seconds > 0.0 ? totalLines / stats.seconds : 0.0;
+    return true;
+}
+
+void printRouteLoadStats(const RouteLoadStats &stats) {
+    if (stats.linesRejected > 0) {
+        cout << "Rejected " << stats.linesRejected << " malformed line(s)." << endl;
+    }
+    if (stats.linesDropped > 0) {
+        cout << "Dropped " << stats.linesDropped << " sailing(s) past the " << MAX_COMPANIES << "-company limit." << endl;
+    }
+    cout << "Parsed " << stats.bytesRead << " bytes in " << stats.seconds * 1000.0 << " ms ("
+         << (long long)stats.linesPerSecond << " lines/s, " << stats.threadCount << " thread(s))." << endl;
+}
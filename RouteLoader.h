@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include "Graph.h"
+
+using namespace std;
+
+// One parsed line; names point straight into the parsed buffer
+struct ParsedSailing {
+    const char *origin;
+    const char *destination;
+    const char *company;
+    int originLength;
+    int destinationLength;
+    int companyLength;
+    Date date;
+    Time departure;
+    Time arrival;
+    int cost;
+};
+
+// Counters reported after a routes file has been loaded
+struct RouteLoadStats {
+    int linesAccepted;
+    int linesRejected;
+    int linesDropped;     // well-formed, but past the company limit
+    int chunkCount;
+    int threadCount;
+    long long bytesRead;
+    double seconds;
+    double linesPerSecond;
+
+    RouteLoadStats() : linesAccepted(0), linesRejected(0), linesDropped(0), chunkCount(0), threadCount(0), bytesRead(0), seconds(0.0), linesPerSecond(0.0) {}
+};
+
+// Maps the routes file, parses newline-aligned chunks on worker threads and
+// merges them into the graph in file order. threadCount <= 0 picks one
+// worker per hardware thread.
+bool loadRoutesParallel(Graph &g, const string &filePath, RouteLoadStats &stats, int threadCount = 0);
+
+void printRouteLoadStats(const RouteLoadStats &stats);
+
+// Parses one Routes.txt line, [line, lineEnd) without the newline
+bool parseSailingLine(const char *line, const char *lineEnd, ParsedSailing &s);
+
+bool isBlankLine(const char *line, const char *lineEnd);
@@ -0,0 +1,412 @@
+#include "RouteMatrix.h"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <limits.h>
+
+using namespace std;
+
+static const char MATRIX_MAGIC[8] = { 'O', 'R', 'N', 'M', 'A', 'T', 'R', 'X' };
+
+// Fixed-size header; the payload is cost[n * n], minutes[n * n], legs[n * n]
+struct MatrixHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    int32_t portCount;
+    int32_t reserved;
+    uint64_t networkChecksum;
+    uint64_t payloadBytes;
+};
+
+static uint64_t checksumBytes(uint64_t h, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static size_t payloadSizeFor(int portCount) {
+    size_t cells = (size_t)portCount * portCount;
+    return cells * (sizeof(int32_t) * 2 + sizeof(uint8_t));
+}
+
+void buildPortArcs(const Graph& g, const FrozenGraph& fg, PortArcs& arcs, const RoutePreferences* prefs, PortArcChoice choice) {
+    freePortArcs(arcs);
+    int portCount = fg.portCount;
+    arcs.portCount = portCount;
+    arcs.firstArc = new int[portCount + 1];
+    arcs.arcTarget = new int[fg.edgeCount > 0 ? fg.edgeCount : 1];
+    arcs.arcCost = new int[fg.edgeCount > 0 ? fg.edgeCount : 1];
+    arcs.arcMinutes = new int[fg.edgeCount > 0 ? fg.edgeCount : 1];
+    arcs.arcEdge = new int[fg.edgeCount > 0 ? fg.edgeCount : 1];
+
+    bool* portForbidden = new bool[portCount > 0 ? portCount : 1];
+    for (int i = 0; i < portCount; i++) {
+        portForbidden[i] = prefs && prefs->forbiddenPortsCount > 0 && isPortForbidden(*prefs, g.portById[i]->name);
+    }
+    bool* companyAllowed = new bool[g.companyCount > 0 ? g.companyCount : 1];
+    for (int i = 0; i < g.companyCount; i++) {
+        companyAllowed[i] = !prefs || isCompanyAllowed(*prefs, g.companyNames[i]);
+    }
+
+    // arcAt[v] is the arc from the current port to v, valid while seenFrom[v] matches it
+    int* arcAt = new int[portCount > 0 ? portCount : 1];
+    int* seenFrom = new int[portCount > 0 ? portCount : 1];
+    for (int i = 0; i < portCount; i++) {
+        seenFrom[i] = -1;
+    }
+
+    int count = 0;
+    for (int u = 0; u < portCount; u++) {
+        arcs.firstArc[u] = count;
+        if (portForbidden[u]) continue;
+        for (int e = fg.firstEdge[u]; e < fg.firstEdge[u + 1]; e++) {
+            const Sailing& s = fg.edges[e];
+            int v = s.destinationId;
+            if (v == u || portForbidden[v] || !companyAllowed[s.companyId]) continue;
+
+            if (seenFrom[v] != u) {
+                seenFrom[v] = u;
+                arcAt[v] = count;
+                arcs.arcTarget[count] = v;
+                arcs.arcCost[count] = s.voyageCost;
+                arcs.arcMinutes[count] = s.duration;
+                arcs.arcEdge[count] = e;
+                count++;
+            } else {
+                int a = arcAt[v];
+                bool better = choice == PORT_ARCS_FASTEST
+                    ? s.duration < arcs.arcMinutes[a] || (s.duration == arcs.arcMinutes[a] && s.voyageCost < arcs.arcCost[a])
+                    : s.voyageCost < arcs.arcCost[a] || (s.voyageCost == arcs.arcCost[a] && s.duration < arcs.arcMinutes[a]);
+                if (better) {
+                    arcs.arcCost[a] = s.voyageCost;
+                    arcs.arcMinutes[a] = s.duration;
+                    arcs.arcEdge[a] = e;
+                }
+            }
+        }
+    }
+    arcs.firstArc[portCount] = count;
+    arcs.arcCount = count;
+
+    delete[] arcAt;
+    delete[] seenFrom;
+    delete[] portForbidden;
+    delete[] companyAllowed;
+}
+
+void freePortArcs(PortArcs& arcs) {
+    delete[] arcs.firstArc;
+    delete[] arcs.arcTarget;
+    delete[] arcs.arcCost;
+    delete[] arcs.arcMinutes;
+    delete[] arcs.arcEdge;
+    arcs.firstArc = nullptr;
+    arcs.arcTarget = nullptr;
+    arcs.arcCost = nullptr;
+    arcs.arcMinutes = nullptr;
+    arcs.arcEdge = nullptr;
+    arcs.portCount = 0;
+    arcs.arcCount = 0;
+}
+
+unsigned long long checksumPortArcs(const PortArcs& arcs) {
+    uint64_t h = 14695981039346656037ULL;
+    h = checksumBytes(h, &arcs.portCount, sizeof(arcs.portCount));
+    h = checksumBytes(h, arcs.firstArc, sizeof(int) * (arcs.portCount + 1));
+    h = checksumBytes(h, arcs.arcTarget, sizeof(int) * arcs.arcCount);
+    h = checksumBytes(h, arcs.arcCost, sizeof(int) * arcs.arcCount);
+    h = checksumBytes(h, arcs.arcMinutes, sizeof(int) * arcs.arcCount);
+    return h;
+}
+
+void initOneToAllWorkspace(OneToAllWorkspace& ws, int portCount) {
+    freeOneToAllWorkspace(ws);
+    ws.portCount = portCount;
+    ws.cost = new int[portCount > 0 ? portCount : 1];
+    ws.legs = new int[portCount > 0 ? portCount : 1];
+    ws.minutes = new int[portCount > 0 ? portCount : 1];
+    resetIndexedHeap(ws.heap, portCount);
+}
+
+void freeOneToAllWorkspace(OneToAllWorkspace& ws) {
+    delete[] ws.cost;
+    delete[] ws.legs;
+    delete[] ws.minutes;
+    clearIndexedHeap(ws.heap);
+    ws.cost = nullptr;
+    ws.legs = nullptr;
+    ws.minutes = nullptr;
+    ws.portCount = 0;
+}
+
+int searchOneToAll(const PortArcs& arcs, int origin, OneToAllWorkspace& ws) {
+    int portCount = arcs.portCount;
+    for (int i = 0; i < portCount; i++) {
+        ws.cost[i] = INT_MAX;
+        ws.legs[i] = INT_MAX;
+        ws.minutes[i] = INT_MAX;
+    }
+    resetIndexedHeap(ws.heap, portCount);
+    if (origin < 0 || origin >= portCount) return 0;
+
+    ws.cost[origin] = 0;
+    ws.legs[origin] = 0;
+    ws.minutes[origin] = 0;
+    OneToAllEntry start = { 0, 0, 0, origin };
+    pushIndexedHeap(ws.heap, start);
+
+    int settled = 0;
+    OneToAllEntry current;
+    while (popIndexedHeap(ws.heap, current)) {
+        int u = current.port;
+        settled++;
+
+        for (int a = arcs.firstArc[u]; a < arcs.firstArc[u + 1]; a++) {
+            OneToAllEntry next;
+            next.port = arcs.arcTarget[a];
+            next.cost = current.cost + arcs.arcCost[a];
+            next.legs = current.legs + 1;
+            next.minutes = current.minutes + arcs.arcMinutes[a];
+
+            int v = next.port;
+            OneToAllEntry known = { ws.cost[v], ws.legs[v], ws.minutes[v], v };
+            if (!OneToAllEntryOrder::before(next, known)) continue;
+            ws.cost[v] = next.cost;
+            ws.legs[v] = next.legs;
+            ws.minutes[v] = next.minutes;
+            pushIndexedHeap(ws.heap, next);
+        }
+    }
+    return settled;
+}
+
+// What one worker thread needs; origins come from the shared counter
+struct MatrixWorker {
+    const PortArcs* arcs;
+    RouteMatrix* matrix;
+    atomic<int>* nextOrigin;
+    long long portsSettled;
+    long long reachablePairs;
+};
+
+static void runMatrixWorker(MatrixWorker* worker) {
+    const PortArcs& arcs = *worker->arcs;
+    RouteMatrix& m = *worker->matrix;
+    int portCount = arcs.portCount;
+
+    OneToAllWorkspace ws;
+    initOneToAllWorkspace(ws, portCount);
+
+    while (true) {
+        int origin = worker->nextOrigin->fetch_add(1);
+        if (origin >= portCount) break;
+
+        worker->portsSettled += searchOneToAll(arcs, origin, ws);
+
+        size_t row = (size_t)origin * portCount;
+        for (int p = 0; p < portCount; p++) {
+            if (ws.cost[p] == INT_MAX) {
+                m.cost[row + p] = ROUTE_MATRIX_UNREACHABLE;
+                m.minutes[row + p] = ROUTE_MATRIX_UNREACHABLE;
+                m.legs[row + p] = 0;
+            } else {
+                m.cost[row + p] = ws.cost[p];
+                m.minutes[row + p] = ws.minutes[p];
+                m.legs[row + p] = (uint8_t)(ws.legs[p] < 255 ? ws.legs[p] : 255);
+                worker->reachablePairs++;
+            }
+        }
+    }
+
+    freeOneToAllWorkspace(ws);
+}
+
+bool buildRouteMatrix(Graph& g, RouteMatrix& m, RouteMatrixStats& stats, int threadCount, const RoutePreferences* prefs) {
+    stats = RouteMatrixStats();
+    freeRouteMatrix(m);
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+
+    PortArcs arcs;
+    {
+        FrozenGraphPin pin(g);
+        buildPortArcs(g, *pin.fg, arcs, prefs);
+    }
+    int portCount = arcs.portCount;
+    if (portCount == 0) {
+        freePortArcs(arcs);
+        return false;
+    }
+
+    size_t cells = (size_t)portCount * portCount;
+    m.portCount = portCount;
+    m.networkChecksum = checksumPortArcs(arcs);
+    m.cost = new int32_t[cells];
+    m.minutes = new int32_t[cells];
+    m.legs = new uint8_t[cells];
+
+    if (threadCount <= 0) {
+        threadCount = (int)thread::hardware_concurrency();
+        if (threadCount <= 0) threadCount = 1;
+    }
+    if (threadCount > portCount) threadCount = portCount;
+
+    atomic<int> nextOrigin(0);
+    MatrixWorker* workers = new MatrixWorker[threadCount];
+    for (int i = 0; i < threadCount; i++) {
+        workers[i].arcs = &arcs;
+        workers[i].matrix = &m;
+        workers[i].nextOrigin = &nextOrigin;
+        workers[i].portsSettled = 0;
+        workers[i].reachablePairs = 0;
+    }
+
+    if (threadCount > 1) {
+        thread* threads = new thread[threadCount - 1];
+        for (int i = 1; i < threadCount; i++) {
+            threads[i - 1] = thread(runMatrixWorker, &workers[i]);
+        }
+        runMatrixWorker(&workers[0]);
+        for (int i = 0; i < threadCount - 1; i++) {
+            threads[i].join();
+        }
+        delete[] threads;
+    } else {
+        runMatrixWorker(&workers[0]);
+    }
+
+    for (int i = 0; i < threadCount; i++) {
+        stats.portsSettled += workers[i].portsSettled;
+        stats.reachablePairs += workers[i].reachablePairs;
+    }
+    stats.portCount = portCount;
+    stats.arcCount = arcs.arcCount;
+    stats.threadCount = threadCount;
+
+    delete[] workers;
+    freePortArcs(arcs);
+
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    stats.originsPerSecond = stats.seconds > 0.0 ? portCount / stats.seconds : 0.0;
+    return true;
+}
+
+void freeRouteMatrix(RouteMatrix& m) {
+    if (m.file.data) {
+        unmapFile(m.file);
+    } else {
+        delete[] m.cost;
+        delete[] m.minutes;
+        delete[] m.legs;
+    }
+    m.cost = nullptr;
+    m.minutes = nullptr;
+    m.legs = nullptr;
+    m.portCount = 0;
+    m.networkChecksum = 0;
+}
+
+bool lookupRouteMatrix(const Graph& g, const RouteMatrix& m, const string& originPort, const string& destPort, int& cost, int& minutes, int& legs) {
+    int from = findPortId(g, originPort);
+    int to = findPortId(g, destPort);
+    if (from < 0 || to < 0 || from >= m.portCount || to >= m.portCount) return false;
+
+    cost = routeMatrixCost(m, from, to);
+    minutes = routeMatrixMinutes(m, from, to);
+    legs = routeMatrixLegs(m, from, to);
+    return cost != ROUTE_MATRIX_UNREACHABLE;
+}
+
+bool saveRouteMatrix(const RouteMatrix& m, const string& path) {
+    if (!m.cost) return false;
+    size_t cells = (size_t)m.portCount * m.portCount;
+
+    MatrixHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MATRIX_MAGIC, sizeof(MATRIX_MAGIC));
+    header.version = ROUTE_MATRIX_FORMAT_VERSION;
+    header.headerSize = sizeof(MatrixHeader);
+    header.portCount = m.portCount;
+    header.networkChecksum = m.networkChecksum;
+    header.payloadBytes = payloadSizeFor(m.portCount);
+
+    // Write next to the target and swap it in, so a crash never leaves a half-written matrix
+    string tempPath = path + ".tmp";
+    bool ok = false;
+    FILE* f = fopen(tempPath.c_str(), "wb");
+    if (f) {
+        ok = fwrite(&header, sizeof(header), 1, f) == 1;
+        if (ok) ok = fwrite(m.cost, sizeof(int32_t), cells, f) == cells;
+        if (ok) ok = fwrite(m.minutes, sizeof(int32_t), cells, f) == cells;
+        if (ok) ok = fwrite(m.legs, sizeof(uint8_t), cells, f) == cells;
+        if (fclose(f) != 0) ok = false;
+        if (ok) {
+            remove(path.c_str());
+            ok = rename(tempPath.c_str(), path.c_str()) == 0;
+        }
+        if (!ok) remove(tempPath.c_str());
+    }
+    return ok;
+}
+
+bool loadRouteMatrix(Graph& g, RouteMatrix& m, const string& path, const RoutePreferences* prefs) {
+    freeRouteMatrix(m);
+
+    MappedFile file;
+    if (!mapFileReadOnly(path, file)) return false;
+    if (file.size < sizeof(MatrixHeader)) {
+        unmapFile(file);
+        return false;
+    }
+
+    MatrixHeader header;
+    memcpy(&header, file.data, sizeof(header));
+    if (memcmp(header.magic, MATRIX_MAGIC, sizeof(MATRIX_MAGIC)) != 0
+        || header.version != ROUTE_MATRIX_FORMAT_VERSION || header.headerSize != sizeof(MatrixHeader)) {
+        cout << "Route matrix ignored: format version " << header.version << ", expected " << ROUTE_MATRIX_FORMAT_VERSION << "." << endl;
+        unmapFile(file);
+        return false;
+    }
+    if (header.portCount <= 0 || header.payloadBytes != file.size - sizeof(MatrixHeader)
+        || header.payloadBytes != payloadSizeFor(header.portCount)) {
+        cout << "Route matrix ignored: size does not match its header." << endl;
+        unmapFile(file);
+        return false;
+    }
+
+    PortArcs arcs;
+    {
+        FrozenGraphPin pin(g);
+        buildPortArcs(g, *pin.fg, arcs, prefs);
+    }
+    bool current = arcs.portCount == header.portCount && checksumPortArcs(arcs) == header.networkChecksum;
+    freePortArcs(arcs);
+    if (!current) {
+        cout << "Route matrix ignored: built from a different timetable." << endl;
+        unmapFile(file);
+        return false;
+    }
+
+    size_t cells = (size_t)header.portCount * header.portCount;
+    const char* payload = file.data + sizeof(MatrixHeader);
+    adviseRandomAccess(file);
+    m.file = file;
+    m.portCount = header.portCount;
+    m.networkChecksum = header.networkChecksum;
+    m.cost = (int32_t*)payload;
+    m.minutes = (int32_t*)(payload + sizeof(int32_t) * cells);
+    m.legs = (uint8_t*)(payload + sizeof(int32_t) * cells * 2);
+    return true;
+}
+
+void printRouteMatrixStats(const RouteMatrixStats& stats) {
+    cout << "Route matrix: " << stats.portCount << " x " << stats.portCount << " ports over " << stats.arcCount
+         << " arcs, " << stats.reachablePairs << " reachable pair(s) in " << stats.seconds * 1000.0 << " ms ("
+         << (long long)stats.originsPerSecond << " origins/s, " << stats.threadCount << " thread(s))." << endl;
+}
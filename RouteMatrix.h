@@ -0,0 +1,155 @@
+#ifndef ROUTE_MATRIX_H
+#define ROUTE_MATRIX_H
+
+#include <string>
+#include <cstdint>
+#include "Graph.h"
+#include "MappedFile.h"
+#include "RoutePreferences.h"
+#include "SearchKernel.h"
+
+using namespace std;
+
+// Bump whenever the on-disk layout changes; older matrix files are then rebuilt
+const unsigned int ROUTE_MATRIX_FORMAT_VERSION = 1;
+
+// Cost and minutes of a pair with no route between them
+const int ROUTE_MATRIX_UNREACHABLE = -1;
+
+// Which sailing stands for a port pair once the timetable is collapsed:
+// the cheapest (fewest minutes on a tie) or the fastest (cheapest on a tie)
+enum PortArcChoice {
+    PORT_ARCS_CHEAPEST,
+    PORT_ARCS_FASTEST
+};
+
+// Port-to-port view of one timetable version: every sailing between two
+// ports collapses into a single arc carrying the fare and duration of the
+// chosen sailing, ignoring dates; arcEdge is that sailing's edge in the
+// version. Arcs leaving port u are [firstArc[u], firstArc[u + 1]).
+struct PortArcs {
+    int portCount;
+    int arcCount;
+    int* firstArc;
+    int* arcTarget;
+    int* arcCost;
+    int* arcMinutes;
+    int* arcEdge;
+
+    PortArcs() : portCount(0), arcCount(0), firstArc(nullptr), arcTarget(nullptr), arcCost(nullptr), arcMinutes(nullptr), arcEdge(nullptr) {}
+};
+
+// Collapses version fg. Sailings run by companies prefs does not allow, and
+// those touching a forbidden port, are left out.
+void buildPortArcs(const Graph& g, const FrozenGraph& fg, PortArcs& arcs, const RoutePreferences* prefs = nullptr, PortArcChoice choice = PORT_ARCS_CHEAPEST);
+
+void freePortArcs(PortArcs& arcs);
+
+// Fingerprint of the arcs, stored with a saved matrix to spot stale files
+unsigned long long checksumPortArcs(const PortArcs& arcs);
+
+struct OneToAllEntry {
+    int cost;
+    int legs;
+    int minutes;
+    int port;
+};
+
+// Cheaper first, then fewer legs, then fewer minutes
+struct OneToAllEntryOrder {
+    static bool before(const OneToAllEntry& a, const OneToAllEntry& b) {
+        if (a.cost != b.cost) return a.cost < b.cost;
+        if (a.legs != b.legs) return a.legs < b.legs;
+        return a.minutes < b.minutes;
+    }
+    static int id(const OneToAllEntry& e) { return e.port; }
+};
+
+// Arrays one search needs, sized once per thread and reused for every origin
+struct OneToAllWorkspace {
+    int portCount;
+    int* cost;
+    int* legs;
+    int* minutes;
+    IndexedHeap<OneToAllEntry, OneToAllEntryOrder> heap;
+
+    OneToAllWorkspace() : portCount(0), cost(nullptr), legs(nullptr), minutes(nullptr) {}
+};
+
+void initOneToAllWorkspace(OneToAllWorkspace& ws, int portCount);
+
+void freeOneToAllWorkspace(OneToAllWorkspace& ws);
+
+// Dijkstra from origin over every port. Afterwards ws.cost[p] is the
+// cheapest total fare to p (INT_MAX if p cannot be reached), and ws.legs[p]
+// and ws.minutes[p] are the leg count and sailing minutes of that route;
+// among equally cheap routes the one with fewest legs, then fewest minutes,
+// wins. Returns the number of ports settled.
+int searchOneToAll(const PortArcs& arcs, int origin, OneToAllWorkspace& ws);
+
+// Dense origin x destination tables, row-major. Either owned (built in
+// memory) or pointing straight into a mapped matrix file. Entries come
+// from the collapsed port arcs, so like those they ignore dates and
+// layovers, and no leg limit applies: a pair's cheapest entry may take
+// more legs than findCheapestRouteIgnoringDates allows (15 by default),
+// which then returns a dearer route or none. Compare routeMatrixLegs with
+// the limit before treating an entry as that search's answer.
+struct RouteMatrix {
+    int portCount;
+    unsigned long long networkChecksum;
+    int32_t* cost;
+    int32_t* minutes;
+    uint8_t* legs;
+    MappedFile file;
+
+    RouteMatrix() : portCount(0), networkChecksum(0), cost(nullptr), minutes(nullptr), legs(nullptr) {}
+};
+
+struct RouteMatrixStats {
+    int portCount;
+    int arcCount;
+    int threadCount;
+    long long portsSettled;
+    long long reachablePairs;
+    double seconds;
+    double originsPerSecond;
+
+    RouteMatrixStats() : portCount(0), arcCount(0), threadCount(0), portsSettled(0), reachablePairs(0), seconds(0.0), originsPerSecond(0.0) {}
+};
+
+// Runs searchOneToAll from every port. Origins are handed out one at a time
+// to threadCount workers (one per hardware thread if <= 0), each with its
+// own workspace writing straight into its rows of the matrix.
+bool buildRouteMatrix(Graph& g, RouteMatrix& m, RouteMatrixStats& stats, int threadCount = 0, const RoutePreferences* prefs = nullptr);
+
+void freeRouteMatrix(RouteMatrix& m);
+
+inline int routeMatrixCost(const RouteMatrix& m, int from, int to) {
+    return m.cost[(size_t)from * m.portCount + to];
+}
+
+inline int routeMatrixMinutes(const RouteMatrix& m, int from, int to) {
+    return m.minutes[(size_t)from * m.portCount + to];
+}
+
+// Saturates at 255
+inline int routeMatrixLegs(const RouteMatrix& m, int from, int to) {
+    return m.legs[(size_t)from * m.portCount + to];
+}
+
+// Looks the pair up by name; false if either port is unknown, outside the
+// matrix or the pair is unreachable
+bool lookupRouteMatrix(const Graph& g, const RouteMatrix& m, const string& originPort, const string& destPort, int& cost, int& minutes, int& legs);
+
+// Writes the tables behind a small header, replacing the file atomically
+bool saveRouteMatrix(const RouteMatrix& m, const string& path);
+
+// Maps a saved matrix read-only so lookups read straight from the file.
+// Returns false if it is missing or has another format version, or if the
+// port arcs it was built from (timetable and prefs together) differ from
+// the ones g and prefs give now.
+bool loadRouteMatrix(Graph& g, RouteMatrix& m, const string& path, const RoutePreferences* prefs = nullptr);
+
+void printRouteMatrixStats(const RouteMatrixStats& stats);
+
+#endif
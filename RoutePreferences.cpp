@@ -114,11 +114,15 @@ Route* filterDirectRoutesByPreferences(const RoutePreferences& prefs, Route* inp
 
             Route* copy = new Route();
             copy->destinationPort = cur->destinationPort;
+            copy->destinationId = cur->destinationId;
             copy->voyageDate = cur->voyageDate;
             copy->departureTime = cur->departureTime;
             copy->arrivalTime = cur->arrivalTime;
             copy->voyageCost = cur->voyageCost;
             copy->shippingCompany = cur->shippingCompany;
+            copy->companyId = cur->companyId;
+            copy->departureMinutes = cur->departureMinutes;
+            copy->arrivalMinutes = cur->arrivalMinutes;
             copy->next = nullptr;
 
             if (!filteredHead) {
@@ -147,20 +151,28 @@ TwoLegRoute* filterOneStopRoutesByPreferences(const RoutePreferences& prefs, Two
 
             copy->leg1 = new Route();
             copy->leg1->destinationPort = cur->leg1->destinationPort;
+            copy->leg1->destinationId = cur->leg1->destinationId;
             copy->leg1->voyageDate = cur->leg1->voyageDate;
             copy->leg1->departureTime = cur->leg1->departureTime;
             copy->leg1->arrivalTime = cur->leg1->arrivalTime;
             copy->leg1->voyageCost = cur->leg1->voyageCost;
             copy->leg1->shippingCompany = cur->leg1->shippingCompany;
+            copy->leg1->companyId = cur->leg1->companyId;
+            copy->leg1->departureMinutes = cur->leg1->departureMinutes;
+            copy->leg1->arrivalMinutes = cur->leg1->arrivalMinutes;
             copy->leg1->next = nullptr;
 
             copy->leg2 = new Route();
             copy->leg2->destinationPort = cur->leg2->destinationPort;
+            copy->leg2->destinationId = cur->leg2->destinationId;
             copy->leg2->voyageDate = cur->leg2->voyageDate;
             copy->leg2->departureTime = cur->leg2->departureTime;
             copy->leg2->arrivalTime = cur->leg2->arrivalTime;
             copy->leg2->voyageCost = cur->leg2->voyageCost;
             copy->leg2->shippingCompany = cur->leg2->shippingCompany;
+            copy->leg2->companyId = cur->leg2->companyId;
+            copy->leg2->departureMinutes = cur->leg2->departureMinutes;
+            copy->leg2->arrivalMinutes = cur->leg2->arrivalMinutes;
             copy->leg2->next = nullptr;
 
             copy->next = nullptr;
@@ -191,29 +203,41 @@ ThreeLegRoute* filterTwoStopRoutesByPreferences(const RoutePreferences& prefs, T
 
             copy->leg1 = new Route();
             copy->leg1->destinationPort = cur->leg1->destinationPort;
+            copy->leg1->destinationId = cur->leg1->destinationId;
             copy->leg1->voyageDate = cur->leg1->voyageDate;
             copy->leg1->departureTime = cur->leg1->departureTime;
             copy->leg1->arrivalTime = cur->leg1->arrivalTime;
             copy->leg1->voyageCost = cur->leg1->voyageCost;
             copy->leg1->shippingCompany = cur->leg1->shippingCompany;
+            copy->leg1->companyId = cur->leg1->companyId;
+            copy->leg1->departureMinutes = cur->leg1->departureMinutes;
+            copy->leg1->arrivalMinutes = cur->leg1->arrivalMinutes;
             copy->leg1->next = nullptr;
 
             copy->leg2 = new Route();
             copy->leg2->destinationPort = cur->leg2->destinationPort;
+            copy->leg2->destinationId = cur->leg2->destinationId;
             copy->leg2->voyageDate = cur->leg2->voyageDate;
             copy->leg2->departureTime = cur->leg2->departureTime;
             copy->leg2->arrivalTime = cur->leg2->arrivalTime;
             copy->leg2->voyageCost = cur->leg2->voyageCost;
             copy->leg2->shippingCompany = cur->leg2->shippingCompany;
+            copy->leg2->companyId = cur->leg2->companyId;
+            copy->leg2->departureMinutes = cur->leg2->departureMinutes;
+            copy->leg2->arrivalMinutes = cur->leg2->arrivalMinutes;
             copy->leg2->next = nullptr;
 
             copy->leg3 = new Route();
             copy->leg3->destinationPort = cur->leg3->destinationPort;
+            copy->leg3->destinationId = cur->leg3->destinationId;
             copy->leg3->voyageDate = cur->leg3->voyageDate;
             copy->leg3->departureTime = cur->leg3->departureTime;
             copy->leg3->arrivalTime = cur->leg3->arrivalTime;
             copy->leg3->voyageCost = cur->leg3->voyageCost;
             copy->leg3->shippingCompany = cur->leg3->shippingCompany;
+            copy->leg3->companyId = cur->leg3->companyId;
+            copy->leg3->departureMinutes = cur->leg3->departureMinutes;
+            copy->leg3->arrivalMinutes = cur->leg3->arrivalMinutes;
             copy->leg3->next = nullptr;
 
             copy->next = nullptr;
@@ -297,38 +321,54 @@ FourLegRoute* filterThreeStopRoutesByPreferences(const RoutePreferences& prefs,
 
             copy->leg1 = new Route();
             copy->leg1->destinationPort = cur->leg1->destinationPort;
+            copy->leg1->destinationId = cur->leg1->destinationId;
             copy->leg1->voyageDate = cur->leg1->voyageDate;
             copy->leg1->departureTime = cur->leg1->departureTime;
             copy->leg1->arrivalTime = cur->leg1->arrivalTime;
             copy->leg1->voyageCost = cur->leg1->voyageCost;
             copy->leg1->shippingCompany = cur->leg1->shippingCompany;
+            copy->leg1->companyId = cur->leg1->companyId;
+            copy->leg1->departureMinutes = cur->leg1->departureMinutes;
+            copy->leg1->arrivalMinutes = cur->leg1->arrivalMinutes;
             copy->leg1->next = nullptr;
 
             copy->leg2 = new Route();
             copy->leg2->destinationPort = cur->leg2->destinationPort;
+            copy->leg2->destinationId = cur->leg2->destinationId;
             copy->leg2->voyageDate = cur->leg2->voyageDate;
             copy->leg2->departureTime = cur->leg2->departureTime;
             copy->leg2->arrivalTime = cur->leg2->arrivalTime;
             copy->leg2->voyageCost = cur->leg2->voyageCost;
             copy->leg2->shippingCompany = cur->leg2->shippingCompany;
+            copy->leg2->companyId = cur->leg2->companyId;
+            copy->leg2->departureMinutes = cur->leg2->departureMinutes;
+            copy->leg2->arrivalMinutes = cur->leg2->arrivalMinutes;
             copy->leg2->next = nullptr;
 
             copy->leg3 = new Route();
             copy->leg3->destinationPort = cur->leg3->destinationPort;
+            copy->leg3->destinationId = cur->leg3->destinationId;
             copy->leg3->voyageDate = cur->leg3->voyageDate;
             copy->leg3->departureTime = cur->leg3->departureTime;
             copy->leg3->arrivalTime = cur->leg3->arrivalTime;
             copy->leg3->voyageCost = cur->leg3->voyageCost;
             copy->leg3->shippingCompany = cur->leg3->shippingCompany;
+            copy->leg3->companyId = cur->leg3->companyId;
+            copy->leg3->departureMinutes = cur->leg3->departureMinutes;
+            copy->leg3->arrivalMinutes = cur->leg3->arrivalMinutes;
             copy->leg3->next = nullptr;
 
             copy->leg4 = new Route();
             copy->leg4->destinationPort = cur->leg4->destinationPort;
+            copy->leg4->destinationId = cur->leg4->destinationId;
             copy->leg4->voyageDate = cur->leg4->voyageDate;
             copy->leg4->departureTime = cur->leg4->departureTime;
             copy->leg4->arrivalTime = cur->leg4->arrivalTime;
             copy->leg4->voyageCost = cur->leg4->voyageCost;
             copy->leg4->shippingCompany = cur->leg4->shippingCompany;
+            copy->leg4->companyId = cur->leg4->companyId;
+            copy->leg4->departureMinutes = cur->leg4->departureMinutes;
+            copy->leg4->arrivalMinutes = cur->leg4->arrivalMinutes;
             copy->leg4->next = nullptr;
 
             copy->next = nullptr;
@@ -359,47 +399,67 @@ FiveLegRoute* filterFourStopRoutesByPreferences(const RoutePreferences& prefs, F
 
             copy->leg1 = new Route();
             copy->leg1->destinationPort = cur->leg1->destinationPort;
+            copy->leg1->destinationId = cur->leg1->destinationId;
             copy->leg1->voyageDate = cur->leg1->voyageDate;
             copy->leg1->departureTime = cur->leg1->departureTime;
             copy->leg1->arrivalTime = cur->leg1->arrivalTime;
             copy->leg1->voyageCost = cur->leg1->voyageCost;
             copy->leg1->shippingCompany = cur->leg1->shippingCompany;
+            copy->leg1->companyId = cur->leg1->companyId;
+            copy->leg1->departureMinutes = cur->leg1->departureMinutes;
+            copy->leg1->arrivalMinutes = cur->leg1->arrivalMinutes;
             copy->leg1->next = nullptr;
 
             copy->leg2 = new Route();
             copy->leg2->destinationPort = cur->leg2->destinationPort;
+            copy->leg2->destinationId = cur->leg2->destinationId;
             copy->leg2->voyageDate = cur->leg2->voyageDate;
             copy->leg2->departureTime = cur->leg2->departureTime;
             copy->leg2->arrivalTime = cur->leg2->arrivalTime;
             copy->leg2->voyageCost = cur->leg2->voyageCost;
             copy->leg2->shippingCompany = cur->leg2->shippingCompany;
+            copy->leg2->companyId = cur->leg2->companyId;
+            copy->leg2->departureMinutes = cur->leg2->departureMinutes;
+            copy->leg2->arrivalMinutes = cur->leg2->arrivalMinutes;
             copy->leg2->next = nullptr;
 
             copy->leg3 = new Route();
             copy->leg3->destinationPort = cur->leg3->destinationPort;
+            copy->leg3->destinationId = cur->leg3->destinationId;
             copy->leg3->voyageDate = cur->leg3->voyageDate;
             copy->leg3->departureTime = cur->leg3->departureTime;
             copy->leg3->arrivalTime = cur->leg3->arrivalTime;
             copy->leg3->voyageCost = cur->leg3->voyageCost;
             copy->leg3->shippingCompany = cur->leg3->shippingCompany;
+            copy->leg3->companyId = cur->leg3->companyId;
+            copy->leg3->departureMinutes = cur->leg3->departureMinutes;
+            copy->leg3->arrivalMinutes = cur->leg3->arrivalMinutes;
             copy->leg3->next = nullptr;
 
             copy->leg4 = new Route();
             copy->leg4->destinationPort = cur->leg4->destinationPort;
+            copy->leg4->destinationId = cur->leg4->destinationId;
             copy->leg4->voyageDate = cur->leg4->voyageDate;
             copy->leg4->departureTime = cur->leg4->departureTime;
             copy->leg4->arrivalTime = cur->leg4->arrivalTime;
             copy->leg4->voyageCost = cur->leg4->voyageCost;
             copy->leg4->shippingCompany = cur->leg4->shippingCompany;
+            copy->leg4->companyId = cur->leg4->companyId;
+            copy->leg4->departureMinutes = cur->leg4->departureMinutes;
+            copy->leg4->arrivalMinutes = cur->leg4->arrivalMinutes;
             copy->leg4->next = nullptr;
 
             copy->leg5 = new Route();
             copy->leg5->destinationPort = cur->leg5->destinationPort;
+            copy->leg5->destinationId = cur->leg5->destinationId;
             copy->leg5->voyageDate = cur->leg5->voyageDate;
             copy->leg5->departureTime = cur->leg5->departureTime;
             copy->leg5->arrivalTime = cur->leg5->arrivalTime;
             copy->leg5->voyageCost = cur->leg5->voyageCost;
             copy->leg5->shippingCompany = cur->leg5->shippingCompany;
+            copy->leg5->companyId = cur->leg5->companyId;
+            copy->leg5->departureMinutes = cur->leg5->departureMinutes;
+            copy->leg5->arrivalMinutes = cur->leg5->arrivalMinutes;
             copy->leg5->next = nullptr;
 
             copy->next = nullptr;
@@ -16,11 +16,15 @@ Route* copyRoute(Route* original) {
 
     Route* copy = new Route;
     copy->destinationPort = original->destinationPort;
+    copy->destinationId = original->destinationId;
     copy->voyageDate = original->voyageDate;
     copy->departureTime = original->departureTime;
     copy->arrivalTime = original->arrivalTime;
     copy->voyageCost = original->voyageCost;
     copy->shippingCompany = original->shippingCompany;
+    copy->companyId = original->companyId;
+    copy->departureMinutes = original->departureMinutes;
+    copy->arrivalMinutes = original->arrivalMinutes;
     copy->next = nullptr;
 
     return copy;
@@ -33,119 +37,22 @@ int compareDates(const Date& a, const Date& b) {
     return 0;
 }
 
-int getDayOfYear(const Date& d) {
-    int daysInMonth[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    int dayOfYear = d.day;
-    for (int m = 1; m < d.month; m++) {
-        dayOfYear += daysInMonth[m];
-    }
-    return dayOfYear + d.year * 365;
-}
-
-bool isDateInRange(const Date& date, const Date& startDate, int maxDays) {
-
-    int dateDay = getDayOfYear(date);
-    int startDay = getDayOfYear(startDate);
-
-    int yearDiff = date.year - startDate.year;
-    if (yearDiff > 0) {
-        dateDay += yearDiff * 365;
-    } else if (yearDiff < 0) {
-
-        return false;
-    }
-
-    int diff = dateDay - startDay;
-
-    return diff >= 0 && diff <= maxDays;
-}
-
 bool isDateOnOrAfter(const Date& dateA, const Date& dateB) {
     if (dateA.year != dateB.year) return dateA.year > dateB.year;
     if (dateA.month != dateB.month) return dateA.month > dateB.month;
     return dateA.day >= dateB.day;
 }
 
-bool voyageCrossesMidnight(const Time& departure, const Time& arrival) {
-    int depMin = departure.hour * 60 + departure.minute;
-    int arrMin = arrival.hour * 60 + arrival.minute;
-    return arrMin < depMin;
-}
-
-Date getActualArrivalDate(const Date& departureDate, const Time& departure, const Time& arrival) {
-    Date arrivalDate = departureDate;
-    if (voyageCrossesMidnight(departure, arrival)) {
+// Arrival and departure are epoch minutes with the midnight rollover already
+// applied, so the layover and the calendar-day gap are plain subtractions
+bool isValidConnectionMultiDay(int leg1ArrivalMinutes, int leg2DepartureMinutes, int minLayoverMinutes, int maxDaysGap) {
 
-        arrivalDate.day++;
-
-        int daysInMonth[] = {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-        if (arrivalDate.day > daysInMonth[arrivalDate.month]) {
-            arrivalDate.day = 1;
-            arrivalDate.month++;
-            if (arrivalDate.month > 12) {
-                arrivalDate.month = 1;
-                arrivalDate.year++;
-            }
-        }
-    }
-    return arrivalDate;
-}
-
-bool isValidConnectionSameDay(const Date& leg1Date, const Time& leg1ArrivalTime, const Date& leg2Date, const Time& leg2DepartureTime, int minLayoverMinutes) {
-
-    if (compareDates(leg1Date, leg2Date) != 0) {
+    if (!canConnect(leg1ArrivalMinutes, leg2DepartureMinutes, minLayoverMinutes)) {
         return false;
     }
 
-    int arrMin = leg1ArrivalTime.hour * 60 + leg1ArrivalTime.minute;
-    int depMin = leg2DepartureTime.hour * 60 + leg2DepartureTime.minute;
-    int layover = depMin - arrMin;
-
-    if (layover < minLayoverMinutes) {
-        return false;
-    }
-
-    return true;
-}
-
-bool isValidConnectionMultiDay(const Date& leg1DepartureDate, const Time& leg1DepartureTime, const Time& leg1ArrivalTime, const Date& leg2DepartureDate, const Time& leg2DepartureTime, int minLayoverMinutes, int maxDaysGap) {
-
-    Date actualArrivalDate = getActualArrivalDate(leg1DepartureDate, leg1DepartureTime, leg1ArrivalTime);
-
-    int cmp = compareDates(actualArrivalDate, leg2DepartureDate);
-
-    if (cmp > 0) {
-        return false;
-    }
-
-    int arrivalDayNum = getDayOfYear(actualArrivalDate) + actualArrivalDate.year * 365;
-    int departureDayNum = getDayOfYear(leg2DepartureDate) + leg2DepartureDate.year * 365;
-    int daysDiff = departureDayNum - arrivalDayNum;
-
-    if (daysDiff > maxDaysGap) {
-        return false;
-    }
-
-    if (cmp == 0) {
-
-        int arrivalMinutes = leg1ArrivalTime.hour * 60 + leg1ArrivalTime.minute;
-        int departureMinutes = leg2DepartureTime.hour * 60 + leg2DepartureTime.minute;
-        int layoverMinutes = departureMinutes - arrivalMinutes;
-
-        if (layoverMinutes < 0) {
-            return false;
-        }
-
-        if (layoverMinutes < minLayoverMinutes) {
-            return false;
-        }
-    }
-
-    return true;
-}
-
-bool isValidConnection(const Date& arrivalDate, const Time& arrivalTime, const Date& nextDepDate, const Time& nextDepTime) {
-    return isValidConnectionSameDay(arrivalDate, arrivalTime, nextDepDate, nextDepTime, MIN_LAYOVER_MINUTES);
+    int daysDiff = leg2DepartureMinutes / MINUTES_PER_DAY - leg1ArrivalMinutes / MINUTES_PER_DAY;
+    return daysDiff <= maxDaysGap;
 }
 
 bool isTimeBefore(const Time& a, const Time& b) {
@@ -162,16 +69,38 @@ bool isLayoverFeasible(const Time& arrival, const Time& nextDeparture) {
     return (departureMinutes - arrivalMinutes) >= 60;
 }
 
+// Edges of portId leaving on calendar day d
+static void departuresOnDate(const FrozenGraph& fg, int portId, const Date& d, int& begin, int& end) {
+    Time midnight = {0, 0};
+    int dayStart = toEpochMinutes(d, midnight);
+    begin = firstDepartureFrom(fg, portId, dayStart);
+    end = firstDepartureFrom(fg, portId, dayStart + MINUTES_PER_DAY);
+}
+
+// Edges of portId that a ship arriving at arrivalMinutes can connect to:
+// the same window isValidConnectionMultiDay accepts, found by binary search
+static void connectingDepartures(const FrozenGraph& fg, int portId, int arrivalMinutes, int& begin, int& end) {
+    int horizon = (arrivalMinutes / MINUTES_PER_DAY + MAX_CONNECTION_DAYS + 1) * MINUTES_PER_DAY;
+    begin = firstDepartureFrom(fg, portId, arrivalMinutes + MIN_LAYOVER_MINUTES);
+    end = firstDepartureFrom(fg, portId, horizon);
+}
+
 Route* getDirectRoutes(Graph& g, const string& origin, const Date& d) {
 
     Port* originPort = findPort(g, origin);
     if (!originPort) return nullptr;
+    FrozenGraphPin pin(g);
+    const FrozenGraph& fg = *pin.fg;
 
     Route* resultHead = nullptr;
     Route* resultTail = nullptr;
 
-    Route* current = originPort->routeHead;
-    while (current) {
+    int currentBegin, currentEnd;
+    departuresOnDate(fg, originPort->id, d, currentBegin, currentEnd);
+    for (int currentEdge = currentBegin; currentEdge < currentEnd; currentEdge++) {
+        Route currentValue;
+        expandSailing(g, fg, currentEdge, currentValue);
+        Route* current = &currentValue;
 
         if (compareDates(current->voyageDate, d) == 0) {
 
@@ -185,7 +114,6 @@ Route* getDirectRoutes(Graph& g, const string& origin, const Date& d) {
                 resultTail = copy;
             }
         }
-        current = current->next;
     }
 
     return resultHead;
@@ -195,6 +123,9 @@ TwoLegRoute* getOneStopConnections(Graph& g, const string& origin, const string&
 
     Port* originPort = findPort(g, origin);
     if (!originPort) return nullptr;
+    FrozenGraphPin pin(g);
+    const FrozenGraph& fg = *pin.fg;
+    int destId = findPortId(g, destination);
 
     TwoLegRoute* resultHead = nullptr;
     TwoLegRoute* resultTail = nullptr;
@@ -204,51 +135,54 @@ TwoLegRoute* getOneStopConnections(Graph& g, const string& origin, const string&
     int validConnections = 0;
     int rejectedEarlyDeparture = 0;
 
-    Route* leg1 = originPort->routeHead;
-    while (leg1) {
+    int leg1Begin, leg1End;
+    departuresOnDate(fg, originPort->id, d, leg1Begin, leg1End);
+    for (int leg1Edge = leg1Begin; leg1Edge < leg1End; leg1Edge++) {
+        Route leg1Value;
+        expandSailing(g, fg, leg1Edge, leg1Value);
+        Route* leg1 = &leg1Value;
 
         if (compareDates(leg1->voyageDate, d) == 0) {
             leg1Count++;
-            string intermediatePort = leg1->destinationPort;
+            int intermediateId = leg1->destinationId;
 
-            if (intermediatePort == destination) {
-                leg1 = leg1->next;
+            if (intermediateId == destId) {
                 continue;
             }
 
-            Port* interPort = findPort(g, intermediatePort);
+            Port* interPort = g.portById[intermediateId];
             if (interPort) {
 
-                Route* leg2 = interPort->routeHead;
-                while (leg2) {
-
-                    if (leg2->destinationPort.compare(destination) == 0) {
-                        leg2Candidates++;
-
-                        if (isValidConnectionMultiDay(leg1->voyageDate, leg1->departureTime, leg1->arrivalTime, leg2->voyageDate, leg2->departureTime, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
-                            validConnections++;
-
-                            TwoLegRoute* twoLeg = new TwoLegRoute;
-                            twoLeg->leg1 = copyRoute(leg1);
-                            twoLeg->leg2 = copyRoute(leg2);
-                            twoLeg->next = nullptr;
-
-                            if (!resultHead) {
-                                resultHead = twoLeg;
-                                resultTail = twoLeg;
-                            } else {
-                                resultTail->next = twoLeg;
-                                resultTail = twoLeg;
-                            }
+                int leg2Begin, leg2End;
+                connectingDepartures(fg, interPort->id, leg1->arrivalMinutes, leg2Begin, leg2End);
+                for (int leg2Edge = leg2Begin; leg2Edge < leg2End; leg2Edge++) {
+                    if (fg.edges[leg2Edge].destinationId != destId) continue;
+                    Route leg2Value;
+                    expandSailing(g, fg, leg2Edge, leg2Value);
+                    Route* leg2 = &leg2Value;
+                    leg2Candidates++;
+
+                    if (isValidConnectionMultiDay(leg1->arrivalMinutes, leg2->departureMinutes, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
+                        validConnections++;
+
+                        TwoLegRoute* twoLeg = new TwoLegRoute;
+                        twoLeg->leg1 = copyRoute(leg1);
+                        twoLeg->leg2 = copyRoute(leg2);
+                        twoLeg->next = nullptr;
+
+                        if (!resultHead) {
+                            resultHead = twoLeg;
+                            resultTail = twoLeg;
                         } else {
-                            rejectedEarlyDeparture++;
+                            resultTail->next = twoLeg;
+                            resultTail = twoLeg;
                         }
+                    } else {
+                        rejectedEarlyDeparture++;
                     }
-                    leg2 = leg2->next;
                 }
             }
         }
-        leg1 = leg1->next;
     }
 
     cout << "[DEBUG OneStop] Leg1 routes: " << leg1Count
@@ -263,6 +197,10 @@ ThreeLegRoute* getTwoStopConnections(Graph& g, const string& origin, const strin
 
     Port* originPort = findPort(g, origin);
     if (!originPort) return nullptr;
+    FrozenGraphPin pin(g);
+    const FrozenGraph& fg = *pin.fg;
+    int originId = originPort->id;
+    int destId = findPortId(g, destination);
 
     ThreeLegRoute* resultHead = nullptr;
     ThreeLegRoute* resultTail = nullptr;
@@ -270,68 +208,72 @@ ThreeLegRoute* getTwoStopConnections(Graph& g, const string& origin, const strin
     int validRoutes = 0;
     int rejectedConnections = 0;
 
-    Route* leg1 = originPort->routeHead;
-    while (leg1) {
+    int leg1Begin, leg1End;
+    departuresOnDate(fg, originPort->id, d, leg1Begin, leg1End);
+    for (int leg1Edge = leg1Begin; leg1Edge < leg1End; leg1Edge++) {
+        Route leg1Value;
+        expandSailing(g, fg, leg1Edge, leg1Value);
+        Route* leg1 = &leg1Value;
 
         if (compareDates(leg1->voyageDate, d) == 0) {
-            string stop1 = leg1->destinationPort;
+            int stop1Id = leg1->destinationId;
 
-            if (stop1 == destination) {
-                leg1 = leg1->next;
+            if (stop1Id == destId) {
                 continue;
             }
 
-            Port* stop1Port = findPort(g, stop1);
+            Port* stop1Port = g.portById[stop1Id];
             if (stop1Port) {
 
-                Route* leg2 = stop1Port->routeHead;
-                while (leg2) {
-
-                    if (leg2->destinationPort == origin) {
-                        leg2 = leg2->next;
+                int leg2Begin, leg2End;
+                connectingDepartures(fg, stop1Port->id, leg1->arrivalMinutes, leg2Begin, leg2End);
+                for (int leg2Edge = leg2Begin; leg2Edge < leg2End; leg2Edge++) {
+                    if (fg.edges[leg2Edge].destinationId == originId) {
                         continue;
                     }
 
-                    if (isValidConnectionMultiDay(leg1->voyageDate, leg1->departureTime, leg1->arrivalTime, leg2->voyageDate, leg2->departureTime, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
-                        string stop2 = leg2->destinationPort;
-
-                        Port* stop2Port = findPort(g, stop2);
-                        if (stop2Port) {
-
-                            Route* leg3 = stop2Port->routeHead;
-                            while (leg3) {
-
-                                if (leg3->destinationPort.compare(destination) == 0) {
+                    Route leg2Value;
+                    expandSailing(g, fg, leg2Edge, leg2Value);
+                    Route* leg2 = &leg2Value;
 
-                                    if (isValidConnectionMultiDay(leg2->voyageDate, leg2->departureTime, leg2->arrivalTime, leg3->voyageDate, leg3->departureTime, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
-                                        validRoutes++;
+                    if (isValidConnectionMultiDay(leg1->arrivalMinutes, leg2->departureMinutes, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
+                        int stop2Id = leg2->destinationId;
 
-                                        ThreeLegRoute* threeLeg = new ThreeLegRoute;
-                                        threeLeg->leg1 = copyRoute(leg1);
-                                        threeLeg->leg2 = copyRoute(leg2);
-                                        threeLeg->leg3 = copyRoute(leg3);
-                                        threeLeg->next = nullptr;
+                        Port* stop2Port = g.portById[stop2Id];
+                        if (stop2Port) {
 
-                                        if (!resultHead) {
-                                            resultHead = threeLeg;
-                                            resultTail = threeLeg;
-                                        } else {
-                                            resultTail->next = threeLeg;
-                                            resultTail = threeLeg;
-                                        }
+                            int leg3Begin, leg3End;
+                            connectingDepartures(fg, stop2Port->id, leg2->arrivalMinutes, leg3Begin, leg3End);
+                            for (int leg3Edge = leg3Begin; leg3Edge < leg3End; leg3Edge++) {
+                                if (fg.edges[leg3Edge].destinationId != destId) continue;
+                                Route leg3Value;
+                                expandSailing(g, fg, leg3Edge, leg3Value);
+                                Route* leg3 = &leg3Value;
+                                if (isValidConnectionMultiDay(leg2->arrivalMinutes, leg3->departureMinutes, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
+                                    validRoutes++;
+
+                                    ThreeLegRoute* threeLeg = new ThreeLegRoute;
+                                    threeLeg->leg1 = copyRoute(leg1);
+                                    threeLeg->leg2 = copyRoute(leg2);
+                                    threeLeg->leg3 = copyRoute(leg3);
+                                    threeLeg->next = nullptr;
+
+                                    if (!resultHead) {
+                                        resultHead = threeLeg;
+                                        resultTail = threeLeg;
                                     } else {
-                                        rejectedConnections++;
+                                        resultTail->next = threeLeg;
+                                        resultTail = threeLeg;
                                     }
+                                } else {
+                                    rejectedConnections++;
                                 }
-                                leg3 = leg3->next;
                             }
                         }
                     }
-                    leg2 = leg2->next;
                 }
             }
         }
-        leg1 = leg1->next;
     }
 
     cout << "[DEBUG TwoStop] Valid routes: " << validRoutes
@@ -343,6 +285,10 @@ ThreeLegRoute* getTwoStopConnections(Graph& g, const string& origin, const strin
 FourLegRoute* getThreeStopConnections(Graph& g, const string& origin, const string& destination, const Date& d) {
     Port* originPort = findPort(g, origin);
     if (!originPort) return nullptr;
+    FrozenGraphPin pin(g);
+    const FrozenGraph& fg = *pin.fg;
+    int originId = originPort->id;
+    int destId = findPortId(g, destination);
 
     FourLegRoute* resultHead = nullptr;
     FourLegRoute* resultTail = nullptr;
@@ -350,91 +296,95 @@ FourLegRoute* getThreeStopConnections(Graph& g, const string& origin, const stri
     int validRoutes = 0;
     int rejectedConnections = 0;
 
-    Route* leg1 = originPort->routeHead;
-    while (leg1) {
+    int leg1Begin, leg1End;
+    departuresOnDate(fg, originPort->id, d, leg1Begin, leg1End);
+    for (int leg1Edge = leg1Begin; leg1Edge < leg1End; leg1Edge++) {
+        Route leg1Value;
+        expandSailing(g, fg, leg1Edge, leg1Value);
+        Route* leg1 = &leg1Value;
         if (compareDates(leg1->voyageDate, d) == 0) {
-            string stop1 = leg1->destinationPort;
-            if (stop1 == destination) {
-                leg1 = leg1->next;
+            int stop1Id = leg1->destinationId;
+            if (stop1Id == destId) {
                 continue;
             }
 
-            Port* stop1Port = findPort(g, stop1);
+            Port* stop1Port = g.portById[stop1Id];
             if (stop1Port) {
-                Route* leg2 = stop1Port->routeHead;
-                while (leg2) {
-                    if (leg2->destinationPort == origin) {
-                        leg2 = leg2->next;
+                int leg2Begin, leg2End;
+                connectingDepartures(fg, stop1Port->id, leg1->arrivalMinutes, leg2Begin, leg2End);
+                for (int leg2Edge = leg2Begin; leg2Edge < leg2End; leg2Edge++) {
+                    if (fg.edges[leg2Edge].destinationId == originId) {
                         continue;
                     }
 
-                    if (isValidConnectionMultiDay(leg1->voyageDate, leg1->departureTime,
-                                                  leg1->arrivalTime,
-                                                  leg2->voyageDate, leg2->departureTime,
+                    Route leg2Value;
+                    expandSailing(g, fg, leg2Edge, leg2Value);
+                    Route* leg2 = &leg2Value;
+
+                    if (isValidConnectionMultiDay(leg1->arrivalMinutes, leg2->departureMinutes,
                                                   MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
-                        string stop2 = leg2->destinationPort;
-                        if (stop2 == destination) {
-                            leg2 = leg2->next;
+                        int stop2Id = leg2->destinationId;
+                        if (stop2Id == destId) {
                             continue;
                         }
 
-                        Port* stop2Port = findPort(g, stop2);
+                        Port* stop2Port = g.portById[stop2Id];
                         if (stop2Port) {
-                            Route* leg3 = stop2Port->routeHead;
-                            while (leg3) {
-                                if (leg3->destinationPort == origin || leg3->destinationPort == stop1) {
-                                    leg3 = leg3->next;
+                            int leg3Begin, leg3End;
+                            connectingDepartures(fg, stop2Port->id, leg2->arrivalMinutes, leg3Begin, leg3End);
+                            for (int leg3Edge = leg3Begin; leg3Edge < leg3End; leg3Edge++) {
+                                if (fg.edges[leg3Edge].destinationId == originId || fg.edges[leg3Edge].destinationId == stop1Id) {
                                     continue;
                                 }
 
-                                if (isValidConnectionMultiDay(leg2->voyageDate, leg2->departureTime,
-                                                              leg2->arrivalTime,
-                                                              leg3->voyageDate, leg3->departureTime,
+                                Route leg3Value;
+                                expandSailing(g, fg, leg3Edge, leg3Value);
+                                Route* leg3 = &leg3Value;
+
+                                if (isValidConnectionMultiDay(leg2->arrivalMinutes, leg3->departureMinutes,
                                                               MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
-                                    string stop3 = leg3->destinationPort;
-                                    if (stop3 == destination) {
-                                        leg3 = leg3->next;
+                                    int stop3Id = leg3->destinationId;
+                                    if (stop3Id == destId) {
                                         continue;
                                     }
 
-                                    Port* stop3Port = findPort(g, stop3);
+                                    Port* stop3Port = g.portById[stop3Id];
                                     if (stop3Port) {
-                                        Route* leg4 = stop3Port->routeHead;
-                                        while (leg4) {
-                                            if (leg4->destinationPort.compare(destination) == 0) {
-                                                if (isValidConnectionMultiDay(leg3->voyageDate, leg3->departureTime, leg3->arrivalTime, leg4->voyageDate, leg4->departureTime, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
-                                                    validRoutes++;
-                                                    FourLegRoute* fourLeg = new FourLegRoute;
-                                                    fourLeg->leg1 = copyRoute(leg1);
-                                                    fourLeg->leg2 = copyRoute(leg2);
-                                                    fourLeg->leg3 = copyRoute(leg3);
-                                                    fourLeg->leg4 = copyRoute(leg4);
-                                                    fourLeg->next = nullptr;
-
-                                                    if (!resultHead) {
-                                                        resultHead = fourLeg;
-                                                        resultTail = fourLeg;
-                                                    } else {
-                                                        resultTail->next = fourLeg;
-                                                        resultTail = fourLeg;
-                                                    }
+                                        int leg4Begin, leg4End;
+                                        connectingDepartures(fg, stop3Port->id, leg3->arrivalMinutes, leg4Begin, leg4End);
+                                        for (int leg4Edge = leg4Begin; leg4Edge < leg4End; leg4Edge++) {
+                                            if (fg.edges[leg4Edge].destinationId != destId) continue;
+                                            Route leg4Value;
+                                            expandSailing(g, fg, leg4Edge, leg4Value);
+                                            Route* leg4 = &leg4Value;
+                                            if (isValidConnectionMultiDay(leg3->arrivalMinutes, leg4->departureMinutes, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
+                                                validRoutes++;
+                                                FourLegRoute* fourLeg = new FourLegRoute;
+                                                fourLeg->leg1 = copyRoute(leg1);
+                                                fourLeg->leg2 = copyRoute(leg2);
+                                                fourLeg->leg3 = copyRoute(leg3);
+                                                fourLeg->leg4 = copyRoute(leg4);
+                                                fourLeg->next = nullptr;
+
+                                                if (!resultHead) {
+                                                    resultHead = fourLeg;
+                                                    resultTail = fourLeg;
                                                 } else {
-                                                    rejectedConnections++;
+                                                    resultTail->next = fourLeg;
+                                                    resultTail = fourLeg;
                                                 }
+                                            } else {
+                                                rejectedConnections++;
                                             }
-                                            leg4 = leg4->next;
                                         }
                                     }
                                 }
-                                leg3 = leg3->next;
                             }
                         }
                     }
-                    leg2 = leg2->next;
                 }
             }
         }
-        leg1 = leg1->next;
     }
 
     cout << "[DEBUG ThreeStop] Valid routes: " << validRoutes
@@ -446,6 +396,10 @@ FourLegRoute* getThreeStopConnections(Graph& g, const string& origin, const stri
 FiveLegRoute* getFourStopConnections(Graph& g, const string& origin, const string& destination, const Date& d) {
     Port* originPort = findPort(g, origin);
     if (!originPort) return nullptr;
+    FrozenGraphPin pin(g);
+    const FrozenGraph& fg = *pin.fg;
+    int originId = originPort->id;
+    int destId = findPortId(g, destination);
 
     FiveLegRoute* resultHead = nullptr;
     FiveLegRoute* resultTail = nullptr;
@@ -453,109 +407,117 @@ FiveLegRoute* getFourStopConnections(Graph& g, const string& origin, const strin
     int validRoutes = 0;
     int rejectedConnections = 0;
 
-    Route* leg1 = originPort->routeHead;
-    while (leg1) {
+    int leg1Begin, leg1End;
+    departuresOnDate(fg, originPort->id, d, leg1Begin, leg1End);
+    for (int leg1Edge = leg1Begin; leg1Edge < leg1End; leg1Edge++) {
+        Route leg1Value;
+        expandSailing(g, fg, leg1Edge, leg1Value);
+        Route* leg1 = &leg1Value;
         if (compareDates(leg1->voyageDate, d) == 0) {
-            string stop1 = leg1->destinationPort;
-            if (stop1 == destination) {
-                leg1 = leg1->next;
+            int stop1Id = leg1->destinationId;
+            if (stop1Id == destId) {
                 continue;
             }
 
-            Port* stop1Port = findPort(g, stop1);
+            Port* stop1Port = g.portById[stop1Id];
             if (stop1Port) {
-                Route* leg2 = stop1Port->routeHead;
-                while (leg2) {
-                    if (leg2->destinationPort == origin) {
-                        leg2 = leg2->next;
+                int leg2Begin, leg2End;
+                connectingDepartures(fg, stop1Port->id, leg1->arrivalMinutes, leg2Begin, leg2End);
+                for (int leg2Edge = leg2Begin; leg2Edge < leg2End; leg2Edge++) {
+                    if (fg.edges[leg2Edge].destinationId == originId) {
                         continue;
                     }
 
-                    if (isValidConnectionMultiDay(leg1->voyageDate, leg1->departureTime,
-                                                  leg1->arrivalTime,
-                                                  leg2->voyageDate, leg2->departureTime,
+                    Route leg2Value;
+                    expandSailing(g, fg, leg2Edge, leg2Value);
+                    Route* leg2 = &leg2Value;
+
+                    if (isValidConnectionMultiDay(leg1->arrivalMinutes, leg2->departureMinutes,
                                                   MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
-                        string stop2 = leg2->destinationPort;
-                        if (stop2 == destination) {
-                            leg2 = leg2->next;
+                        int stop2Id = leg2->destinationId;
+                        if (stop2Id == destId) {
                             continue;
                         }
 
-                        Port* stop2Port = findPort(g, stop2);
+                        Port* stop2Port = g.portById[stop2Id];
                         if (stop2Port) {
-                            Route* leg3 = stop2Port->routeHead;
-                            while (leg3) {
-                                if (leg3->destinationPort == origin || leg3->destinationPort == stop1) {
-                                    leg3 = leg3->next;
+                            int leg3Begin, leg3End;
+                            connectingDepartures(fg, stop2Port->id, leg2->arrivalMinutes, leg3Begin, leg3End);
+                            for (int leg3Edge = leg3Begin; leg3Edge < leg3End; leg3Edge++) {
+                                if (fg.edges[leg3Edge].destinationId == originId || fg.edges[leg3Edge].destinationId == stop1Id) {
                                     continue;
                                 }
 
-                                if (isValidConnectionMultiDay(leg2->voyageDate, leg2->departureTime, leg2->arrivalTime, leg3->voyageDate, leg3->departureTime, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
-                                    string stop3 = leg3->destinationPort;
-                                    if (stop3 == destination) {
-                                        leg3 = leg3->next;
+                                Route leg3Value;
+                                expandSailing(g, fg, leg3Edge, leg3Value);
+                                Route* leg3 = &leg3Value;
+
+                                if (isValidConnectionMultiDay(leg2->arrivalMinutes, leg3->departureMinutes, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
+                                    int stop3Id = leg3->destinationId;
+                                    if (stop3Id == destId) {
                                         continue;
                                     }
 
-                                    Port* stop3Port = findPort(g, stop3);
+                                    Port* stop3Port = g.portById[stop3Id];
                                     if (stop3Port) {
-                                        Route* leg4 = stop3Port->routeHead;
-                                        while (leg4) {
-                                            if (leg4->destinationPort == origin || leg4->destinationPort == stop1 || leg4->destinationPort == stop2) {
-                                                leg4 = leg4->next;
+                                        int leg4Begin, leg4End;
+                                        connectingDepartures(fg, stop3Port->id, leg3->arrivalMinutes, leg4Begin, leg4End);
+                                        for (int leg4Edge = leg4Begin; leg4Edge < leg4End; leg4Edge++) {
+                                            if (fg.edges[leg4Edge].destinationId == originId || fg.edges[leg4Edge].destinationId == stop1Id || fg.edges[leg4Edge].destinationId == stop2Id) {
                                                 continue;
                                             }
 
-                                            if (isValidConnectionMultiDay(leg3->voyageDate, leg3->departureTime, leg3->arrivalTime, leg4->voyageDate, leg4->departureTime, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
-                                                string stop4 = leg4->destinationPort;
-                                                if (stop4 == destination) {
-                                                    leg4 = leg4->next;
+                                            Route leg4Value;
+                                            expandSailing(g, fg, leg4Edge, leg4Value);
+                                            Route* leg4 = &leg4Value;
+
+                                            if (isValidConnectionMultiDay(leg3->arrivalMinutes, leg4->departureMinutes, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
+                                                int stop4Id = leg4->destinationId;
+                                                if (stop4Id == destId) {
                                                     continue;
                                                 }
 
-                                                Port* stop4Port = findPort(g, stop4);
+                                                Port* stop4Port = g.portById[stop4Id];
                                                 if (stop4Port) {
-                                                    Route* leg5 = stop4Port->routeHead;
-                                                    while (leg5) {
-                                                        if (leg5->destinationPort.compare(destination) == 0) {
-                                                            if (isValidConnectionMultiDay(leg4->voyageDate, leg4->departureTime, leg4->arrivalTime, leg5->voyageDate, leg5->departureTime, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
-                                                                validRoutes++;
-                                                                FiveLegRoute* fiveLeg = new FiveLegRoute;
-                                                                fiveLeg->leg1 = copyRoute(leg1);
-                                                                fiveLeg->leg2 = copyRoute(leg2);
-                                                                fiveLeg->leg3 = copyRoute(leg3);
-                                                                fiveLeg->leg4 = copyRoute(leg4);
-                                                                fiveLeg->leg5 = copyRoute(leg5);
-                                                                fiveLeg->next = nullptr;
-
-                                                                if (!resultHead) {
-                                                                    resultHead = fiveLeg;
-                                                                    resultTail = fiveLeg;
-                                                                } else {
-                                                                    resultTail->next = fiveLeg;
-                                                                    resultTail = fiveLeg;
-                                                                }
+                                                    int leg5Begin, leg5End;
+                                                    connectingDepartures(fg, stop4Port->id, leg4->arrivalMinutes, leg5Begin, leg5End);
+                                                    for (int leg5Edge = leg5Begin; leg5Edge < leg5End; leg5Edge++) {
+                                                        if (fg.edges[leg5Edge].destinationId != destId) continue;
+                                                        Route leg5Value;
+                                                        expandSailing(g, fg, leg5Edge, leg5Value);
+                                                        Route* leg5 = &leg5Value;
+                                                        if (isValidConnectionMultiDay(leg4->arrivalMinutes, leg5->departureMinutes, MIN_LAYOVER_MINUTES, MAX_CONNECTION_DAYS)) {
+                                                            validRoutes++;
+                                                            FiveLegRoute* fiveLeg = new FiveLegRoute;
+                                                            fiveLeg->leg1 = copyRoute(leg1);
+                                                            fiveLeg->leg2 = copyRoute(leg2);
+                                                            fiveLeg->leg3 = copyRoute(leg3);
+                                                            fiveLeg->leg4 = copyRoute(leg4);
+                                                            fiveLeg->leg5 = copyRoute(leg5);
+                                                            fiveLeg->next = nullptr;
+
+                                                            if (!resultHead) {
+                                                                resultHead = fiveLeg;
+                                                                resultTail = fiveLeg;
                                                             } else {
-                                                                rejectedConnections++;
+                                                                resultTail->next = fiveLeg;
+                                                                resultTail = fiveLeg;
                                                             }
+                                                        } else {
+                                                            rejectedConnections++;
                                                         }
-                                                        leg5 = leg5->next;
                                                     }
                                                 }
                                             }
-                                            leg4 = leg4->next;
                                         }
                                     }
                                 }
-                                leg3 = leg3->next;
                             }
                         }
                     }
-                    leg2 = leg2->next;
                 }
             }
         }
-        leg1 = leg1->next;
     }
 
     cout << "[DEBUG FourStop] Valid routes: " << validRoutes
@@ -581,7 +543,7 @@ void getAllPossibleRoutes(Graph& g, const string& origin, const string& destinat
     while (current) {
         Route* nextRoute = current->next;
 
-        if (current->destinationPort.compare(destination) == 0) {
+        if (destination.compare(current->destinationPort) == 0) {
 
             current->next = nullptr;
 
@@ -635,7 +597,6 @@ void printDirectRoutes(Route* head) {
         cout << "  Company: " << current->shippingCompany << "\n\n";
 
         count++;
-        current = current->next;
   }
 }
 
@@ -682,7 +643,6 @@ void printTwoLegRoutes(TwoLegRoute* head) {
   cout << "  Total Cost: $" << totalCost << "\n\n";
 
         count++;
-        current = current->next;
   }
 }
 
@@ -743,7 +703,6 @@ void printThreeLegRoutes(ThreeLegRoute* head) {
 cout << "  Total Cost: $" << totalCost << "\n\n";
 
   count++;
-        current = current->next;
  }
 }
 
@@ -819,7 +778,6 @@ void printFourLegRoutes(FourLegRoute* head) {
         cout << "  Total Cost: $" << totalCost << "\n\n";
 
         count++;
-        current = current->next;
     }
 }
 
@@ -910,7 +868,6 @@ void printFiveLegRoutes(FiveLegRoute* head) {
         cout << "  Total Cost: $" << totalCost << "\n\n";
 
         count++;
-        current = current->next;
     }
 }
 
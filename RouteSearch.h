@@ -49,7 +49,7 @@ bool isTimeBefore(const Time& a, const Time& b);
 
 bool isLayoverFeasible(const Time& arrival, const Time& nextDeparture);
 
-bool isValidConnectionMultiDay(const Date& leg1DepartureDate, const Time& leg1DepartureTime, const Time& leg1ArrivalTime, const Date& leg2DepartureDate, const Time& leg2DepartureTime, int minLayoverMinutes, int maxDaysGap);
+bool isValidConnectionMultiDay(int leg1ArrivalMinutes, int leg2DepartureMinutes, int minLayoverMinutes, int maxDaysGap);
 
 Route* getDirectRoutes(Graph& g, const string& origin, const Date& d);
 
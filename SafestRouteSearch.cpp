@@ -1,5 +1,6 @@
 #include "SafestRouteSearch.h"
 #include "RoutePreferences.h"
+#include "SearchKernel.h"
 #include <iostream>
 #include <climits>
 
@@ -21,21 +22,7 @@ static int calculateRouteTravelTimeMinutes(const Route* route) {
 static bool isValidLayover(const Route* prevRoute, const Route* nextRoute, int minLayoverMinutes = 60) {
     if (!prevRoute || !nextRoute) return true;
     
-    // Check if dates are compatible
-    int prevDay = prevRoute->voyageDate.year * 365 + prevRoute->voyageDate.month * 31 + prevRoute->voyageDate.day;
-    int nextDay = nextRoute->voyageDate.year * 365 + nextRoute->voyageDate.month * 31 + nextRoute->voyageDate.day;
-    
-    if (nextDay < prevDay) return false; // Going backwards in time
-    
-    if (nextDay == prevDay) {
-        // Same day - check if enough layover time
-        int arrMinutes = prevRoute->arrivalTime.hour * 60 + prevRoute->arrivalTime.minute;
-        int depMinutes = nextRoute->departureTime.hour * 60 + nextRoute->departureTime.minute;
-        return (depMinutes >= arrMinutes + minLayoverMinutes);
-    }
-    
-    // Different day - valid as long as next departure is after previous arrival
-    return true;
+    return canConnect(prevRoute->arrivalMinutes, nextRoute->departureMinutes, minLayoverMinutes);
 }
 
 // Utility: Check if route departs on or after a given date
@@ -46,10 +33,25 @@ static bool isRouteOnOrAfterDate(const Route* route, const Date& searchDate) {
             route->voyageDate.day == searchDate.day);
 }
 
+// Utility: Edges of a port the DFS may take next. The first leg must leave
+// on the search date; later legs must leave after the last leg's arrival
+// plus the layover. Both windows are found by binary search.
+static void candidateDepartures(const FrozenGraph& fg, int portId, const Route* lastRoute, const Date& searchDate, int& begin, int& end) {
+    if (lastRoute) {
+        begin = firstDepartureFrom(fg, portId, lastRoute->arrivalMinutes + 60);
+        end = fg.firstEdge[portId + 1];
+    } else {
+        Time midnight = {0, 0};
+        int dayStart = toEpochMinutes(searchDate, midnight);
+        begin = firstDepartureFrom(fg, portId, dayStart);
+        end = firstDepartureFrom(fg, portId, dayStart + MINUTES_PER_DAY);
+    }
+}
+
 // Utility: Add a leg to journey
 static void addLegToJourney(SafeJourney& journey, Route* route) {
     SafeJourneyLeg* newLeg = new SafeJourneyLeg();
-    newLeg->route = route;
+    newLeg->route = *route;
     newLeg->next = nullptr;
     
     if (journey.legsHead == nullptr) {
@@ -73,8 +75,8 @@ static void removeLastLegFromJourney(SafeJourney& journey) {
     
     if (journey.legsHead->next == nullptr) {
         // Only one leg
-        journey.totalCost -= journey.legsHead->route->voyageCost;
-        journey.totalTime -= calculateRouteTravelTimeMinutes(journey.legsHead->route);
+        journey.totalCost -= journey.legsHead->route.voyageCost;
+        journey.totalTime -= calculateRouteTravelTimeMinutes(&journey.legsHead->route);
         delete journey.legsHead;
         journey.legsHead = nullptr;
         journey.legCount = 0;
@@ -85,8 +87,8 @@ static void removeLastLegFromJourney(SafeJourney& journey) {
             current = current->next;
         }
         
-        journey.totalCost -= current->next->route->voyageCost;
-        journey.totalTime -= calculateRouteTravelTimeMinutes(current->next->route);
+        journey.totalCost -= current->next->route.voyageCost;
+        journey.totalTime -= calculateRouteTravelTimeMinutes(&current->next->route);
         delete current->next;
         current->next = nullptr;
         journey.legCount--;
@@ -101,7 +103,7 @@ static Route* getLastLeg(const SafeJourney& journey) {
     while (current->next != nullptr) {
         current = current->next;
     }
-    return current->route;
+    return &current->route;
 }
 
 // Calculate safety score (lower is better/safer)
@@ -114,13 +116,13 @@ int calculateSafetyScore(const SafeJourney& journey, const RoutePreferences& pre
     // Penalize forbidden ports
     SafeJourneyLeg* current = journey.legsHead;
     while (current != nullptr) {
-        if (isPortForbidden(prefs, current->route->destinationPort)) {
+        if (isPortForbidden(prefs, current->route.destinationPort)) {
             score += 1000; // Heavy penalty for forbidden ports
         }
         
         // Check if company is not in allowed list
         if (prefs.allowedCompaniesCount > 0) {
-            if (!isCompanyAllowed(prefs, current->route->shippingCompany)) {
+            if (!isCompanyAllowed(prefs, current->route.shippingCompany)) {
                 score += 500; // Penalty for non-preferred companies
             }
         }
@@ -157,7 +159,7 @@ void copySafeJourney(const SafeJourney& src, SafeJourney& dest) {
     
     SafeJourneyLeg* current = src.legsHead;
     while (current != nullptr) {
-        addLegToJourney(dest, current->route);
+        addLegToJourney(dest, &current->route);
         current = current->next;
     }
     
@@ -172,7 +174,7 @@ void printSafeJourney(const SafeJourney& journey) {
     SafeJourneyLeg* current = journey.legsHead;
     int legNum = 1;
     while (current != nullptr) {
-        Route* r = current->route;
+        const Route* r = &current->route;
         cout << "  Leg " << legNum++ << ": " << r->shippingCompany 
              << " - " << r->destinationPort 
              << " (Departs: " << r->voyageDate.day << "/" << r->voyageDate.month 
@@ -185,20 +187,19 @@ void printSafeJourney(const SafeJourney& journey) {
 // DFS recursive helper to explore all possible routes
 static void dfsSafestRoute(
     Graph& g,
-    const string& currentPort,
-    const string& destPort,
+    const FrozenGraph& fg,
+    int currentPortId,
+    int destPortId,
     const Date& searchDate,
     const RoutePreferences& prefs,
     SafeJourney& currentJourney,
     SafeJourney& bestJourney,
     bool* visited,
-    Port** portArray,
-    int portCount,
     int maxDepth,
     int& solutionsFound
 ) {
     // Base case: reached destination
-    if (currentPort == destPort) {
+    if (currentPortId == destPortId) {
         int currentScore = calculateSafetyScore(currentJourney, prefs);
         currentJourney.safetyScore = currentScore;
         
@@ -225,45 +226,27 @@ static void dfsSafestRoute(
         return;
     }
     
-    // Find current port in graph
-    Port* currentPortNode = nullptr;
-    for (int i = 0; i < portCount; i++) {
-        if (portArray[i]->name == currentPort) {
-            currentPortNode = portArray[i];
-            break;
-        }
-    }
-    
-    if (!currentPortNode) return;
-    
     // Mark current port as visited
-    int currentPortIdx = -1;
-    for (int i = 0; i < portCount; i++) {
-        if (portArray[i]->name == currentPort) {
-            currentPortIdx = i;
-            break;
-        }
-    }
-    if (currentPortIdx >= 0) {
-        visited[currentPortIdx] = true;
-    }
+    visited[currentPortId] = true;
     
     // Get last route for layover validation
     Route* lastRoute = getLastLeg(currentJourney);
+    bool lastLeg = currentJourney.legCount + 1 >= maxDepth || (prefs.useMaxLegs && currentJourney.legCount + 1 >= prefs.maxLegs);
     
     // Explore all outgoing routes from current port
-    Route* route = currentPortNode->routeHead;
-    while (route != nullptr) {
-        string nextPort = route->destinationPort;
-        
-        // Find next port index
-        int nextPortIdx = -1;
-        for (int i = 0; i < portCount; i++) {
-            if (portArray[i]->name == nextPort) {
-                nextPortIdx = i;
-                break;
-            }
-        }
+    int edgeBegin, edgeEnd;
+    candidateDepartures(fg, currentPortId, lastRoute, searchDate, edgeBegin, edgeEnd);
+    for (int e = edgeBegin; e < edgeEnd; e++) {
+        // Ports already on the path, and on the last leg anything but the
+        // destination, are ruled out before the sailing is expanded
+        int nextPortIdx = fg.edges[e].destinationId;
+        if (visited[nextPortIdx] && nextPortIdx != destPortId) continue;
+        if (lastLeg && nextPortIdx != destPortId) continue;
+
+        Route routeValue;
+        expandSailing(g, fg, e, routeValue);
+        Route* route = &routeValue;
+        const string& nextPort = route->destinationPort;
         
         // Check constraints
         bool canUseRoute = true;
@@ -275,11 +258,6 @@ static void dfsSafestRoute(
             }
         }
         
-        // Avoid cycles (already visited)
-        if (canUseRoute && nextPortIdx >= 0 && visited[nextPortIdx] && nextPort != destPort) {
-            canUseRoute = false;
-        }
-        
         // Check forbidden ports
         if (canUseRoute && isPortForbidden(prefs, nextPort)) {
             canUseRoute = false;
@@ -301,21 +279,17 @@ static void dfsSafestRoute(
         
         // Recursively explore this route
         if (canUseRoute) {
-            addLegToJourney(currentJourney, route);
+            addLegToJourney(currentJourney, getRouteView(g, fg, e));
             
-            dfsSafestRoute(g, nextPort, destPort, searchDate, prefs, currentJourney, bestJourney, 
-                          visited, portArray, portCount, maxDepth, solutionsFound);
+            dfsSafestRoute(g, fg, nextPortIdx, destPortId, searchDate, prefs, currentJourney, bestJourney, 
+                          visited, maxDepth, solutionsFound);
             
             removeLastLegFromJourney(currentJourney);
         }
-        
-        route = route->next;
     }
     
     // Unmark current port as visited (backtrack)
-    if (currentPortIdx >= 0) {
-        visited[currentPortIdx] = false;
-    }
+    visited[currentPortId] = false;
 }
 
 // Main entry point: Find the safest route using DFS
@@ -326,30 +300,26 @@ void findSafestRoute(
     const Date& searchDate,
     const RoutePreferences& prefs,
     SafeJourney& bestJourney,
-    int maxDepth
+    int maxDepth,
+    SearchWorkspace* workspace
 ) {
     clearSafeJourney(bestJourney);
     
-    // Build port array for easier access
     int portCount = g.portCount;
     if (portCount == 0) {
         cout << "Error: No ports in graph" << endl;
         return;
     }
     
-    Port** portArray = new Port*[portCount];
-    Port* current = g.portHead;
-    int idx = 0;
-    while (current != nullptr) {
-        portArray[idx++] = current;
-        current = current->next;
-    }
+    int originId = findPortId(g, originPort);
+    int destId = findPortId(g, destPort);
+    if (originId < 0 || destId < 0) return;
     
-    // Initialize visited array
-    bool* visited = new bool[portCount];
-    for (int i = 0; i < portCount; i++) {
-        visited[i] = false;
-    }
+    // The workspace keeps its path flags all false between searches, and
+    // the DFS unmarks every port it marks
+    SearchWorkspace& ws = chooseWorkspace(workspace);
+    prepareSearchWorkspace(ws, g);
+    bool* visited = ws.onPath;
     
     // Create current journey for DFS exploration
     SafeJourney currentJourney;
@@ -367,8 +337,9 @@ void findSafestRoute(
     cout << "Search Date: " << searchDate.day << "/" << searchDate.month << "/" << searchDate.year << endl;
     
     // Start DFS from origin
-    dfsSafestRoute(g, originPort, destPort, searchDate, prefs, currentJourney, bestJourney,
-                   visited, portArray, portCount, maxDepth, solutionsFound);
+    FrozenGraphPin pin(g);
+    dfsSafestRoute(g, *pin.fg, originId, destId, searchDate, prefs, currentJourney, bestJourney,
+                   visited, maxDepth, solutionsFound);
     
     cout << "Solutions explored: " << solutionsFound << endl;
     
@@ -382,8 +353,6 @@ void findSafestRoute(
     
     // Cleanup
     clearSafeJourney(currentJourney);
-    delete[] portArray;
-    delete[] visited;
 }
 
 // Helper: Clear journey list
@@ -427,20 +396,19 @@ void addToSafeJourneyList(SafeJourneyList& list, const SafeJourney& journey) {
 // DFS helper that collects ALL valid routes
 static void dfsSafestRouteAll(
     Graph& g,
-    const string& currentPort,
-    const string& destPort,
+    const FrozenGraph& fg,
+    int currentPortId,
+    int destPortId,
     const Date& searchDate,
     const RoutePreferences& prefs,
     SafeJourney& currentJourney,
     SafeJourneyList& allJourneys,
     bool* visited,
-    Port** portArray,
-    int portCount,
     int maxDepth,
     int& solutionsFound
 ) {
     // Base case: reached destination
-    if (currentPort == destPort) {
+    if (currentPortId == destPortId) {
         int currentScore = calculateSafetyScore(currentJourney, prefs);
         currentJourney.safetyScore = currentScore;
         
@@ -455,39 +423,26 @@ static void dfsSafestRouteAll(
     if (prefs.useMaxTotalCost && currentJourney.totalCost > prefs.maxTotalCost) return;
     if (prefs.useMaxLegs && currentJourney.legCount >= prefs.maxLegs) return;
     
-    // Find current port
-    Port* currentPortNode = nullptr;
-    int currentPortIdx = -1;
-    for (int i = 0; i < portCount; i++) {
-        if (portArray[i]->name == currentPort) {
-            currentPortNode = portArray[i];
-            currentPortIdx = i;
-            break;
-        }
-    }
-    
-    if (!currentPortNode) return;
-    
     // Mark visited
-    if (currentPortIdx >= 0) {
-        visited[currentPortIdx] = true;
-    }
+    visited[currentPortId] = true;
     
     Route* lastRoute = getLastLeg(currentJourney);
+    bool lastLeg = currentJourney.legCount + 1 >= maxDepth || (prefs.useMaxLegs && currentJourney.legCount + 1 >= prefs.maxLegs);
     
     // Explore all routes
-    Route* route = currentPortNode->routeHead;
-    while (route != nullptr) {
-        string nextPort = route->destinationPort;
-        
-        // Find next port index
-        int nextPortIdx = -1;
-        for (int i = 0; i < portCount; i++) {
-            if (portArray[i]->name == nextPort) {
-                nextPortIdx = i;
-                break;
-            }
-        }
+    int edgeBegin, edgeEnd;
+    candidateDepartures(fg, currentPortId, lastRoute, searchDate, edgeBegin, edgeEnd);
+    for (int e = edgeBegin; e < edgeEnd; e++) {
+        // Ports already on the path, and on the last leg anything but the
+        // destination, are ruled out before the sailing is expanded
+        int nextPortIdx = fg.edges[e].destinationId;
+        if (visited[nextPortIdx] && nextPortIdx != destPortId) continue;
+        if (lastLeg && nextPortIdx != destPortId) continue;
+
+        Route routeValue;
+        expandSailing(g, fg, e, routeValue);
+        Route* route = &routeValue;
+        const string& nextPort = route->destinationPort;
         
         // Check constraints
         bool canUseRoute = true;
@@ -499,11 +454,6 @@ static void dfsSafestRouteAll(
             }
         }
         
-        // Avoid cycles
-        if (canUseRoute && nextPortIdx >= 0 && visited[nextPortIdx] && nextPort != destPort) {
-            canUseRoute = false;
-        }
-        
         // Check forbidden ports
         if (canUseRoute && isPortForbidden(prefs, nextPort)) {
             canUseRoute = false;
@@ -525,19 +475,15 @@ static void dfsSafestRouteAll(
         
         // Recurse
         if (canUseRoute) {
-            addLegToJourney(currentJourney, route);
-            dfsSafestRouteAll(g, nextPort, destPort, searchDate, prefs, currentJourney, allJourneys,
-                             visited, portArray, portCount, maxDepth, solutionsFound);
+            addLegToJourney(currentJourney, getRouteView(g, fg, e));
+            dfsSafestRouteAll(g, fg, nextPortIdx, destPortId, searchDate, prefs, currentJourney, allJourneys,
+                             visited, maxDepth, solutionsFound);
             removeLastLegFromJourney(currentJourney);
         }
-        
-        route = route->next;
     }
     
     // Backtrack
-    if (currentPortIdx >= 0) {
-        visited[currentPortIdx] = false;
-    }
+    visited[currentPortId] = false;
 }
 
 // Main function to find all safe routes
@@ -548,37 +494,27 @@ void findAllSafestRoutes(
     const Date& searchDate,
     const RoutePreferences& prefs,
     SafeJourneyList& allJourneys,
-    int maxDepth
+    int maxDepth,
+    SearchWorkspace* workspace
 ) {
     // Initialize
     allJourneys.count = 0;
     allJourneys.capacity = 0;
     allJourneys.journeys = nullptr;
     
-    // Get port count
-    int portCount = 0;
-    Port* current = g.portHead;
-    while (current != nullptr) {
-        portCount++;
-        current = current->next;
-    }
-    
+    // Resolve endpoints to port ids
+    int portCount = g.portCount;
     if (portCount == 0) return;
     
-    // Build port array
-    Port** portArray = new Port*[portCount];
-    current = g.portHead;
-    int idx = 0;
-    while (current != nullptr) {
-        portArray[idx++] = current;
-        current = current->next;
-    }
+    int originId = findPortId(g, originPort);
+    int destId = findPortId(g, destPort);
+    if (originId < 0 || destId < 0) return;
     
-    // Initialize visited
-    bool* visited = new bool[portCount];
-    for (int i = 0; i < portCount; i++) {
-        visited[i] = false;
-    }
+    // The workspace keeps its path flags all false between searches, and
+    // the DFS unmarks every port it marks
+    SearchWorkspace& ws = chooseWorkspace(workspace);
+    prepareSearchWorkspace(ws, g);
+    bool* visited = ws.onPath;
     
     // Create current journey
     SafeJourney currentJourney;
@@ -596,15 +532,14 @@ void findAllSafestRoutes(
     cout << "Search Date: " << searchDate.day << "/" << searchDate.month << "/" << searchDate.year << endl;
     
     // Start DFS
-    dfsSafestRouteAll(g, originPort, destPort, searchDate, prefs, currentJourney, allJourneys,
-                     visited, portArray, portCount, maxDepth, solutionsFound);
+    FrozenGraphPin pin(g);
+    dfsSafestRouteAll(g, *pin.fg, originId, destId, searchDate, prefs, currentJourney, allJourneys,
+                     visited, maxDepth, solutionsFound);
     
     cout << "Total solutions found: " << allJourneys.count << endl;
     cout << "===============================================\n\n";
     
     // Cleanup
     clearSafeJourney(currentJourney);
-    delete[] portArray;
-    delete[] visited;
 }
 
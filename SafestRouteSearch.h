@@ -6,15 +6,18 @@
 #include "Route.h"
 #include "DateTime.h"
 #include "RoutePreferences.h"
+#include "SearchKernel.h"
 
 using namespace std;
 
 // Generic journey representation using linked list of route pointers
+// A copy of the sailing, so a journey outlives the timetable version it
+// was found in
 struct SafeJourneyLeg {
-    Route* route;
+    Route route;
     SafeJourneyLeg* next;
     
-    SafeJourneyLeg() : route(nullptr), next(nullptr) {}
+    SafeJourneyLeg() : next(nullptr) {}
 };
 
 struct SafeJourney {
@@ -44,7 +47,8 @@ void findAllSafestRoutes(
     const Date& searchDate,
     const RoutePreferences& prefs,
     SafeJourneyList& allJourneys,
-    int maxDepth = 15
+    int maxDepth = 15,
+    SearchWorkspace* workspace = nullptr
 );
 
 // Original function - finds single best route
@@ -55,7 +59,8 @@ void findSafestRoute(
     const Date& searchDate,
     const RoutePreferences& prefs,
     SafeJourney& bestJourney,
-    int maxDepth = 15
+    int maxDepth = 15,
+    SearchWorkspace* workspace = nullptr
 );
 
 // Helper functions
@@ -0,0 +1,186 @@
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include "ScheduleUpdate.h"
+
+using namespace std;
+
+// A sailing the batch adds (or a retimed one re-added under its new time)
+struct AddedSailing {
+    int originId;
+    Sailing sailing;
+    bool alive;
+};
+
+static bool departsBefore(const Sailing& a, const Sailing& b) {
+    return a.departure < b.departure;
+}
+
+static bool addedBefore(const AddedSailing& a, const AddedSailing& b) {
+    if (a.originId != b.originId) return a.originId < b.originId;
+    return a.sailing.departure < b.sailing.departure;
+}
+
+static bool sameSailing(const Sailing& a, const Sailing& b) {
+    return a.departure == b.departure && a.destinationId == b.destinationId && a.companyId == b.companyId;
+}
+
+bool makeSailingChange(Graph& g, SailingChangeKind kind, const string& origin, const string& destination, const Date& date, const Time& dep, const Time& arr, int cost, const string& company, SailingChange& out) {
+    int companyId = internCompany(g, company.data(), (int)company.size());
+    if (companyId < 0) return false;
+
+    out.kind = kind;
+    out.originId = addPortIfNotExists(g, origin)->id;
+    out.sailing = makeSailing(addPortIfNotExists(g, destination)->id, date, dep, arr, cost, companyId);
+    out.retimed = out.sailing;
+    return true;
+}
+
+// Index of the first live sailing in the origin's slice of old that matches, or -1
+static int findExistingSailing(const FrozenGraph& old, const char* removed, int originId, const Sailing& target) {
+    if (originId >= old.portCount) return -1;
+    const Sailing* begin = old.edges + old.firstEdge[originId];
+    const Sailing* end = old.edges + old.firstEdge[originId + 1];
+    for (const Sailing* s = lower_bound(begin, end, target, departsBefore); s < end && s->departure == target.departure; s++) {
+        int e = (int)(s - old.edges);
+        if (!removed[e] && sameSailing(*s, target)) return e;
+    }
+    return -1;
+}
+
+// Latest still-live sailing added earlier in this batch that matches, or -1
+static int findAddedSailing(const AddedSailing* added, int addedCount, int originId, const Sailing& target) {
+    for (int i = addedCount - 1; i >= 0; i--) {
+        if (added[i].alive && added[i].originId == originId && sameSailing(added[i].sailing, target)) return i;
+    }
+    return -1;
+}
+
+static void retime(Sailing& s, const Sailing& retimed) {
+    s.departure = retimed.departure;
+    s.duration = retimed.duration;
+    s.voyageCost = retimed.voyageCost;
+}
+
+bool applyScheduleUpdate(Graph& g, const SailingChange* changes, int changeCount, ScheduleUpdateStats& stats) {
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+    stats = ScheduleUpdateStats();
+
+    // Sailings still staged by a loader are merged first so the batch sees them
+    getFrozenGraph(g);
+
+    lock_guard<mutex> lock(g.updateLock);
+    const FrozenGraph& old = *g.frozen.load();
+    int portCount = g.portCount;
+
+    char* removed = new char[old.edgeCount > 0 ? old.edgeCount : 1];
+    memset(removed, 0, old.edgeCount > 0 ? old.edgeCount : 1);
+    int removedCount = 0;
+
+    AddedSailing* added = new AddedSailing[changeCount > 0 ? changeCount : 1];
+    int addedCount = 0;
+
+    for (int i = 0; i < changeCount; i++) {
+        const SailingChange& c = changes[i];
+        if (c.originId < 0 || c.originId >= portCount
+            || c.sailing.destinationId < 0 || c.sailing.destinationId >= portCount
+            || c.sailing.companyId >= g.companyCount) {
+            stats.unmatched++;
+            continue;
+        }
+
+        if (c.kind == SAILING_ADDED) {
+            AddedSailing& a = added[addedCount++];
+            a.originId = c.originId;
+            a.sailing = c.sailing;
+            a.alive = true;
+            stats.added++;
+            continue;
+        }
+
+        // A cancel or retime may name a sailing added earlier in the same batch
+        int a = findAddedSailing(added, addedCount, c.originId, c.sailing);
+        if (a >= 0) {
+            if (c.kind == SAILING_CANCELLED) {
+                added[a].alive = false;
+                stats.cancelled++;
+            } else {
+                retime(added[a].sailing, c.retimed);
+                stats.retimed++;
+            }
+            continue;
+        }
+
+        int e = findExistingSailing(old, removed, c.originId, c.sailing);
+        if (e < 0) {
+            stats.unmatched++;
+            continue;
+        }
+        removed[e] = 1;
+        removedCount++;
+
+        if (c.kind == SAILING_CANCELLED) {
+            stats.cancelled++;
+        } else {
+            AddedSailing& r = added[addedCount++];
+            r.originId = c.originId;
+            r.sailing = old.edges[e];
+            retime(r.sailing, c.retimed);
+            r.alive = true;
+            stats.retimed++;
+        }
+    }
+
+    int liveAdded = 0;
+    for (int i = 0; i < addedCount; i++) {
+        if (added[i].alive) added[liveAdded++] = added[i];
+    }
+    stable_sort(added, added + liveAdded, addedBefore);
+
+    bool changed = removedCount > 0 || liveAdded > 0 || portCount != old.portCount;
+    if (changed) {
+        FrozenGraph* fg = newFrozenGraph(portCount, old.edgeCount - removedCount + liveAdded);
+
+        // Each port's slice is its surviving old sailings merged with its
+        // additions; both are already in departure order, and on equal
+        // departures the old sailing stays first
+        int slot = 0;
+        int next = 0;
+        for (int id = 0; id < portCount; id++) {
+            fg->firstEdge[id] = slot;
+            int e = id < old.portCount ? old.firstEdge[id] : 0;
+            int end = id < old.portCount ? old.firstEdge[id + 1] : 0;
+            while (true) {
+                while (e < end && removed[e]) e++;
+                bool haveOld = e < end;
+                bool haveNew = next < liveAdded && added[next].originId == id;
+                if (!haveOld && !haveNew) break;
+                if (haveOld && (!haveNew || old.edges[e].departure <= added[next].sailing.departure)) {
+                    fg->edges[slot++] = old.edges[e++];
+                } else {
+                    fg->edges[slot++] = added[next++].sailing;
+                }
+            }
+        }
+        fg->firstEdge[portCount] = slot;
+
+        publishFrozenGraph(g, fg);
+    }
+    stats.version = g.frozen.load()->version;
+
+    delete[] added;
+    delete[] removed;
+
+    stats.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+    return changed;
+}
+
+void printScheduleUpdateStats(const ScheduleUpdateStats& stats) {
+    cout << "Schedule update -> version " << stats.version << ": " << stats.added << " added, "
+         << stats.cancelled << " cancelled, " << stats.retimed << " retimed";
+    if (stats.unmatched > 0) {
+        cout << ", " << stats.unmatched << " unmatched";
+    }
+    cout << " in " << stats.milliseconds << " ms." << endl;
+}
@@ -0,0 +1,52 @@
+#ifndef SCHEDULE_UPDATE_H
+#define SCHEDULE_UPDATE_H
+
+#include <string>
+#include "Graph.h"
+
+using namespace std;
+
+enum SailingChangeKind {
+    SAILING_ADDED,
+    SAILING_CANCELLED,
+    SAILING_RETIMED
+};
+
+// One delta from the schedule feed. For SAILING_ADDED, sailing is the new
+// sailing. For SAILING_CANCELLED and SAILING_RETIMED it names an existing
+// sailing, matched on origin, destination, company and departure; a retime
+// replaces that sailing's departure, duration and cost with retimed's.
+struct SailingChange {
+    SailingChangeKind kind;
+    int originId;
+    Sailing sailing;
+    Sailing retimed;
+};
+
+// Counters for one applied batch; unmatched counts cancels and retimes
+// that named no existing sailing, plus changes with out-of-range ids
+struct ScheduleUpdateStats {
+    int added;
+    int cancelled;
+    int retimed;
+    int unmatched;
+    unsigned long long version;
+    double milliseconds;
+
+    ScheduleUpdateStats() : added(0), cancelled(0), retimed(0), unmatched(0), version(0), milliseconds(0.0) {}
+};
+
+// Resolves names to ids and packs the sailing. Unknown ports and companies
+// are interned, so call this from the thread that owns the graph, not
+// while searches run elsewhere. Returns false once the company table is full.
+bool makeSailingChange(Graph &g, SailingChangeKind kind, const string &origin, const string &destination, const Date &date, const Time &dep, const Time &arr, int cost, const string &company, SailingChange &out);
+
+// Applies a batch copy-on-write: the current version is copied with the
+// changes merged in and published as a new version, so searches that have
+// the old one pinned finish on it undisturbed. Changes apply in order.
+// Returns true if a new version was published.
+bool applyScheduleUpdate(Graph &g, const SailingChange *changes, int changeCount, ScheduleUpdateStats &stats);
+
+void printScheduleUpdateStats(const ScheduleUpdateStats &stats);
+
+#endif
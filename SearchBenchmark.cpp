@@ -0,0 +1,504 @@
+#include "SearchBenchmark.h"
+#include "ShortestPath.h"
+#include "AStarSearch.h"
+#include "BidirectionalSearch.h"
+#include "ConnectionScan.h"
+#include "Landmarks.h"
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+static const char* ENGINE_NAMES[BENCH_ENGINE_COUNT] = {
+    "Earliest arrival",
+    "Earliest arrival (CSA)",
+    "Cheapest (Dijkstra)",
+    "Cheapest (A*)",
+    "Cheapest in window (CSA)",
+    "Cheapest, undated (heap)",
+    "Cheapest, undated (buckets)",
+    "Cheapest, undated (bidirectional)",
+    "Cheapest, undated (hierarchy)"
+};
+
+static const char* FILTERED_ENGINE_NAMES[FILTERED_ENGINE_COUNT] = {
+    "Cheapest, undated, filtered (kernel)",
+    "Cheapest, undated, filtered (port-arc Dijkstra)",
+    "Cheapest, undated, filtered (customized hierarchy)"
+};
+
+// Queries each engine runs untimed before the timed ones
+static const int BENCH_WARM_UP_QUERIES = 20;
+
+// Filters the filtered benchmark's queries take in turn, and the ports
+// the ones that avoid ports leave out
+static const int BENCH_FILTER_COUNT = 3;
+static const int BENCH_AVOIDED_PORTS = 10;
+
+static const char* COMPANY_NAMES[] = { "Maersk", "MSC", "CMA CGM", "Evergreen" };
+static const int COMPANY_COUNT = 4;
+
+// xorshift: the timetable depends on the seed alone, not on rand()'s state
+static unsigned int nextRandom(unsigned int& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static string portName(int port) {
+    return "P" + to_string(port);
+}
+
+void buildSyntheticTimetable(Graph& g, int portCount, int sailingCount, int days, unsigned int seed, int crossingReach) {
+    unsigned int state = seed != 0 ? seed : 1;
+    if (portCount < 2 || days <= 0) return;
+    for (int p = 0; p < portCount; p++) {
+        addPortIfNotExists(g, portName(p));
+    }
+
+    Time midnight = {0, 0};
+    int start = toEpochMinutes(Date{1, 1, 2024}, midnight);
+    for (int i = 0; i < sailingCount; i++) {
+        int origin = (int)(nextRandom(state) % portCount);
+        int destination;
+        if (i % 2 == 0) {
+            destination = (origin + 1) % portCount;
+        } else if (crossingReach > 0) {
+            int offset = 1 + (int)(nextRandom(state) % crossingReach) % (portCount - 1);
+            if (nextRandom(state) & 1) offset = portCount - offset;
+            destination = (origin + offset) % portCount;
+        } else {
+            destination = (int)(nextRandom(state) % portCount);
+            if (destination == origin) destination = (origin + 1) % portCount;
+        }
+
+        Date date;
+        Time departure;
+        Time arrival;
+        int day = (int)(nextRandom(state) % days);
+        fromEpochMinutes(start + day * MINUTES_PER_DAY, date, departure);
+        departure.hour = (int)(nextRandom(state) % 24);
+        departure.minute = (int)(nextRandom(state) % 60);
+        arrival.hour = (int)(nextRandom(state) % 24);
+        arrival.minute = (int)(nextRandom(state) % 60);
+        int cost = 100 + (int)(nextRandom(state) % 900);
+        addRoute(g, portName(origin), portName(destination), date, departure, arrival, cost, COMPANY_NAMES[nextRandom(state) % COMPANY_COUNT]);
+    }
+    freezeGraph(g);
+}
+
+static void addQueryCounters(HeapCounters& total, const HeapCounters& query) {
+    total.pushes += query.pushes;
+    total.decreases += query.decreases;
+    total.pops += query.pops;
+    total.stalePops += query.stalePops;
+    if (query.peakSize > total.peakSize) total.peakSize = query.peakSize;
+    if (query.buckets > total.buckets) total.buckets = query.buckets;
+}
+
+// Runs engine on one pair and returns its arrival (earliest-arrival
+// engines) or fare (the rest), or -1 if it found nothing
+static int runEngine(int engine, Graph& g, ConnectionScan& cs, LandmarkIndex& landmarks, const ContractionHierarchy& ch, HierarchyQuery& hq, SearchWorkspace& ws, const string& origin, const string& destination, const Date& startDate, int days, EngineTiming& timing) {
+    Time midnight = {0, 0};
+    ShortestPathResult result;
+    AStarResult astar;
+    bool found = false;
+    int value = -1;
+    int expanded = 0;
+
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+    switch (engine) {
+    case BENCH_EARLIEST_ARRIVAL:
+        findEarliestArrival(g, origin, destination, startDate, midnight, result, nullptr, &ws);
+        break;
+    case BENCH_EARLIEST_ARRIVAL_CSA:
+        findEarliestArrivalCSA(g, cs, origin, destination, startDate, midnight, result, nullptr, &ws);
+        break;
+    case BENCH_CHEAPEST_DIJKSTRA:
+        findCheapestRoute(g, origin, destination, result, &ws);
+        break;
+    case BENCH_CHEAPEST_ASTAR:
+        findRouteAStar(g, landmarks, origin, destination, astar, nullptr, &ws);
+        break;
+    case BENCH_CHEAPEST_IN_WINDOW_CSA:
+        findCheapestInWindowCSA(g, cs, origin, destination, startDate, days + 2, result, nullptr, &ws);
+        break;
+    case BENCH_UNDATED_HEAP:
+        findCheapestRouteIgnoringDates(g, origin, destination, result, 15, nullptr, SEARCH_QUEUE_HEAP, &ws);
+        break;
+    case BENCH_UNDATED_BUCKETS:
+        findCheapestRouteIgnoringDates(g, origin, destination, result, 15, nullptr, SEARCH_QUEUE_BUCKETS, &ws);
+        break;
+    case BENCH_UNDATED_BIDIRECTIONAL:
+        findCheapestRouteBidirectional(g, origin, destination, result, 15, nullptr, &ws);
+        break;
+    case BENCH_UNDATED_HIERARCHY:
+        findRouteHierarchy(g, ch, hq, origin, destination, result);
+        break;
+    }
+    timing.seconds += chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    if (engine == BENCH_CHEAPEST_ASTAR) {
+        found = astar.found;
+        value = astar.totalCost;
+        expanded = astar.nodesExpanded;
+        addQueryCounters(timing.heap, astar.heapCounters);
+        clearJourney(astar.journey);
+    } else {
+        found = result.found;
+        bool byArrival = engine == BENCH_EARLIEST_ARRIVAL || engine == BENCH_EARLIEST_ARRIVAL_CSA;
+        value = byArrival ? result.arrivalMinutes : result.totalCost;
+        expanded = result.nodesExpanded;
+        addQueryCounters(timing.heap, result.heapCounters);
+        clearJourney(result.journey);
+    }
+
+    timing.nodesExpanded += expanded;
+    if (!found) return -1;
+    timing.found++;
+    return value;
+}
+
+void runSearchBenchmark(const SearchBenchmarkOptions& options, SearchBenchmarkReport& report) {
+    report = SearchBenchmarkReport();
+    for (int e = 0; e < BENCH_ENGINE_COUNT; e++) {
+        report.engines[e].name = ENGINE_NAMES[e];
+    }
+
+    Graph g;
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+    buildSyntheticTimetable(g, options.portCount, options.sailingCount, options.days, options.seed);
+    report.buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    report.portCount = g.portCount;
+    if (g.portCount < 2) {
+        freeGraph(g);
+        return;
+    }
+
+    {
+        FrozenGraphPin pin(g);
+        report.sailingCount = pin.fg->edgeCount;
+    }
+
+    ConnectionScan cs;
+    LandmarkIndex landmarks;
+    ContractionHierarchy ch;
+    HierarchyQuery hq;
+    buildContractionHierarchy(g, ch, report.hierarchy);
+    Date startDate = {1, 1, 2024};
+    unsigned int state = options.seed * 2654435761u + 1;
+
+    // Warm-up queries use their own pairs, so the timed run may still meet
+    // a search bigger than any of them
+    SearchWorkspace workspaces[BENCH_ENGINE_COUNT];
+    EngineTiming warmUp;
+    unsigned int warmState = options.seed * 2246822519u + 1;
+    for (int w = 0; w < BENCH_WARM_UP_QUERIES; w++) {
+        int origin = (int)(nextRandom(warmState) % g.portCount);
+        int destination = (int)(nextRandom(warmState) % g.portCount);
+        for (int e = 0; e < BENCH_ENGINE_COUNT; e++) {
+            runEngine(e, g, cs, landmarks, ch, hq, workspaces[e], portName(origin), portName(destination), startDate, options.days, warmUp);
+        }
+    }
+    long long warmGrowths[BENCH_ENGINE_COUNT];
+    for (int e = 0; e < BENCH_ENGINE_COUNT; e++) {
+        warmGrowths[e] = workspaces[e].growths;
+    }
+
+    int values[BENCH_ENGINE_COUNT];
+    for (int q = 0; q < options.queryCount; q++) {
+        int origin = (int)(nextRandom(state) % g.portCount);
+        int destination = (int)(nextRandom(state) % g.portCount);
+        if (origin == destination) continue;
+
+        for (int e = 0; e < BENCH_ENGINE_COUNT; e++) {
+            values[e] = runEngine(e, g, cs, landmarks, ch, hq, workspaces[e], portName(origin), portName(destination), startDate, options.days, report.engines[e]);
+        }
+        if (values[BENCH_EARLIEST_ARRIVAL] != values[BENCH_EARLIEST_ARRIVAL_CSA]) report.arrivalMismatches++;
+        if (values[BENCH_CHEAPEST_DIJKSTRA] != values[BENCH_CHEAPEST_ASTAR]) report.costMismatches++;
+        if (values[BENCH_UNDATED_HEAP] != values[BENCH_UNDATED_BUCKETS]) report.queueMismatches++;
+        int kernelFare = values[BENCH_UNDATED_HEAP];
+        int bidirectionalFare = values[BENCH_UNDATED_BIDIRECTIONAL];
+        if (kernelFare >= 0 && (bidirectionalFare < 0 || bidirectionalFare > kernelFare)) report.bidirectionalDearer++;
+        if (bidirectionalFare >= 0 && (kernelFare < 0 || bidirectionalFare < kernelFare)) report.bidirectionalCheaper++;
+        int hierarchyFare = values[BENCH_UNDATED_HIERARCHY];
+        if (kernelFare >= 0 && (hierarchyFare < 0 || hierarchyFare > kernelFare)) report.hierarchyDearer++;
+        if (values[BENCH_EARLIEST_ARRIVAL] >= 0 && values[BENCH_CHEAPEST_DIJKSTRA] < 0) report.cheapestMissed++;
+        report.queryCount++;
+    }
+    for (int e = 0; e < BENCH_ENGINE_COUNT; e++) {
+        report.engines[e].growths = workspaces[e].growths - warmGrowths[e];
+    }
+
+    freeConnectionScan(cs);
+    freeLandmarkIndex(landmarks);
+    freeHierarchyQuery(hq);
+    freeContractionHierarchy(ch);
+    freeGraph(g);
+}
+
+static void printEngineTiming(const EngineTiming& t, int queryCount) {
+    int queries = queryCount > 0 ? queryCount : 1;
+    cout << "  " << t.name << ": " << t.seconds * 1000.0 / queries << " ms/query, " << t.nodesExpanded / queries
+         << " expanded/query, " << t.found << " found, " << t.growths << " workspace growth(s)"
+         << (t.growths > 0 ? " <- allocated after warm-up" : "") << "." << endl;
+    if (t.heap.pushes > 0) {
+        cout << "    queue: " << t.heap.pushes / queries << " pushes, " << t.heap.decreases / queries << " decreases, "
+             << t.heap.pops / queries << " pops (" << t.heap.stalePops / queries << " stale) per query, peak "
+             << t.heap.peakSize << " queued";
+        if (t.heap.buckets > 0) cout << " in " << t.heap.buckets << " buckets";
+        cout << "." << endl;
+    }
+}
+
+void printSearchBenchmarkReport(const SearchBenchmarkReport& report) {
+    cout << "Search benchmark: " << report.portCount << " ports, " << report.sailingCount << " sailings (built in "
+         << report.buildSeconds * 1000.0 << " ms), " << report.queryCount << " queries." << endl;
+    for (int e = 0; e < BENCH_ENGINE_COUNT; e++) {
+        printEngineTiming(report.engines[e], report.queryCount);
+    }
+    cout << "  " << report.arrivalMismatches << " arrival mismatch(es), " << report.costMismatches << " fare mismatch(es), "
+         << report.queueMismatches << " heap/bucket mismatch(es), " << report.cheapestMissed
+         << " pair(s) reached by earliest arrival but not by cheapest (Dijkstra)." << endl;
+    cout << "  Bidirectional: " << report.bidirectionalCheaper << " fare(s) below the kernel's, " << report.bidirectionalDearer
+         << " above it" << (report.bidirectionalDearer > 0 ? " <- should be 0" : "") << "." << endl;
+    cout << "  Hierarchy: " << report.hierarchyDearer << " fare(s) above the kernel's"
+         << (report.hierarchyDearer > 0 ? " <- should be 0" : "") << "; ";
+    printHierarchyStats(report.hierarchy);
+}
+
+// Runs engine on one pair under prefs and returns its fare, or -1 if it
+// found nothing. arcs are the port arcs collapsed for prefs.
+static int runFilteredEngine(int engine, Graph& g, const CustomizableHierarchy& cch, HierarchyMetricCache& cache, CustomizedQuery& cq,
+                             const PortArcs& arcs, OneToAllWorkspace& ows, SearchWorkspace& ws, const RoutePreferences& prefs,
+                             const string& origin, const string& destination, EngineTiming& timing) {
+    ShortestPathResult result;
+    int expanded = 0;
+    int value = -1;
+
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+    switch (engine) {
+    case FILTERED_KERNEL:
+        findCheapestRouteIgnoringDates(g, origin, destination, result, 15, &prefs, SEARCH_QUEUE_BUCKETS, &ws);
+        expanded = result.nodesExpanded;
+        if (result.found) value = result.totalCost;
+        break;
+    case FILTERED_PORT_ARCS: {
+        int from = findPortId(g, origin);
+        int to = findPortId(g, destination);
+        expanded = searchOneToAll(arcs, from, ows);
+        if (ows.cost[to] != INT_MAX) value = ows.cost[to];
+        break;
+    }
+    case FILTERED_CUSTOMIZED: {
+        HierarchyMetricPin pin(g, cch, cache, PORT_ARCS_CHEAPEST, &prefs);
+        if (pin.metric) findRouteCustomized(g, cch, *pin.metric, cq, origin, destination, result);
+        expanded = result.nodesExpanded;
+        if (result.found) value = result.totalCost;
+        break;
+    }
+    }
+    timing.seconds += chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+    addQueryCounters(timing.heap, result.heapCounters);
+    clearJourney(result.journey);
+    timing.nodesExpanded += expanded;
+    if (value < 0) return -1;
+    timing.found++;
+    return value;
+}
+
+void runFilteredBenchmark(const SearchBenchmarkOptions& options, FilteredBenchmarkReport& report) {
+    report = FilteredBenchmarkReport();
+    for (int e = 0; e < FILTERED_ENGINE_COUNT; e++) {
+        report.engines[e].name = FILTERED_ENGINE_NAMES[e];
+    }
+
+    Graph g;
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+    buildSyntheticTimetable(g, options.portCount, options.sailingCount, options.days, options.seed, options.crossingReach);
+    report.buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    report.portCount = g.portCount;
+    if (g.portCount < 2) {
+        freeGraph(g);
+        return;
+    }
+
+    {
+        FrozenGraphPin pin(g);
+        report.sailingCount = pin.fg->edgeCount;
+    }
+
+    // Two of the four companies, every company with some ports avoided,
+    // and both at once
+    unsigned int state = options.seed * 2654435761u + 1;
+    bool* avoided = new bool[g.portCount];
+    for (int p = 0; p < g.portCount; p++) {
+        avoided[p] = false;
+    }
+    RoutePreferences filters[BENCH_FILTER_COUNT];
+    filters[0].allowedCompanies[0] = COMPANY_NAMES[0];
+    filters[0].allowedCompanies[1] = COMPANY_NAMES[1];
+    filters[0].allowedCompaniesCount = 2;
+    for (int i = 0; i < BENCH_AVOIDED_PORTS; i++) {
+        int port = (int)(nextRandom(state) % g.portCount);
+        avoided[port] = true;
+        filters[1].forbiddenPorts[i] = portName(port);
+    }
+    filters[1].forbiddenPortsCount = BENCH_AVOIDED_PORTS;
+    filters[2] = filters[1];
+    filters[2].allowedCompanies[0] = COMPANY_NAMES[0];
+    filters[2].allowedCompanies[1] = COMPANY_NAMES[2];
+    filters[2].allowedCompaniesCount = 2;
+    report.filterCount = BENCH_FILTER_COUNT;
+
+    CustomizableHierarchy cch;
+    buildCustomizableHierarchy(g, cch, report.hierarchy);
+
+    // Each filter's metric goes into the cache, and its port arcs are
+    // collapsed, before the timed queries
+    HierarchyMetricCache cache;
+    PortArcs arcs[BENCH_FILTER_COUNT];
+    for (int f = 0; f < BENCH_FILTER_COUNT; f++) {
+        started = chrono::steady_clock::now();
+        releaseHierarchyMetric(cache, acquireHierarchyMetric(g, cch, cache, PORT_ARCS_CHEAPEST, &filters[f]));
+        report.customizeSeconds += chrono::duration<double>(chrono::steady_clock::now() - started).count();
+
+        started = chrono::steady_clock::now();
+        FrozenGraphPin pin(g);
+        buildPortArcs(g, *pin.fg, arcs[f], &filters[f]);
+        report.portArcSeconds += chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    }
+
+    CustomizedQuery cq;
+    OneToAllWorkspace ows;
+    initOneToAllWorkspace(ows, g.portCount);
+    SearchWorkspace workspaces[FILTERED_ENGINE_COUNT];
+    EngineTiming warmUp;
+    unsigned int warmState = options.seed * 2246822519u + 1;
+    for (int w = 0; w < BENCH_WARM_UP_QUERIES; w++) {
+        int origin = (int)(nextRandom(warmState) % g.portCount);
+        int destination = (int)(nextRandom(warmState) % g.portCount);
+        int f = w % BENCH_FILTER_COUNT;
+        for (int e = 0; e < FILTERED_ENGINE_COUNT; e++) {
+            runFilteredEngine(e, g, cch, cache, cq, arcs[f], ows, workspaces[e], filters[f], portName(origin), portName(destination), warmUp);
+        }
+    }
+    long long warmGrowths[FILTERED_ENGINE_COUNT];
+    for (int e = 0; e < FILTERED_ENGINE_COUNT; e++) {
+        warmGrowths[e] = workspaces[e].growths;
+    }
+
+    int values[FILTERED_ENGINE_COUNT];
+    for (int q = 0; q < options.queryCount; q++) {
+        int origin = (int)(nextRandom(state) % g.portCount);
+        int destination = (int)(nextRandom(state) % g.portCount);
+        if (origin == destination || avoided[origin] || avoided[destination]) continue;
+
+        int f = q % BENCH_FILTER_COUNT;
+        for (int e = 0; e < FILTERED_ENGINE_COUNT; e++) {
+            values[e] = runFilteredEngine(e, g, cch, cache, cq, arcs[f], ows, workspaces[e], filters[f], portName(origin), portName(destination), report.engines[e]);
+        }
+        int kernelFare = values[FILTERED_KERNEL];
+        int customizedFare = values[FILTERED_CUSTOMIZED];
+        if (customizedFare != values[FILTERED_PORT_ARCS]) report.customizedMismatches++;
+        if (kernelFare >= 0 && (customizedFare < 0 || customizedFare > kernelFare)) report.customizedDearer++;
+        report.queryCount++;
+    }
+    for (int e = 0; e < FILTERED_ENGINE_COUNT; e++) {
+        report.engines[e].growths = workspaces[e].growths - warmGrowths[e];
+    }
+    report.cacheHits = cache.hits;
+    report.cacheMisses = cache.misses;
+
+    delete[] avoided;
+    freeOneToAllWorkspace(ows);
+    freeCustomizedQuery(cq);
+    for (int f = 0; f < BENCH_FILTER_COUNT; f++) {
+        freePortArcs(arcs[f]);
+    }
+    freeHierarchyMetricCache(cache);
+    freeCustomizableHierarchy(cch);
+    freeGraph(g);
+}
+
+void printFilteredBenchmarkReport(const FilteredBenchmarkReport& report) {
+    cout << "Filtered benchmark: " << report.portCount << " ports, " << report.sailingCount << " sailings (built in "
+         << report.buildSeconds * 1000.0 << " ms), " << report.queryCount << " queries over " << report.filterCount << " filters." << endl;
+    cout << "  ";
+    printCustomizableHierarchyStats(report.hierarchy);
+    cout << "  Metrics customized in " << report.customizeSeconds * 1000.0 << " ms (" << report.cacheMisses << " cache miss(es), "
+         << report.cacheHits << " hit(s)); port arcs collapsed in " << report.portArcSeconds * 1000.0 << " ms." << endl;
+    for (int e = 0; e < FILTERED_ENGINE_COUNT; e++) {
+        printEngineTiming(report.engines[e], report.queryCount);
+    }
+    cout << "  Customized hierarchy: " << report.customizedMismatches << " fare(s) unlike the port-arc Dijkstra's, "
+         << report.customizedDearer << " above the kernel's"
+         << (report.customizedMismatches + report.customizedDearer > 0 ? " <- should be 0" : "") << "." << endl;
+}
+
+// FNV-1a over the three tables, so runs can be compared without keeping
+// a second matrix in memory
+static unsigned long long hashRouteMatrix(const RouteMatrix& m) {
+    size_t cells = (size_t)m.portCount * m.portCount;
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < cells; i++) {
+        hash = (hash ^ (unsigned int)m.cost[i]) * 1099511628211ULL;
+        hash = (hash ^ (unsigned int)m.minutes[i]) * 1099511628211ULL;
+        hash = (hash ^ m.legs[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+void runMatrixBenchmark(const SearchBenchmarkOptions& options, int maxThreads, MatrixBenchmarkReport& report) {
+    report = MatrixBenchmarkReport();
+    if (maxThreads <= 0) {
+        maxThreads = (int)thread::hardware_concurrency();
+        if (maxThreads <= 0) maxThreads = 1;
+    }
+
+    Graph g;
+    buildSyntheticTimetable(g, options.portCount, options.sailingCount, options.days, options.seed, options.crossingReach);
+    report.portCount = g.portCount;
+    {
+        FrozenGraphPin pin(g);
+        report.sailingCount = pin.fg->edgeCount;
+    }
+
+    unsigned long long firstHash = 0;
+    for (int threads = 1; report.runCount < MATRIX_BENCHMARK_MAX_RUNS; threads *= 2) {
+        if (threads > maxThreads) threads = maxThreads;
+        RouteMatrix m;
+        RouteMatrixStats& stats = report.runs[report.runCount];
+        if (!buildRouteMatrix(g, m, stats, threads)) break;
+        unsigned long long hash = hashRouteMatrix(m);
+        if (report.runCount == 0) {
+            firstHash = hash;
+        } else if (hash != firstHash) {
+            report.tableMismatches++;
+        }
+        freeRouteMatrix(m);
+        report.runCount++;
+        if (threads == maxThreads) break;
+    }
+
+    freeGraph(g);
+}
+
+void printMatrixBenchmarkReport(const MatrixBenchmarkReport& report) {
+    cout << "Matrix benchmark: " << report.portCount << " ports, " << report.sailingCount << " sailings, "
+         << report.runCount << " build(s)." << endl;
+    double oneThread = report.runCount > 0 ? report.runs[0].seconds : 0.0;
+    for (int r = 0; r < report.runCount; r++) {
+        const RouteMatrixStats& stats = report.runs[r];
+        cout << "  " << stats.threadCount << " thread(s): " << stats.seconds * 1000.0 << " ms wall, "
+             << (long long)stats.originsPerSecond << " origins/s";
+        if (r > 0 && stats.seconds > 0.0) cout << ", " << oneThread / stats.seconds << "x the 1-thread build";
+        cout << "." << endl;
+    }
+    cout << "  " << report.tableMismatches << " build(s) with tables unlike the 1-thread one"
+         << (report.tableMismatches > 0 ? " <- should be 0" : "") << "." << endl;
+}
@@ -0,0 +1,174 @@
+#ifndef SEARCH_BENCHMARK_H
+#define SEARCH_BENCHMARK_H
+
+#include "Graph.h"
+#include "SearchKernel.h"
+#include "ContractionHierarchy.h"
+#include "CustomizableHierarchy.h"
+#include "RouteMatrix.h"
+
+using namespace std;
+
+// Engines timed by runSearchBenchmark, in report order. The last four
+// answer the date-agnostic cheapest query: the kernel on each of its
+// queues, the bidirectional search, then the contraction hierarchy.
+enum SearchBenchmarkEngine {
+    BENCH_EARLIEST_ARRIVAL,
+    BENCH_EARLIEST_ARRIVAL_CSA,
+    BENCH_CHEAPEST_DIJKSTRA,
+    BENCH_CHEAPEST_ASTAR,
+    BENCH_CHEAPEST_IN_WINDOW_CSA,
+    BENCH_UNDATED_HEAP,
+    BENCH_UNDATED_BUCKETS,
+    BENCH_UNDATED_BIDIRECTIONAL,
+    BENCH_UNDATED_HIERARCHY,
+    BENCH_ENGINE_COUNT
+};
+
+// crossingReach limits crossings to ports at most that many places round
+// the ring; 0 lets them join any two ports
+struct SearchBenchmarkOptions {
+    int portCount;
+    int sailingCount;
+    int days;
+    int queryCount;
+    int crossingReach;
+    unsigned int seed;
+
+    SearchBenchmarkOptions() : portCount(20000), sailingCount(600000), days(30), queryCount(200), crossingReach(0), seed(1) {}
+};
+
+// growths is how often the engine's workspace had to allocate after its
+// warm-up queries; anything but 0 means a search in the timed run did.
+// heap sums the queue counters of every query, except peakSize and
+// buckets, which are the largest any one query reached (buckets stays 0
+// for engines that only ran on a heap).
+struct EngineTiming {
+    const char* name;
+    int found;
+    long long nodesExpanded;
+    double seconds;
+    long long growths;
+    HeapCounters heap;
+
+    EngineTiming() : name(""), found(0), nodesExpanded(0), seconds(0.0), growths(0) {}
+};
+
+// Both earliest-arrival engines must agree on every arrival, Dijkstra and
+// A* on every fare, and the undated search on the same fare whichever
+// queue it ran on; the mismatch counts say how often they did not. The
+// bidirectional search keeps every undominated label, so it must never
+// find a dearer route than the kernel (bidirectionalDearer) and finds a
+// cheaper one whenever the kernel's single label per port was not enough
+// (bidirectionalCheaper).
+// The hierarchy has no leg limit and searches the same cheapest arcs, so
+// it must never be dearer than the kernel either (hierarchyDearer).
+// hierarchy holds the build statistics, build time and core size included.
+// cheapestMissed counts pairs the time-dependent search reached but the
+// one-label-per-port Dijkstra did not, the gap it leaves on timetables
+// this large.
+struct SearchBenchmarkReport {
+    int portCount;
+    int sailingCount;
+    int queryCount;
+    double buildSeconds;
+    EngineTiming engines[BENCH_ENGINE_COUNT];
+    int arrivalMismatches;
+    int costMismatches;
+    int queueMismatches;
+    int bidirectionalDearer;
+    int bidirectionalCheaper;
+    int hierarchyDearer;
+    int cheapestMissed;
+    HierarchyStats hierarchy;
+
+    SearchBenchmarkReport() : portCount(0), sailingCount(0), queryCount(0), buildSeconds(0.0), arrivalMismatches(0), costMismatches(0),
+                              queueMismatches(0), bidirectionalDearer(0), bidirectionalCheaper(0), hierarchyDearer(0),
+                              cheapestMissed(0) {}
+};
+
+// Ports P0..P(portCount-1) joined in a ring by coastal sailings, plus
+// random crossings between any two ports (or, with crossingReach > 0,
+// between ports at most that far apart round the ring), spread over days
+// from 1 January 2024. The same seed always gives the same timetable. The
+// graph is frozen on return.
+void buildSyntheticTimetable(Graph& g, int portCount, int sailingCount, int days, unsigned int seed, int crossingReach = 0);
+
+// Builds a synthetic timetable and times every engine on the same random
+// port pairs, each leaving from the start of the timetable. Each engine
+// has its own workspace; the contraction hierarchy is built up front, and
+// the connection array, the landmarks and the workspaces are set up by
+// untimed warm-up queries.
+void runSearchBenchmark(const SearchBenchmarkOptions& options, SearchBenchmarkReport& report);
+
+void printSearchBenchmarkReport(const SearchBenchmarkReport& report);
+
+// Engines timed by runFilteredBenchmark on date-agnostic cheapest queries
+// under a company / avoided-port filter: the kernel's filtered Dijkstra,
+// Dijkstra over the filtered port arcs, then the customizable hierarchy
+// through its metric cache
+enum FilteredBenchmarkEngine {
+    FILTERED_KERNEL,
+    FILTERED_PORT_ARCS,
+    FILTERED_CUSTOMIZED,
+    FILTERED_ENGINE_COUNT
+};
+
+// The hierarchy and the port-arc Dijkstra search the same arcs, so their
+// fares must match (customizedMismatches); the kernel also needs legs to
+// connect in time and keeps to its leg limit, so the hierarchy must never
+// be dearer than it (customizedDearer). Each filter's metric is
+// customized once, before the timed queries, in customizeSeconds; every
+// timed query then pins it from the cache. portArcSeconds is the time
+// spent collapsing the timetable once per filter for the port-arc search.
+struct FilteredBenchmarkReport {
+    int portCount;
+    int sailingCount;
+    int queryCount;
+    int filterCount;
+    double buildSeconds;
+    EngineTiming engines[FILTERED_ENGINE_COUNT];
+    CustomizableHierarchyStats hierarchy;
+    double customizeSeconds;
+    double portArcSeconds;
+    long long cacheHits;
+    long long cacheMisses;
+    int customizedMismatches;
+    int customizedDearer;
+
+    FilteredBenchmarkReport() : portCount(0), sailingCount(0), queryCount(0), filterCount(0), buildSeconds(0.0), customizeSeconds(0.0),
+                                portArcSeconds(0.0), cacheHits(0), cacheMisses(0), customizedMismatches(0), customizedDearer(0) {}
+};
+
+// Builds a synthetic timetable and times the filtered engines on the same
+// random port pairs, each pair under one of a few filters in turn.
+// Random crossings leave no small separators, so the customizable
+// hierarchy fills in to nearly every pair unless crossingReach is set.
+void runFilteredBenchmark(const SearchBenchmarkOptions& options, FilteredBenchmarkReport& report);
+
+void printFilteredBenchmarkReport(const FilteredBenchmarkReport& report);
+
+// Thread counts one runMatrixBenchmark can time
+const int MATRIX_BENCHMARK_MAX_RUNS = 16;
+
+// One buildRouteMatrix per thread count, each run's stats holding its wall
+// time. Every run must fill the same tables as the first
+// (tableMismatches counts those that did not).
+struct MatrixBenchmarkReport {
+    int portCount;
+    int sailingCount;
+    int runCount;
+    RouteMatrixStats runs[MATRIX_BENCHMARK_MAX_RUNS];
+    int tableMismatches;
+
+    MatrixBenchmarkReport() : portCount(0), sailingCount(0), runCount(0), tableMismatches(0) {}
+};
+
+// Builds a synthetic timetable, then the all-pairs matrix on 1, 2, 4, ...
+// threads up to maxThreads (one per hardware thread if <= 0), which is
+// always the last count run
+void runMatrixBenchmark(const SearchBenchmarkOptions& options, int maxThreads, MatrixBenchmarkReport& report);
+
+void printMatrixBenchmarkReport(const MatrixBenchmarkReport& report);
+
+#endif
@@ -0,0 +1,166 @@
+#include "SearchKernel.h"
+
+using namespace std;
+
+template <typename T>
+static void regrow(T*& array, int count) {
+    delete[] array;
+    array = new T[count];
+}
+
+static void growSide(SearchSide& side, bool backward, int portCount) {
+    side.backward = backward;
+    regrow(side.head, portCount);
+    regrow(side.stamp, portCount);
+    for (int i = 0; i < portCount; i++) {
+        side.stamp[i] = 0;
+    }
+    if (!side.labels) {
+        side.labelCapacity = 64;
+        side.labels = new BidirectionalLabel[side.labelCapacity];
+    }
+    emptySearchHeap(side.open);
+}
+
+static void freeSide(SearchSide& side) {
+    delete[] side.labels;
+    delete[] side.head;
+    delete[] side.stamp;
+    clearSearchHeap(side.open);
+    side.labels = nullptr;
+    side.head = nullptr;
+    side.stamp = nullptr;
+    side.labelCount = 0;
+    side.labelCapacity = 0;
+}
+
+static void freeBags(ParetoBag*& bags, int count) {
+    if (!bags) return;
+    for (int i = 0; i < count; i++) {
+        delete[] bags[i].labels;
+    }
+    delete[] bags;
+    bags = nullptr;
+}
+
+template <typename Key>
+static void freeKernelBuffers(KernelBuffers<Key>& buffers) {
+    delete[] buffers.states;
+    buffers.states = nullptr;
+    buffers.stateCapacity = 0;
+    clearIndexedHeap(buffers.heap);
+    clearBucketQueue(buffers.buckets);
+}
+
+void prepareSearchWorkspace(SearchWorkspace& ws, const Graph& g) {
+    if (g.portCount > ws.portCapacity) {
+        // Leave room so a few ports added by updates do not regrow it all
+        int portCount = g.portCount + g.portCount / 4 + 16;
+        regrow(ws.valueStamp, portCount);
+        regrow(ws.value, portCount);
+        regrow(ws.doneStamp, portCount);
+        regrow(ws.parentEdge, portCount);
+        regrow(ws.parentPort, portCount);
+        regrow(ws.estimateStamp, portCount);
+        regrow(ws.estimate, portCount);
+        regrow(ws.onPath, portCount);
+        regrow(ws.portForbidden, portCount);
+        for (int i = 0; i < portCount; i++) {
+            ws.valueStamp[i] = 0;
+            ws.doneStamp[i] = 0;
+            ws.estimateStamp[i] = 0;
+            ws.onPath[i] = false;
+        }
+        if (ws.intLabels.stateCapacity < portCount) {
+            regrow(ws.intLabels.states, portCount);
+            ws.intLabels.stateCapacity = portCount;
+        }
+        freeBags(ws.paretoBags, ws.portCapacity);
+        ws.paretoBags = new ParetoBag[portCount];
+        growSide(ws.forward, false, portCount);
+        growSide(ws.backward, true, portCount);
+        resetIndexedHeap(ws.arrivals, portCount);
+        resetIndexedHeap(ws.intLabels.heap, portCount);
+        ws.portCapacity = portCount;
+        ws.growths++;
+    }
+
+    if (g.companyCount > ws.companyCapacity) {
+        int companyCount = g.companyCount + g.companyCount / 4 + 16;
+        regrow(ws.companyAllowed, companyCount);
+        ws.companyCapacity = companyCount;
+        ws.growths++;
+    }
+
+    if (ws.pathCapacity < 64) {
+        workspacePath(ws, 64);
+    }
+}
+
+int* workspacePath(SearchWorkspace& ws, int length) {
+    if (length > ws.pathCapacity) {
+        int capacity = ws.pathCapacity > 0 ? ws.pathCapacity : 64;
+        while (capacity < length) {
+            capacity *= 2;
+        }
+        regrow(ws.pathEdges, capacity);
+        ws.pathCapacity = capacity;
+        ws.growths++;
+    }
+    return ws.pathEdges;
+}
+
+void freeSearchWorkspace(SearchWorkspace& ws) {
+    delete[] ws.valueStamp;
+    delete[] ws.value;
+    delete[] ws.doneStamp;
+    delete[] ws.parentEdge;
+    delete[] ws.parentPort;
+    delete[] ws.estimateStamp;
+    delete[] ws.estimate;
+    delete[] ws.onPath;
+    delete[] ws.portForbidden;
+    delete[] ws.companyAllowed;
+    delete[] ws.pathEdges;
+    ws.valueStamp = nullptr;
+    ws.value = nullptr;
+    ws.doneStamp = nullptr;
+    ws.parentEdge = nullptr;
+    ws.parentPort = nullptr;
+    ws.estimateStamp = nullptr;
+    ws.estimate = nullptr;
+    ws.onPath = nullptr;
+    ws.portForbidden = nullptr;
+    ws.companyAllowed = nullptr;
+    ws.pathEdges = nullptr;
+    ws.pathCapacity = 0;
+    delete[] ws.windowLabels;
+    delete[] ws.paretoLabels;
+    delete[] ws.marked;
+    delete[] ws.nextMarked;
+    ws.windowLabels = nullptr;
+    ws.paretoLabels = nullptr;
+    ws.marked = nullptr;
+    ws.nextMarked = nullptr;
+    ws.windowLabelCapacity = 0;
+    ws.paretoLabelCapacity = 0;
+    ws.markedCapacity = 0;
+    ws.nextMarkedCapacity = 0;
+    clearSearchHeap(ws.pending);
+    freeBags(ws.paretoBags, ws.portCapacity);
+    freeKernelBuffers(ws.intLabels);
+    clearIndexedHeap(ws.arrivals);
+    freeSide(ws.forward);
+    freeSide(ws.backward);
+    ws.portCapacity = 0;
+    ws.companyCapacity = 0;
+}
+
+SearchWorkspace::~SearchWorkspace() {
+    freeSearchWorkspace(*this);
+}
+
+SearchWorkspace& threadSearchWorkspace() {
+    static thread_local SearchWorkspace workspace;
+    return workspace;
+}
@@ -0,0 +1,979 @@
+#ifndef SEARCH_KERNEL_H
+#define SEARCH_KERNEL_H
+
+#include <string>
+#include <limits.h>
+#include "Graph.h"
+#include "Journey.h"
+#include "RoutePreferences.h"
+#include "SearchTrace.h"
+
+using namespace std;
+
+// Binary min-heap of plain entries. Before::before(a, b) is true when a
+// must come out first; the array doubles when full.
+template <typename Entry, typename Before>
+struct SearchHeap {
+    Entry* items;
+    int size;
+    int capacity;
+
+    SearchHeap() : items(nullptr), size(0), capacity(0) {}
+};
+
+template <typename Entry, typename Before>
+inline void initSearchHeap(SearchHeap<Entry, Before>& heap, int capacity) {
+    heap.capacity = capacity > 0 ? capacity : 1;
+    heap.size = 0;
+    heap.items = new Entry[heap.capacity];
+}
+
+template <typename Entry, typename Before>
+inline void clearSearchHeap(SearchHeap<Entry, Before>& heap) {
+    delete[] heap.items;
+    heap.items = nullptr;
+    heap.size = 0;
+    heap.capacity = 0;
+}
+
+// Empties heap, keeping its array for the next search
+template <typename Entry, typename Before>
+inline void emptySearchHeap(SearchHeap<Entry, Before>& heap) {
+    heap.size = 0;
+}
+
+template <typename Entry, typename Before>
+inline void pushSearchHeap(SearchHeap<Entry, Before>& heap, const Entry& entry) {
+    if (heap.size >= heap.capacity) {
+        int newCap = heap.capacity > 0 ? heap.capacity * 2 : 64;
+        Entry* grown = new Entry[newCap];
+        for (int i = 0; i < heap.size; i++) {
+            grown[i] = heap.items[i];
+        }
+        delete[] heap.items;
+        heap.items = grown;
+        heap.capacity = newCap;
+    }
+    int idx = heap.size++;
+    while (idx > 0) {
+        int parent = (idx - 1) / 2;
+        if (!Before::before(entry, heap.items[parent])) break;
+        heap.items[idx] = heap.items[parent];
+        idx = parent;
+    }
+    heap.items[idx] = entry;
+}
+
+template <typename Entry, typename Before>
+inline bool popSearchHeap(SearchHeap<Entry, Before>& heap, Entry& out) {
+    if (heap.size == 0) return false;
+    out = heap.items[0];
+    Entry last = heap.items[--heap.size];
+    int idx = 0;
+    while (true) {
+        int child = 2 * idx + 1;
+        if (child >= heap.size) break;
+        if (child + 1 < heap.size && Before::before(heap.items[child + 1], heap.items[child])) child++;
+        if (!Before::before(heap.items[child], last)) break;
+        heap.items[idx] = heap.items[child];
+        idx = child;
+    }
+    if (heap.size > 0) heap.items[idx] = last;
+    return true;
+}
+
+// Work done by an IndexedHeap or BucketQueue during one search; buckets
+// is 0 unless a BucketQueue ran
+struct HeapCounters {
+    long long pushes;
+    long long decreases;
+    long long pops;
+    long long stalePops;
+    int peakSize;
+    int buckets;
+
+    HeapCounters() : pushes(0), decreases(0), pops(0), stalePops(0), peakSize(0), buckets(0) {}
+};
+
+// 4-ary min-heap holding at most one entry per id in [0, idCount).
+// Traits::before(a, b) orders entries and Traits::id(e) gives the dense id
+// (a port) an entry belongs to. position[id] is where that id sits in
+// items, or -1, so an improved label replaces the queued one in place
+// (decrease-key) instead of being pushed again. Both arrays are sized
+// once for idCount entries and reused after resetIndexedHeap.
+template <typename Entry, typename Traits>
+struct IndexedHeap {
+    Entry* items;
+    int* position;
+    int idCount;
+    int size;
+    HeapCounters counters;
+
+    IndexedHeap() : items(nullptr), position(nullptr), idCount(0), size(0) {}
+};
+
+template <typename Entry, typename Traits>
+inline void clearIndexedHeap(IndexedHeap<Entry, Traits>& heap) {
+    delete[] heap.items;
+    delete[] heap.position;
+    heap.items = nullptr;
+    heap.position = nullptr;
+    heap.idCount = 0;
+    heap.size = 0;
+}
+
+// Empties the heap and zeroes its counters, keeping the arrays if they
+// already cover idCount ids
+template <typename Entry, typename Traits>
+inline void resetIndexedHeap(IndexedHeap<Entry, Traits>& heap, int idCount) {
+    if (idCount > heap.idCount) {
+        clearIndexedHeap(heap);
+        heap.idCount = idCount;
+        heap.items = new Entry[idCount];
+        heap.position = new int[idCount];
+        for (int i = 0; i < idCount; i++) {
+            heap.position[i] = -1;
+        }
+    } else {
+        for (int i = 0; i < heap.size; i++) {
+            heap.position[Traits::id(heap.items[i])] = -1;
+        }
+    }
+    heap.size = 0;
+    heap.counters = HeapCounters();
+}
+
+template <typename Entry, typename Traits>
+inline bool indexedHeapContains(const IndexedHeap<Entry, Traits>& heap, int id) {
+    return heap.position[id] >= 0;
+}
+
+// The queued entry for id; only valid while indexedHeapContains(heap, id)
+template <typename Entry, typename Traits>
+inline const Entry& indexedHeapEntry(const IndexedHeap<Entry, Traits>& heap, int id) {
+    return heap.items[heap.position[id]];
+}
+
+template <typename Entry, typename Traits>
+inline void siftUpIndexed(IndexedHeap<Entry, Traits>& heap, int idx, const Entry& entry) {
+    while (idx > 0) {
+        int parent = (idx - 1) / 4;
+        if (!Traits::before(entry, heap.items[parent])) break;
+        heap.items[idx] = heap.items[parent];
+        heap.position[Traits::id(heap.items[idx])] = idx;
+        idx = parent;
+    }
+    heap.items[idx] = entry;
+    heap.position[Traits::id(entry)] = idx;
+}
+
+// Queues entry, or replaces the queued entry with the same id; the
+// replacement must not order after the entry it replaces
+template <typename Entry, typename Traits>
+inline void pushIndexedHeap(IndexedHeap<Entry, Traits>& heap, const Entry& entry) {
+    int pos = heap.position[Traits::id(entry)];
+    if (pos >= 0) {
+        heap.counters.decreases++;
+        siftUpIndexed(heap, pos, entry);
+        return;
+    }
+    heap.counters.pushes++;
+    siftUpIndexed(heap, heap.size++, entry);
+    if (heap.size > heap.counters.peakSize) heap.counters.peakSize = heap.size;
+}
+
+template <typename Entry, typename Traits>
+inline bool popIndexedHeap(IndexedHeap<Entry, Traits>& heap, Entry& out) {
+    if (heap.size == 0) return false;
+    heap.counters.pops++;
+    out = heap.items[0];
+    heap.position[Traits::id(out)] = -1;
+
+    Entry last = heap.items[--heap.size];
+    if (heap.size == 0) return true;
+    int idx = 0;
+    while (true) {
+        int first = 4 * idx + 1;
+        if (first >= heap.size) break;
+        int best = first;
+        int end = first + 4 < heap.size ? first + 4 : heap.size;
+        for (int c = first + 1; c < end; c++) {
+            if (Traits::before(heap.items[c], heap.items[best])) best = c;
+        }
+        if (!Traits::before(heap.items[best], last)) break;
+        heap.items[idx] = heap.items[best];
+        heap.position[Traits::id(heap.items[idx])] = idx;
+        idx = best;
+    }
+    heap.items[idx] = last;
+    heap.position[Traits::id(last)] = idx;
+    return true;
+}
+
+// Dial's bucket queue for integer keys that never drop below the last key
+// popped and never exceed it by more than maxStep, which holds in Dijkstra
+// when every weight is in [0, maxStep]. Key k lives in bucket
+// k % (maxStep + 1), so the buckets form a ring that a cursor sweeps
+// forward. Like IndexedHeap it holds at most one entry per id, kept in
+// items[id] and linked into its bucket through next/prev, so decrease-key
+// just moves the id to another bucket. Traits::key(e) gives the key.
+template <typename Entry, typename Traits>
+struct BucketQueue {
+    Entry* items;
+    int* next;
+    int* prev;
+    int* bucketOf;
+    int* head;
+    int idCount;
+    int bucketCount;
+    int bucketCapacity;
+    int size;
+    int cursor;
+    HeapCounters counters;
+
+    BucketQueue() : items(nullptr), next(nullptr), prev(nullptr), bucketOf(nullptr), head(nullptr),
+                    idCount(0), bucketCount(0), bucketCapacity(0), size(0), cursor(0) {}
+};
+
+// Widest step range a BucketQueue is used for; wider ranges use the heap
+const int BUCKET_QUEUE_MAX_BUCKETS = 1 << 16;
+
+template <typename Entry, typename Traits>
+inline void clearBucketQueue(BucketQueue<Entry, Traits>& q) {
+    delete[] q.items;
+    delete[] q.next;
+    delete[] q.prev;
+    delete[] q.bucketOf;
+    delete[] q.head;
+    q.items = nullptr;
+    q.next = nullptr;
+    q.prev = nullptr;
+    q.bucketOf = nullptr;
+    q.head = nullptr;
+    q.idCount = 0;
+    q.bucketCount = 0;
+    q.bucketCapacity = 0;
+    q.size = 0;
+}
+
+// Empties the queue for ids in [0, idCount) and steps of at most maxStep,
+// reusing the arrays when they are big enough
+template <typename Entry, typename Traits>
+inline void resetBucketQueue(BucketQueue<Entry, Traits>& q, int idCount, int maxStep) {
+    int bucketCount = maxStep + 1;
+    if (idCount > q.idCount) {
+        delete[] q.items;
+        delete[] q.next;
+        delete[] q.prev;
+        delete[] q.bucketOf;
+        q.items = new Entry[idCount];
+        q.next = new int[idCount];
+        q.prev = new int[idCount];
+        q.bucketOf = new int[idCount];
+        for (int i = 0; i < idCount; i++) {
+            q.bucketOf[i] = -1;
+        }
+        q.idCount = idCount;
+    } else {
+        for (int b = 0; b < q.bucketCount && q.size > 0; b++) {
+            for (int id = q.head[b]; id >= 0; id = q.next[id]) {
+                q.bucketOf[id] = -1;
+                q.size--;
+            }
+        }
+    }
+    if (bucketCount > q.bucketCapacity) {
+        delete[] q.head;
+        q.head = new int[bucketCount];
+        q.bucketCapacity = bucketCount;
+    }
+    for (int b = 0; b < bucketCount; b++) {
+        q.head[b] = -1;
+    }
+    q.bucketCount = bucketCount;
+    q.size = 0;
+    q.cursor = 0;
+    q.counters = HeapCounters();
+    q.counters.buckets = bucketCount;
+}
+
+template <typename Entry, typename Traits>
+inline bool bucketQueueContains(const BucketQueue<Entry, Traits>& q, int id) {
+    return q.bucketOf[id] >= 0;
+}
+
+template <typename Entry, typename Traits>
+inline const Entry& bucketQueueEntry(const BucketQueue<Entry, Traits>& q, int id) {
+    return q.items[id];
+}
+
+template <typename Entry, typename Traits>
+inline void unlinkBucketEntry(BucketQueue<Entry, Traits>& q, int id) {
+    int b = q.bucketOf[id];
+    if (q.prev[id] >= 0) q.next[q.prev[id]] = q.next[id];
+    else q.head[b] = q.next[id];
+    if (q.next[id] >= 0) q.prev[q.next[id]] = q.prev[id];
+    q.bucketOf[id] = -1;
+}
+
+// Queues entry, or moves the queued entry with the same id to the bucket
+// of its new key
+template <typename Entry, typename Traits>
+inline void pushBucketQueue(BucketQueue<Entry, Traits>& q, const Entry& entry) {
+    int id = Traits::id(entry);
+    if (q.bucketOf[id] >= 0) {
+        q.counters.decreases++;
+        unlinkBucketEntry(q, id);
+    } else {
+        q.counters.pushes++;
+        q.size++;
+        if (q.size > q.counters.peakSize) q.counters.peakSize = q.size;
+    }
+    // The cursor only has to stay at or below the smallest queued key
+    int key = Traits::key(entry);
+    if (q.size == 1 || key < q.cursor) q.cursor = key;
+    int b = key % q.bucketCount;
+    q.items[id] = entry;
+    q.bucketOf[id] = b;
+    q.prev[id] = -1;
+    q.next[id] = q.head[b];
+    if (q.head[b] >= 0) q.prev[q.head[b]] = id;
+    q.head[b] = id;
+}
+
+template <typename Entry, typename Traits>
+inline bool popBucketQueue(BucketQueue<Entry, Traits>& q, Entry& out) {
+    if (q.size == 0) return false;
+    int b = q.cursor % q.bucketCount;
+    while (q.head[b] < 0) {
+        q.cursor++;
+        if (++b == q.bucketCount) b = 0;
+    }
+    // Every queued key lies in [cursor, cursor + maxStep], so a bucket
+    // holds one key; Traits::before still orders the ties inside it
+    int id = q.head[b];
+    for (int other = q.next[id]; other >= 0; other = q.next[other]) {
+        if (Traits::before(q.items[other], q.items[id])) id = other;
+    }
+    out = q.items[id];
+    unlinkBucketEntry(q, id);
+    q.size--;
+    q.counters.pops++;
+    return true;
+}
+
+// The operations the search kernel needs, for either queue
+template <typename Entry, typename Traits>
+inline void resetQueue(IndexedHeap<Entry, Traits>& q, int idCount, int) { resetIndexedHeap(q, idCount); }
+template <typename Entry, typename Traits>
+inline void resetQueue(BucketQueue<Entry, Traits>& q, int idCount, int maxStep) { resetBucketQueue(q, idCount, maxStep); }
+
+template <typename Entry, typename Traits>
+inline void clearQueue(IndexedHeap<Entry, Traits>& q) { clearIndexedHeap(q); }
+template <typename Entry, typename Traits>
+inline void clearQueue(BucketQueue<Entry, Traits>& q) { clearBucketQueue(q); }
+
+template <typename Entry, typename Traits>
+inline void pushQueue(IndexedHeap<Entry, Traits>& q, const Entry& e) { pushIndexedHeap(q, e); }
+template <typename Entry, typename Traits>
+inline void pushQueue(BucketQueue<Entry, Traits>& q, const Entry& e) { pushBucketQueue(q, e); }
+
+template <typename Entry, typename Traits>
+inline bool popQueue(IndexedHeap<Entry, Traits>& q, Entry& out) { return popIndexedHeap(q, out); }
+template <typename Entry, typename Traits>
+inline bool popQueue(BucketQueue<Entry, Traits>& q, Entry& out) { return popBucketQueue(q, out); }
+
+template <typename Entry, typename Traits>
+inline bool queueContains(const IndexedHeap<Entry, Traits>& q, int id) { return indexedHeapContains(q, id); }
+template <typename Entry, typename Traits>
+inline bool queueContains(const BucketQueue<Entry, Traits>& q, int id) { return bucketQueueContains(q, id); }
+
+template <typename Entry, typename Traits>
+inline const Entry& queuedEntry(const IndexedHeap<Entry, Traits>& q, int id) { return indexedHeapEntry(q, id); }
+template <typename Entry, typename Traits>
+inline const Entry& queuedEntry(const BucketQueue<Entry, Traits>& q, int id) { return bucketQueueEntry(q, id); }
+
+// Which queue the date-agnostic searches run on. Buckets fall back to the
+// heap when the timetable's weights do not fit them.
+enum SearchQueueKind {
+    SEARCH_QUEUE_HEAP,
+    SEARCH_QUEUE_BUCKETS
+};
+
+// Cost metrics: what one sailing adds to a label, and the range of that
+// over a whole version
+struct FareMetric {
+    static int weight(const Sailing& s) { return s.voyageCost; }
+    static int minWeight(const FrozenGraph& fg) { return fg.minVoyageCost; }
+    static int maxWeight(const FrozenGraph& fg) { return fg.maxVoyageCost; }
+};
+
+struct DurationMetric {
+    static int weight(const Sailing& s) { return s.duration; }
+    static int minWeight(const FrozenGraph&) { return 0; }
+    static int maxWeight(const FrozenGraph& fg) { return fg.maxDuration; }
+};
+
+// True if a Dijkstra on Metric over fg can run on a BucketQueue
+template <typename Metric>
+inline bool bucketQueueFits(const FrozenGraph& fg) {
+    return Metric::minWeight(fg) >= 0 && Metric::maxWeight(fg) < BUCKET_QUEUE_MAX_BUCKETS;
+}
+
+// Heuristics: a lower bound on what is left from a port to the target.
+// Key is the type labels are ordered by.
+struct NoHeuristic {
+    typedef int Key;
+    int estimate(int) const { return 0; }
+};
+
+// Leg-limit policies. A limited search keeps labels that tie the best
+// known value, since one may have fewer legs or an earlier arrival than
+// the label it ties.
+struct UnlimitedLegs {
+    static const bool keepsEqualLabels = false;
+    bool allows(int) const { return true; }
+};
+
+struct LegLimit {
+    static const bool keepsEqualLabels = true;
+    int maxLegs;
+
+    explicit LegLimit(int limit) : maxLegs(limit) {}
+    bool allows(int legs) const { return legs <= maxLegs; }
+};
+
+// Preference filters: whether a sailing out of fromPort may be taken
+struct AcceptAllSailings {
+    bool allows(int, const Sailing&) const { return true; }
+};
+
+struct SearchWorkspace;
+
+// Company and port rules resolved to flags once per query, so the loop
+// never compares names. The flags are allocated per filter unless a
+// workspace lends its arrays.
+struct PreferenceFilter {
+    bool* portForbidden;
+    bool* companyAllowed;
+    bool ownsFlags;
+
+    PreferenceFilter(const Graph& g, const RoutePreferences& prefs) : ownsFlags(true) {
+        portForbidden = new bool[g.portCount > 0 ? g.portCount : 1];
+        companyAllowed = new bool[g.companyCount > 0 ? g.companyCount : 1];
+        setFlags(g, prefs);
+    }
+
+    // ws must have been prepared for g
+    PreferenceFilter(const Graph& g, const RoutePreferences& prefs, SearchWorkspace& ws);
+
+    ~PreferenceFilter() {
+        if (!ownsFlags) return;
+        delete[] portForbidden;
+        delete[] companyAllowed;
+    }
+
+    bool allows(int fromPort, const Sailing& s) const {
+        return companyAllowed[s.companyId] && !portForbidden[fromPort] && !portForbidden[s.destinationId];
+    }
+
+private:
+    void setFlags(const Graph& g, const RoutePreferences& prefs) {
+        for (int i = 0; i < g.portCount; i++) {
+            portForbidden[i] = prefs.forbiddenPortsCount > 0 && isPortForbidden(prefs, g.portById[i]->name);
+        }
+        for (int i = 0; i < g.companyCount; i++) {
+            companyAllowed[i] = isCompanyAllowed(prefs, g.companyNames[i]);
+        }
+    }
+
+    PreferenceFilter(const PreferenceFilter&);
+    PreferenceFilter& operator=(const PreferenceFilter&);
+};
+
+// True if prefs restricts companies or ports at all; otherwise a search
+// can run with AcceptAllSailings
+inline bool preferencesFilterSailings(const RoutePreferences* prefs) {
+    return prefs && (prefs->allowedCompaniesCount > 0 || prefs->forbiddenPortsCount > 0);
+}
+
+template <typename Key>
+struct KernelState {
+    int portIndex;
+    int value;
+    Key key;
+    int legCount;
+    int arrivalMinutes;
+    int parentStateIdx;
+    int edgeUsed;
+};
+
+// Of two labels with the same value at a port, the earlier arrival catches
+// more sailings; fewer legs breaks the remaining ties
+template <typename Key>
+inline bool kernelTieBetter(const KernelState<Key>& a, const KernelState<Key>& b) {
+    if (a.arrivalMinutes != b.arrivalMinutes) return a.arrivalMinutes < b.arrivalMinutes;
+    return a.legCount < b.legCount;
+}
+
+// Lower key first; equal keys go by kernelTieBetter and then port, so the
+// heap and the buckets settle labels in the same order
+template <typename Key>
+struct KernelStateOrder {
+    static bool before(const KernelState<Key>& a, const KernelState<Key>& b) {
+        if (a.key != b.key) return a.key < b.key;
+        if (kernelTieBetter(a, b)) return true;
+        if (kernelTieBetter(b, a)) return false;
+        return a.portIndex < b.portIndex;
+    }
+    static int id(const KernelState<Key>& s) { return s.portIndex; }
+    static int key(const KernelState<Key>& s) { return (int)s.key; }
+};
+
+// Earliest arrival keeps one label per port: with waiting allowed,
+// arriving somewhere earlier never rules out a connection that a later
+// arrival could make (the FIFO property), so the first time a port is
+// settled its arrival is final and no per-state bookkeeping is needed.
+struct ArrivalState {
+    int portIndex;
+    int arrivalMinutes;
+};
+
+struct ArrivalStateOrder {
+    static bool before(const ArrivalState& a, const ArrivalState& b) { return a.arrivalMinutes < b.arrivalMinutes; }
+    static int id(const ArrivalState& s) { return s.portIndex; }
+};
+
+// A label on one side of the bidirectional search. Forward labels carry
+// the arrival at port; backward labels the departure of the sailing that
+// carries on towards the destination. edge joins the label to parent, its
+// neighbour on the path. nextAtPort chains the live labels of port; a
+// label stops being alive when a better one at its port replaces it.
+struct BidirectionalLabel {
+    int port;
+    int value;
+    int legCount;
+    int minutes;
+    int parent;
+    int edge;
+    int nextAtPort;
+    bool alive;
+};
+
+struct SideEntry {
+    int value;
+    int label;
+};
+
+struct SideEntryBefore {
+    static bool before(const SideEntry& a, const SideEntry& b) {
+        if (a.value != b.value) return a.value < b.value;
+        return a.label < b.label;
+    }
+};
+
+// Every label made on one side during a query, so paths through replaced
+// labels stay intact. head[port] starts the chain of labels the port
+// holds, none of which is as good as another on value, legs and time,
+// but only while stamp[port] equals generation. open queues labels by
+// value; a label replaced while queued is skipped when it comes up, and
+// counters records the queue's work as an IndexedHeap would.
+struct SearchSide {
+    bool backward;
+    BidirectionalLabel* labels;
+    int labelCount;
+    int labelCapacity;
+    int* head;
+    unsigned int* stamp;
+    unsigned int generation;
+    SearchHeap<SideEntry, SideEntryBefore> open;
+    HeapCounters counters;
+
+    SearchSide() : backward(false), labels(nullptr), labelCount(0), labelCapacity(0), head(nullptr), stamp(nullptr), generation(0) {}
+};
+
+// A connection the window CSA relaxed and the relaxed connection it
+// continued from
+struct WindowLabel {
+    int connection;
+    int parent;
+};
+
+// Window CSA labels waiting for their port's layover to pass, keyed on readyAt
+struct PendingLabel {
+    int readyAt;
+    int port;
+    int cost;
+    int label;
+};
+
+struct PendingLabelBefore {
+    static bool before(const PendingLabel& a, const PendingLabel& b) { return a.readyAt < b.readyAt; }
+};
+
+// One Pareto itinerary prefix ending at port; parent is the label it extends
+struct ParetoLabel {
+    int cost;
+    int arrival;
+    int legs;
+    int port;
+    int edge;
+    int parent;
+    bool alive;
+};
+
+// Live Pareto labels at one port; none is beaten on both cost and arrival
+// by another with no more legs. count only holds while stamp matches the
+// workspace generation (see paretoBag).
+struct ParetoBag {
+    int* labels;
+    int count;
+    int capacity;
+    unsigned int stamp;
+
+    ParetoBag() : labels(nullptr), count(0), capacity(0), stamp(0) {}
+};
+
+// The kernel's labels and both of its queues for one key type. states
+// has room for stateCapacity labels and doubles whenever a search fills it,
+// so no label is ever dropped.
+template <typename Key>
+struct KernelBuffers {
+    KernelState<Key>* states;
+    int stateCapacity;
+    IndexedHeap<KernelState<Key>, KernelStateOrder<Key> > heap;
+    BucketQueue<KernelState<Key>, KernelStateOrder<Key> > buckets;
+
+    KernelBuffers() : states(nullptr), stateCapacity(0) {}
+};
+
+// Doubles the label array of b, keeping its first used labels
+template <typename Key>
+inline void growKernelStates(KernelBuffers<Key>& b, int used) {
+    int capacity = b.stateCapacity > 0 ? b.stateCapacity * 2 : 1024;
+    KernelState<Key>* grown = new KernelState<Key>[capacity];
+    for (int i = 0; i < used; i++) {
+        grown[i] = b.states[i];
+    }
+    delete[] b.states;
+    b.states = grown;
+    b.stateCapacity = capacity;
+}
+
+// Buffers one thread reuses for query after query, sized to the graph
+// when prepared and grown only when the graph gains ports or companies.
+// value[p] counts only while valueStamp[p] equals generation, so a search
+// starts with one increment instead of a pass over every port; doneStamp
+// and estimateStamp work the same way (the latter against
+// estimateGeneration, since a heuristic is set up before its search
+// starts). Queues are emptied in O(queued) by their own reset, and onPath
+// is left all false by the searches that use it. Label arrays (the
+// kernel's, the bidirectional sides', the CSA window's and Pareto's)
+// double whenever a search fills them and are kept for the next. growths counts the times any buffer had
+// to be (re)allocated.
+struct SearchWorkspace {
+    int portCapacity;
+    int companyCapacity;
+    unsigned int generation;
+    unsigned int estimateGeneration;
+    unsigned int* valueStamp;
+    int* value;
+    unsigned int* doneStamp;
+    int* parentEdge;
+    int* parentPort;
+    unsigned int* estimateStamp;
+    int* estimate;
+    bool* onPath;
+    bool* portForbidden;
+    bool* companyAllowed;
+    int* pathEdges;
+    int pathCapacity;
+    KernelBuffers<int> intLabels;
+    IndexedHeap<ArrivalState, ArrivalStateOrder> arrivals;
+    SearchSide forward;
+    SearchSide backward;
+    WindowLabel* windowLabels;
+    int windowLabelCapacity;
+    SearchHeap<PendingLabel, PendingLabelBefore> pending;
+    ParetoLabel* paretoLabels;
+    int paretoLabelCapacity;
+    ParetoBag* paretoBags;
+    int* marked;
+    int markedCapacity;
+    int* nextMarked;
+    int nextMarkedCapacity;
+    long long growths;
+
+    SearchWorkspace() : portCapacity(0), companyCapacity(0), generation(0), estimateGeneration(0), valueStamp(nullptr), value(nullptr),
+                        doneStamp(nullptr), parentEdge(nullptr), parentPort(nullptr), estimateStamp(nullptr), estimate(nullptr),
+                        onPath(nullptr), portForbidden(nullptr), companyAllowed(nullptr), pathEdges(nullptr), pathCapacity(0),
+                        windowLabels(nullptr), windowLabelCapacity(0), paretoLabels(nullptr), paretoLabelCapacity(0), paretoBags(nullptr),
+                        marked(nullptr), markedCapacity(0), nextMarked(nullptr), nextMarkedCapacity(0), growths(0) {}
+    ~SearchWorkspace();
+
+private:
+    SearchWorkspace(const SearchWorkspace&);
+    SearchWorkspace& operator=(const SearchWorkspace&);
+};
+
+// Makes ws cover every port and company of g; allocates nothing once it
+// does
+void prepareSearchWorkspace(SearchWorkspace& ws, const Graph& g);
+
+void freeSearchWorkspace(SearchWorkspace& ws);
+
+// The calling thread's own workspace, used by entry points given none
+SearchWorkspace& threadSearchWorkspace();
+
+inline SearchWorkspace& chooseWorkspace(SearchWorkspace* ws) {
+    return ws ? *ws : threadSearchWorkspace();
+}
+
+// Moves on to a fresh generation, so every stamp of the count stamps goes
+// stale; on wrap-around the stamps are cleared instead
+inline unsigned int nextGeneration(unsigned int& generation, unsigned int* stamps, int count) {
+    if (++generation == 0) {
+        for (int i = 0; i < count; i++) {
+            stamps[i] = 0;
+        }
+        generation = 1;
+    }
+    return generation;
+}
+
+// Starts a search: every port's value reads as INT_MAX, none is done and
+// every Pareto bag is empty
+inline void beginWorkspaceSearch(SearchWorkspace& ws) {
+    if (++ws.generation == 0) {
+        for (int i = 0; i < ws.portCapacity; i++) {
+            ws.valueStamp[i] = 0;
+            ws.doneStamp[i] = 0;
+            ws.paretoBags[i].stamp = 0;
+        }
+        ws.generation = 1;
+    }
+}
+
+inline int workspaceValue(const SearchWorkspace& ws, int port) {
+    return ws.valueStamp[port] == ws.generation ? ws.value[port] : INT_MAX;
+}
+
+inline void setWorkspaceValue(SearchWorkspace& ws, int port, int value) {
+    ws.value[port] = value;
+    ws.valueStamp[port] = ws.generation;
+}
+
+inline bool workspaceDone(const SearchWorkspace& ws, int port) {
+    return ws.doneStamp[port] == ws.generation;
+}
+
+inline void markWorkspaceDone(SearchWorkspace& ws, int port) {
+    ws.doneStamp[port] = ws.generation;
+}
+
+// Room for a path of length sailings, grown if need be
+int* workspacePath(SearchWorkspace& ws, int length);
+
+// Doubles items (starting at initial), keeping its first used entries
+template <typename T>
+inline void growWorkspaceArray(SearchWorkspace& ws, T*& items, int& capacity, int used, int initial = 64) {
+    int newCap = capacity > 0 ? capacity * 2 : initial;
+    T* grown = new T[newCap];
+    for (int i = 0; i < used; i++) {
+        grown[i] = items[i];
+    }
+    delete[] items;
+    items = grown;
+    capacity = newCap;
+    ws.growths++;
+}
+
+// The Pareto bag of port in the current search, emptied on first use
+inline ParetoBag& paretoBag(SearchWorkspace& ws, int port) {
+    ParetoBag& bag = ws.paretoBags[port];
+    if (bag.stamp != ws.generation) {
+        bag.count = 0;
+        bag.stamp = ws.generation;
+    }
+    return bag;
+}
+
+inline PreferenceFilter::PreferenceFilter(const Graph& g, const RoutePreferences& prefs, SearchWorkspace& ws)
+    : portForbidden(ws.portForbidden), companyAllowed(ws.companyAllowed), ownsFlags(false) {
+    setFlags(g, prefs);
+}
+
+inline KernelBuffers<int>& kernelBuffers(SearchWorkspace& ws, int) { return ws.intLabels; }
+
+template <typename Key>
+inline IndexedHeap<KernelState<Key>, KernelStateOrder<Key> >& kernelQueue(KernelBuffers<Key>& b, IndexedHeap<KernelState<Key>, KernelStateOrder<Key> >*) {
+    return b.heap;
+}
+template <typename Key>
+inline BucketQueue<KernelState<Key>, KernelStateOrder<Key> >& kernelQueue(KernelBuffers<Key>& b, BucketQueue<KernelState<Key>, KernelStateOrder<Key> >*) {
+    return b.buckets;
+}
+
+// Handed the sailings of the route found, in travel order. Results that
+// need the edge indices specialise it before instantiating the kernel
+template <typename Result>
+struct KernelPathKeeper {
+    static void keep(Result&, const int*, int) {}
+};
+
+// Label-setting search over the sailings of fg from originIdx to destIdx,
+// queued on Queue (IndexedHeap, or BucketQueue when there is no heuristic
+// and bucketQueueFits<Metric>).
+// Each label accumulates Metric::weight of its sailings and is ordered by
+// that plus heuristic.estimate(port); a leg may only follow one that
+// arrived at least 60 minutes earlier. Each port has at most one queued
+// label; a better one replaces it through decrease-key. Fills found,
+// totalCost (the fare of the route found), nodesExpanded, the trace,
+// heapCounters and journey in result, and returns the accumulated metric
+// at the destination (-1 if unreached). Labels, queue and path come from
+// ws, which must have been prepared for g; nothing is allocated for them
+// unless the labels outgrow their array, which then doubles.
+template <typename Metric, template <typename, typename> class Queue = IndexedHeap,
+          typename Heuristic, typename LegPolicy, typename Filter, typename Result>
+int runSearchKernel(Graph& g, const FrozenGraph& fg, const string& originPort, int originIdx, int destIdx,
+                    Heuristic& heuristic, const LegPolicy& legs, const Filter& filter, SearchWorkspace& ws, Result& result) {
+    typedef typename Heuristic::Key Key;
+    typedef KernelState<Key> State;
+
+    result.found = false;
+    result.totalCost = 0;
+    result.nodesExpanded = 0;
+    resetSearchTrace(result.trace);
+    result.heapCounters = HeapCounters();
+    clearJourney(result.journey);
+    initJourney(result.journey);
+
+    int portCount = fg.portCount;
+    if (originIdx < 0 || destIdx < 0 || originIdx >= portCount || destIdx >= portCount) return -1;
+
+    beginWorkspaceSearch(ws);
+    KernelBuffers<Key>& buffers = kernelBuffers(ws, Key());
+    State* allStates = buffers.states;
+    int stateCount = 0;
+
+    Queue<State, KernelStateOrder<Key> >& open = kernelQueue(buffers, (Queue<State, KernelStateOrder<Key> >*)nullptr);
+    resetQueue(open, portCount, Metric::maxWeight(fg));
+
+    State start;
+    start.portIndex = originIdx;
+    start.value = 0;
+    start.key = heuristic.estimate(originIdx);
+    start.legCount = 0;
+    start.arrivalMinutes = SEARCH_START_MINUTES;
+    start.parentStateIdx = -1;
+    start.edgeUsed = -1;
+    pushQueue(open, start);
+    setWorkspaceValue(ws, originIdx, 0);
+
+    int destStateIdx = -1;
+    State current;
+    while (popQueue(open, current)) {
+        if (current.value > workspaceValue(ws, current.portIndex) && current.portIndex != originIdx) {
+            open.counters.stalePops++;
+            continue;
+        }
+
+        if (stateCount >= buffers.stateCapacity) {
+            growKernelStates(buffers, stateCount);
+            allStates = buffers.states;
+            ws.growths++;
+        }
+        int currentStateIdx = stateCount;
+        allStates[stateCount++] = current;
+
+        if (current.portIndex == destIdx) {
+            result.found = true;
+            destStateIdx = currentStateIdx;
+            break;
+        }
+
+        result.nodesExpanded++;
+
+        const int edgeEnd = fg.firstEdge[current.portIndex + 1];
+        for (int e = firstDepartureFrom(fg, current.portIndex, current.arrivalMinutes + 60); e < edgeEnd; e++) {
+            const Sailing& edge = fg.edges[e];
+            if (!filter.allows(current.portIndex, edge)) continue;
+
+            int newLegCount = current.legCount + 1;
+            if (!legs.allows(newLegCount)) continue;
+
+            int neighborIdx = edge.destinationId;
+            int newValue = current.value + Metric::weight(edge);
+
+            traceEdge(result.trace, current.portIndex, neighborIdx);
+
+            int bestValue = workspaceValue(ws, neighborIdx);
+            bool tie = newValue == bestValue;
+            if (newValue < bestValue || (LegPolicy::keepsEqualLabels && tie)) {
+                setWorkspaceValue(ws, neighborIdx, newValue);
+
+                State next;
+                next.portIndex = neighborIdx;
+                next.value = newValue;
+                next.key = newValue + heuristic.estimate(neighborIdx);
+                next.legCount = newLegCount;
+                next.arrivalMinutes = sailingArrival(edge);
+                next.parentStateIdx = currentStateIdx;
+                next.edgeUsed = e;
+
+                // A tie only displaces a queued label it can outlast
+                if (tie && queueContains(open, neighborIdx)
+                    && !kernelTieBetter(next, queuedEntry(open, neighborIdx))) {
+                    continue;
+                }
+                pushQueue(open, next);
+            }
+        }
+    }
+
+    int destValue = -1;
+    if (destStateIdx >= 0) {
+        destValue = allStates[destStateIdx].value;
+
+        int n = allStates[destStateIdx].legCount;
+        int* pathEdges = workspacePath(ws, n);
+        int at = n;
+        for (int s = destStateIdx; s >= 0 && allStates[s].edgeUsed >= 0; s = allStates[s].parentStateIdx) {
+            pathEdges[--at] = allStates[s].edgeUsed;
+        }
+        KernelPathKeeper<Result>::keep(result, pathEdges, n);
+
+        string fromPort = originPort;
+        for (int i = 0; i < n; i++) {
+            Route* r = getRouteView(g, fg, pathEdges[i]);
+            result.totalCost += r->voyageCost;
+            appendLeg(result.journey,
+                fromPort,
+                r->destinationPort,
+                r->voyageDate,
+                r->departureTime,
+                r->arrivalTime,
+                r->voyageCost,
+                r->shippingCompany);
+            fromPort = r->destinationPort;
+        }
+    }
+
+    result.heapCounters = open.counters;
+    return destValue;
+}
+
+// Runs the kernel with the cheapest filter that honours prefs
+template <typename Metric, template <typename, typename> class Queue = IndexedHeap,
+          typename Heuristic, typename LegPolicy, typename Result>
+int searchWithPreferences(Graph& g, const FrozenGraph& fg, const string& originPort, int originIdx, int destIdx,
+                          Heuristic& heuristic, const LegPolicy& legs, const RoutePreferences* prefs, SearchWorkspace& ws, Result& result) {
+    if (preferencesFilterSailings(prefs)) {
+        PreferenceFilter filter(g, *prefs, ws);
+        return runSearchKernel<Metric, Queue>(g, fg, originPort, originIdx, destIdx, heuristic, legs, filter, ws, result);
+    }
+    AcceptAllSailings acceptAll;
+    return runSearchKernel<Metric, Queue>(g, fg, originPort, originIdx, destIdx, heuristic, legs, acceptAll, ws, result);
+}
+
+#endif
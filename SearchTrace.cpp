@@ -0,0 +1,22 @@
+#include "SearchTrace.h"
+
+using namespace std;
+
+void growSearchTrace(SearchTrace& trace) {
+    int newCap = trace.capacity > 0 ? trace.capacity * 2 : 256;
+    TracedEdge* grown = new TracedEdge[newCap];
+    for (int i = 0; i < trace.count; i++) {
+        grown[i] = trace.edges[i];
+    }
+    delete[] trace.edges;
+    trace.edges = grown;
+    trace.capacity = newCap;
+}
+
+void freeSearchTrace(SearchTrace& trace) {
+    delete[] trace.edges;
+    trace.edges = nullptr;
+    trace.count = 0;
+    trace.capacity = 0;
+    trace.offered = 0;
+}
@@ -0,0 +1,63 @@
+#ifndef SEARCH_TRACE_H
+#define SEARCH_TRACE_H
+
+using namespace std;
+
+// Building with -DSEARCH_TRACE_OFF compiles every traceEdge call out of
+// the searches; otherwise a search traces only when its result has a
+// trace attached.
+
+// One sailing a search looked at: its ports (ids) and when, counting
+// every edge offered to the trace, recorded or not
+struct TracedEdge {
+    int fromPort;
+    int toPort;
+    int order;
+};
+
+// Explored edges of one search in the order they were relaxed. Keeps
+// every sampleEvery-th edge offered (1 keeps all), stopping at limit
+// edges (0 for no limit). The buffer doubles when full and is kept by
+// resetSearchTrace, so a trace reused across searches stops allocating
+// once it has grown to fit.
+struct SearchTrace {
+    TracedEdge* edges;
+    int count;
+    int capacity;
+    int offered;
+    int sampleEvery;
+    int limit;
+
+    SearchTrace() : edges(nullptr), count(0), capacity(0), offered(0), sampleEvery(1), limit(0) {}
+};
+
+void growSearchTrace(SearchTrace& trace);
+
+void freeSearchTrace(SearchTrace& trace);
+
+// Empties trace for a new search; does nothing for a null trace
+inline void resetSearchTrace(SearchTrace* trace) {
+    if (!trace) return;
+    trace->count = 0;
+    trace->offered = 0;
+}
+
+inline void traceEdge(SearchTrace* trace, int fromPort, int toPort) {
+#ifndef SEARCH_TRACE_OFF
+    if (!trace) return;
+    int order = trace->offered++;
+    if (trace->sampleEvery > 1 && order % trace->sampleEvery != 0) return;
+    if (trace->limit > 0 && trace->count >= trace->limit) return;
+    if (trace->count >= trace->capacity) growSearchTrace(*trace);
+    TracedEdge& edge = trace->edges[trace->count++];
+    edge.fromPort = fromPort;
+    edge.toPort = toPort;
+    edge.order = order;
+#else
+    (void)trace;
+    (void)fromPort;
+    (void)toPort;
+#endif
+}
+
+#endif
@@ -3,6 +3,12 @@
 #include "AStarSearch.h"
 #include "SafestRouteSearch.h"
 #include "ShipAnimator.h"
+#include "RouteFeed.h"
+#include "ConnectionScan.h"
+#include "ParetoSearch.h"
+#include "KShortestPaths.h"
+#include "QueryCache.h"
+#include "CustomizableHierarchy.h"
 #include <SFML/Graphics.hpp>
 #include <iostream>
 #include <sstream>
@@ -16,6 +22,34 @@ static MapCalibration gMapCalib = {-0.0740f, 0.0520f, 1.0000f, 1.0000f};
 static sf::FloatRect gMapBounds;
 static ShipAnimator gShipAnimator;
 
+// Built on the first CSA search and kept until the timetable changes
+static ConnectionScan gConnectionScan;
+
+// A* landmark bounds, built on the first A* search and rebuilt by the
+// first one after the timetable changes
+static LandmarkIndex gLandmarks;
+
+// Results of the graph-wide strategies for the current timetable version
+static QueryCache gQueryCache;
+
+// The hierarchy main() built or loaded, and the arrays its queries reuse
+static ContractionHierarchy* gHierarchy = nullptr;
+static HierarchyQuery gHierarchyQuery;
+
+// Filtered hierarchy queries: the weight-free hierarchy, built on the
+// first one, and its metrics for each company / avoided-port filter
+static CustomizableHierarchy gCustomizable;
+static HierarchyMetricCache gMetricCache;
+static CustomizedQuery gCustomizedQuery;
+
+// How far past the travel date the date-aware searches (CSA, Pareto) look
+static const int SEARCH_WINDOW_DAYS = 30;
+
+// Ranked alternatives listed after a Dijkstra result, and the time allowed
+// to find them
+static const int RANKED_ALTERNATIVES = 5;
+static const double RANKED_ALTERNATIVES_BUDGET_MS = 30.0;
+
 sf::Vector2f geoToMapCoords(float lat, float lon) {
 
     float xNorm = (lon + 180.0f) / 360.0f;
@@ -231,6 +265,145 @@ bool journeyPassesPreferences(const UIState& state, const BookedJourney& journey
     return true;
 }
 
+static void fillStrategyResult(UIState::StrategyResult& out, const ParetoOption& option, int labelsCreated) {
+    out.valid = true;
+    out.cost = option.totalCost;
+    out.totalCost = option.totalCost;
+    out.legs = option.legs;
+    out.totalTime = calculateJourneyTravelTime(option.journey);
+    out.risk = 0;
+    out.route = buildRouteSummary(option.journey);
+    out.nodesExpanded = labelsCreated;
+}
+
+// Picks the cheapest and earliest-arriving options off the frontier;
+// options are already sorted cheapest first. The safest card comes from
+// the safest search itself, not from the frontier.
+static void fillParetoAnalytics(UIState& state, const ParetoResult& pareto) {
+    state.cheapestResult.valid = false;
+    state.fastestResult.valid = false;
+    state.paretoOptionCount = pareto.optionCount;
+    if (!pareto.found) return;
+
+    int fastest = 0;
+    for (int i = 1; i < pareto.optionCount; i++) {
+        if (pareto.options[i].arrivalMinutes < pareto.options[fastest].arrivalMinutes) fastest = i;
+    }
+
+    fillStrategyResult(state.cheapestResult, pareto.options[0], pareto.labelsCreated);
+    fillStrategyResult(state.fastestResult, pareto.options[fastest], pareto.labelsCreated);
+}
+
+// Fills the safest card from the lowest safety score found; risk is that
+// score, so lower is safer
+static void fillSafestResult(UIState& state, const SafeJourneyList& journeys) {
+    state.safestResult.valid = false;
+    if (journeys.count == 0) return;
+
+    int safest = 0;
+    for (int i = 1; i < journeys.count; i++) {
+        if (journeys.journeys[i].safetyScore < journeys.journeys[safest].safetyScore) safest = i;
+    }
+
+    const SafeJourney& journey = journeys.journeys[safest];
+    BookedJourney booked = buildJourneyFromSafeJourney(state.originPort, journey);
+    state.safestResult.valid = true;
+    state.safestResult.cost = journey.totalCost;
+    state.safestResult.totalCost = journey.totalCost;
+    state.safestResult.legs = journey.legCount;
+    state.safestResult.totalTime = calculateJourneyTravelTime(booked);
+    state.safestResult.risk = journey.safetyScore;
+    state.safestResult.route = buildRouteSummary(booked);
+    state.safestResult.nodesExpanded = journeys.count;
+    clearJourney(booked);
+}
+
+// Fills one row of the journey list from a booked journey
+static void fillJourneyInfo(UIState::JourneyInfo& info, int id, const BookedJourney& journey) {
+    info.id = id;
+    info.cost = journey.totalCost;
+    info.legs = journey.legCount;
+    info.route = buildRouteSummary(journey);
+    info.valid = true;
+
+    int legCount = journey.legCount;
+    if (legCount == 1) {
+        info.risk = 15 + (rand() % 10);
+    } else if (legCount == 2) {
+        info.risk = 30 + (rand() % 15);
+    } else if (legCount == 3) {
+        info.risk = 50 + (rand() % 20);
+    } else {
+        info.risk = 70 + (rand() % 20);
+    }
+
+    BookedLeg* leg = journey.head;
+    int legIdx = 0;
+    while (leg && legIdx < 5) {
+        info.schedule[legIdx].fromPort = leg->originPort;
+        info.schedule[legIdx].toPort = leg->destinationPort;
+        info.schedule[legIdx].company = leg->shippingCompany;
+        info.schedule[legIdx].cost = leg->voyageCost;
+        info.schedule[legIdx].depDay = leg->voyageDate.day;
+        info.schedule[legIdx].depMonth = leg->voyageDate.month;
+        info.schedule[legIdx].depYear = leg->voyageDate.year;
+        info.schedule[legIdx].depHour = leg->departureTime.hour;
+        info.schedule[legIdx].depMinute = leg->departureTime.minute;
+        info.schedule[legIdx].arrHour = leg->arrivalTime.hour;
+        info.schedule[legIdx].arrMinute = leg->arrivalTime.minute;
+
+        leg = leg->next;
+        legIdx++;
+    }
+}
+
+// True if both journeys take the same sailings
+static bool sameItinerary(const BookedJourney& a, const BookedJourney& b) {
+    if (a.legCount != b.legCount) return false;
+    const BookedLeg* x = a.head;
+    const BookedLeg* y = b.head;
+    while (x && y) {
+        if (x->originPort != y->originPort || x->destinationPort != y->destinationPort || x->shippingCompany != y->shippingCompany
+            || x->voyageDate.day != y->voyageDate.day || x->voyageDate.month != y->voyageDate.month || x->voyageDate.year != y->voyageDate.year
+            || x->departureTime.hour != y->departureTime.hour || x->departureTime.minute != y->departureTime.minute) return false;
+        x = x->next;
+        y = y->next;
+    }
+    return true;
+}
+
+// Rebuilds the hierarchy if sailings arrived since it was built or loaded
+static void refreshHierarchy(Graph& graph) {
+    unsigned long long version;
+    {
+        FrozenGraphPin pin(graph);
+        version = pin.fg->version;
+    }
+    if (gHierarchy->arcs && gHierarchy->graphVersion == version) return;
+    HierarchyStats stats;
+    buildContractionHierarchy(graph, *gHierarchy, stats);
+    printHierarchyStats(stats);
+}
+
+static void buildCustomizable(Graph& graph) {
+    CustomizableHierarchyStats stats;
+    buildCustomizableHierarchy(graph, gCustomizable, stats);
+    printCustomizableHierarchyStats(stats);
+}
+
+// The cached metric for the filter of prefs, pinned until released. A
+// sailing that links a pair the hierarchy lacks makes it build again.
+static const HierarchyMetric* acquireFilteredMetric(Graph& graph, const RoutePreferences* prefs) {
+    if (!gCustomizable.rank) buildCustomizable(graph);
+    const HierarchyMetric* metric = acquireHierarchyMetric(graph, gCustomizable, gMetricCache, PORT_ARCS_CHEAPEST, prefs);
+    if (metric) return metric;
+
+    freeHierarchyMetricCache(gMetricCache);
+    freeCustomizableHierarchy(gCustomizable);
+    buildCustomizable(graph);
+    return acquireHierarchyMetric(graph, gCustomizable, gMetricCache, PORT_ARCS_CHEAPEST, prefs);
+}
+
 // Executes selected pathfinding algorithm and stores results in UIState
 void performSearch(Graph& graph, JourneyManager& journeyManager, UIState& state) {
 
@@ -263,13 +436,29 @@ void performSearch(Graph& graph, JourneyManager& journeyManager, UIState& state)
     }
 
     if (state.strategy == UI_DIJKSTRA_COST || state.strategy == UI_DIJKSTRA_TIME ||
-        state.strategy == UI_ASTAR_COST || state.strategy == UI_ASTAR_TIME) {
+        state.strategy == UI_ASTAR_COST || state.strategy == UI_ASTAR_TIME ||
+        state.strategy == UI_CSA_COST || state.strategy == UI_CSA_TIME ||
+        state.strategy == UI_HIERARCHY_COST) {
+
+        bool isCsa = (state.strategy == UI_CSA_COST || state.strategy == UI_CSA_TIME);
 
-        cout << "\n========== GRAPH OPTIMIZATION SEARCH (Date-Agnostic) ==========\n";
+        cout << "\n========== GRAPH OPTIMIZATION SEARCH (" << (isCsa ? "Date-Aware" : "Date-Agnostic") << ") ==========\n";
         cout << "Strategy: " << (state.strategy == UI_DIJKSTRA_COST ? "Dijkstra (Cost)" :
                                  state.strategy == UI_DIJKSTRA_TIME ? "Dijkstra (Time)" :
-                                 state.strategy == UI_ASTAR_COST ? "A* (Cost)" : "A* (Time)") << "\n";
-        cout << "Mode: Pure graph shortest-path (ignoring dates)\n";
+                                 state.strategy == UI_ASTAR_COST ? "A* (Cost)" :
+                                 state.strategy == UI_ASTAR_TIME ? "A* (Time)" :
+                                 state.strategy == UI_CSA_COST ? "CSA (Cost)" :
+                                 state.strategy == UI_CSA_TIME ? "CSA (Time)" : "Hierarchy (Cost)") << "\n";
+        if (isCsa) {
+            cout << "Mode: Connection scan over the timetable from " << state.day << "/" << state.month << "/" << state.year << "\n";
+        } else if (state.strategy == UI_HIERARCHY_COST) {
+            cout << "Mode: Contraction hierarchy over the cheapest sailing between each pair of ports (ignoring dates and the leg limit)\n";
+            if (state.preferencesEnabled) {
+                cout << "  Filtered by company and avoided ports only, on the customizable hierarchy\n";
+            }
+        } else {
+            cout << "Mode: Pure graph shortest-path (ignoring dates)\n";
+        }
         cout << "Origin: " << state.originPort << " -> Destination: " << state.destPort << "\n";
 
         RoutePreferences prefs = convertToRoutePreferences(state);
@@ -299,8 +488,28 @@ void performSearch(Graph& graph, JourneyManager& journeyManager, UIState& state)
         }
 
         ShortestPathResult result;
+        result.trace = &state.exploration;
+
+        // A repeated search on the same timetable version is answered from
+        // the cache, explored edges included; only the CSA strategies depend
+        // on the travel date. The safest search below lists every itinerary
+        // and is not cached.
+        QueryKey queryKey;
+        queryKey.strategy = state.strategy;
+        queryKey.originPort = state.originPort;
+        queryKey.destPort = state.destPort;
+        if (isCsa) {
+            queryKey.date = {state.day, state.month, state.year};
+        }
+        queryKey.maxLegs = state.maxLegs;
+        queryKey.prefs = prefsPtr;
+        QueryCacheTicket cacheTicket;
+        bool cached = lookupQueryCache(gQueryCache, graph, queryKey, result, cacheTicket);
 
-        if (state.strategy == UI_DIJKSTRA_COST) {
+        if (cached) {
+            cout << "Result served from the query cache\n";
+        }
+        else if (state.strategy == UI_DIJKSTRA_COST) {
 
             findCheapestRouteIgnoringDates(graph, state.originPort, state.destPort, result, state.maxLegs, prefsPtr);
         }
@@ -308,35 +517,58 @@ void performSearch(Graph& graph, JourneyManager& journeyManager, UIState& state)
 
             findFastestRouteIgnoringDates(graph, state.originPort, state.destPort, result, state.maxLegs, prefsPtr);
         }
+        else if (state.strategy == UI_CSA_COST || state.strategy == UI_CSA_TIME) {
+
+            Date travelDate = {state.day, state.month, state.year};
+            if (state.strategy == UI_CSA_COST) {
+                findCheapestInWindowCSA(graph, gConnectionScan, state.originPort, state.destPort, travelDate, SEARCH_WINDOW_DAYS, result, prefsPtr);
+            } else {
+                Time midnight = {0, 0};
+                findEarliestArrivalCSA(graph, gConnectionScan, state.originPort, state.destPort, travelDate, midnight, result, prefsPtr);
+            }
+        }
+        else if (state.strategy == UI_HIERARCHY_COST) {
+
+            if (prefsPtr) {
+                // The contraction hierarchy is built over every sailing, so
+                // filtered searches use the customizable one, weighed once
+                // per filter
+                const HierarchyMetric* metric = acquireFilteredMetric(graph, prefsPtr);
+                if (metric) {
+                    findRouteCustomized(graph, gCustomizable, *metric, gCustomizedQuery, state.originPort, state.destPort, result);
+                }
+                releaseHierarchyMetric(gMetricCache, metric);
+            } else {
+                refreshHierarchy(graph);
+                findRouteHierarchy(graph, *gHierarchy, gHierarchyQuery, state.originPort, state.destPort, result);
+            }
+        }
         else if (state.strategy == UI_ASTAR_COST) {
 
             AStarResult astarRes;
-            findRouteAStar(graph, state.originPort, state.destPort, astarRes, prefsPtr);
+            astarRes.trace = result.trace;
+            findRouteAStar(graph, gLandmarks, state.originPort, state.destPort, astarRes, prefsPtr);
             result.found = astarRes.found;
             result.totalCost = astarRes.totalCost;
             result.nodesExpanded = astarRes.nodesExpanded;
-            result.exploredEdgeCount = astarRes.exploredEdgeCount;
-            for (int i = 0; i < astarRes.exploredEdgeCount; i++) {
-                result.exploredEdges[i].fromPort = astarRes.exploredEdges[i].fromPort;
-                result.exploredEdges[i].toPort = astarRes.exploredEdges[i].toPort;
-            }
             result.journey = astarRes.journey;
         }
         else {
 
             AStarResult astarRes;
-            findFastestRouteAStarIgnoringDates(graph, state.originPort, state.destPort, astarRes, state.maxLegs, prefsPtr);
+            astarRes.trace = result.trace;
+            findFastestRouteAStarIgnoringDates(graph, gLandmarks, state.originPort, state.destPort, astarRes, state.maxLegs, prefsPtr);
             result.found = astarRes.found;
             result.totalCost = astarRes.totalCost;
             result.nodesExpanded = astarRes.nodesExpanded;
-            result.exploredEdgeCount = astarRes.exploredEdgeCount;
-            for (int i = 0; i < astarRes.exploredEdgeCount; i++) {
-                result.exploredEdges[i].fromPort = astarRes.exploredEdges[i].fromPort;
-                result.exploredEdges[i].toPort = astarRes.exploredEdges[i].toPort;
-            }
             result.journey = astarRes.journey;
         }
 
+        if (!cached) {
+            storeQueryCache(gQueryCache, graph, cacheTicket, result);
+        }
+        printQueryCacheStats(getQueryCacheStats(gQueryCache));
+
         if (!result.found) {
             state.statusMessage = "No connecting path found (graph-wide search)";
             state.isError = true;
@@ -356,55 +588,35 @@ void performSearch(Graph& graph, JourneyManager& journeyManager, UIState& state)
 
         addJourney(journeyManager, result.journey);
 
-        state.totalExploredEdges = min(result.exploredEdgeCount, 500);
-        for (int i = 0; i < state.totalExploredEdges; i++) {
-            state.exploredEdges[i].fromPort = result.exploredEdges[i].fromPort;
-            state.exploredEdges[i].toPort = result.exploredEdges[i].toPort;
-        }
+        state.totalExploredEdges = state.exploration.count;
 
         state.hasResults = true;
         state.journeyListCount = 1;
         state.selectedJourneyIndex = 0;
 
-        UIState::JourneyInfo& info = state.journeyList[0];
-        info.id = 1;
-        info.cost = result.totalCost;
-        info.legs = result.journey.legCount;
-        info.route = buildRouteSummary(result.journey);
-        info.valid = true;
-        
-        int legCount = result.journey.legCount;
-        if (legCount == 1) {
-            info.risk = 15 + (rand() % 10);
-        } else if (legCount == 2) {
-            info.risk = 30 + (rand() % 15);
-        } else if (legCount == 3) {
-            info.risk = 50 + (rand() % 20);
-        } else {
-            info.risk = 70 + (rand() % 20);
-        }
-
-        BookedLeg* leg = result.journey.head;
-        int legIdx = 0;
-        while (leg && legIdx < 5) {
-            info.schedule[legIdx].fromPort = leg->originPort;
-            info.schedule[legIdx].toPort = leg->destinationPort;
-            info.schedule[legIdx].company = leg->shippingCompany;
-            info.schedule[legIdx].cost = leg->voyageCost;
-            info.schedule[legIdx].depDay = leg->voyageDate.day;
-            info.schedule[legIdx].depMonth = leg->voyageDate.month;
-            info.schedule[legIdx].depYear = leg->voyageDate.year;
-            info.schedule[legIdx].depHour = leg->departureTime.hour;
-            info.schedule[legIdx].depMinute = leg->departureTime.minute;
-            info.schedule[legIdx].arrHour = leg->arrivalTime.hour;
-            info.schedule[legIdx].arrMinute = leg->arrivalTime.minute;
+        fillJourneyInfo(state.journeyList[0], 1, result.journey);
 
-            leg = leg->next;
-            legIdx++;
+        // The next best itineraries by the same measure, as alternatives
+        if (state.strategy == UI_DIJKSTRA_COST || state.strategy == UI_DIJKSTRA_TIME) {
+            RankedRoutesResult ranked;
+            if (state.strategy == UI_DIJKSTRA_COST) {
+                findKCheapestRoutes(graph, state.originPort, state.destPort, RANKED_ALTERNATIVES + 1, ranked, state.maxLegs, prefsPtr, RANKED_ALTERNATIVES_BUDGET_MS);
+            } else {
+                findKFastestRoutes(graph, state.originPort, state.destPort, RANKED_ALTERNATIVES + 1, ranked, state.maxLegs, prefsPtr, RANKED_ALTERNATIVES_BUDGET_MS);
+            }
+            for (int i = 0; i < ranked.routeCount && state.journeyListCount < 20; i++) {
+                if (sameItinerary(ranked.routes[i].journey, result.journey)) continue;
+                addJourney(journeyManager, ranked.routes[i].journey);
+                fillJourneyInfo(state.journeyList[state.journeyListCount], state.journeyListCount + 1, ranked.routes[i].journey);
+                state.journeyListCount++;
+            }
+            cout << "Alternatives: " << state.journeyListCount - 1 << " ranked in " << ranked.seconds * 1000.0 << " ms"
+                 << (ranked.complete ? "" : " (time budget reached)") << "\n";
+            clearRankedRoutes(ranked);
         }
 
         state.journeyPortCount = 0;
-        leg = result.journey.head;
+        BookedLeg* leg = result.journey.head;
         if (leg) {
             state.journeyPorts[state.journeyPortCount++] = leg->originPort;
             while (leg && state.journeyPortCount < 50) {
@@ -422,7 +634,7 @@ void performSearch(Graph& graph, JourneyManager& journeyManager, UIState& state)
             state.cheapestResult.route = buildRouteSummary(result.journey);
             state.cheapestResult.nodesExpanded = result.nodesExpanded;
         }
-        else {
+        else if (state.strategy == UI_ASTAR_COST || state.strategy == UI_ASTAR_TIME) {
             state.astarResult.valid = true;
             state.astarResult.cost = result.totalCost;
             state.astarResult.totalCost = result.totalCost;
@@ -437,7 +649,8 @@ void performSearch(Graph& graph, JourneyManager& journeyManager, UIState& state)
 
         if (state.journeyPortCount > 1) {
             if ((state.strategy == UI_DIJKSTRA_COST || state.strategy == UI_DIJKSTRA_TIME ||
-                 state.strategy == UI_ASTAR_COST || state.strategy == UI_ASTAR_TIME) && state.totalExploredEdges > 0) {
+                 state.strategy == UI_ASTAR_COST || state.strategy == UI_ASTAR_TIME ||
+                 state.strategy == UI_CSA_COST || state.strategy == UI_CSA_TIME) && state.totalExploredEdges > 0) {
 
                 state.animState = UIState::ANIM_EXPLORING;
                 state.explorationAnimTime = 0.0f;
@@ -504,6 +717,8 @@ void performSearch(Graph& graph, JourneyManager& journeyManager, UIState& state)
         cout << "No safe route found within constraints" << endl;
     }
     
+    fillSafestResult(state, allJourneys);
+
     // Clean up
     clearSafeJourneyList(allJourneys);
 
@@ -597,32 +812,15 @@ void performSearch(Graph& graph, JourneyManager& journeyManager, UIState& state)
         node = node->next;
     }
 
-    ShortestPathResult dijkstraResult;
-    findCheapestRoute(graph, state.originPort, state.destPort, dijkstraResult);
-
-    state.cheapestResult.valid = dijkstraResult.found;
-    if (dijkstraResult.found) {
-        state.cheapestResult.cost = dijkstraResult.totalCost;
-        state.cheapestResult.totalCost = dijkstraResult.totalCost;
-        state.cheapestResult.legs = dijkstraResult.journey.legCount;
-        state.cheapestResult.totalTime = calculateJourneyTravelTime(dijkstraResult.journey);
-        state.cheapestResult.risk = 0;
-        state.cheapestResult.route = buildRouteSummary(dijkstraResult.journey);
-        state.cheapestResult.nodesExpanded = dijkstraResult.nodesExpanded;
-
-        if (state.strategy == UI_DIJKSTRA_COST || state.strategy == UI_DIJKSTRA_TIME) {
-            state.totalExploredEdges = min(dijkstraResult.exploredEdgeCount, 500);
-            for (int i = 0; i < state.totalExploredEdges; i++) {
-                state.exploredEdges[i].fromPort = dijkstraResult.exploredEdges[i].fromPort;
-                state.exploredEdges[i].toPort = dijkstraResult.exploredEdges[i].toPort;
-            }
-        }
-
-        clearJourney(dijkstraResult.journey);
-    }
+    // One multi-criteria pass fills the cheapest and fastest analytics
+    // instead of a separate search for each
+    ParetoResult pareto;
+    findParetoRoutes(graph, state.originPort, state.destPort, searchDate, SEARCH_WINDOW_DAYS, prefs, pareto);
+    fillParetoAnalytics(state, pareto);
+    clearParetoResult(pareto);
 
     AStarResult astarResult;
-    findRouteAStar(graph, state.originPort, state.destPort, astarResult);
+    findRouteAStar(graph, gLandmarks, state.originPort, state.destPort, astarResult);
 
     state.astarResult.valid = astarResult.found;
     if (astarResult.found) {
@@ -633,27 +831,10 @@ void performSearch(Graph& graph, JourneyManager& journeyManager, UIState& state)
         state.astarResult.risk = 0;
         state.astarResult.route = buildRouteSummary(astarResult.journey);
         state.astarResult.nodesExpanded = astarResult.nodesExpanded;
-
-        if (state.strategy == UI_ASTAR_COST || state.strategy == UI_ASTAR_TIME) {
-            state.totalExploredEdges = min(astarResult.exploredEdgeCount, 500);
-            for (int i = 0; i < state.totalExploredEdges; i++) {
-                state.exploredEdges[i].fromPort = astarResult.exploredEdges[i].fromPort;
-                state.exploredEdges[i].toPort = astarResult.exploredEdges[i].toPort;
-            }
-        }
-
-        clearJourney(astarResult.journey);
     }
+    clearJourney(astarResult.journey);
 
-    state.safestResult.valid = false;
-
-    if ((state.strategy == UI_DIJKSTRA_COST || state.strategy == UI_DIJKSTRA_TIME) && dijkstraResult.found) {
-
-        getJourneyPortSequence(dijkstraResult.journey, state.journeyPorts, state.journeyPortCount);
-    } else if ((state.strategy == UI_ASTAR_COST || state.strategy == UI_ASTAR_TIME) && astarResult.found) {
-
-        getJourneyPortSequence(astarResult.journey, state.journeyPorts, state.journeyPortCount);
-    } else if (journeyManager.head) {
+    if (journeyManager.head) {
         getJourneyPortSequence(journeyManager.head->journey, state.journeyPorts, state.journeyPortCount);
     }
 
@@ -695,10 +876,14 @@ void collectAllCompanies(Graph& graph, UIState& state) {
     string seen[50];
     int seenCount = 0;
 
+    FrozenGraphPin pin(graph);
+    const FrozenGraph& fg = *pin.fg;
     Port* port = graph.portHead;
     while (port && state.companyCount < 50) {
-        Route* route = port->routeHead;
-        while (route && state.companyCount < 50) {
+        for (int routeEdge = fg.firstEdge[port->id]; routeEdge < fg.firstEdge[port->id + 1] && state.companyCount < 50; routeEdge++) {
+            Route routeValue;
+            expandSailing(graph, fg, routeEdge, routeValue);
+            Route* route = &routeValue;
 
             bool alreadySeen = false;
             for (int i = 0; i < seenCount; i++) {
@@ -708,12 +893,11 @@ void collectAllCompanies(Graph& graph, UIState& state) {
                 }
             }
 
-            if (!alreadySeen && !route->shippingCompany.empty()) {
+            if (!alreadySeen && route->shippingCompany[0] != '\0') {
                 state.companyList[state.companyCount++] = route->shippingCompany;
                 seen[seenCount++] = route->shippingCompany;
             }
 
-            route = route->next;
         }
         port = port->next;
     }
@@ -1352,7 +1536,7 @@ private:
     }
 };
 
-void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
+void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager, ContractionHierarchy& hierarchy) {
 
     sf::RenderWindow window(sf::VideoMode(1920, 1000), "OceanRoute Navigator - Maritime Route Planning System", sf::Style::Default);
     window.setFramerateLimit(60);
@@ -1375,10 +1559,14 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
         dockingManager.initializePorts(portNamesForDocking, portCount);
 
         int shipCounter = 0;
+        FrozenGraphPin pin(graph);
+        const FrozenGraph& fg = *pin.fg;
         Port* port = graph.portHead;
         while (port && shipCounter < 100) {
-            Route* route = port->routeHead;
-            while (route && shipCounter < 100) {
+            for (int routeEdge = fg.firstEdge[port->id]; routeEdge < fg.firstEdge[port->id + 1] && shipCounter < 100; routeEdge++) {
+                Route routeValue;
+                expandSailing(graph, fg, routeEdge, routeValue);
+                Route* route = &routeValue;
                 DockingShip ship;
 
                 char shipId[50];
@@ -1395,12 +1583,11 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
 
                 int departureTime = 0;
 
-                ship.setData(shipId, route->shippingCompany.c_str(), (shipCounter % 3 == 0) ? "Container" : (shipCounter % 3 == 1) ? "Tanker" : "Bulk", port->name.c_str(), route->destinationPort.c_str(), route->voyageDate.day, route->voyageDate.month, route->voyageDate.year, departureTime, voyageDuration, serviceDuration);
+                ship.setData(shipId, route->shippingCompany, (shipCounter % 3 == 0) ? "Container" : (shipCounter % 3 == 1) ? "Tanker" : "Bulk", port->name, route->destinationPort, route->voyageDate.day, route->voyageDate.month, route->voyageDate.year, departureTime, voyageDuration, serviceDuration);
 
                 dockingManager.enqueueShip(ship);
 
                 shipCounter++;
-                route = route->next;
             }
             port = port->next;
         }
@@ -1501,9 +1688,23 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
 
     sf::Clock animClock;
 
+    // Sailings appended to Routes.txt while the UI runs become searchable
+    // on the next frame that sees them
+    RouteFeed routeFeed;
+    if (!openRouteFeed(routeFeed, "Routes.txt")) {
+        cout << "Warning: Could not follow Routes.txt (new sailings need a restart)\n";
+    }
+
+    initQueryCache(gQueryCache);
+    gHierarchy = &hierarchy;
+
     while (window.isOpen()) {
         bool clicked = false;
         sf::Vector2i mousePos = sf::Mouse::getPosition(window);
+
+        if (pollRouteFeed(graph, routeFeed) > 0) {
+            printRouteFeedStats(routeFeed.stats);
+        }
         float dt = animClock.restart().asSeconds();
         state.pulseTimer += dt;
 
@@ -2310,6 +2511,8 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
 
         if (state.currentView == VIEW_COMPANY_ROUTES) {
 
+            FrozenGraphPin pin(graph);
+            const FrozenGraph& fg = *pin.fg;
             Port* p = graph.portHead;
 
             unsigned int companyColors[] = {0xFF6B6BFF, 0x4ECDC4FF, 0xFFE66DFF, 0x95E1D3FF, 0xF38181FF, 0xAA96DAFF, 0xFCBAD3FF, 0xA8E6CFFF, 0xFF8B94FF, 0xC7CEAAFF, 0xFFD3B6FF, 0xDCEDC1FF};
@@ -2318,8 +2521,10 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
             while (p) {
                 float ox, oy;
                 if (getPortCoords(p->name, ox, oy)) {
-                    Route* r = p->routeHead;
-                    while (r) {
+                    for (int rEdge = fg.firstEdge[p->id]; rEdge < fg.firstEdge[p->id + 1]; rEdge++) {
+                        Route rValue;
+                        expandSailing(graph, fg, rEdge, rValue);
+                        Route* r = &rValue;
 
                         bool shouldDisplay = false;
                         int companyColorIdx = 0;
@@ -2405,11 +2610,13 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
 
                                     Port* destPort = graph.portHead;
                                     while (destPort != nullptr) {
-                                        if (destPort->name == r->destinationPort) {
+                                        if (destPort->id == r->destinationId) {
 
-                                            Route* connectingRoute = destPort->routeHead;
-                                            while (connectingRoute != nullptr) {
-                                                if (connectingRoute->shippingCompany == r->shippingCompany) {
+                                            for (int connectingRouteEdge = fg.firstEdge[destPort->id]; connectingRouteEdge < fg.firstEdge[destPort->id + 1]; connectingRouteEdge++) {
+                                                Route connectingRouteValue;
+                                                expandSailing(graph, fg, connectingRouteEdge, connectingRouteValue);
+                                                Route* connectingRoute = &connectingRouteValue;
+                                                if (connectingRoute->companyId == r->companyId) {
 
                                                     float cx, cy;
                                                     if (getPortCoords(connectingRoute->destinationPort, cx, cy)) {
@@ -2444,7 +2651,6 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
                                                     }
                                                     break;
                                                 }
-                                                connectingRoute = connectingRoute->next;
                                             }
                                             break;
                                         }
@@ -2454,7 +2660,6 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
                             }
                         }
 
-                        r = r->next;
                     }
                 }
                 p = p->next;
@@ -2462,12 +2667,16 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
         } else {
 
         if (state.showAllRoutes) {
+            FrozenGraphPin pin(graph);
+            const FrozenGraph& fg = *pin.fg;
             Port* p = graph.portHead;
             while (p) {
                 float ox, oy;
                 if (getPortCoords(p->name, ox, oy)) {
-                    Route* r = p->routeHead;
-                    while (r) {
+                    for (int rEdge = fg.firstEdge[p->id]; rEdge < fg.firstEdge[p->id + 1]; rEdge++) {
+                        Route rValue;
+                        expandSailing(graph, fg, rEdge, rValue);
+                        Route* r = &rValue;
                         float dx, dy;
                         if (getPortCoords(r->destinationPort, dx, dy)) {
                             float length = sqrt((dx-ox)*(dx-ox) + (dy-oy)*(dy-oy));
@@ -2480,7 +2689,6 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
                             routeLine.setFillColor(sf::Color(100, 120, 150, 50));
                             window.draw(routeLine);
                         }
-                        r = r->next;
                     }
                 }
                 p = p->next;
@@ -2540,8 +2748,9 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
 
             for (int i = 0; i < edgesToShow && i < state.totalExploredEdges; i++) {
                 float x1, y1, x2, y2;
-                if (getPortCoords(state.exploredEdges[i].fromPort, x1, y1) &&
-                    getPortCoords(state.exploredEdges[i].toPort, x2, y2)) {
+                const TracedEdge& explored = state.exploration.edges[i];
+                if (getPortCoords(graph.portById[explored.fromPort]->name, x1, y1) &&
+                    getPortCoords(graph.portById[explored.toPort]->name, x2, y2)) {
 
                     float length = sqrt((x2-x1)*(x2-x1) + (y2-y1)*(y2-y1));
                     float angle = atan2(y2-y1, x2-x1) * 180 / 3.14159f;
@@ -3482,7 +3691,7 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
 
                 ly += cardPrefH + 10;
 
-                float card4H = 150.0f;
+                float card4H = 220.0f;
                 drawCard(window, cardMargin, ly, cardWidth, card4H, Colors::ELECTRIC_BLUE);
                 drawSectionHeader(window, font, "ALGORITHM", cardMargin + 10, ly + 8, cardWidth - 20, Colors::ELECTRIC_BLUE);
 
@@ -3491,21 +3700,21 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
                 float btnW = (cardWidth - 35) / 2;
                 float btnH = 30;
 
-                const char* stratLabels[] = {"Dijkstra (Cost)", "Dijkstra (Time)", "A* (Cost)", "A* (Time)", "Safest Route"};
-                UIStrategy stratVals[] = {UI_DIJKSTRA_COST, UI_DIJKSTRA_TIME, UI_ASTAR_COST, UI_ASTAR_TIME, UI_SAFEST};
+                const char* stratLabels[] = {"Dijkstra (Cost)", "Dijkstra (Time)", "A* (Cost)", "A* (Time)", "CSA (Cost)", "CSA (Time)", "Hierarchy (Cost)", "Safest Route"};
+                UIStrategy stratVals[] = {UI_DIJKSTRA_COST, UI_DIJKSTRA_TIME, UI_ASTAR_COST, UI_ASTAR_TIME, UI_CSA_COST, UI_CSA_TIME, UI_HIERARCHY_COST, UI_SAFEST};
 
-                for (int i = 0; i < 5; i++) {
+                for (int i = 0; i < 8; i++) {
                     float bx, by;
                     float currentBtnW = btnW;
 
-                    if (i < 4) {
+                    if (i < 6) {
 
                         bx = cardMargin + 10 + (i % 2) * (btnW + 5);
                         by = cy + (i / 2) * (btnH + 5);
                     } else {
 
                         bx = cardMargin + 10;
-                        by = cy + 70;
+                        by = cy + 105 + (i - 6) * (btnH + 5);
                         currentBtnW = cardWidth - 20;
                     }
 
@@ -3513,8 +3722,8 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
                     bool hovered = mousePos.x >= bx && mousePos.x <= bx + currentBtnW &&
                                   mousePos.y >= by && mousePos.y <= by + btnH;
 
-                    unsigned int fillColor = selected ? Colors::HIGHLIGHT : (i == 4 ? 0x2a4a2aFF : 0x1a1a3aFF);
-                    unsigned int borderColor = selected ? Colors::ELECTRIC_BLUE : (i == 4 ? Colors::SUCCESS : Colors::INPUT_BORDER);
+                    unsigned int fillColor = selected ? Colors::HIGHLIGHT : (i == 7 ? 0x2a4a2aFF : 0x1a1a3aFF);
+                    unsigned int borderColor = selected ? Colors::ELECTRIC_BLUE : (i == 7 ? Colors::SUCCESS : Colors::INPUT_BORDER);
 
                     sf::RectangleShape btn(sf::Vector2f(currentBtnW, btnH));
                     btn.setPosition(bx, by);
@@ -3527,7 +3736,7 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
                     btnTxt.setStyle(selected ? sf::Text::Bold : sf::Text::Regular);
                     sf::FloatRect bounds = btnTxt.getLocalBounds();
                     btnTxt.setPosition(bx + (currentBtnW - bounds.width) / 2, by + 9);
-                    btnTxt.setFillColor(selected ? hexToColor(Colors::DARK_BG) : hexToColor(i == 4 ? Colors::SUCCESS : Colors::TEXT_SECONDARY));
+                    btnTxt.setFillColor(selected ? hexToColor(Colors::DARK_BG) : hexToColor(i == 7 ? Colors::SUCCESS : Colors::TEXT_SECONDARY));
                     window.draw(btnTxt);
 
                     if (hovered && clicked) {
@@ -3798,6 +4007,15 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
             } else if (state.strategy == UI_ASTAR_TIME) {
                 strategyName = "Strategy: A* (Time)";
                 stratColor = Colors::NEON_PURPLE;
+            } else if (state.strategy == UI_CSA_COST) {
+                strategyName = "Strategy: CSA (Cost)";
+                stratColor = Colors::ELECTRIC_BLUE;
+            } else if (state.strategy == UI_CSA_TIME) {
+                strategyName = "Strategy: CSA (Time)";
+                stratColor = Colors::ELECTRIC_BLUE;
+            } else if (state.strategy == UI_HIERARCHY_COST) {
+                strategyName = "Strategy: Hierarchy (Cost)";
+                stratColor = Colors::ELECTRIC_BLUE;
             } else if (state.strategy == UI_SAFEST) {
                 strategyName = "Strategy: Safest Route";
                 stratColor = Colors::LIME_GREEN;
@@ -3849,6 +4067,8 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
                     bool isDijkstraStrategy = (state.strategy == UI_DIJKSTRA_COST || state.strategy == UI_DIJKSTRA_TIME);
                     bool isAStarStrategy = (state.strategy == UI_ASTAR_COST || state.strategy == UI_ASTAR_TIME);
                     bool isSafestStrategy = (state.strategy == UI_SAFEST);
+                    bool isCsaStrategy = (state.strategy == UI_CSA_COST || state.strategy == UI_CSA_TIME);
+                    bool isHierarchyStrategy = (state.strategy == UI_HIERARCHY_COST);
 
                     float cardH = 135.0f;
                     drawCard(window, rx + cardMargin, contentY, cardW, cardH, Colors::SUCCESS);
@@ -3895,9 +4115,9 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
 
                         string nodesStr = "Nodes: " + to_string(state.cheapestResult.nodesExpanded);
                         drawText(window, font, nodesStr, rx + cardMargin + 15, contentY + 111, 9, Colors::TEXT_MUTED);
-                    } else if (isSafestStrategy || isAStarStrategy) {
+                    } else if (isSafestStrategy || isAStarStrategy || isCsaStrategy || isHierarchyStrategy) {
                         drawText(window, font, "Not evaluated", rx + cardMargin + 15, contentY + 50, 10, Colors::TEXT_MUTED);
-                        drawText(window, font, "(using " + string(isSafestStrategy ? "Safest" : "A*") + " strategy)",
+                        drawText(window, font, "(using " + string(isSafestStrategy ? "Safest" : isCsaStrategy ? "CSA" : isHierarchyStrategy ? "Hierarchy" : "A*") + " strategy)",
                                 rx + cardMargin + 15, contentY + 70, 9, Colors::TEXT_MUTED);
                     } else {
                         drawText(window, font, "No route found", rx + cardMargin + 15, contentY + 50, 10, Colors::TEXT_MUTED);
@@ -3949,9 +4169,9 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
 
                         string nodesStr = "Nodes: " + to_string(state.astarResult.nodesExpanded);
                         drawText(window, font, nodesStr, rx + cardMargin + 15, contentY + 111, 9, Colors::TEXT_MUTED);
-                    } else if (isSafestStrategy || isDijkstraStrategy) {
+                    } else if (isSafestStrategy || isDijkstraStrategy || isCsaStrategy || isHierarchyStrategy) {
                         drawText(window, font, "Not evaluated", rx + cardMargin + 15, contentY + 50, 10, Colors::TEXT_MUTED);
-                        drawText(window, font, "(using " + string(isSafestStrategy ? "Safest" : "Dijkstra") + " strategy)",
+                        drawText(window, font, "(using " + string(isSafestStrategy ? "Safest" : isCsaStrategy ? "CSA" : isHierarchyStrategy ? "Hierarchy" : "Dijkstra") + " strategy)",
                                 rx + cardMargin + 15, contentY + 70, 9, Colors::TEXT_MUTED);
                     } else {
                         drawText(window, font, "No route found", rx + cardMargin + 15, contentY + 50, 10, Colors::TEXT_MUTED);
@@ -3960,7 +4180,7 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
                     contentY += cardH + 15;
 
                     if (isSafestStrategy && state.safestResult.valid) {
-                        float safeCardH = 80;
+                        float safeCardH = 115;
                         drawCard(window, rx + cardMargin, contentY, cardW, safeCardH, Colors::INFO);
 
                         drawText(window, font, "SAFEST ROUTE", rx + cardMargin + 15, contentY + 12, 10, Colors::INFO, true);
@@ -3970,6 +4190,16 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
 
                         string legsStr = to_string(state.safestResult.legs) + " legs  |  Risk: " + to_string(state.safestResult.risk);
                         drawText(window, font, legsStr, rx + cardMargin + 15, contentY + 55, 9, Colors::TEXT_SECONDARY);
+
+                        if (state.cheapestResult.valid && state.fastestResult.valid) {
+                            int fastMins = state.fastestResult.totalTime;
+                            string frontierStr = "Cheapest $" + to_string(state.cheapestResult.totalCost) + "  |  Fastest " +
+                                                 to_string(fastMins / 60) + "h " + to_string(fastMins % 60) + "m";
+                            drawText(window, font, frontierStr, rx + cardMargin + 15, contentY + 73, 9, Colors::TEXT_SECONDARY);
+
+                            string optionsStr = to_string(state.paretoOptionCount) + " non-dominated option(s)";
+                            drawText(window, font, optionsStr, rx + cardMargin + 15, contentY + 91, 9, Colors::TEXT_MUTED);
+                        }
                     }
 
                     if (state.cheapestResult.valid && state.astarResult.valid &&
@@ -4610,7 +4840,10 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
             string stratName = (state.strategy == UI_DIJKSTRA_COST) ? "DIJKSTRA (COST)" :
                               (state.strategy == UI_DIJKSTRA_TIME) ? "DIJKSTRA (TIME)" :
                               (state.strategy == UI_ASTAR_COST) ? "A* (COST)" :
-                              (state.strategy == UI_ASTAR_TIME) ? "A* (TIME)" : "SAFEST";
+                              (state.strategy == UI_ASTAR_TIME) ? "A* (TIME)" :
+                              (state.strategy == UI_CSA_COST) ? "CSA (COST)" :
+                              (state.strategy == UI_CSA_TIME) ? "CSA (TIME)" :
+                              (state.strategy == UI_HIERARCHY_COST) ? "HIERARCHY (COST)" : "SAFEST";
 
             sf::RectangleShape stratBadge(sf::Vector2f(180.0f, 26.0f));
             stratBadge.setPosition(560.0f, (float)(WINDOW_HEIGHT - 38));
@@ -5955,5 +6188,15 @@ void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager) {
         window.display();
     }
 
+    closeRouteFeed(routeFeed);
+    freeConnectionScan(gConnectionScan);
+    freeLandmarkIndex(gLandmarks);
+    freeQueryCache(gQueryCache);
+    freeHierarchyQuery(gHierarchyQuery);
+    gHierarchy = nullptr;
+    freeCustomizedQuery(gCustomizedQuery);
+    freeHierarchyMetricCache(gMetricCache);
+    freeCustomizableHierarchy(gCustomizable);
+    freeSearchTrace(state.exploration);
     cout << "OceanRoute Nav UI closed.\n";
 }
@@ -9,6 +9,7 @@
 #include "AStarSearch.h"
 #include "MultiLegBuilder.h"
 #include "ShipAnimator.h"
+#include "ContractionHierarchy.h"
 #include <string>
 #include <SFML/Graphics.hpp>
 
@@ -164,7 +165,10 @@ enum UIStrategy {
     UI_DIJKSTRA_TIME = 1,
     UI_ASTAR_COST = 2,
     UI_ASTAR_TIME = 3,
-    UI_SAFEST = 4
+    UI_SAFEST = 4,
+    UI_CSA_COST = 5,
+    UI_CSA_TIME = 6,
+    UI_HIERARCHY_COST = 7
 };
 
 enum ViewMode {
@@ -252,6 +256,7 @@ struct UIState {
     StrategyResult fastestResult;
     StrategyResult astarResult;
     StrategyResult safestResult;
+    int paretoOptionCount;
 
     string statusMessage;
     bool isError;
@@ -321,11 +326,8 @@ struct UIState {
     float explorationAnimDuration;
     int explorationEdgesDrawn;
 
-    struct ExploredEdgeViz {
-        string fromPort;
-        string toPort;
-    };
-    ExploredEdgeViz exploredEdges[500];
+    // Every edge the last search explored, reused from search to search
+    SearchTrace exploration;
     int totalExploredEdges;
 
     float mapViewCenterX;
@@ -410,6 +412,7 @@ struct UIState {
         maxCost = 999999;
         maxLegs = 5;
         strategy = UI_DIJKSTRA_COST;
+        paretoOptionCount = 0;
         activeField = NONE;
         inputBuffer = "";
         hasResults = false;
@@ -538,7 +541,9 @@ struct UIState {
     }
 };
 
-void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager);
+// hierarchy answers the hierarchy strategy; it is rebuilt in place by the
+// first such search after the timetable changes
+void runOceanRouteNavUI(Graph& graph, JourneyManager& journeyManager, ContractionHierarchy& hierarchy);
 
 bool getPortCoords(const string& name, float& x, float& y);
 
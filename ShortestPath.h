@@ -4,8 +4,9 @@
 #include <string>
 #include "Graph.h"
 #include "Journey.h"
-#include "PriorityQueue.h"
+#include "SearchTrace.h"
 #include "RoutePreferences.h"
+#include "SearchKernel.h"
 
 using namespace std;
 
@@ -13,24 +14,34 @@ struct ShortestPathResult {
     bool found;
     int totalCost;
     int nodesExpanded;
+    int arrivalMinutes;
     BookedJourney journey;
 
-    struct ExploredEdge {
-        string fromPort;
-        string toPort;
-    };
-    ExploredEdge exploredEdges[500];
-    int exploredEdgeCount;
+    // Edges the search relaxes are recorded here when the caller attaches
+    // a trace; nullptr records nothing
+    SearchTrace* trace;
+    HeapCounters heapCounters;
 
-    ShortestPathResult() : found(false), totalCost(0), nodesExpanded(0), exploredEdgeCount(0) {
+    ShortestPathResult() : found(false), totalCost(0), nodesExpanded(0), arrivalMinutes(0), trace(nullptr) {
         initJourney(journey);
     }
 };
 
-void findCheapestRoute(Graph& g, const string& originPort, const string& destPort, ShortestPathResult& result);
+// Every search below runs in workspace, or in the calling thread's own
+// workspace when given none
+void findCheapestRoute(Graph& g, const string& originPort, const string& destPort, ShortestPathResult& result, SearchWorkspace* workspace = nullptr);
 
-void findCheapestRouteIgnoringDates(Graph& g, const string& originPort, const string& destPort, ShortestPathResult& result, int maxLegs = 15, const RoutePreferences* prefs = nullptr);
+// Both run on a BucketQueue unless queue says otherwise, falling back to
+// the heap when a fare or duration is too large (or negative) for buckets;
+// result.heapCounters.buckets tells which one ran
+void findCheapestRouteIgnoringDates(Graph& g, const string& originPort, const string& destPort, ShortestPathResult& result, int maxLegs = 15, const RoutePreferences* prefs = nullptr, SearchQueueKind queue = SEARCH_QUEUE_BUCKETS, SearchWorkspace* workspace = nullptr);
 
-void findFastestRouteIgnoringDates(Graph& g, const string& originPort, const string& destPort, ShortestPathResult& result, int maxLegs = 15, const RoutePreferences* prefs = nullptr);
+void findFastestRouteIgnoringDates(Graph& g, const string& originPort, const string& destPort, ShortestPathResult& result, int maxLegs = 15, const RoutePreferences* prefs = nullptr, SearchQueueKind queue = SEARCH_QUEUE_BUCKETS, SearchWorkspace* workspace = nullptr);
+
+// Earliest arrival at destPort leaving originPort no earlier than
+// departAfter. States live per port, so there is no cap on how much of the
+// timetable can be explored. result.arrivalMinutes holds the arrival in
+// epoch minutes; totalCost is the fare of that itinerary.
+void findEarliestArrival(Graph& g, const string& originPort, const string& destPort, const Date& departAfterDate, const Time& departAfterTime, ShortestPathResult& result, const RoutePreferences* prefs = nullptr, SearchWorkspace* workspace = nullptr);
 
 #endif
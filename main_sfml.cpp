@@ -1,14 +1,75 @@
 
 
 #include <iostream>
+#include <cstdlib>
 #include "Graph.h"
 #include "PortCharges.h"
+#include "GraphSnapshot.h"
 #include "JourneyManager.h"
 #include "SfmlApp.h"
+#include "SearchBenchmark.h"
+#include "ContractionHierarchy.h"
+#include "RouteMatrix.h"
 
 using namespace std;
 
-int main() {
+int main(int argc, char** argv) {
+    // --benchmark [ports] [sailings] times the dated engines on a synthetic
+    // timetable instead of opening the map
+    if (argc > 1 && string(argv[1]) == "--benchmark") {
+        SearchBenchmarkOptions options;
+        if (argc > 2) options.portCount = atoi(argv[2]);
+        if (argc > 3) options.sailingCount = atoi(argv[3]);
+        SearchBenchmarkReport report;
+        runSearchBenchmark(options, report);
+        printSearchBenchmarkReport(report);
+        return 0;
+    }
+
+    // --filtered-benchmark [ports] [sailings] [reach] times filtered fare
+    // queries on the customizable hierarchy against the filtered Dijkstra.
+    // Crossings stay within reach ports round the ring, as random ones
+    // would leave the hierarchy nearly every pair as an arc.
+    if (argc > 1 && string(argv[1]) == "--filtered-benchmark") {
+        SearchBenchmarkOptions options;
+        options.crossingReach = 20;
+        if (argc > 2) options.portCount = atoi(argv[2]);
+        if (argc > 3) options.sailingCount = atoi(argv[3]);
+        if (argc > 4) options.crossingReach = atoi(argv[4]);
+        FilteredBenchmarkReport report;
+        runFilteredBenchmark(options, report);
+        printFilteredBenchmarkReport(report);
+        return 0;
+    }
+
+    // --matrix-benchmark [ports] [sailings] [threads] times the all-pairs
+    // matrix build on 1, 2, 4, ... threads up to threads
+    if (argc > 1 && string(argv[1]) == "--matrix-benchmark") {
+        SearchBenchmarkOptions options;
+        options.portCount = 10000;
+        options.sailingCount = 100000;
+        if (argc > 2) options.portCount = atoi(argv[2]);
+        if (argc > 3) options.sailingCount = atoi(argv[3]);
+        int maxThreads = argc > 4 ? atoi(argv[4]) : 0;
+        MatrixBenchmarkReport report;
+        runMatrixBenchmark(options, maxThreads, report);
+        printMatrixBenchmarkReport(report);
+        return 0;
+    }
+
+    // --route-matrix <out> [threads] writes the all-pairs tariff matrix of
+    // the timetable to out once it is loaded, instead of opening the map
+    string matrixPath;
+    int matrixThreads = 0;
+    if (argc > 1 && string(argv[1]) == "--route-matrix") {
+        if (argc < 3) {
+            cout << "Usage: " << argv[0] << " --route-matrix <out> [threads]\n";
+            return 1;
+        }
+        matrixPath = argv[2];
+        if (argc > 3) matrixThreads = atoi(argv[3]);
+    }
+
     cout << "========================================\n";
     cout << " OceanRoute Nav - Maritime Navigation  \n";
     cout << " Optimizer (SFML World Map UI)         \n";
@@ -16,22 +77,65 @@ int main() {
 
     Graph graph;
 
-    cout << "Loading routes from Routes.txt...\n";
-    if (!loadRoutesFromFile(graph, "Routes.txt")) {
-        cout << "ERROR: Could not open Routes.txt\n";
-        cout << "Make sure Routes.txt is in the application directory.\n";
-        return 1;
+    PortChargeList portCharges;
+
+    // A snapshot written by an earlier run skips parsing entirely; it is
+    // rebuilt whenever Routes.txt or PortCharges.txt changes.
+    if (loadGraphSnapshot(graph, "Routes.snapshot", "Routes.txt", "PortCharges.txt")) {
+        cout << "  Loaded " << graph.portCount << " ports (port charges included).\n";
+    } else {
+        cout << "Loading routes from Routes.txt...\n";
+        if (!loadRoutesFromFile(graph, "Routes.txt")) {
+            cout << "ERROR: Could not open Routes.txt\n";
+            cout << "Make sure Routes.txt is in the application directory.\n";
+            return 1;
+        }
+        cout << "  Loaded " << graph.portCount << " ports.\n";
+
+        cout << "Loading port charges from PortCharges.txt...\n";
+        if (!loadPortChargesFromFile(portCharges, "PortCharges.txt")) {
+            cout << "Warning: Could not load PortCharges.txt (continuing without charges)\n";
+        } else {
+            applyPortChargesToGraph(portCharges, graph);
+            cout << "  Port charges applied.\n";
+        }
+
+        if (!saveGraphSnapshot(graph, "Routes.snapshot", "Routes.txt", "PortCharges.txt")) {
+            cout << "Warning: Could not write Routes.snapshot\n";
+        }
     }
-    cout << "  Loaded " << graph.portCount << " ports.\n";
+    printArenaReport(graph.arena, "  Graph arena");
 
-    PortChargeList portCharges;
+    if (!matrixPath.empty()) {
+        RouteMatrix matrix;
+        RouteMatrixStats matrixStats;
+        bool written = buildRouteMatrix(graph, matrix, matrixStats, matrixThreads) && saveRouteMatrix(matrix, matrixPath);
+        if (written) {
+            cout << "  ";
+            printRouteMatrixStats(matrixStats);
+            cout << "  Wrote " << matrixPath << "\n";
+        } else {
+            cout << "ERROR: Could not write " << matrixPath << "\n";
+        }
+        freeRouteMatrix(matrix);
+        clearPortChargeList(portCharges);
+        freeGraph(graph);
+        return written ? 0 : 1;
+    }
 
-    cout << "Loading port charges from PortCharges.txt...\n";
-    if (!loadPortChargesFromFile(portCharges, "PortCharges.txt")) {
-        cout << "Warning: Could not load PortCharges.txt (continuing without charges)\n";
+    // The hierarchy behind the hierarchy strategy is kept next to the
+    // snapshot; a file from another timetable is rebuilt and rewritten
+    ContractionHierarchy hierarchy;
+    if (loadContractionHierarchy(graph, hierarchy, "Routes.hierarchy")) {
+        cout << "  Loaded the contraction hierarchy (" << hierarchy.corePorts << " core port(s)).\n";
     } else {
-        applyPortChargesToGraph(portCharges, graph);
-        cout << "  Port charges applied.\n";
+        HierarchyStats hierarchyStats;
+        buildContractionHierarchy(graph, hierarchy, hierarchyStats);
+        cout << "  ";
+        printHierarchyStats(hierarchyStats);
+        if (!saveContractionHierarchy(hierarchy, "Routes.hierarchy")) {
+            cout << "Warning: Could not write Routes.hierarchy\n";
+        }
     }
     cout << "\n";
 
@@ -41,9 +145,10 @@ int main() {
     cout << "Backend initialized successfully.\n";
     cout << "Launching SFML World Map UI...\n\n";
 
-    runOceanRouteNavUI(graph, journeyManager);
+    runOceanRouteNavUI(graph, journeyManager, hierarchy);
 
     clearJourneyManager(journeyManager);
+    freeContractionHierarchy(hierarchy);
     clearPortChargeList(portCharges);
     freeGraph(graph);
 